@@ -41,7 +41,16 @@ const std::string Configuration::default_config_filename = "/etc/mct.cfg";
 Configuration::Configuration(int argc, char** argv)
  : m_argc(argc), m_argv(argv), m_app_name(m_argv[0]),
  m_log_silent(false), m_log_nofile(false), m_log_rotate(false),
- m_log_rotate_size(0), m_log_rotate_all_files_max_size(0), m_log_rotate_min_free_space(0)
+ m_log_rotate_size(0), m_log_rotate_all_files_max_size(0), m_log_rotate_min_free_space(0),
+ m_mode_proxy_shadow_buffer_size(0), m_mode_proxy_shadow_close_timeout(0), m_mode_proxy_capture_file_size(0), m_mode_proxy_capture_file_count(0),
+ m_mode_proxy_drain_timeout(0), m_mode_proxy_accept_batch_size(0), m_mode_proxy_affinity_table_size(0), m_mode_proxy_affinity_timeout(0),
+ m_mode_udp_session_timeout(0), m_mode_udp_batch_size(0), m_mode_udp_max_sessions(0), m_mode_udp_offload(false),
+ m_mode_replay_remote_port(0), m_mode_replay_speed(0),
+ m_mode_socks_resolver_cache_size(0), m_mode_socks_resolver_cache_ttl(0), m_mode_socks_resolver_timeout(0),
+ m_mode_http_resolver_cache_size(0), m_mode_http_resolver_cache_ttl(0), m_mode_http_resolver_timeout(0),
+ m_mode_tunnel_peer_port(0), m_mode_tunnel_connections(0), m_mode_tunnel_window(0),
+ m_mode_tls_session_cache_size(0), m_mode_tls_session_timeout(0), m_mode_tls_ktls(false),
+ m_mode_multiplex_backend_port(0), m_mode_multiplex_connections(0)
 {
 }
 
@@ -75,6 +75,104 @@ public:
     const std::vector<uint16_t>& get_mode_proxy_remote_ports() const { return m_mode_proxy_remote_ports; }
     const std::vector<std::string>& get_mode_proxy_local_hosts() const { return m_mode_proxy_local_hosts; }
     const std::vector<std::string>& get_mode_proxy_remote_hosts() const { return m_mode_proxy_remote_hosts; }
+    const std::vector<std::string>& get_mode_proxy_port_ranges() const { return m_mode_proxy_port_ranges; }
+    const std::vector<std::string>& get_mode_proxy_shadow_hosts() const { return m_mode_proxy_shadow_hosts; }
+    const std::vector<uint16_t>& get_mode_proxy_shadow_ports() const { return m_mode_proxy_shadow_ports; }
+    uint64_t get_mode_proxy_shadow_buffer_size() const { return m_mode_proxy_shadow_buffer_size; }
+    uint32_t get_mode_proxy_shadow_close_timeout() const { return m_mode_proxy_shadow_close_timeout; }
+    const std::vector<std::string>& get_mode_proxy_capture_files() const { return m_mode_proxy_capture_files; }
+    uint64_t get_mode_proxy_capture_file_size() const { return m_mode_proxy_capture_file_size; }
+    uint16_t get_mode_proxy_capture_file_count() const { return m_mode_proxy_capture_file_count; }
+    const std::string& get_mode_proxy_handoff_socket() const { return m_mode_proxy_handoff_socket; }
+    uint16_t get_mode_proxy_drain_timeout() const { return m_mode_proxy_drain_timeout; }
+    uint16_t get_mode_proxy_accept_batch_size() const { return m_mode_proxy_accept_batch_size; }
+    const std::vector<std::string>& get_mode_proxy_session_engines() const { return m_mode_proxy_session_engines; }
+    const std::vector<std::string>& get_mode_proxy_extra_backends() const { return m_mode_proxy_extra_backends; }
+    const std::vector<std::string>& get_mode_proxy_affinities() const { return m_mode_proxy_affinities; }
+    const std::vector<std::string>& get_mode_proxy_send_proxy_protocol() const { return m_mode_proxy_send_proxy_protocol; }
+    const std::vector<std::string>& get_mode_proxy_accept_proxy_protocol() const { return m_mode_proxy_accept_proxy_protocol; }
+    uint32_t get_mode_proxy_affinity_table_size() const { return m_mode_proxy_affinity_table_size; }
+    uint32_t get_mode_proxy_affinity_timeout() const { return m_mode_proxy_affinity_timeout; }
+    const std::vector<int>& get_mode_proxy_tcp_nodelay() const { return m_mode_proxy_tcp_nodelay; }
+    const std::vector<int>& get_mode_proxy_receive_buffer_size() const { return m_mode_proxy_receive_buffer_size; }
+    const std::vector<int>& get_mode_proxy_send_buffer_size() const { return m_mode_proxy_send_buffer_size; }
+    const std::vector<int>& get_mode_proxy_tcp_notsent_lowat() const { return m_mode_proxy_tcp_notsent_lowat; }
+    const std::vector<int>& get_mode_proxy_tcp_quickack() const { return m_mode_proxy_tcp_quickack; }
+    const std::vector<int>& get_mode_proxy_keepalive() const { return m_mode_proxy_keepalive; }
+    const std::vector<int>& get_mode_proxy_keepalive_idle() const { return m_mode_proxy_keepalive_idle; }
+    const std::vector<int>& get_mode_proxy_keepalive_interval() const { return m_mode_proxy_keepalive_interval; }
+    const std::vector<int>& get_mode_proxy_keepalive_count() const { return m_mode_proxy_keepalive_count; }
+    const std::vector<int>& get_mode_proxy_busy_poll() const { return m_mode_proxy_busy_poll; }
+    const std::vector<int>& get_mode_proxy_tcp_fastopen_connect() const { return m_mode_proxy_tcp_fastopen_connect; }
+    const std::vector<int>& get_mode_proxy_backlog() const { return m_mode_proxy_backlog; }
+    const std::vector<int>& get_mode_proxy_tcp_defer_accept() const { return m_mode_proxy_tcp_defer_accept; }
+    const std::vector<int>& get_mode_proxy_tcp_fastopen() const { return m_mode_proxy_tcp_fastopen; }
+
+    // ModeUdp module
+    const std::vector<uint16_t>& get_mode_udp_local_ports() const { return m_mode_udp_local_ports; }
+    const std::vector<uint16_t>& get_mode_udp_remote_ports() const { return m_mode_udp_remote_ports; }
+    const std::vector<std::string>& get_mode_udp_local_hosts() const { return m_mode_udp_local_hosts; }
+    const std::vector<std::string>& get_mode_udp_remote_hosts() const { return m_mode_udp_remote_hosts; }
+    uint16_t get_mode_udp_session_timeout() const { return m_mode_udp_session_timeout; }
+    uint16_t get_mode_udp_batch_size() const { return m_mode_udp_batch_size; }
+    uint32_t get_mode_udp_max_sessions() const { return m_mode_udp_max_sessions; }
+    bool get_mode_udp_offload() const { return m_mode_udp_offload; }
+
+    // ModeReplay module
+    const std::string& get_mode_replay_capture_file() const { return m_mode_replay_capture_file; }
+    const std::string& get_mode_replay_remote_host() const { return m_mode_replay_remote_host; }
+    uint16_t get_mode_replay_remote_port() const { return m_mode_replay_remote_port; }
+    uint16_t get_mode_replay_speed() const { return m_mode_replay_speed; }
+
+    // ModeSocks module
+    const std::vector<uint16_t>& get_mode_socks_local_ports() const { return m_mode_socks_local_ports; }
+    const std::vector<std::string>& get_mode_socks_local_hosts() const { return m_mode_socks_local_hosts; }
+    const std::string& get_mode_socks_username() const { return m_mode_socks_username; }
+    const std::string& get_mode_socks_password() const { return m_mode_socks_password; }
+    uint32_t get_mode_socks_resolver_cache_size() const { return m_mode_socks_resolver_cache_size; }
+    uint32_t get_mode_socks_resolver_cache_ttl() const { return m_mode_socks_resolver_cache_ttl; }
+    uint32_t get_mode_socks_resolver_timeout() const { return m_mode_socks_resolver_timeout; }
+
+    // ModeHttp module
+    const std::vector<uint16_t>& get_mode_http_local_ports() const { return m_mode_http_local_ports; }
+    const std::vector<std::string>& get_mode_http_local_hosts() const { return m_mode_http_local_hosts; }
+    const std::vector<std::string>& get_mode_http_allow() const { return m_mode_http_allow; }
+    uint32_t get_mode_http_resolver_cache_size() const { return m_mode_http_resolver_cache_size; }
+    uint32_t get_mode_http_resolver_cache_ttl() const { return m_mode_http_resolver_cache_ttl; }
+    uint32_t get_mode_http_resolver_timeout() const { return m_mode_http_resolver_timeout; }
+
+    // ModeSni module
+    const std::vector<uint16_t>& get_mode_sni_local_ports() const { return m_mode_sni_local_ports; }
+    const std::vector<std::string>& get_mode_sni_local_hosts() const { return m_mode_sni_local_hosts; }
+    const std::vector<std::string>& get_mode_sni_routes() const { return m_mode_sni_routes; }
+    const std::string& get_mode_sni_default_backend() const { return m_mode_sni_default_backend; }
+
+    // ModeTunnel module (tunnel_edge and tunnel_core)
+    const std::vector<std::string>& get_mode_tunnel_services() const { return m_mode_tunnel_services; }
+    const std::string& get_mode_tunnel_peer_host() const { return m_mode_tunnel_peer_host; }
+    uint16_t get_mode_tunnel_peer_port() const { return m_mode_tunnel_peer_port; }
+    uint16_t get_mode_tunnel_connections() const { return m_mode_tunnel_connections; }
+    uint32_t get_mode_tunnel_window() const { return m_mode_tunnel_window; }
+    const std::string& get_mode_tunnel_compression() const { return m_mode_tunnel_compression; }
+
+    // ModeTls module
+    const std::vector<uint16_t>& get_mode_tls_local_ports() const { return m_mode_tls_local_ports; }
+    const std::vector<uint16_t>& get_mode_tls_remote_ports() const { return m_mode_tls_remote_ports; }
+    const std::vector<std::string>& get_mode_tls_local_hosts() const { return m_mode_tls_local_hosts; }
+    const std::vector<std::string>& get_mode_tls_remote_hosts() const { return m_mode_tls_remote_hosts; }
+    const std::string& get_mode_tls_certificate() const { return m_mode_tls_certificate; }
+    const std::string& get_mode_tls_private_key() const { return m_mode_tls_private_key; }
+    uint32_t get_mode_tls_session_cache_size() const { return m_mode_tls_session_cache_size; }
+    uint32_t get_mode_tls_session_timeout() const { return m_mode_tls_session_timeout; }
+    bool get_mode_tls_ktls() const { return m_mode_tls_ktls; }
+
+    // ModeMultiplex module
+    const std::vector<uint16_t>& get_mode_multiplex_local_ports() const { return m_mode_multiplex_local_ports; }
+    const std::vector<std::string>& get_mode_multiplex_local_hosts() const { return m_mode_multiplex_local_hosts; }
+    const std::string& get_mode_multiplex_protocol() const { return m_mode_multiplex_protocol; }
+    const std::string& get_mode_multiplex_backend_host() const { return m_mode_multiplex_backend_host; }
+    uint16_t get_mode_multiplex_backend_port() const { return m_mode_multiplex_backend_port; }
+    uint16_t get_mode_multiplex_connections() const { return m_mode_multiplex_connections; }
 
     void set_config_filename(const std::string& filename) { m_config_filename = filename; }
     void set_app_mode(const std::string& mode) { m_mode = mode; }
@@ -120,6 +218,104 @@ protected:
     std::vector<std::string> m_mode_proxy_remote_hosts;
     std::vector<uint16_t> m_mode_proxy_local_ports;
     std::vector<uint16_t> m_mode_proxy_remote_ports;
+    std::vector<std::string> m_mode_proxy_port_ranges;
+    std::vector<std::string> m_mode_proxy_shadow_hosts;
+    std::vector<uint16_t> m_mode_proxy_shadow_ports;
+    uint64_t m_mode_proxy_shadow_buffer_size;
+    uint32_t m_mode_proxy_shadow_close_timeout;
+    std::vector<std::string> m_mode_proxy_capture_files;
+    uint64_t m_mode_proxy_capture_file_size;
+    uint16_t m_mode_proxy_capture_file_count;
+    std::string m_mode_proxy_handoff_socket;
+    uint16_t m_mode_proxy_drain_timeout;
+    uint16_t m_mode_proxy_accept_batch_size;
+    std::vector<std::string> m_mode_proxy_session_engines;
+    std::vector<std::string> m_mode_proxy_extra_backends;
+    std::vector<std::string> m_mode_proxy_affinities;
+    std::vector<std::string> m_mode_proxy_send_proxy_protocol;
+    std::vector<std::string> m_mode_proxy_accept_proxy_protocol;
+    uint32_t m_mode_proxy_affinity_table_size;
+    uint32_t m_mode_proxy_affinity_timeout;
+    std::vector<int> m_mode_proxy_tcp_nodelay;
+    std::vector<int> m_mode_proxy_receive_buffer_size;
+    std::vector<int> m_mode_proxy_send_buffer_size;
+    std::vector<int> m_mode_proxy_tcp_notsent_lowat;
+    std::vector<int> m_mode_proxy_tcp_quickack;
+    std::vector<int> m_mode_proxy_keepalive;
+    std::vector<int> m_mode_proxy_keepalive_idle;
+    std::vector<int> m_mode_proxy_keepalive_interval;
+    std::vector<int> m_mode_proxy_keepalive_count;
+    std::vector<int> m_mode_proxy_busy_poll;
+    std::vector<int> m_mode_proxy_tcp_fastopen_connect;
+    std::vector<int> m_mode_proxy_backlog;
+    std::vector<int> m_mode_proxy_tcp_defer_accept;
+    std::vector<int> m_mode_proxy_tcp_fastopen;
+
+    // ModeUdp module
+    std::vector<std::string> m_mode_udp_local_hosts;
+    std::vector<std::string> m_mode_udp_remote_hosts;
+    std::vector<uint16_t> m_mode_udp_local_ports;
+    std::vector<uint16_t> m_mode_udp_remote_ports;
+    uint16_t m_mode_udp_session_timeout;
+    uint16_t m_mode_udp_batch_size;
+    uint32_t m_mode_udp_max_sessions;
+    bool m_mode_udp_offload;
+
+    // ModeReplay module
+    std::string m_mode_replay_capture_file;
+    std::string m_mode_replay_remote_host;
+    uint16_t m_mode_replay_remote_port;
+    uint16_t m_mode_replay_speed;
+
+    // ModeSocks module
+    std::vector<std::string> m_mode_socks_local_hosts;
+    std::vector<uint16_t> m_mode_socks_local_ports;
+    std::string m_mode_socks_username;
+    std::string m_mode_socks_password;
+    uint32_t m_mode_socks_resolver_cache_size;
+    uint32_t m_mode_socks_resolver_cache_ttl;
+    uint32_t m_mode_socks_resolver_timeout;
+
+    // ModeHttp module
+    std::vector<std::string> m_mode_http_local_hosts;
+    std::vector<uint16_t> m_mode_http_local_ports;
+    std::vector<std::string> m_mode_http_allow;
+    uint32_t m_mode_http_resolver_cache_size;
+    uint32_t m_mode_http_resolver_cache_ttl;
+    uint32_t m_mode_http_resolver_timeout;
+
+    // ModeSni module
+    std::vector<std::string> m_mode_sni_local_hosts;
+    std::vector<uint16_t> m_mode_sni_local_ports;
+    std::vector<std::string> m_mode_sni_routes;
+    std::string m_mode_sni_default_backend;
+
+    // ModeTunnel module
+    std::vector<std::string> m_mode_tunnel_services;
+    std::string m_mode_tunnel_peer_host;
+    uint16_t m_mode_tunnel_peer_port;
+    uint16_t m_mode_tunnel_connections;
+    uint32_t m_mode_tunnel_window;
+    std::string m_mode_tunnel_compression;
+
+    // ModeTls module
+    std::vector<std::string> m_mode_tls_local_hosts;
+    std::vector<std::string> m_mode_tls_remote_hosts;
+    std::vector<uint16_t> m_mode_tls_local_ports;
+    std::vector<uint16_t> m_mode_tls_remote_ports;
+    std::string m_mode_tls_certificate;
+    std::string m_mode_tls_private_key;
+    uint32_t m_mode_tls_session_cache_size;
+    uint32_t m_mode_tls_session_timeout;
+    bool m_mode_tls_ktls;
+
+    // ModeMultiplex module
+    std::vector<std::string> m_mode_multiplex_local_hosts;
+    std::vector<uint16_t> m_mode_multiplex_local_ports;
+    std::string m_mode_multiplex_protocol;
+    std::string m_mode_multiplex_backend_host;
+    uint16_t m_mode_multiplex_backend_port;
+    uint16_t m_mode_multiplex_connections;
 };
 
 }
@@ -125,7 +125,7 @@ bool ConfigurationBuilder::setup_config_fields(
         po_config.add_options()
             ("mode", po::value<std::string>(&m_config.m_mode)->default_value("proxy"),
                   "specifies the way the application is going to operate\n"
-                  "possible modes: proxy")
+                  "possible modes: proxy, udp, replay, socks5, http_connect, sni, tunnel_edge, tunnel_core, tls (when built with OpenSSL), multiplex")
             ("log.silent", po::value<bool>(&m_config.m_log_silent)->default_value(false),
                   "should logger be completely silent")
             ("log.nofile", po::value<bool>(&m_config.m_log_nofile)->default_value(false),
@@ -163,9 +163,219 @@ bool ConfigurationBuilder::setup_config_fields(
             ("mode.proxy.remote_port", po::value< std::vector<uint16_t> >(&m_config.m_mode_proxy_remote_ports)->multitoken()->default_value(std::vector<uint16_t>(), "80"),
                   "a set of remote ports to send to in proxy mode, separated by spaces")
             ("mode.proxy.local_host", po::value< std::vector<std::string> >(&m_config.m_mode_proxy_local_hosts)->multitoken()->default_value(std::vector<std::string>(), "localhost"),
-                  "a set of local interfaces to bind to in proxy mode, separated by spaces")
+                  "a set of local interfaces to bind to in proxy mode, separated by spaces;\n"
+                  "unix:/path (or unix:@name in the abstract namespace) listens on a Unix domain socket, its port is ignored")
             ("mode.proxy.remote_host", po::value< std::vector<std::string> >(&m_config.m_mode_proxy_remote_hosts)->multitoken()->default_value(std::vector<std::string>(), "127.0.0.1"),
-                  "a set of remote hosts to send to in proxy mode, separated by spaces")
+                  "a set of remote hosts to send to in proxy mode, separated by spaces;\n"
+                  "unix:/path (or unix:@name in the abstract namespace) connects to a Unix domain socket, its port is ignored")
+            ("mode.proxy.port_range", po::value< std::vector<std::string> >(&m_config.m_mode_proxy_port_ranges)->multitoken()->default_value(std::vector<std::string>(), ""),
+                  "a set of rules forwarding whole port ranges in proxy mode, separated by spaces: local_host:first-last=remote_host:first[-last];\n"
+                  "each local port goes to its counterpart in the remote range (of the same length) or to the single remote port.\n"
+                  "Rules are listeners numbered after the ones of mode.proxy.local_host for per-listener options")
+            ("mode.proxy.shadow_host", po::value< std::vector<std::string> >(&m_config.m_mode_proxy_shadow_hosts)->multitoken()->default_value(std::vector<std::string>(), "none"),
+                  "a set of shadow hosts which receive a copy of client traffic (responses are discarded) in proxy mode,\n"
+                  "one entry for all listeners or one per listener, 'none' disables shadowing")
+            ("mode.proxy.shadow_port", po::value< std::vector<uint16_t> >(&m_config.m_mode_proxy_shadow_ports)->multitoken()->default_value(std::vector<uint16_t>(), ""),
+                  "a set of shadow ports, one entry for all listeners or one per listener")
+            ("mode.proxy.shadow_buffer_size", po::value<uint64_t>(&m_config.m_mode_proxy_shadow_buffer_size)->default_value(262144),
+                  "maximum number of bytes queued for the shadow host per session,\n"
+                  "traffic exceeding it is dropped (and counted) instead of slowing down the session")
+            ("mode.proxy.shadow_close_timeout", po::value<uint32_t>(&m_config.m_mode_proxy_shadow_close_timeout)->default_value(5000),
+                  "time (in milliseconds) a closed session waits for its queued shadow traffic to be written,\n"
+                  "afterwards the shadow connection is closed and the bytes still queued are dropped (and counted)")
+            ("mode.proxy.capture_file", po::value< std::vector<std::string> >(&m_config.m_mode_proxy_capture_files)->multitoken()->default_value(std::vector<std::string>(), "none"),
+                  "a set of capture file prefixes, one entry for all listeners or one per listener, 'none' disables capturing;\n"
+                  "traffic is stored in <prefix>.0 ... <prefix>.<capture_file_count - 1> memory-mapped files, the oldest file is overwritten first")
+            ("mode.proxy.capture_file_size", po::value<uint64_t>(&m_config.m_mode_proxy_capture_file_size)->default_value(67108864),
+                  "size (in bytes) of a single capture file")
+            ("mode.proxy.capture_file_count", po::value<uint16_t>(&m_config.m_mode_proxy_capture_file_count)->default_value(4),
+                  "number of capture files in the ring")
+            ("mode.proxy.handoff_socket", po::value<std::string>(&m_config.m_mode_proxy_handoff_socket)->default_value("none"),
+                  "path of a unix domain socket used for upgrades without downtime, 'none' disables it;\n"
+                  "a starting instance takes the listening sockets over from the instance serving this path,\n"
+                  "which then stops accepting and drains its sessions")
+            ("mode.proxy.drain_timeout", po::value<uint16_t>(&m_config.m_mode_proxy_drain_timeout)->default_value(30),
+                  "number of seconds established sessions are given to finish when the instance stops accepting,\n"
+                  "sessions still running afterwards are closed")
+            ("mode.proxy.accept_batch_size", po::value<uint16_t>(&m_config.m_mode_proxy_accept_batch_size)->default_value(64),
+                  "maximum number of connections a listener accepts each time it is woken up,\n"
+                  "1 accepts a single connection per wake-up")
+            ("mode.proxy.session_engine", po::value< std::vector<std::string> >(&m_config.m_mode_proxy_session_engines)->multitoken()->default_value(std::vector<std::string>(), "callback"),
+                  "a set of session implementations, one entry for all listeners or one per listener:\n"
+                  "'callback' chains read and write handlers, 'coroutine' runs a stackless coroutine per direction")
+            ("mode.proxy.extra_backends", po::value< std::vector<std::string> >(&m_config.m_mode_proxy_extra_backends)->multitoken()->default_value(std::vector<std::string>(), "none"),
+                  "a set of backend lists, one entry for all listeners or one per listener, 'none' uses only the remote host;\n"
+                  "every entry is a comma separated list of host:port, new sessions take turns between the remote host and these backends")
+            ("mode.proxy.affinity", po::value< std::vector<std::string> >(&m_config.m_mode_proxy_affinities)->multitoken()->default_value(std::vector<std::string>(), "none"),
+                  "a set of client affinities for listeners with extra backends, one entry for all listeners or one per listener:\n"
+                  "'ip' sends a client to the backend it used first, 'prefix' does the same for whole /24 (IPv6: /64) networks, 'none' disables it")
+            ("mode.proxy.send_proxy_protocol", po::value< std::vector<std::string> >(&m_config.m_mode_proxy_send_proxy_protocol)->multitoken()->default_value(std::vector<std::string>(), "none"),
+                  "a set of PROXY protocol versions sent to the backends, one entry for all listeners or one per listener:\n"
+                  "'v1' (text) or 'v2' (binary) tells the backend the address of the client, 'none' disables it")
+            ("mode.proxy.accept_proxy_protocol", po::value< std::vector<std::string> >(&m_config.m_mode_proxy_accept_proxy_protocol)->multitoken()->default_value(std::vector<std::string>(), "none"),
+                  "a set of PROXY protocol versions required from the clients (i.e. a load balancer), one entry for all listeners or one per listener:\n"
+                  "'v1', 'v2' or 'any' - connections without a valid header are closed, 'none' disables it")
+            ("mode.proxy.affinity_table_size", po::value<uint32_t>(&m_config.m_mode_proxy_affinity_table_size)->default_value(65536),
+                  "maximum number of clients (or networks) remembered by the affinity table of a listener,\n"
+                  "the least recently used one is forgotten when there is no room")
+            ("mode.proxy.affinity_timeout", po::value<uint32_t>(&m_config.m_mode_proxy_affinity_timeout)->default_value(1800),
+                  "number of seconds after which a client which has not connected again is forgotten by the affinity table")
+            ("mode.proxy.tcp_nodelay", po::value< std::vector<int> >(&m_config.m_mode_proxy_tcp_nodelay)->multitoken()->default_value(std::vector<int>(), "-1"),
+                  "1 disables Nagle's algorithm (lower latency), 0 enables it (fewer, larger segments),\n"
+                  "one entry for all listeners or one per listener, -1 keeps the system default")
+            ("mode.proxy.receive_buffer_size", po::value< std::vector<int> >(&m_config.m_mode_proxy_receive_buffer_size)->multitoken()->default_value(std::vector<int>(), "-1"),
+                  "size (in bytes) of the kernel receive buffer (SO_RCVBUF) of the listening and session sockets,\n"
+                  "one entry for all listeners or one per listener, -1 keeps the system default")
+            ("mode.proxy.send_buffer_size", po::value< std::vector<int> >(&m_config.m_mode_proxy_send_buffer_size)->multitoken()->default_value(std::vector<int>(), "-1"),
+                  "size (in bytes) of the kernel send buffer (SO_SNDBUF) of the listening and session sockets,\n"
+                  "one entry for all listeners or one per listener, -1 keeps the system default")
+            ("mode.proxy.tcp_notsent_lowat", po::value< std::vector<int> >(&m_config.m_mode_proxy_tcp_notsent_lowat)->multitoken()->default_value(std::vector<int>(), "-1"),
+                  "maximum number of unsent bytes (TCP_NOTSENT_LOWAT) queued in the kernel before the socket stops being writable,\n"
+                  "one entry for all listeners or one per listener, -1 keeps the system default")
+            ("mode.proxy.tcp_quickack", po::value< std::vector<int> >(&m_config.m_mode_proxy_tcp_quickack)->multitoken()->default_value(std::vector<int>(), "-1"),
+                  "1 acknowledges segments immediately at the start of a connection (TCP_QUICKACK), 0 allows delayed acknowledgements,\n"
+                  "one entry for all listeners or one per listener, -1 keeps the system default")
+            ("mode.proxy.keepalive", po::value< std::vector<int> >(&m_config.m_mode_proxy_keepalive)->multitoken()->default_value(std::vector<int>(), "-1"),
+                  "1 enables TCP keepalive probes (SO_KEEPALIVE) on session sockets, 0 disables them,\n"
+                  "one entry for all listeners or one per listener, -1 keeps the system default")
+            ("mode.proxy.keepalive_idle", po::value< std::vector<int> >(&m_config.m_mode_proxy_keepalive_idle)->multitoken()->default_value(std::vector<int>(), "-1"),
+                  "number of idle seconds before the first keepalive probe is sent (TCP_KEEPIDLE),\n"
+                  "one entry for all listeners or one per listener, -1 keeps the system default")
+            ("mode.proxy.keepalive_interval", po::value< std::vector<int> >(&m_config.m_mode_proxy_keepalive_interval)->multitoken()->default_value(std::vector<int>(), "-1"),
+                  "number of seconds between keepalive probes (TCP_KEEPINTVL),\n"
+                  "one entry for all listeners or one per listener, -1 keeps the system default")
+            ("mode.proxy.keepalive_count", po::value< std::vector<int> >(&m_config.m_mode_proxy_keepalive_count)->multitoken()->default_value(std::vector<int>(), "-1"),
+                  "number of unanswered keepalive probes after which the connection is dropped (TCP_KEEPCNT),\n"
+                  "one entry for all listeners or one per listener, -1 keeps the system default")
+            ("mode.proxy.busy_poll", po::value< std::vector<int> >(&m_config.m_mode_proxy_busy_poll)->multitoken()->default_value(std::vector<int>(), "-1"),
+                  "number of microseconds to busy poll the device queue on blocking reads (SO_BUSY_POLL),\n"
+                  "one entry for all listeners or one per listener, -1 keeps the system default")
+            ("mode.proxy.tcp_fastopen_connect", po::value< std::vector<int> >(&m_config.m_mode_proxy_tcp_fastopen_connect)->multitoken()->default_value(std::vector<int>(), "-1"),
+                  "1 sends the first client bytes with SYN when connecting to the remote endpoint (TCP_FASTOPEN_CONNECT),\n"
+                  "one entry for all listeners or one per listener, -1 keeps the system default")
+            ("mode.proxy.backlog", po::value< std::vector<int> >(&m_config.m_mode_proxy_backlog)->multitoken()->default_value(std::vector<int>(), "-1"),
+                  "length of the queue of connections waiting to be accepted, -1 uses the system maximum,\n"
+                  "one entry for all listeners or one per listener")
+            ("mode.proxy.tcp_defer_accept", po::value< std::vector<int> >(&m_config.m_mode_proxy_tcp_defer_accept)->multitoken()->default_value(std::vector<int>(), "-1"),
+                  "number of seconds a connection is kept from being accepted until the client sends data (TCP_DEFER_ACCEPT),\n"
+                  "one entry for all listeners or one per listener, -1 keeps the system default")
+            ("mode.proxy.tcp_fastopen", po::value< std::vector<int> >(&m_config.m_mode_proxy_tcp_fastopen)->multitoken()->default_value(std::vector<int>(), "-1"),
+                  "length of the queue of connections which sent data with SYN (TCP_FASTOPEN) on the listening socket,\n"
+                  "one entry for all listeners or one per listener, -1 keeps the system default")
+            ("mode.udp.local_port", po::value< std::vector<uint16_t> >(&m_config.m_mode_udp_local_ports)->multitoken()->default_value(std::vector<uint16_t>(), "5353"),
+                  "a set of local ports to bind to in udp mode, separated by spaces")
+            ("mode.udp.remote_port", po::value< std::vector<uint16_t> >(&m_config.m_mode_udp_remote_ports)->multitoken()->default_value(std::vector<uint16_t>(), "53"),
+                  "a set of remote ports to send to in udp mode, separated by spaces")
+            ("mode.udp.local_host", po::value< std::vector<std::string> >(&m_config.m_mode_udp_local_hosts)->multitoken()->default_value(std::vector<std::string>(), "localhost"),
+                  "a set of local interfaces to bind to in udp mode, separated by spaces")
+            ("mode.udp.remote_host", po::value< std::vector<std::string> >(&m_config.m_mode_udp_remote_hosts)->multitoken()->default_value(std::vector<std::string>(), "127.0.0.1"),
+                  "a set of remote hosts to send to in udp mode, separated by spaces")
+            ("mode.udp.session_timeout", po::value<uint16_t>(&m_config.m_mode_udp_session_timeout)->default_value(60),
+                  "number of seconds without traffic after which a client session is expired in udp mode")
+            ("mode.udp.batch_size", po::value<uint16_t>(&m_config.m_mode_udp_batch_size)->default_value(32),
+                  "maximum number of datagrams received or sent with a single system call in udp mode")
+            ("mode.udp.max_sessions", po::value<uint32_t>(&m_config.m_mode_udp_max_sessions)->default_value(65536),
+                  "maximum number of client sessions (each with its own socket) of a single relay in udp mode,\n"
+                  "datagrams of new clients are dropped until a session expires, 0 means no limit")
+            ("mode.udp.offload", po::value<bool>(&m_config.m_mode_udp_offload)->default_value(true),
+                  "receive datagram trains coalesced by the kernel (UDP GRO) and send them on with segmentation offload (UDP GSO)\n"
+                  "where the kernel allows it (Linux 5.0 or newer), datagrams are relayed one by one otherwise")
+            ("mode.replay.capture_file", po::value<std::string>(&m_config.m_mode_replay_capture_file)->default_value("capture"),
+                  "prefix of the capture files (written by mode.proxy.capture_file) to replay in replay mode")
+            ("mode.replay.remote_host", po::value<std::string>(&m_config.m_mode_replay_remote_host)->default_value("127.0.0.1"),
+                  "remote host which receives the replayed traffic in replay mode")
+            ("mode.replay.remote_port", po::value<uint16_t>(&m_config.m_mode_replay_remote_port)->default_value(80),
+                  "remote port which receives the replayed traffic in replay mode")
+            ("mode.replay.speed", po::value<uint16_t>(&m_config.m_mode_replay_speed)->default_value(1),
+                  "replay speed multiplier in replay mode: 1 keeps the captured timing, N replays N times faster,\n"
+                  "0 sends the traffic as fast as possible")
+            ("mode.socks.local_port", po::value< std::vector<uint16_t> >(&m_config.m_mode_socks_local_ports)->multitoken()->default_value(std::vector<uint16_t>(), "1080"),
+                  "a set of local ports to bind to in socks5 mode, separated by spaces")
+            ("mode.socks.local_host", po::value< std::vector<std::string> >(&m_config.m_mode_socks_local_hosts)->multitoken()->default_value(std::vector<std::string>(), "localhost"),
+                  "a set of local interfaces to bind to in socks5 mode, separated by spaces")
+            ("mode.socks.username", po::value<std::string>(&m_config.m_mode_socks_username)->default_value("none"),
+                  "username required from clients (username/password authentication) in socks5 mode,\n"
+                  "'none' lets clients connect without authentication")
+            ("mode.socks.password", po::value<std::string>(&m_config.m_mode_socks_password)->default_value(""),
+                  "password required from clients together with mode.socks.username in socks5 mode")
+            ("mode.socks.resolver_cache_size", po::value<uint32_t>(&m_config.m_mode_socks_resolver_cache_size)->default_value(4096),
+                  "maximum number of host names whose addresses are remembered in socks5 mode")
+            ("mode.socks.resolver_cache_ttl", po::value<uint32_t>(&m_config.m_mode_socks_resolver_cache_ttl)->default_value(60),
+                  "number of seconds the addresses of a host name are remembered in socks5 mode, 0 resolves every request")
+            ("mode.socks.resolver_timeout", po::value<uint32_t>(&m_config.m_mode_socks_resolver_timeout)->default_value(5),
+                  "number of seconds a client waits for the addresses of its destination in socks5 mode, 0 waits for ever")
+            ("mode.http.local_port", po::value< std::vector<uint16_t> >(&m_config.m_mode_http_local_ports)->multitoken()->default_value(std::vector<uint16_t>(), "3128"),
+                  "a set of local ports to bind to in http_connect mode, separated by spaces")
+            ("mode.http.local_host", po::value< std::vector<std::string> >(&m_config.m_mode_http_local_hosts)->multitoken()->default_value(std::vector<std::string>(), "localhost"),
+                  "a set of local interfaces to bind to in http_connect mode, separated by spaces")
+            ("mode.http.allow", po::value< std::vector<std::string> >(&m_config.m_mode_http_allow)->multitoken()->default_value(std::vector<std::string>(1, "*:443"), "*:443"),
+                  "destinations which CONNECT requests are allowed to in http_connect mode, separated by spaces;\n"
+                  "every one is host:port, where host is a name, an address ([addr] for IPv6), *.domain or *,\n"
+                  "and port is a number, a range from-to or *")
+            ("mode.http.resolver_cache_size", po::value<uint32_t>(&m_config.m_mode_http_resolver_cache_size)->default_value(4096),
+                  "maximum number of host names whose addresses are remembered in http_connect mode")
+            ("mode.http.resolver_cache_ttl", po::value<uint32_t>(&m_config.m_mode_http_resolver_cache_ttl)->default_value(60),
+                  "number of seconds the addresses of a host name are remembered in http_connect mode, 0 resolves every request")
+            ("mode.http.resolver_timeout", po::value<uint32_t>(&m_config.m_mode_http_resolver_timeout)->default_value(5),
+                  "number of seconds a client waits for the addresses of its destination in http_connect mode, 0 waits for ever")
+            ("mode.sni.local_port", po::value< std::vector<uint16_t> >(&m_config.m_mode_sni_local_ports)->multitoken()->default_value(std::vector<uint16_t>(), "443"),
+                  "a set of local ports to bind to in sni mode, separated by spaces")
+            ("mode.sni.local_host", po::value< std::vector<std::string> >(&m_config.m_mode_sni_local_hosts)->multitoken()->default_value(std::vector<std::string>(), "localhost"),
+                  "a set of local interfaces to bind to in sni mode, separated by spaces")
+            ("mode.sni.route", po::value< std::vector<std::string> >(&m_config.m_mode_sni_routes)->multitoken()->default_value(std::vector<std::string>(), ""),
+                  "server names and their backends in sni mode, separated by spaces; every one is server_name=host:port,\n"
+                  "where server_name is a name or *.domain (matching a single label in front of domain)")
+            ("mode.sni.default_backend", po::value<std::string>(&m_config.m_mode_sni_default_backend)->default_value("none"),
+                  "host:port which receives clients whose server name has no route (or who send none) in sni mode,\n"
+                  "'none' refuses them")
+            ("mode.tunnel.service", po::value< std::vector<std::string> >(&m_config.m_mode_tunnel_services)->multitoken()->default_value(std::vector<std::string>(), ""),
+                  "services carried by the tunnel, separated by spaces; every one is name=host:port - the local endpoint\n"
+                  "clients connect to in tunnel_edge mode, the backend the streams are forwarded to in tunnel_core mode")
+            ("mode.tunnel.peer_host", po::value<std::string>(&m_config.m_mode_tunnel_peer_host)->default_value("localhost"),
+                  "the core to connect to in tunnel_edge mode, the interface to accept edges on in tunnel_core mode")
+            ("mode.tunnel.peer_port", po::value<uint16_t>(&m_config.m_mode_tunnel_peer_port)->default_value(7000),
+                  "port of the core in tunnel_edge mode, the port to accept edges on in tunnel_core mode")
+            ("mode.tunnel.connections", po::value<uint16_t>(&m_config.m_mode_tunnel_connections)->default_value(4),
+                  "number of long-lived connections the edge keeps to the core, all the streams are spread over them")
+            ("mode.tunnel.window", po::value<uint32_t>(&m_config.m_mode_tunnel_window)->default_value(262144),
+                  "number of bytes the peer may send on a stream before they are passed on (stream flow-control window),\n"
+                  "a stream buffers up to this much; one stream gets at most window / round-trip time through a high-latency link")
+            ("mode.tunnel.compression", po::value<std::string>(&m_config.m_mode_tunnel_compression)->default_value("none"),
+                  "codec which compresses the data this end sends to the peer: none, lz4 (fast) or zstd (smaller); both ends may choose\n"
+                  "differently. Streams which do not compress (e.g. TLS) are sampled and sent as they are most of the time")
+#if defined(MCT_WITH_OPENSSL)
+            ("mode.tls.local_port", po::value< std::vector<uint16_t> >(&m_config.m_mode_tls_local_ports)->multitoken()->default_value(std::vector<uint16_t>(), "443"),
+                  "a set of local ports to accept TLS clients on in tls mode, separated by spaces")
+            ("mode.tls.local_host", po::value< std::vector<std::string> >(&m_config.m_mode_tls_local_hosts)->multitoken()->default_value(std::vector<std::string>(), "localhost"),
+                  "a set of local interfaces to accept TLS clients on in tls mode, separated by spaces")
+            ("mode.tls.remote_port", po::value< std::vector<uint16_t> >(&m_config.m_mode_tls_remote_ports)->multitoken()->default_value(std::vector<uint16_t>(), "80"),
+                  "a set of backend ports which receive the plain data in tls mode, one per local port, separated by spaces")
+            ("mode.tls.remote_host", po::value< std::vector<std::string> >(&m_config.m_mode_tls_remote_hosts)->multitoken()->default_value(std::vector<std::string>(), "localhost"),
+                  "a set of backend hosts which receive the plain data in tls mode, one per local host, separated by spaces")
+            ("mode.tls.certificate", po::value<std::string>(&m_config.m_mode_tls_certificate)->default_value(""),
+                  "PEM file with the certificate (followed by its chain) which every listener presents in tls mode")
+            ("mode.tls.private_key", po::value<std::string>(&m_config.m_mode_tls_private_key)->default_value(""),
+                  "PEM file with the private key of mode.tls.certificate")
+            ("mode.tls.session_cache_size", po::value<uint32_t>(&m_config.m_mode_tls_session_cache_size)->default_value(20480),
+                  "maximum number of sessions clients can resume in tls mode, shared by all the listeners")
+            ("mode.tls.session_timeout", po::value<uint32_t>(&m_config.m_mode_tls_session_timeout)->default_value(300),
+                  "number of seconds a session (cached or in a ticket) can be resumed for in tls mode")
+            ("mode.tls.ktls", po::value<bool>(&m_config.m_mode_tls_ktls)->default_value(true),
+                  "move the record encryption to the kernel (kTLS) after the handshake where the kernel and the cipher allow it,\n"
+                  "sessions which cannot encrypt in the kernel do it in user space")
+#endif
+            ("mode.multiplex.local_port", po::value< std::vector<uint16_t> >(&m_config.m_mode_multiplex_local_ports)->multitoken()->default_value(std::vector<uint16_t>(), "6379"),
+                  "a set of local ports to accept cache clients on in multiplex mode, separated by spaces")
+            ("mode.multiplex.local_host", po::value< std::vector<std::string> >(&m_config.m_mode_multiplex_local_hosts)->multitoken()->default_value(std::vector<std::string>(), "localhost"),
+                  "a set of local interfaces to accept cache clients on in multiplex mode, separated by spaces")
+            ("mode.multiplex.protocol", po::value<std::string>(&m_config.m_mode_multiplex_protocol)->default_value("redis"),
+                  "protocol the clients and the backend speak in multiplex mode: redis (RESP) or memcached (text protocol)")
+            ("mode.multiplex.backend_host", po::value<std::string>(&m_config.m_mode_multiplex_backend_host)->default_value("localhost"),
+                  "cache server which all the clients share in multiplex mode")
+            ("mode.multiplex.backend_port", po::value<uint16_t>(&m_config.m_mode_multiplex_backend_port)->default_value(6379),
+                  "port of mode.multiplex.backend_host")
+            ("mode.multiplex.connections", po::value<uint16_t>(&m_config.m_mode_multiplex_connections)->default_value(4),
+                  "number of persistent backend connections the requests of all the clients are pipelined over in multiplex mode")
             ;
 
         // Hidden options allowed with the command line and the config file
@@ -289,7 +499,7 @@ void ConfigurationBuilder::build_generate_message(std::string& msg, po::options_
         cfgFile << "#" << std::endl;
 
         std::string comment(std::string("# ") + opt->description());
-        int iPos = comment.find(newline);
+        std::string::size_type iPos = comment.find(newline);
 
         while (iPos != std::string::npos) {
             comment.replace(iPos++, 1, newline + std::string("# "));
@@ -328,7 +538,7 @@ template < typename T >
 std::ostream& operator<<(std::ostream& stream, const std::vector<T>& vect)
 {
     for (auto it = vect.begin(); it != vect.end(); ++it) {
-        if (std::distance(vect.begin(), it) == vect.size() - 1) {
+        if (static_cast<size_t>(std::distance(vect.begin(), it)) == vect.size() - 1) {
             stream << *it;
         } else {
             stream << *it << " ";
@@ -96,6 +96,7 @@ public:
 
     bool initialize(std::string& msg);
     void print_helper(va_list& args, const char* format, severity_level level);
+    void flush();
 
 protected:
     Configuration& m_config;
@@ -167,6 +168,11 @@ void Logger::log_if_not_silent(const char* format, ...)
     va_end(args);
 }
 
+void Logger::flush()
+{
+    m_pImpl->flush();
+}
+
 template <typename T>
 void formatting_setup(boost::shared_ptr<T>& pSink, const std::string& log_format, const std::string& severity)
 {
@@ -311,4 +317,9 @@ void LoggerImpl::print_helper(va_list& args, const char* format, severity_level
     BOOST_LOG_SEV(m_log, level) << format << "[LoggerImpl::print_helper] write error!";
 }
 
+void LoggerImpl::flush()
+{
+    logging::core::get()->flush();
+}
+
 }
@@ -59,6 +59,11 @@ public:
 
     void log_if_not_silent(const char* format, ...);
 
+    /**
+     * Writes out everything buffered by the sinks (e.g. before the program exits).
+     */
+    void flush();
+
 private:
     LoggerImpl* m_pImpl;
 };
@@ -33,6 +33,17 @@
 #include <Configuration/Configuration.hpp>
 
 #include <ModeProxy/ModeProxy.hpp>
+#include <ModeUdp/ModeUdp.hpp>
+#include <ModeReplay/ModeReplay.hpp>
+#include <ModeSocks/ModeSocks.hpp>
+#include <ModeHttp/ModeHttp.hpp>
+#include <ModeSni/ModeSni.hpp>
+#include <ModeTunnel/ModeTunnelEdge.hpp>
+#include <ModeTunnel/ModeTunnelCore.hpp>
+#if defined(MCT_WITH_OPENSSL)
+#include <ModeTls/ModeTls.hpp>
+#endif
+#include <ModeMultiplex/ModeMultiplex.hpp>
 
 namespace mct
 {
@@ -49,6 +60,26 @@ Mode* ModeFactory::create(const std::string& mode)
 {
 	if (mode == "proxy") {
 		return new ModeProxy(m_config, m_log);
+	} else if (mode == "udp") {
+		return new ModeUdp(m_config, m_log);
+	} else if (mode == "replay") {
+		return new ModeReplay(m_config, m_log);
+	} else if (mode == "socks5") {
+		return new ModeSocks(m_config, m_log);
+	} else if (mode == "http_connect") {
+		return new ModeHttp(m_config, m_log);
+	} else if (mode == "sni") {
+		return new ModeSni(m_config, m_log);
+	} else if (mode == "tunnel_edge") {
+		return new ModeTunnelEdge(m_config, m_log);
+	} else if (mode == "tunnel_core") {
+		return new ModeTunnelCore(m_config, m_log);
+#if defined(MCT_WITH_OPENSSL)
+	} else if (mode == "tls") {
+		return new ModeTls(m_config, m_log);
+#endif
+	} else if (mode == "multiplex") {
+		return new ModeMultiplex(m_config, m_log);
 	}
 
 	return nullptr;
@@ -0,0 +1,141 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeHttp/AllowList.cpp
+ *
+ * @desc AllowList holds the destinations which tunnels are allowed to.
+ */
+
+#include <cctype>
+#include <algorithm>
+
+#include <ModeHttp/AllowList.hpp>
+
+namespace mct
+{
+
+bool AllowList::add(const std::string& rule)
+{
+	const size_t colon = rule.rfind(':');
+	if (colon == std::string::npos || colon == 0) {
+		return false;
+	}
+
+	Rule parsed;
+	parsed.host = rule.substr(0, colon);
+	parsed.is_any_host = (parsed.host == "*");
+	parsed.is_suffix = !parsed.is_any_host && parsed.host.compare(0, 2, "*.") == 0;
+
+	if (parsed.host.size() > 2 && parsed.host.front() == '[' && parsed.host.back() == ']') {
+		parsed.host = parsed.host.substr(1, parsed.host.size() - 2);
+	} else if (parsed.host.find(':') != std::string::npos) {
+		return false;
+	}
+
+	if (parsed.is_suffix) {
+		parsed.host.erase(0, 1);
+		if (parsed.host.size() < 2) {
+			return false;
+		}
+	}
+
+	if (!parsed.is_any_host && parsed.host.find('*') != std::string::npos) {
+		return false;
+	}
+
+	std::transform(parsed.host.begin(), parsed.host.end(), parsed.host.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+
+	const std::string ports = rule.substr(colon + 1);
+	const size_t dash = ports.find('-');
+
+	if (ports == "*") {
+		parsed.min_port = 1;
+		parsed.max_port = 65535;
+	} else if (dash == std::string::npos) {
+		if (!parse_port(ports, parsed.min_port)) {
+			return false;
+		}
+		parsed.max_port = parsed.min_port;
+	} else if (!parse_port(ports.substr(0, dash), parsed.min_port) || !parse_port(ports.substr(dash + 1), parsed.max_port) || parsed.min_port > parsed.max_port) {
+		return false;
+	}
+
+	m_rules.push_back(parsed);
+	return true;
+}
+
+bool AllowList::is_allowed(const char* host, size_t host_length, uint16_t port) const
+{
+	// "example.com." is the same host as "example.com"
+	if (host_length > 1 && host[host_length - 1] == '.') {
+		--host_length;
+	}
+
+	auto equals = [](const char* text, const std::string& lower_text, size_t length) {
+		for (size_t i = 0; i < length; ++i) {
+			if (std::tolower(static_cast<unsigned char>(text[i])) != lower_text[i]) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+	for (auto&& rule : m_rules) {
+		if (port < rule.min_port || port > rule.max_port) {
+			continue;
+		}
+
+		if (rule.is_any_host) {
+			return true;
+		}
+
+		if (rule.is_suffix) {
+			// ".example.com" - the host has to be longer than the suffix, so example.com itself does not match
+			if (host_length > rule.host.size() && equals(host + host_length - rule.host.size(), rule.host, rule.host.size())) {
+				return true;
+			}
+		} else if (host_length == rule.host.size() && equals(host, rule.host, host_length)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool AllowList::parse_port(const std::string& text, uint16_t& port)
+{
+	if (text.empty() || text.size() > 5 || text.find_first_not_of("0123456789") != std::string::npos) {
+		return false;
+	}
+
+	const unsigned long value = std::stoul(text);
+	if (value == 0 || value > 65535) {
+		return false;
+	}
+
+	port = static_cast<uint16_t>(value);
+	return true;
+}
+
+}
@@ -0,0 +1,81 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeHttp/AllowList.hpp
+ *
+ * @desc AllowList holds the destinations which tunnels are allowed to.
+ */
+
+#ifndef MCT_MODEHTTP_ALLOWLIST_HPP
+#define MCT_MODEHTTP_ALLOWLIST_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <ModeHttp/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * Every rule is "host:port". The host is a name or address matched exactly (names ignore the case, IPv6
+ * addresses are written in brackets), "*.example.com" matching every subdomain of example.com, or "*" matching
+ * anything. The port is a number, a range "from-to" or "*".
+ *
+ * A destination is allowed if any rule matches it, so an empty list denies everything.
+ */
+class MCT_MODEHTTP_DLL_PUBLIC AllowList
+{
+public:
+    /**
+     * Returns false (and changes nothing) if the rule is malformed.
+     */
+    bool add(const std::string& rule);
+
+    bool is_allowed(const char* host, size_t host_length, uint16_t port) const;
+    bool is_allowed(const std::string& host, uint16_t port) const { return is_allowed(host.data(), host.size(), port); }
+
+    size_t get_num_of_rules() const { return m_rules.size(); }
+
+protected:
+    struct Rule
+    {
+        std::string host; // lower case, without the leading '*' of a suffix
+        bool is_any_host;
+        bool is_suffix;
+        uint16_t min_port;
+        uint16_t max_port;
+    };
+
+    static bool parse_port(const std::string& text, uint16_t& port);
+
+protected:
+    std::vector<Rule> m_rules;
+};
+
+}
+
+#endif // MCT_MODEHTTP_ALLOWLIST_HPP
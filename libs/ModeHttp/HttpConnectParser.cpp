@@ -0,0 +1,216 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeHttp/HttpConnectParser.cpp
+ *
+ * @desc HttpConnectParser reads the CONNECT request which opens an HTTP tunnel.
+ */
+
+#include <ModeHttp/HttpConnectParser.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+const char connect_method[] = "CONNECT";
+const size_t connect_method_length = sizeof(connect_method) - 1;
+
+const char version_prefix[] = "HTTP/1.";
+const size_t version_prefix_length = sizeof(version_prefix) - 1;
+
+bool is_method_char(unsigned char c)
+{
+	return c >= 'A' && c <= 'Z';
+}
+
+bool is_host_char(unsigned char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '_';
+}
+
+bool is_ipv6_char(unsigned char c)
+{
+	return (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F') || (c >= '0' && c <= '9') || c == ':' || c == '.';
+}
+
+bool is_header_char(unsigned char c)
+{
+	return c >= 0x20 || c == '\t';
+}
+
+}
+
+HttpConnectParser::HttpConnectParser()
+ : m_state(state_method), m_result(incomplete), m_position(0), m_token_length(0), m_is_connect(true), m_host_offset(0), m_host_length(0), m_port(0)
+{
+}
+
+HttpConnectParser::Result HttpConnectParser::parse(const unsigned char* data, size_t length)
+{
+	while (m_result == incomplete && m_position < length) {
+		m_result = step(data[m_position]);
+		++m_position;
+	}
+
+	return m_result;
+}
+
+HttpConnectParser::Result HttpConnectParser::step(unsigned char c)
+{
+	switch (m_state) {
+	case state_method:
+		if (c == ' ') {
+			if (!m_is_connect || m_token_length != connect_method_length) {
+				return method_not_allowed;
+			}
+			m_state = state_host_start;
+		} else if (is_method_char(c)) {
+			m_is_connect = m_is_connect && m_token_length < connect_method_length && c == connect_method[m_token_length];
+			++m_token_length;
+		} else {
+			return bad_request;
+		}
+		break;
+
+	case state_host_start:
+		if (c == '[') {
+			m_host_offset = m_position + 1;
+			m_state = state_ipv6_host;
+		} else if (is_host_char(c)) {
+			m_host_offset = m_position;
+			m_state = state_host;
+		} else {
+			return bad_request;
+		}
+		break;
+
+	case state_host:
+		if (c == ':') {
+			m_host_length = m_position - m_host_offset;
+			m_state = state_port;
+		} else if (!is_host_char(c)) {
+			return bad_request;
+		}
+		break;
+
+	case state_ipv6_host:
+		if (c == ']') {
+			m_host_length = m_position - m_host_offset;
+			if (m_host_length == 0) {
+				return bad_request;
+			}
+			m_state = state_ipv6_host_end;
+		} else if (!is_ipv6_char(c)) {
+			return bad_request;
+		}
+		break;
+
+	case state_ipv6_host_end:
+		if (c != ':') {
+			return bad_request;
+		}
+		m_state = state_port;
+		break;
+
+	case state_port:
+		if (c >= '0' && c <= '9') {
+			m_port = m_port * 10 + (c - '0');
+			if (m_port > 65535) {
+				return bad_request;
+			}
+		} else if (c == ' ' && m_port != 0) {
+			m_token_length = 0;
+			m_state = state_version;
+		} else {
+			return bad_request;
+		}
+		break;
+
+	case state_version:
+		if (m_token_length < version_prefix_length) {
+			if (c != version_prefix[m_token_length]) {
+				return bad_request;
+			}
+		} else if (m_token_length == version_prefix_length) {
+			if (c != '0' && c != '1') {
+				return bad_request;
+			}
+		} else if (c == '\r') {
+			m_state = state_line_end;
+		} else if (c == '\n') {
+			m_state = state_header_start;
+		} else {
+			return bad_request;
+		}
+		++m_token_length;
+		break;
+
+	case state_line_end:
+		if (c != '\n') {
+			return bad_request;
+		}
+		m_state = state_header_start;
+		break;
+
+	case state_header_start:
+		// folded header lines are obsolete (RFC 7230), a line starting with whitespace is rejected
+		if (c == '\r') {
+			m_state = state_final_line_end;
+		} else if (c == '\n') {
+			m_state = state_done;
+			return complete;
+		} else if (c == ' ' || c == '\t' || c == ':' || !is_header_char(c)) {
+			return bad_request;
+		} else {
+			m_state = state_header;
+		}
+		break;
+
+	case state_header:
+		if (c == '\r') {
+			m_state = state_line_end;
+		} else if (c == '\n') {
+			m_state = state_header_start;
+		} else if (!is_header_char(c)) {
+			return bad_request;
+		}
+		break;
+
+	case state_final_line_end:
+		if (c != '\n') {
+			return bad_request;
+		}
+		m_state = state_done;
+		return complete;
+
+	case state_done:
+		return complete;
+	}
+
+	return incomplete;
+}
+
+}
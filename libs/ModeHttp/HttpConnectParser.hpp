@@ -0,0 +1,110 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeHttp/HttpConnectParser.hpp
+ *
+ * @desc HttpConnectParser reads the CONNECT request which opens an HTTP tunnel.
+ */
+
+#ifndef MCT_MODEHTTP_HTTPCONNECTPARSER_HPP
+#define MCT_MODEHTTP_HTTPCONNECTPARSER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <ModeHttp/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * Incremental parser of "CONNECT host:port HTTP/1.x" followed by header lines. It does not allocate or copy
+ * anything - the destination is remembered as a position in the buffer of the caller, header fields are only
+ * validated and skipped.
+ */
+class MCT_MODEHTTP_DLL_PUBLIC HttpConnectParser
+{
+public:
+    enum Result
+    {
+        incomplete,
+        complete,
+        bad_request,
+        method_not_allowed
+    };
+
+    HttpConnectParser();
+
+    /**
+     * Parses data[0, length). Every call continues where the previous one stopped, so the bytes already seen
+     * have to stay in place (e.g. one buffer filled by consecutive reads) and length can only grow.
+     * Once the result is other than incomplete, it does not change.
+     */
+    Result parse(const unsigned char* data, size_t length);
+
+    // valid once parse() returned complete
+    size_t get_host_offset() const { return m_host_offset; }
+    size_t get_host_length() const { return m_host_length; }
+    uint16_t get_port() const { return static_cast<uint16_t>(m_port); }
+
+    /**
+     * Number of bytes of the request including its empty line, anything after it belongs to the tunnel.
+     */
+    size_t get_request_length() const { return m_position; }
+
+protected:
+    enum State
+    {
+        state_method,
+        state_host_start,
+        state_host,
+        state_ipv6_host,
+        state_ipv6_host_end,
+        state_port,
+        state_version,
+        state_line_end,
+        state_header_start,
+        state_header,
+        state_final_line_end,
+        state_done
+    };
+
+    Result step(unsigned char c);
+
+protected:
+    State m_state;
+    Result m_result;
+
+    size_t m_position;
+    size_t m_token_length;
+    bool m_is_connect;
+
+    size_t m_host_offset;
+    size_t m_host_length;
+    uint32_t m_port;
+};
+
+}
+
+#endif // MCT_MODEHTTP_HTTPCONNECTPARSER_HPP
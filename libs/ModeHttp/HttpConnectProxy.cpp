@@ -0,0 +1,251 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeHttp/HttpConnectProxy.cpp
+ *
+ * @desc HttpConnectProxy is a session which learns its destination from an HTTP CONNECT request.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include <boost/asio/write.hpp>
+#include <boost/asio/coroutine.hpp>
+
+#include <Logger/Logger.hpp>
+#include <ModeProxy/SessionSlab.hpp>
+#include <ModeHttp/HttpConnectProxy.hpp>
+#include <ModeHttp/HttpConnectParser.hpp>
+
+#include <boost/asio/yield.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+const unsigned status_ok = 200;
+const unsigned status_bad_request = 400;
+const unsigned status_forbidden = 403;
+const unsigned status_method_not_allowed = 405;
+const unsigned status_request_header_fields_too_large = 431;
+const unsigned status_bad_gateway = 502;
+const unsigned status_gateway_timeout = 504;
+
+const char* get_reason_phrase(unsigned status)
+{
+	switch (status) {
+	case status_ok:
+		return "Connection established";
+	case status_bad_request:
+		return "Bad Request";
+	case status_forbidden:
+		return "Forbidden";
+	case status_method_not_allowed:
+		return "Method Not Allowed";
+	case status_request_header_fields_too_large:
+		return "Request Header Fields Too Large";
+	case status_gateway_timeout:
+		return "Gateway Timeout";
+	default:
+		return "Bad Gateway";
+	}
+}
+
+}
+
+/**
+ * Runs the whole handshake, from the first byte of the request to the response which opens the tunnel.
+ */
+class HttpConnectProxy::Handshake : boost::asio::coroutine
+{
+public:
+	explicit Handshake(const std::shared_ptr<HttpConnectProxy>& session) : m_session(session), m_result(HttpConnectParser::incomplete), m_received(0), m_address_num(0) {}
+
+	void operator()(const boost::system::error_code& error = boost::system::error_code(), size_t bytes_transferred = 0)
+	{
+		HttpConnectProxy& session = *m_session;
+		Proxy::socket_type& client = session.m_client_socket;
+		unsigned char* request = session.m_client_data;
+		unsigned char* response = session.m_remote_data;
+
+		reenter (this) {
+			// the request may arrive in any number of pieces, the parser looks at every byte only once
+			do {
+				yield client.async_read_some(boost::asio::buffer(request + m_received, m_max_data_length - m_received), *this);
+				if (error) {
+					fail(error, "request");
+					yield break;
+				}
+
+				m_received += bytes_transferred;
+				m_result = m_parser.parse(request, m_received);
+			} while (m_result == HttpConnectParser::incomplete && m_received < m_max_data_length);
+
+			if (m_result != HttpConnectParser::complete) {
+				session.m_log.warning("HTTP client %s:%u sent an invalid or unsupported request.", session.get_client_host().c_str(), session.get_client_port());
+				session.reject(get_request_status(m_result));
+				yield break;
+			}
+
+			session.m_target.host.assign(reinterpret_cast<const char*>(request) + m_parser.get_host_offset(), m_parser.get_host_length());
+			session.m_target.port = m_parser.get_port();
+			session.m_log.info("HTTP client %s:%u requested %s:%u.", session.get_client_host().c_str(), session.get_client_port(),
+				session.m_target.host.c_str(), session.m_target.port);
+
+			if (!session.m_settings->allow_list.is_allowed(session.m_target.host, session.m_target.port)) {
+				session.m_log.warning("HTTP client %s:%u is not allowed to connect to %s:%u.", session.get_client_host().c_str(), session.get_client_port(),
+					session.m_target.host.c_str(), session.m_target.port);
+				session.reject(status_forbidden);
+				yield break;
+			}
+
+			yield session.m_settings->resolver->async_resolve(session.m_target.host, *this);
+			if (error || session.m_target_addresses.empty()) {
+				session.reject(status_bad_gateway);
+				yield break;
+			}
+
+			// every address of the destination is tried in turn
+			for (m_address_num = 0; m_address_num < session.m_target_addresses.size(); ++m_address_num) {
+				session.m_target.endpoint = boost::asio::ip::tcp::endpoint(session.m_target_addresses[m_address_num], session.m_target.port);
+
+				session.open_remote_socket(session.m_target.endpoint);
+				yield session.m_remote_socket.async_connect(session.m_target.endpoint, *this);
+				if (!error) {
+					break;
+				}
+			}
+
+			if (error) {
+				session.m_log.error("Cannot connect HTTP client %s:%u to %s:%u. Error: %s", session.get_client_host().c_str(), session.get_client_port(),
+					session.m_target.host.c_str(), session.m_target.port, error.message().c_str());
+				session.reject(get_status(error));
+				yield break;
+			}
+
+			// whatever the client pipelined after its request is the beginning of the tunnelled stream
+			m_received -= m_parser.get_request_length();
+			if (m_received > 0) {
+				std::memmove(request, request + m_parser.get_request_length(), m_received);
+				session.process_client_data(m_received);
+
+				yield boost::asio::async_write(session.m_remote_socket, boost::asio::buffer(request, m_received), *this);
+				if (error) {
+					fail(error, "forwarding pipelined data");
+					yield break;
+				}
+			}
+
+			yield boost::asio::async_write(client, boost::asio::buffer(response, session.prepare_response(status_ok)), *this);
+			if (error) {
+				fail(error, "response");
+				yield break;
+			}
+
+			session.handle_remote_connect(error);
+		}
+	}
+
+	// completion of the resolver
+	void operator()(const boost::system::error_code& error, const CachedResolver::addresses_type& addresses)
+	{
+		m_session->m_target_addresses = addresses;
+		(*this)(error);
+	}
+
+private:
+	static unsigned get_request_status(HttpConnectParser::Result result)
+	{
+		switch (result) {
+		case HttpConnectParser::method_not_allowed:
+			return status_method_not_allowed;
+		case HttpConnectParser::incomplete:
+			return status_request_header_fields_too_large;
+		default:
+			return status_bad_request;
+		}
+	}
+
+	void fail(const boost::system::error_code& error, const char* step)
+	{
+		m_session->m_log.warning("HTTP handshake with client %s:%u failed at %s%s%s.", m_session->get_client_host().c_str(), m_session->get_client_port(),
+			step, error ? ": " : "", error ? error.message().c_str() : "");
+		m_session->close();
+	}
+
+private:
+	std::shared_ptr<HttpConnectProxy> m_session;
+	HttpConnectParser m_parser;
+	HttpConnectParser::Result m_result;
+	size_t m_received;
+	size_t m_address_num;
+};
+
+HttpConnectProxy::HttpConnectProxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, const std::shared_ptr<const HttpConnectSettings>& settings)
+ : Proxy(logger, ios, route), m_settings(settings), m_target("0.0.0.0", 0)
+{
+}
+
+ListenerOptions::session_factory_type HttpConnectProxy::create_factory(const std::shared_ptr<const HttpConnectSettings>& settings)
+{
+	return [settings](Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route) -> std::shared_ptr<Proxy> {
+		return std::allocate_shared<HttpConnectProxy>(SessionAllocator<HttpConnectProxy>(ios), logger, ios, route, settings);
+	};
+}
+
+void HttpConnectProxy::connect_remote()
+{
+	m_log.info("Accepted HTTP client %s:%u with listener %s:%u.", get_client_host().c_str(), get_client_port(), m_route->listen_host.c_str(), m_route->listen_port);
+
+	Handshake(std::static_pointer_cast<HttpConnectProxy>(shared_from_this()))();
+}
+
+size_t HttpConnectProxy::prepare_response(unsigned status)
+{
+	const char* format = (status == status_ok) ? "HTTP/1.1 %u %s\r\n\r\n"
+		: (status == status_method_not_allowed) ? "HTTP/1.1 %u %s\r\nAllow: CONNECT\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"
+		: "HTTP/1.1 %u %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+	const int length = std::snprintf(reinterpret_cast<char*>(m_remote_data), m_max_data_length, format, status, get_reason_phrase(status));
+	return (length > 0) ? static_cast<size_t>(length) : 0;
+}
+
+unsigned HttpConnectProxy::get_status(const boost::system::error_code& error)
+{
+	return (error == boost::asio::error::timed_out) ? status_gateway_timeout : status_bad_gateway;
+}
+
+void HttpConnectProxy::reject(unsigned status)
+{
+	auto self = shared_from_this();
+	boost::asio::async_write(m_client_socket, boost::asio::buffer(m_remote_data, prepare_response(status)), [self](const boost::system::error_code&, size_t) {
+		self->close();
+	});
+}
+
+}
+
+#include <boost/asio/unyield.hpp>
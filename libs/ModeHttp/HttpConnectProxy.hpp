@@ -0,0 +1,97 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeHttp/HttpConnectProxy.hpp
+ *
+ * @desc HttpConnectProxy is a session which learns its destination from an HTTP CONNECT request.
+ */
+
+#ifndef MCT_MODEHTTP_HTTPCONNECTPROXY_HPP
+#define MCT_MODEHTTP_HTTPCONNECTPROXY_HPP
+
+#include <memory>
+#include <string>
+
+#include <ModeProxy/Proxy.hpp>
+#include <ModeProxy/ProxyRoute.hpp>
+#include <ModeProxy/CachedResolver.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeHttp/AllowList.hpp>
+#include <ModeHttp/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * Shared (read-only) by all the sessions of the mode.
+ */
+struct HttpConnectSettings
+{
+    AllowList allow_list;
+    std::shared_ptr<CachedResolver> resolver;
+};
+
+/**
+ * The request is read into the client buffer of the session and parsed as it arrives. Once the destination
+ * is connected, whatever the client sent after its request is forwarded first and the session moves data
+ * exactly like Proxy does.
+ */
+class MCT_MODEHTTP_DLL_PUBLIC HttpConnectProxy : public Proxy
+{
+public:
+    HttpConnectProxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, const std::shared_ptr<const HttpConnectSettings>& settings);
+
+    const ProxyBackend& get_backend() const override { return m_target; }
+
+    /**
+     * Session factory for ListenerOptions, so ProxyListener starts HttpConnectProxy sessions.
+     */
+    static ListenerOptions::session_factory_type create_factory(const std::shared_ptr<const HttpConnectSettings>& settings);
+
+protected:
+    void connect_remote() override;
+
+    /**
+     * Writes the response with the given status into m_remote_data, returns its length.
+     */
+    size_t prepare_response(unsigned status);
+    static unsigned get_status(const boost::system::error_code& error);
+
+    /**
+     * Sends an error response and closes the session.
+     */
+    void reject(unsigned status);
+
+protected:
+    class Handshake;
+
+    std::shared_ptr<const HttpConnectSettings> m_settings;
+
+    ProxyBackend m_target;
+    CachedResolver::addresses_type m_target_addresses;
+};
+
+}
+
+#endif // MCT_MODEHTTP_HTTPCONNECTPROXY_HPP
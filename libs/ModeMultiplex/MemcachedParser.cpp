@@ -0,0 +1,265 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeMultiplex/MemcachedParser.cpp
+ *
+ * @desc MemcachedParser finds where the memcached text protocol requests or responses end.
+ */
+
+#include <cstring>
+#include <algorithm>
+
+#include <ModeMultiplex/MemcachedParser.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+// memcached does not store larger items
+const uint64_t max_data_length = 1024ULL * 1024 * 1024;
+
+bool is_storage_command(const std::string& command)
+{
+    return command == "set" || command == "add" || command == "replace" || command == "append" || command == "prepend" || command == "cas";
+}
+
+bool is_retrieval_command(const std::string& command)
+{
+    return command == "get" || command == "gets" || command == "gat" || command == "gats";
+}
+
+/**
+ * Whether memcached takes the trailing noreply of the command (so it really does not answer) - unknown commands
+ * and commands with a wrong number of arguments are answered with ERROR even then.
+ */
+bool is_noreply_honoured(const std::vector<std::string>& tokens)
+{
+    const std::string& command = tokens[0];
+
+    if (is_storage_command(command)) {
+        return tokens.size() == ((command == "cas") ? 7u : 6u);
+    }
+
+    if (command == "incr" || command == "decr" || command == "touch") {
+        return tokens.size() == 4;
+    }
+
+    if (command == "delete") {
+        return tokens.size() == 3 || tokens.size() == 4;
+    }
+
+    return false;
+}
+
+}
+
+MemcachedParser::MemcachedParser(bool is_request)
+ : m_is_request(is_request), m_state(state_line), m_data_remaining(0), m_is_last_data(false), m_action(forward), m_response_kind(single_line)
+{
+}
+
+MultiplexParser::Result MemcachedParser::parse(const unsigned char* data, size_t length, size_t& consumed)
+{
+    size_t offset = 0;
+
+    while (offset < length) {
+        if (m_state == state_data) {
+            const size_t take = static_cast<size_t>(std::min<uint64_t>(m_data_remaining, length - offset));
+
+            // the data block ends with CRLF, otherwise the rest of it would be taken for the next command
+            const uint64_t payload_remaining = (m_data_remaining > 2) ? m_data_remaining - 2 : 0;
+            for (size_t i = static_cast<size_t>(std::min<uint64_t>(payload_remaining, take)); i < take; ++i) {
+                if (data[offset + i] != ((m_data_remaining - i == 2) ? '\r' : '\n')) {
+                    consumed = offset + i + 1;
+                    return invalid;
+                }
+            }
+
+            offset += take;
+            m_data_remaining -= take;
+
+            if (m_data_remaining == 0) {
+                m_state = state_line;
+
+                if (m_is_last_data) {
+                    consumed = offset;
+                    return complete;
+                }
+            }
+            continue;
+        }
+
+        const unsigned char* end = static_cast<const unsigned char*>(std::memchr(data + offset, '\n', length - offset));
+        const size_t line_length = end ? static_cast<size_t>(end - (data + offset)) : length - offset;
+
+        if (m_line.size() + line_length > max_line_length) {
+            consumed = length;
+            return invalid;
+        }
+
+        m_line.append(reinterpret_cast<const char*>(data + offset), line_length);
+        offset += line_length;
+
+        if (!end) {
+            break;
+        }
+
+        ++offset;
+        if (!m_line.empty() && m_line[m_line.size() - 1] == '\r') {
+            m_line.resize(m_line.size() - 1);
+        }
+
+        const Result result = m_is_request ? handle_request_line() : handle_response_line();
+        m_line.clear();
+
+        if (result != incomplete) {
+            consumed = offset;
+            return result;
+        }
+    }
+
+    consumed = length;
+    return incomplete;
+}
+
+MultiplexParser::Result MemcachedParser::handle_request_line()
+{
+    split_line();
+
+    m_command = m_tokens.empty() ? std::string() : m_tokens[0];
+    m_action = forward;
+    m_response_kind = single_line;
+
+    if (is_retrieval_command(m_command)) {
+        m_response_kind = values;
+        return complete;
+    }
+
+    if (m_command == "stats") {
+        m_response_kind = statistics;
+        return complete;
+    }
+
+    if (m_command == "quit") {
+        m_action = quit;
+        return complete;
+    }
+
+    if (m_command == "watch" || m_command == "lru_crawler") {
+        m_action = refuse;
+        return complete;
+    }
+
+    // meta commands, their flags follow the key
+    if (m_command.size() == 2 && m_command[0] == 'm') {
+        if (std::find(m_tokens.begin() + std::min<size_t>(2, m_tokens.size()), m_tokens.end(), "q") != m_tokens.end()) {
+            m_action = refuse;
+        }
+
+        if (m_command == "ms") {
+            return (m_tokens.size() >= 3 && expect_data(2)) ? incomplete : invalid;
+        }
+        return complete;
+    }
+
+    // the replies are matched to the requests by their order only, so a request which gets an answer after all must not
+    // lose its reply slot - anything but the commands which surely take noreply is answered here instead
+    if (m_tokens.size() > 1 && m_tokens.back() == "noreply") {
+        if (is_noreply_honoured(m_tokens)) {
+            m_response_kind = no_response;
+        } else {
+            m_action = refuse;
+        }
+    }
+
+    if (is_storage_command(m_command)) {
+        const size_t num_of_tokens = (m_command == "cas") ? 6 : 5;
+        return ((m_tokens.size() == num_of_tokens || m_tokens.size() == num_of_tokens + 1) && expect_data(4)) ? incomplete : invalid;
+    }
+
+    return complete;
+}
+
+MultiplexParser::Result MemcachedParser::handle_response_line()
+{
+    split_line();
+
+    const std::string first = m_tokens.empty() ? std::string() : m_tokens[0];
+
+    switch (m_response_kind) {
+    case values:
+        if (first == "VALUE") {
+            if (m_tokens.size() < 4 || !expect_data(3)) {
+                return invalid;
+            }
+            m_is_last_data = false;
+            return incomplete;
+        }
+        // END, or an error
+        return complete;
+
+    case statistics:
+        return (first == "STAT" || first == "ITEM" || first == "PREFIX") ? incomplete : complete;
+
+    default:
+        if (first == "VA") {
+            return (m_tokens.size() >= 2 && expect_data(1)) ? incomplete : invalid;
+        }
+        return complete;
+    }
+}
+
+bool MemcachedParser::expect_data(size_t token)
+{
+    const std::string& length = m_tokens[token];
+    if (length.empty() || length.size() > 10 || length.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+
+    const uint64_t data_length = std::stoull(length);
+    if (data_length > max_data_length) {
+        return false;
+    }
+
+    m_data_remaining = data_length + 2;
+    m_is_last_data = true;
+    m_state = state_data;
+    return true;
+}
+
+void MemcachedParser::split_line()
+{
+    m_tokens.clear();
+
+    size_t position = 0;
+    while ((position = m_line.find_first_not_of(' ', position)) != std::string::npos) {
+        const size_t end = m_line.find(' ', position);
+        m_tokens.push_back(m_line.substr(position, end - position));
+        position = end;
+    }
+}
+
+}
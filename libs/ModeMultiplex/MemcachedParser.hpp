@@ -0,0 +1,102 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeMultiplex/MemcachedParser.hpp
+ *
+ * @desc MemcachedParser finds where the memcached text protocol requests or responses end.
+ */
+
+#ifndef MCT_MODEMULTIPLEX_MEMCACHEDPARSER_HPP
+#define MCT_MODEMULTIPLEX_MEMCACHEDPARSER_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <ModeMultiplex/MultiplexParser.hpp>
+#include <ModeMultiplex/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * A request is a command line, followed by a data block for the storage commands (set, cas, ms, ...). How its
+ * response ends depends on the command, so the response parser is told the kind of every request it waits for:
+ * values (VALUE blocks until END), statistics (STAT lines until END) or a single line (with the data block of
+ * a meta VA line). Requests with noreply get no response at all - a noreply which memcached would not honour
+ * (an unknown command, a wrong number of arguments) is refused, so it cannot shift the replies of other clients.
+ *
+ * Commands whose responses cannot be counted (meta commands in quiet mode) or never end (watch, lru_crawler)
+ * are refused.
+ */
+class MCT_MODEMULTIPLEX_DLL_PUBLIC MemcachedParser : public MultiplexParser
+{
+public:
+    enum ResponseKind { single_line = 1, values = 2, statistics = 3 };
+
+    explicit MemcachedParser(bool is_request);
+
+    Result parse(const unsigned char* data, size_t length, size_t& consumed) override;
+
+    const std::string& get_command() const override { return m_command; }
+    Action get_action() const override { return m_action; }
+    uint8_t get_response_kind() const override { return m_response_kind; }
+
+    void set_response_kind(uint8_t response_kind) override { m_response_kind = response_kind; }
+
+protected:
+    enum State { state_line, state_data };
+    enum { max_line_length = 65536 };
+
+    /**
+     * Handles a complete line (without its CRLF), returns invalid if it is malformed and complete if it ends the message.
+     */
+    Result handle_request_line();
+    Result handle_response_line();
+
+    /**
+     * Reads the length of the data block which follows the line from the given token.
+     */
+    bool expect_data(size_t token);
+
+    void split_line();
+
+protected:
+    const bool m_is_request;
+
+    State m_state;
+    std::string m_line;
+    std::vector<std::string> m_tokens;
+    uint64_t m_data_remaining;
+    // the data block ends the message
+    bool m_is_last_data;
+
+    std::string m_command;
+    Action m_action;
+    uint8_t m_response_kind;
+};
+
+}
+
+#endif // MCT_MODEMULTIPLEX_MEMCACHEDPARSER_HPP
@@ -0,0 +1,156 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeMultiplex/ModeMultiplex.cpp
+ *
+ * @desc ModeMultiplex class which is one of the possible program runtime modes.
+ */
+
+#include <memory>
+#include <sstream>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+
+#include <boost/asio/io_service.hpp>
+
+#include <ModeMultiplex/ModeMultiplex.hpp>
+#include <ModeMultiplex/MultiplexPool.hpp>
+#include <ModeMultiplex/MultiplexProxy.hpp>
+#include <ModeProxy/IPResolver.hpp>
+#include <ModeProxy/ProxyManager.hpp>
+#include <ModeProxy/ProxyListener.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+
+namespace mct
+{
+
+ModeMultiplex::ModeMultiplex(Configuration& config, Logger& logger) : Mode(config, logger)
+{
+}
+
+ModeMultiplex::~ModeMultiplex()
+{
+}
+
+const std::string& ModeMultiplex::get_name() const
+{
+    static std::string multiplex_name("multiplex");
+    return multiplex_name;
+}
+
+bool ModeMultiplex::validate_configuration(MultiplexParser::Protocol& protocol) const
+{
+    uint16_t lh = m_config.get_mode_multiplex_local_hosts().size();
+    uint16_t lp = m_config.get_mode_multiplex_local_ports().size();
+
+    if (lh != lp) {
+        m_log.fatal("There is a problem with the configuration fields 'mode_multiplex_local_hosts' and 'mode_multiplex_local_ports'. Since they are sets, they should have the same number of entries (repeats) - while they have %d and %d.", lh, lp);
+        return false;
+    }
+
+    if (!MultiplexParser::parse_protocol(m_config.get_mode_multiplex_protocol(), protocol)) {
+        m_log.fatal("'mode_multiplex_protocol' has to be either 'redis' or 'memcached', not '%s'.", m_config.get_mode_multiplex_protocol().c_str());
+        return false;
+    }
+
+    if (m_config.get_mode_multiplex_connections() == 0) {
+        m_log.fatal("'mode_multiplex_connections' cannot be 0, there has to be a backend connection to carry the requests.");
+        return false;
+    }
+
+    for (auto&& port : m_config.get_mode_multiplex_local_ports()) {
+        if (port <= 1023) {
+            m_log.warning("One of supplied mode_multiplex_local_ports: %d is a 'well-known port' (its value is <= 1023). It means that the program might need additional privileges to run correctly.", port);
+        }
+    }
+
+    return true;
+}
+
+uint16_t ModeMultiplex::get_num_of_all_listeners() const
+{   // since both vectors are equal (checked with validate_configuration()), return the size of the first one
+    return m_config.get_mode_multiplex_local_hosts().size();
+}
+
+bool ModeMultiplex::run()
+{
+    m_log.log_if_not_silent("Initialized mode '%s'.", get_name().c_str());
+
+    MultiplexParser::Protocol protocol = MultiplexParser::redis;
+    if (!validate_configuration(protocol)) {
+        return false;
+    }
+
+    // provides the core I/O functionality (OS calls etc.)
+    boost::asio::io_service ios;
+
+    std::shared_ptr<MultiplexPool> pool;
+    ProxyManager manager(m_log);
+    {
+        IPResolver ip_resolver(m_log, ios);
+
+        pool = std::make_shared<MultiplexPool>(m_log, ios, protocol, ip_resolver.resolve_only_first_ip(m_config.get_mode_multiplex_backend_host()),
+            m_config.get_mode_multiplex_backend_port(), m_config.get_mode_multiplex_connections());
+        pool->start();
+
+        // all the listeners share the pool
+        auto settings = std::make_shared<MultiplexSettings>();
+        settings->pool = pool;
+        settings->protocol = protocol;
+
+        ListenerOptions options;
+        options.session_factory = MultiplexProxy::create_factory(settings);
+
+        const uint16_t num_of_all_listeners = get_num_of_all_listeners();
+
+        for (uint16_t listener_num = 0; listener_num < num_of_all_listeners; ++listener_num) {
+            std::string local_interface = m_config.get_mode_multiplex_local_hosts()[listener_num];
+            uint16_t local_port = m_config.get_mode_multiplex_local_ports()[listener_num];
+
+            std::string local_ip = ip_resolver.resolve_only_first_ip(local_interface);
+
+            try {
+                // the sessions send their requests over the pool, the remote endpoint of the listener is not used
+                manager.add_listener(std::make_shared<ProxyListener>(ios, m_log, local_ip, local_port, "0.0.0.0", 0, options));
+            } catch (const boost::system::system_error& e) {
+                std::stringstream sStr;
+                sStr << "Cannot start multiplex listener using given address and port: (" << local_interface << ") " << local_ip << ":" << local_port << std::endl;
+                sStr << "Error code: " << e.code().value() << std::endl;
+                sStr << "System message: " << e.what() << std::endl;
+                throw std::runtime_error(sStr.str());
+            }
+        }
+    }
+
+    // gives control away to Boost.Asio to asynchronously handle connections
+    ios.run();
+
+    manager.log_statistics();
+    m_log.flush();
+
+    return true;
+}
+
+}
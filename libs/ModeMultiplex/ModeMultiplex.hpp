@@ -0,0 +1,70 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeMultiplex/ModeMultiplex.hpp
+ *
+ * @desc ModeMultiplex class which is one of the possible program runtime modes.
+ */
+
+#ifndef MCT_MODEMULTIPLEX_MODEMULTIPLEX_HPP
+#define MCT_MODEMULTIPLEX_MODEMULTIPLEX_HPP
+
+#include <string>
+#include <cstdint>
+
+#include <Mode/Mode.hpp>
+#include <ModeMultiplex/MultiplexParser.hpp>
+#include <ModeMultiplex/Config.hpp>
+
+namespace mct
+{
+
+class Configuration;
+class Logger;
+
+/**
+ * Cache connection multiplexer - the clients of every listener speak redis or memcached, their requests are
+ * pipelined over a few persistent connections to a single backend instead of one connection per client.
+ */
+class MCT_MODEMULTIPLEX_DLL_PUBLIC ModeMultiplex : public Mode
+{
+public:
+    ModeMultiplex(Configuration& config, Logger& logger);
+    virtual ~ModeMultiplex();
+
+    ModeMultiplex(const ModeMultiplex&) = delete;
+    ModeMultiplex& operator=(const ModeMultiplex&) = delete;
+
+    virtual const std::string& get_name() const;
+
+    virtual bool run();
+
+protected:
+    uint16_t get_num_of_all_listeners() const;
+    bool validate_configuration(MultiplexParser::Protocol& protocol) const;
+};
+
+}
+
+#endif // MCT_MODEMULTIPLEX_MODEMULTIPLEX_HPP
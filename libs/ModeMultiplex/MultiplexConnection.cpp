@@ -0,0 +1,196 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeMultiplex/MultiplexConnection.cpp
+ *
+ * @desc MultiplexConnection is one persistent backend connection which carries the requests of many clients.
+ */
+
+#include <boost/asio/write.hpp>
+
+#include <Logger/Logger.hpp>
+#include <ModeMultiplex/MultiplexConnection.hpp>
+#include <ModeMultiplex/MultiplexProxy.hpp>
+
+namespace mct
+{
+
+MultiplexConnection::MultiplexConnection(Logger& logger, boost::asio::io_service& ios, MultiplexParser::Protocol protocol, const std::string& backend_name)
+ : m_log(logger), m_ios(ios), m_socket(ios), m_protocol(protocol), m_backend_name(backend_name), m_parser(MultiplexParser::create(protocol, false)),
+   m_num_of_requests(0), m_is_ready(false), m_is_closed(false), m_is_writing(false), m_is_response_started(false)
+{
+}
+
+MultiplexConnection::~MultiplexConnection()
+{
+}
+
+void MultiplexConnection::start()
+{
+	// requests are already batched by write, Nagle would only delay them
+	boost::system::error_code error;
+	m_socket.set_option(boost::asio::ip::tcp::no_delay(true), error);
+
+	m_is_ready = true;
+	m_log.info("Connected %s connection to backend %s.", MultiplexParser::get_protocol_name(m_protocol), m_backend_name.c_str());
+
+	read();
+}
+
+void MultiplexConnection::close()
+{
+	if (m_is_closed) {
+		return;
+	}
+
+	m_is_closed = true;
+	m_is_ready = false;
+
+	m_log.warning("Closing connection to backend %s with %u requests waiting for their responses, %llu requests sent in total.", m_backend_name.c_str(),
+		static_cast<unsigned>(m_waiting.size()), static_cast<unsigned long long>(m_num_of_requests));
+
+	boost::system::error_code ignored;
+	m_socket.close(ignored);
+
+	std::deque<WaitingRequest> waiting;
+	waiting.swap(m_waiting);
+
+	const std::string reply = MultiplexParser::make_error_reply(m_protocol, "backend connection lost", false);
+	for (auto& request : waiting) {
+		request.session->fail(request.sequence, reply);
+	}
+
+	close_handler_type close_handler;
+	close_handler.swap(m_close_handler);
+	if (close_handler) {
+		close_handler();
+	}
+}
+
+void MultiplexConnection::send(const unsigned char* data, size_t length, const std::shared_ptr<MultiplexProxy>& session, uint64_t sequence, uint8_t response_kind)
+{
+	if (!m_is_ready) {
+		if (response_kind != MultiplexParser::no_response) {
+			session->fail(sequence, MultiplexParser::make_error_reply(m_protocol, "backend unavailable", false));
+		}
+		return;
+	}
+
+	if (response_kind != MultiplexParser::no_response) {
+		m_waiting.push_back(WaitingRequest{session, sequence, response_kind});
+	}
+
+	m_output.insert(m_output.end(), data, data + length);
+	++m_num_of_requests;
+
+	if (!m_is_writing) {
+		write();
+	}
+}
+
+void MultiplexConnection::write()
+{
+	m_writing.clear();
+	m_writing.swap(m_output);
+	m_is_writing = true;
+
+	boost::asio::async_write(m_socket, boost::asio::buffer(m_writing),
+		std::bind(&MultiplexConnection::handle_write, shared_from_this(), std::placeholders::_1));
+}
+
+void MultiplexConnection::handle_write(const boost::system::error_code& error)
+{
+	m_is_writing = false;
+
+	if (error) {
+		if (error != boost::asio::error::operation_aborted) {
+			m_log.warning("Cannot write requests to backend %s, because: %s", m_backend_name.c_str(), error.message().c_str());
+		}
+		close();
+		return;
+	}
+
+	if (!m_output.empty() && !m_is_closed) {
+		write();
+	}
+}
+
+void MultiplexConnection::read()
+{
+	m_socket.async_read_some(boost::asio::buffer(m_input, max_input_length),
+		std::bind(&MultiplexConnection::handle_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+}
+
+void MultiplexConnection::handle_read(const boost::system::error_code& error, size_t bytes_transferred)
+{
+	if (error) {
+		if (error == boost::asio::error::eof) {
+			m_log.warning("Backend %s closed its connection.", m_backend_name.c_str());
+		} else if (error != boost::asio::error::operation_aborted) {
+			m_log.warning("Cannot read responses from backend %s, because: %s", m_backend_name.c_str(), error.message().c_str());
+		}
+		close();
+		return;
+	}
+
+	size_t offset = 0;
+
+	while (offset < bytes_transferred) {
+		if (m_waiting.empty()) {
+			m_log.warning("Backend %s sent %u bytes which no request waits for.", m_backend_name.c_str(), static_cast<unsigned>(bytes_transferred - offset));
+			close();
+			return;
+		}
+
+		// the session may queue its next request on this connection while it takes the response
+		const WaitingRequest request = m_waiting.front();
+
+		if (!m_is_response_started) {
+			m_parser->set_response_kind(request.response_kind);
+			m_is_response_started = true;
+		}
+
+		size_t consumed = 0;
+		const MultiplexParser::Result result = m_parser->parse(m_input + offset, bytes_transferred - offset, consumed);
+
+		if (result == MultiplexParser::invalid) {
+			m_log.warning("Backend %s sent a malformed %s response.", m_backend_name.c_str(), MultiplexParser::get_protocol_name(m_protocol));
+			close();
+			return;
+		}
+
+		const bool is_complete = (result == MultiplexParser::complete);
+		if (is_complete) {
+			m_waiting.pop_front();
+			m_is_response_started = false;
+		}
+
+		request.session->deliver(request.sequence, m_input + offset, consumed, is_complete);
+		offset += consumed;
+	}
+
+	read();
+}
+
+}
@@ -0,0 +1,134 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeMultiplex/MultiplexConnection.hpp
+ *
+ * @desc MultiplexConnection is one persistent backend connection which carries the requests of many clients.
+ */
+
+#ifndef MCT_MODEMULTIPLEX_MULTIPLEXCONNECTION_HPP
+#define MCT_MODEMULTIPLEX_MULTIPLEXCONNECTION_HPP
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include <boost/asio/io_service.hpp>
+
+#include <ModeProxy/Proxy.hpp>
+#include <ModeMultiplex/MultiplexParser.hpp>
+#include <ModeMultiplex/Config.hpp>
+
+namespace mct
+{
+
+class Logger;
+class MultiplexProxy;
+
+/**
+ * Requests are pipelined - the ones which come while a write is in flight are queued together and go out in the
+ * next single write. The backend answers in the order of the requests, so every response is given to the session
+ * of the oldest request still waiting, piece by piece as it is read.
+ */
+class MCT_MODEMULTIPLEX_DLL_PUBLIC MultiplexConnection : public std::enable_shared_from_this<MultiplexConnection>
+{
+public:
+    typedef Proxy::socket_type socket_type;
+    typedef std::function<void ()> close_handler_type;
+
+    MultiplexConnection(Logger& logger, boost::asio::io_service& ios, MultiplexParser::Protocol protocol, const std::string& backend_name);
+    ~MultiplexConnection();
+
+    MultiplexConnection(const MultiplexConnection&) = delete;
+    MultiplexConnection& operator=(const MultiplexConnection&) = delete;
+
+    socket_type& get_socket() { return m_socket; }
+
+    // called once, after the connection is closed (by either end)
+    void set_close_handler(const close_handler_type& close_handler) { m_close_handler = close_handler; }
+
+    // the socket is connected
+    void start();
+
+    /**
+     * The requests still waiting for their responses are answered with an error.
+     */
+    void close();
+
+    bool is_ready() const { return m_is_ready; }
+    size_t get_num_of_waiting_requests() const { return m_waiting.size(); }
+    uint64_t get_num_of_requests() const { return m_num_of_requests; }
+
+    /**
+     * Queues the request, the response goes to the session as its reply number sequence. The backend does not answer
+     * requests whose response_kind is MultiplexParser::no_response, so they are not waited for.
+     */
+    void send(const unsigned char* data, size_t length, const std::shared_ptr<MultiplexProxy>& session, uint64_t sequence, uint8_t response_kind);
+
+protected:
+    struct WaitingRequest
+    {
+        std::shared_ptr<MultiplexProxy> session;
+        uint64_t sequence;
+        uint8_t response_kind;
+    };
+
+    void write();
+    void handle_write(const boost::system::error_code& error);
+
+    void read();
+    void handle_read(const boost::system::error_code& error, size_t bytes_transferred);
+
+protected:
+    enum { max_input_length = 16384 };
+
+    Logger& m_log;
+    boost::asio::io_service& m_ios;
+    socket_type m_socket;
+
+    const MultiplexParser::Protocol m_protocol;
+    const std::string m_backend_name;
+    std::unique_ptr<MultiplexParser> m_parser;
+    close_handler_type m_close_handler;
+
+    std::deque<WaitingRequest> m_waiting;
+    // requests queued while m_writing is being written
+    std::vector<unsigned char> m_output;
+    std::vector<unsigned char> m_writing;
+    unsigned char m_input[max_input_length];
+
+    uint64_t m_num_of_requests;
+    bool m_is_ready;
+    bool m_is_closed;
+    bool m_is_writing;
+    // the response of m_waiting.front() has been partly read
+    bool m_is_response_started;
+};
+
+}
+
+#endif // MCT_MODEMULTIPLEX_MULTIPLEXCONNECTION_HPP
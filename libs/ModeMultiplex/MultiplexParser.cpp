@@ -0,0 +1,73 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeMultiplex/MultiplexParser.cpp
+ *
+ * @desc MultiplexParser finds where the requests (or the responses) of a cache protocol end.
+ */
+
+#include <ModeMultiplex/MultiplexParser.hpp>
+#include <ModeMultiplex/RespParser.hpp>
+#include <ModeMultiplex/MemcachedParser.hpp>
+
+namespace mct
+{
+
+bool MultiplexParser::parse_protocol(const std::string& name, Protocol& protocol)
+{
+    if (name == "redis") {
+        protocol = redis;
+    } else if (name == "memcached") {
+        protocol = memcached;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+const char* MultiplexParser::get_protocol_name(Protocol protocol)
+{
+    return (protocol == redis) ? "redis" : "memcached";
+}
+
+std::unique_ptr<MultiplexParser> MultiplexParser::create(Protocol protocol, bool is_request)
+{
+    if (protocol == redis) {
+        return std::unique_ptr<MultiplexParser>(new RespParser(is_request));
+    }
+
+    return std::unique_ptr<MultiplexParser>(new MemcachedParser(is_request));
+}
+
+std::string MultiplexParser::make_error_reply(Protocol protocol, const std::string& message, bool is_client_error)
+{
+    if (protocol == redis) {
+        return "-ERR " + message + "\r\n";
+    }
+
+    return (is_client_error ? "CLIENT_ERROR " : "SERVER_ERROR ") + message + "\r\n";
+}
+
+}
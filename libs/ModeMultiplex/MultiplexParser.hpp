@@ -0,0 +1,88 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeMultiplex/MultiplexParser.hpp
+ *
+ * @desc MultiplexParser finds where the requests (or the responses) of a cache protocol end.
+ */
+
+#ifndef MCT_MODEMULTIPLEX_MULTIPLEXPARSER_HPP
+#define MCT_MODEMULTIPLEX_MULTIPLEXPARSER_HPP
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include <ModeMultiplex/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * A parser follows a single byte stream, one message after another. Messages may arrive in any number of pieces,
+ * the parser keeps its state between the calls, so no byte is looked at twice.
+ */
+class MCT_MODEMULTIPLEX_DLL_PUBLIC MultiplexParser
+{
+public:
+    enum Protocol { redis = 0, memcached = 1 };
+    enum Result { incomplete, complete, invalid };
+    // what the multiplexer does with a complete request
+    enum Action { forward, refuse, quit };
+    // the backend answers a request of this kind with nothing at all (memcached noreply)
+    enum { no_response = 0 };
+
+    virtual ~MultiplexParser() {}
+
+    /**
+     * Returns false if the name is neither "redis" nor "memcached".
+     */
+    static bool parse_protocol(const std::string& name, Protocol& protocol);
+    static const char* get_protocol_name(Protocol protocol);
+
+    static std::unique_ptr<MultiplexParser> create(Protocol protocol, bool is_request);
+
+    /**
+     * The reply the multiplexer sends itself instead of the backend, client errors are those caused by the request.
+     */
+    static std::string make_error_reply(Protocol protocol, const std::string& message, bool is_client_error);
+
+    /**
+     * Takes data up to the end of the current message (the rest belongs to the next one), consumed is the number
+     * of bytes taken - all of them while the message is incomplete.
+     */
+    virtual Result parse(const unsigned char* data, size_t length, size_t& consumed) = 0;
+
+    // requests - valid once parse returned complete
+    virtual const std::string& get_command() const = 0;
+    virtual Action get_action() const = 0;
+    virtual uint8_t get_response_kind() const = 0;
+
+    // responses - the response_kind of the request which the next response answers
+    virtual void set_response_kind(uint8_t response_kind) = 0;
+};
+
+}
+
+#endif // MCT_MODEMULTIPLEX_MULTIPLEXPARSER_HPP
@@ -0,0 +1,172 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeMultiplex/MultiplexPool.cpp
+ *
+ * @desc MultiplexPool keeps the connections to a cache backend up.
+ */
+
+#include <sstream>
+
+#include <Logger/Logger.hpp>
+#include <ModeMultiplex/MultiplexPool.hpp>
+#include <ModeMultiplex/MultiplexConnection.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+std::string make_name(const std::string& host, uint16_t port)
+{
+    std::stringstream name;
+    name << host;
+    if (!StreamEndpoint::is_local(host)) {
+        name << ":" << port;
+    }
+    return name.str();
+}
+
+}
+
+MultiplexPool::MultiplexPool(Logger& logger, boost::asio::io_service& ios, MultiplexParser::Protocol protocol, const std::string& backend_host, uint16_t backend_port,
+    uint16_t num_of_connections)
+ : m_log(logger), m_ios(ios), m_protocol(protocol), m_backend_endpoint(StreamEndpoint::make(backend_host, backend_port)), m_backend_name(make_name(backend_host, backend_port)),
+   m_is_stopped(false), m_connections(num_of_connections)
+{
+    for (uint16_t slot = 0; slot < num_of_connections; ++slot) {
+        m_reconnect_timers.emplace_back(new boost::asio::deadline_timer(m_ios));
+    }
+}
+
+MultiplexPool::~MultiplexPool()
+{
+}
+
+void MultiplexPool::start()
+{
+    m_log.info("Connecting %u %s connections to backend %s.", static_cast<unsigned>(m_connections.size()), MultiplexParser::get_protocol_name(m_protocol), m_backend_name.c_str());
+
+    for (size_t slot = 0; slot < m_connections.size(); ++slot) {
+        connect(slot);
+    }
+}
+
+void MultiplexPool::stop()
+{
+    m_is_stopped = true;
+
+    for (size_t slot = 0; slot < m_connections.size(); ++slot) {
+        boost::system::error_code ignored;
+        m_reconnect_timers[slot]->cancel(ignored);
+
+        if (m_connections[slot]) {
+            m_connections[slot]->close();
+        }
+    }
+}
+
+std::shared_ptr<MultiplexConnection> MultiplexPool::select_connection() const
+{
+    std::shared_ptr<MultiplexConnection> selected;
+
+    for (auto& connection : m_connections) {
+        if (connection && connection->is_ready() && (!selected || connection->get_num_of_waiting_requests() < selected->get_num_of_waiting_requests())) {
+            selected = connection;
+        }
+    }
+
+    return selected;
+}
+
+size_t MultiplexPool::get_num_of_ready_connections() const
+{
+    size_t num_of_ready = 0;
+
+    for (auto& connection : m_connections) {
+        if (connection && connection->is_ready()) {
+            ++num_of_ready;
+        }
+    }
+
+    return num_of_ready;
+}
+
+void MultiplexPool::connect(size_t slot)
+{
+    if (m_is_stopped) {
+        return;
+    }
+
+    auto connection = std::make_shared<MultiplexConnection>(m_log, m_ios, m_protocol, m_backend_name);
+    m_connections[slot] = connection;
+
+    std::weak_ptr<MultiplexPool> pool = shared_from_this();
+    connection->get_socket().async_connect(m_backend_endpoint, [pool, slot](const boost::system::error_code& error) {
+        if (auto self = pool.lock()) {
+            self->handle_connect(slot, error);
+        }
+    });
+}
+
+void MultiplexPool::handle_connect(size_t slot, const boost::system::error_code& error)
+{
+    if (m_is_stopped) {
+        return;
+    }
+
+    if (error) {
+        m_log.warning("Cannot connect connection %u to backend %s, because: %s", static_cast<unsigned>(slot), m_backend_name.c_str(), error.message().c_str());
+        reconnect_later(slot);
+        return;
+    }
+
+    std::weak_ptr<MultiplexPool> pool = shared_from_this();
+    m_connections[slot]->set_close_handler([pool, slot]() {
+        if (auto self = pool.lock()) {
+            self->reconnect_later(slot);
+        }
+    });
+
+    m_connections[slot]->start();
+}
+
+void MultiplexPool::reconnect_later(size_t slot)
+{
+    if (m_is_stopped) {
+        return;
+    }
+
+    std::weak_ptr<MultiplexPool> pool = shared_from_this();
+    m_reconnect_timers[slot]->expires_from_now(boost::posix_time::milliseconds(static_cast<long>(reconnect_delay_ms)));
+    m_reconnect_timers[slot]->async_wait([pool, slot](const boost::system::error_code& error) {
+        auto self = pool.lock();
+        if (!error && self) {
+            self->connect(slot);
+        }
+    });
+}
+
+}
@@ -0,0 +1,102 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeMultiplex/MultiplexPool.hpp
+ *
+ * @desc MultiplexPool keeps the connections to a cache backend up.
+ */
+
+#ifndef MCT_MODEMULTIPLEX_MULTIPLEXPOOL_HPP
+#define MCT_MODEMULTIPLEX_MULTIPLEXPOOL_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/deadline_timer.hpp>
+
+#include <ModeProxy/StreamEndpoint.hpp>
+#include <ModeMultiplex/MultiplexParser.hpp>
+#include <ModeMultiplex/Config.hpp>
+
+namespace mct
+{
+
+class Logger;
+class MultiplexConnection;
+
+/**
+ * A fixed number of connections to the backend, each of them reconnected a second after it fails. A new client
+ * goes to the connection with the fewest requests waiting for their responses.
+ */
+class MCT_MODEMULTIPLEX_DLL_PUBLIC MultiplexPool : public std::enable_shared_from_this<MultiplexPool>
+{
+public:
+    // backend_host is an IP address or a Unix domain socket name (see StreamEndpoint)
+    MultiplexPool(Logger& logger, boost::asio::io_service& ios, MultiplexParser::Protocol protocol, const std::string& backend_host, uint16_t backend_port,
+        uint16_t num_of_connections);
+    ~MultiplexPool();
+
+    MultiplexPool(const MultiplexPool&) = delete;
+    MultiplexPool& operator=(const MultiplexPool&) = delete;
+
+    void start();
+
+    /**
+     * Closes all the connections (failing the requests they carry), nothing is reconnected any more.
+     */
+    void stop();
+
+    /**
+     * Returns nullptr if none of the connections is up.
+     */
+    std::shared_ptr<MultiplexConnection> select_connection() const;
+
+    size_t get_num_of_ready_connections() const;
+
+protected:
+    void connect(size_t slot);
+    void handle_connect(size_t slot, const boost::system::error_code& error);
+    void reconnect_later(size_t slot);
+
+protected:
+    enum { reconnect_delay_ms = 1000 };
+
+    Logger& m_log;
+    boost::asio::io_service& m_ios;
+
+    const MultiplexParser::Protocol m_protocol;
+    const StreamEndpoint::endpoint_type m_backend_endpoint;
+    const std::string m_backend_name;
+    bool m_is_stopped;
+
+    std::vector< std::shared_ptr<MultiplexConnection> > m_connections;
+    std::vector< std::unique_ptr<boost::asio::deadline_timer> > m_reconnect_timers;
+};
+
+}
+
+#endif // MCT_MODEMULTIPLEX_MULTIPLEXPOOL_HPP
@@ -0,0 +1,330 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeMultiplex/MultiplexProxy.cpp
+ *
+ * @desc MultiplexProxy is a session whose requests share the backend connections of a MultiplexPool.
+ */
+
+#include <boost/asio/write.hpp>
+
+#include <Logger/Logger.hpp>
+#include <ModeProxy/SessionSlab.hpp>
+#include <ModeMultiplex/MultiplexProxy.hpp>
+#include <ModeMultiplex/MultiplexPool.hpp>
+#include <ModeMultiplex/MultiplexConnection.hpp>
+
+namespace mct
+{
+
+MultiplexProxy::MultiplexProxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, const std::shared_ptr<const MultiplexSettings>& settings)
+ : Proxy(logger, ios, route), m_settings(settings), m_unparsed_offset(0), m_unparsed_length(0), m_replies_length(0), m_first_sequence(0),
+   m_is_reading(false), m_is_writing(false), m_is_front_started(false), m_is_quitting(false), m_is_closed(false)
+{
+}
+
+MultiplexProxy::~MultiplexProxy()
+{
+}
+
+ListenerOptions::session_factory_type MultiplexProxy::create_factory(const std::shared_ptr<const MultiplexSettings>& settings)
+{
+	return [settings](Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route) -> std::shared_ptr<Proxy> {
+		return std::allocate_shared<MultiplexProxy>(SessionAllocator<MultiplexProxy>(ios), logger, ios, route, settings);
+	};
+}
+
+void MultiplexProxy::connect_remote()
+{
+	m_log.debug("Accepted %s client %s:%u with listener %s:%u.", MultiplexParser::get_protocol_name(m_settings->protocol), get_client_host().c_str(), get_client_port(),
+		m_route->listen_host.c_str(), m_route->listen_port);
+
+	m_parser = MultiplexParser::create(m_settings->protocol, true);
+
+	// requests which came together with a PROXY protocol header
+	m_unparsed_offset = 0;
+	m_unparsed_length = m_pending_length;
+	m_pending_length = 0;
+
+	parse_requests();
+}
+
+void MultiplexProxy::close()
+{
+	if (m_is_closed) {
+		return;
+	}
+
+	// the connections still hold the session until its requests are answered, the replies are dropped
+	m_is_closed = true;
+	m_replies.clear();
+	m_replies_length = 0;
+	m_connection.reset();
+
+	Proxy::close();
+}
+
+void MultiplexProxy::read_client()
+{
+	m_is_reading = true;
+
+	m_client_socket.async_read_some(
+		boost::asio::buffer(m_client_data, m_max_data_length),
+		std::bind(&MultiplexProxy::handle_client_data_read, std::static_pointer_cast<MultiplexProxy>(shared_from_this()), std::placeholders::_1, std::placeholders::_2)
+	);
+}
+
+void MultiplexProxy::handle_client_data_read(const boost::system::error_code& error, size_t bytes_transferred)
+{
+	m_is_reading = false;
+
+	if (error) {
+		if (error == boost::asio::error::eof) {
+			// the replies still pending are written before the session closes
+			m_log.debug("Client %s:%u has finished sending requests, %u replies pending.", get_client_host().c_str(), get_client_port(),
+				static_cast<unsigned>(m_replies.size()));
+			m_is_client_finished = true;
+			write_client();
+		} else if (error != boost::asio::error::operation_aborted) {
+			handle_client_read_error(error);
+		}
+		return;
+	}
+
+	process_client_data(bytes_transferred);
+
+	m_unparsed_offset = 0;
+	m_unparsed_length = bytes_transferred;
+	parse_requests();
+}
+
+void MultiplexProxy::parse_requests()
+{
+	while (m_unparsed_length > 0 && !m_is_quitting) {
+		if (m_replies.size() >= max_pending_replies || get_reply_backlog() >= max_pending_reply_length) {
+			// resumed once the client takes its replies, the ones which are ready are still written
+			break;
+		}
+
+		const unsigned char* data = m_client_data + m_unparsed_offset;
+		size_t consumed = 0;
+		const MultiplexParser::Result result = m_parser->parse(data, m_unparsed_length, consumed);
+
+		if (result == MultiplexParser::invalid) {
+			m_log.warning("Client %s:%u sent a malformed %s request.", get_client_host().c_str(), get_client_port(), MultiplexParser::get_protocol_name(m_settings->protocol));
+			add_reply(MultiplexParser::make_error_reply(m_settings->protocol, "protocol error", true));
+			m_is_quitting = true;
+			break;
+		}
+
+		m_unparsed_offset += consumed;
+		m_unparsed_length -= consumed;
+
+		if (result == MultiplexParser::incomplete) {
+			if (m_request.size() + consumed > max_request_length) {
+				m_log.warning("Client %s:%u sent a request longer than %u bytes.", get_client_host().c_str(), get_client_port(), static_cast<unsigned>(max_request_length));
+				add_reply(MultiplexParser::make_error_reply(m_settings->protocol, "request too large", true));
+				m_is_quitting = true;
+				break;
+			}
+
+			m_request.append(reinterpret_cast<const char*>(data), consumed);
+			continue;
+		}
+
+		if (m_request.empty()) {
+			handle_request(data, consumed);
+		} else {
+			m_request.append(reinterpret_cast<const char*>(data), consumed);
+			handle_request(reinterpret_cast<const unsigned char*>(m_request.data()), m_request.size());
+			m_request.clear();
+		}
+
+		if (m_is_closed) {
+			return;
+		}
+	}
+
+	write_client();
+
+	if (m_unparsed_length == 0 && !m_is_reading && !m_is_quitting && !m_is_client_finished && !m_is_closed) {
+		read_client();
+	}
+}
+
+void MultiplexProxy::handle_request(const unsigned char* data, size_t length)
+{
+	const MultiplexParser::Action action = m_parser->get_action();
+
+	if (action == MultiplexParser::refuse) {
+		m_log.debug("Client %s:%u sent command %s, which cannot share a backend connection.", get_client_host().c_str(), get_client_port(), m_parser->get_command().c_str());
+		add_reply(MultiplexParser::make_error_reply(m_settings->protocol, "command '" + m_parser->get_command() + "' is not supported by the multiplexer", true));
+		return;
+	}
+
+	if (action == MultiplexParser::quit) {
+		// the backend connection is not the client's to close
+		if (m_settings->protocol == MultiplexParser::redis) {
+			add_reply("+OK\r\n");
+		}
+		m_is_quitting = true;
+		return;
+	}
+
+	const uint8_t response_kind = m_parser->get_response_kind();
+
+	// the replies of the old connection have all been failed when it closed, a new one cannot overtake them
+	if (!m_connection || !m_connection->is_ready()) {
+		m_connection = m_settings->pool->select_connection();
+	}
+
+	if (!m_connection) {
+		if (response_kind != MultiplexParser::no_response) {
+			add_reply(MultiplexParser::make_error_reply(m_settings->protocol, "backend unavailable", false));
+		}
+		return;
+	}
+
+	const uint64_t sequence = m_first_sequence + m_replies.size();
+	if (response_kind != MultiplexParser::no_response) {
+		m_replies.push_back(Reply{std::string(), false});
+	}
+
+	m_connection->send(data, length, std::static_pointer_cast<MultiplexProxy>(shared_from_this()), sequence, response_kind);
+}
+
+void MultiplexProxy::add_reply(const std::string& data)
+{
+	m_replies.push_back(Reply{data, true});
+	m_replies_length += data.size();
+}
+
+void MultiplexProxy::deliver(uint64_t sequence, const unsigned char* data, size_t length, bool is_complete)
+{
+	if (m_is_closed) {
+		return;
+	}
+
+	if (get_reply_backlog() + length > max_reply_backlog) {
+		m_log.warning("Client %s:%u does not take its replies, more than %u bytes of them are waiting.", get_client_host().c_str(), get_client_port(),
+			static_cast<unsigned>(max_reply_backlog));
+		close();
+		return;
+	}
+
+	Reply& reply = m_replies[sequence - m_first_sequence];
+	reply.data.append(reinterpret_cast<const char*>(data), length);
+	reply.is_complete = is_complete;
+	m_replies_length += length;
+
+	if (sequence == m_first_sequence) {
+		write_client();
+	}
+}
+
+void MultiplexProxy::fail(uint64_t sequence, const std::string& data)
+{
+	if (m_is_closed) {
+		return;
+	}
+
+	Reply& reply = m_replies[sequence - m_first_sequence];
+
+	if (!reply.data.empty() || (sequence == m_first_sequence && m_is_front_started)) {
+		m_log.warning("Client %s:%u lost the rest of a reply with its backend connection.", get_client_host().c_str(), get_client_port());
+		close();
+		return;
+	}
+
+	reply.data = data;
+	reply.is_complete = true;
+	m_replies_length += data.size();
+
+	if (sequence == m_first_sequence) {
+		write_client();
+	}
+}
+
+void MultiplexProxy::write_client()
+{
+	if (m_is_writing || m_is_closed) {
+		return;
+	}
+
+	// everything ready at the front goes out in a single write
+	while (!m_replies.empty()) {
+		Reply& reply = m_replies.front();
+
+		if (!reply.data.empty()) {
+			m_is_front_started = true;
+			m_writing.append(reply.data);
+			m_replies_length -= reply.data.size();
+			reply.data.clear();
+		}
+
+		if (!reply.is_complete) {
+			break;
+		}
+
+		m_replies.pop_front();
+		++m_first_sequence;
+		m_is_front_started = false;
+	}
+
+	if (m_writing.empty()) {
+		if (m_replies.empty() && (m_is_client_finished || m_is_quitting)) {
+			close();
+		}
+		return;
+	}
+
+	m_is_writing = true;
+
+	boost::asio::async_write(
+		m_client_socket, boost::asio::buffer(m_writing),
+		std::bind(&MultiplexProxy::handle_client_reply_write, std::static_pointer_cast<MultiplexProxy>(shared_from_this()), std::placeholders::_1)
+	);
+}
+
+void MultiplexProxy::handle_client_reply_write(const boost::system::error_code& error)
+{
+	m_is_writing = false;
+	m_writing.clear();
+
+	if (error) {
+		if (error != boost::asio::error::operation_aborted) {
+			handle_client_write_error(error);
+		}
+		return;
+	}
+
+	if (m_is_closed) {
+		return;
+	}
+
+	// also writes whatever came while this write was in flight
+	parse_requests();
+}
+
+}
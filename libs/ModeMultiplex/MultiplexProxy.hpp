@@ -0,0 +1,148 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeMultiplex/MultiplexProxy.hpp
+ *
+ * @desc MultiplexProxy is a session whose requests share the backend connections of a MultiplexPool.
+ */
+
+#ifndef MCT_MODEMULTIPLEX_MULTIPLEXPROXY_HPP
+#define MCT_MODEMULTIPLEX_MULTIPLEXPROXY_HPP
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include <ModeProxy/Proxy.hpp>
+#include <ModeProxy/ProxyRoute.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeMultiplex/MultiplexParser.hpp>
+#include <ModeMultiplex/Config.hpp>
+
+namespace mct
+{
+
+class MultiplexPool;
+class MultiplexConnection;
+
+/**
+ * Shared (read-only) by all the sessions of a multiplex listener.
+ */
+struct MultiplexSettings
+{
+    std::shared_ptr<MultiplexPool> pool;
+    MultiplexParser::Protocol protocol;
+};
+
+/**
+ * The session never connects its remote socket. Every complete request of the client is sent over one of the
+ * pool connections and gets a numbered slot for its reply; replies are written to the client strictly in the
+ * order of the slots, whichever connection they came from and whether the multiplexer made them itself (e.g. for
+ * a refused command). A client sticks to one connection while it is up, so its requests run in the order it sent them.
+ */
+class MCT_MODEMULTIPLEX_DLL_PUBLIC MultiplexProxy : public Proxy
+{
+public:
+    MultiplexProxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, const std::shared_ptr<const MultiplexSettings>& settings);
+    virtual ~MultiplexProxy();
+
+    /**
+     * Session factory for ListenerOptions, so ProxyListener starts MultiplexProxy sessions.
+     */
+    static ListenerOptions::session_factory_type create_factory(const std::shared_ptr<const MultiplexSettings>& settings);
+
+    void close() override;
+
+    // called by MultiplexConnection - a piece of the reply number sequence, or the error reply which replaces it
+    void deliver(uint64_t sequence, const unsigned char* data, size_t length, bool is_complete);
+    void fail(uint64_t sequence, const std::string& reply);
+
+protected:
+    struct Reply
+    {
+        std::string data;
+        bool is_complete;
+    };
+
+    // reads the client only
+    void connect_remote() override;
+
+    void read_client();
+    void handle_client_data_read(const boost::system::error_code& error, size_t bytes_transferred);
+
+    /**
+     * Takes the requests out of the client data which has not been parsed yet, until the data runs out or too
+     * many replies (or reply bytes) are pending. The client is not read meanwhile, so a client which does not take
+     * its replies stops sending requests to the backend.
+     */
+    void parse_requests();
+    void handle_request(const unsigned char* data, size_t length);
+    void add_reply(const std::string& data);
+
+    // reply bytes held by the session - not written yet, or being written
+    size_t get_reply_backlog() const { return m_replies_length + m_writing.size(); }
+
+    /**
+     * Writes the replies which are ready, in order; closes the session once nothing is left to write after the
+     * client has finished or quit.
+     */
+    void write_client();
+    void handle_client_reply_write(const boost::system::error_code& error);
+
+protected:
+    /**
+     * Requests are not taken from the client while max_pending_reply_length bytes of replies are waiting for it.
+     * The backend connection is shared and cannot be paused for one client, so the replies of requests already sent
+     * keep coming - a session whose backlog grows beyond max_reply_backlog is closed instead.
+     */
+    enum { max_pending_replies = 256, max_pending_reply_length = 1024 * 1024, max_reply_backlog = 64 * 1024 * 1024, max_request_length = 64 * 1024 * 1024 };
+
+    std::shared_ptr<const MultiplexSettings> m_settings;
+    std::unique_ptr<MultiplexParser> m_parser;
+    std::shared_ptr<MultiplexConnection> m_connection;
+
+    // the beginning of a request which did not fit in a single read
+    std::string m_request;
+    size_t m_unparsed_offset;
+    size_t m_unparsed_length;
+
+    // m_replies.front() is the reply number m_first_sequence
+    std::deque<Reply> m_replies;
+    // bytes of reply data in m_replies
+    size_t m_replies_length;
+    uint64_t m_first_sequence;
+    std::string m_writing;
+
+    bool m_is_reading;
+    bool m_is_writing;
+    // a part of m_replies.front() has been written already, so it cannot be replaced by an error reply
+    bool m_is_front_started;
+    bool m_is_quitting;
+    bool m_is_closed;
+};
+
+}
+
+#endif // MCT_MODEMULTIPLEX_MULTIPLEXPROXY_HPP
@@ -0,0 +1,297 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeMultiplex/RespParser.cpp
+ *
+ * @desc RespParser finds where the Redis (RESP) requests or responses end.
+ */
+
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+
+#include <ModeMultiplex/RespParser.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+const int64_t max_bulk_length = 512LL * 1024 * 1024;
+const int64_t max_num_of_elements = 0x7fffffffLL;
+
+// sorted, looked up with std::binary_search
+const char* const refused_commands[] = {
+    "auth", "blmove", "blmpop", "blpop", "brpop", "brpoplpush", "bzmpop", "bzpopmax", "bzpopmin", "client", "discard", "exec", "hello",
+    "monitor", "multi", "psubscribe", "punsubscribe", "readonly", "readwrite", "reset", "select", "ssubscribe", "subscribe",
+    "sunsubscribe", "unsubscribe", "unwatch", "wait", "waitaof", "watch", "xread", "xreadgroup"
+};
+
+bool is_type(unsigned char type)
+{
+    return type != '\0' && std::strchr("+-:$*_#,(!=%~>|", type) != nullptr;
+}
+
+bool is_number_type(unsigned char type)
+{
+    return type != '\0' && std::strchr("$*!=%~>|", type) != nullptr;
+}
+
+bool parse_number(const std::string& line, int64_t& number)
+{
+    size_t position = (!line.empty() && line[0] == '-') ? 1 : 0;
+    if (position == line.size()) {
+        return false;
+    }
+
+    int64_t value = 0;
+    for (; position < line.size(); ++position) {
+        if (line[position] < '0' || line[position] > '9') {
+            return false;
+        }
+        value = value * 10 + (line[position] - '0');
+    }
+
+    number = (line[0] == '-') ? -value : value;
+    return true;
+}
+
+}
+
+RespParser::RespParser(bool is_request)
+ : m_is_request(is_request), m_state(state_type), m_type(0), m_bulk_remaining(0), m_inline_length(0), m_is_command_next(false), m_is_capturing(false)
+{
+}
+
+MultiplexParser::Result RespParser::parse(const unsigned char* data, size_t length, size_t& consumed)
+{
+    size_t offset = 0;
+
+    while (offset < length) {
+        switch (m_state) {
+        case state_type:
+            m_type = data[offset];
+
+            if (m_remaining_elements.empty()) {
+                begin_message();
+
+                // anything but an array is an inline command, this byte is its first one
+                if (m_is_request && m_type != '*') {
+                    m_state = state_inline;
+                    m_inline_length = 0;
+                    m_is_capturing = true;
+                    break;
+                }
+            }
+
+            ++offset;
+            if (!is_type(m_type)) {
+                consumed = offset;
+                return invalid;
+            }
+
+            m_line.clear();
+            m_state = state_line;
+            break;
+
+        case state_line: {
+            const unsigned char c = data[offset++];
+
+            if (c == '\n') {
+                bool is_value_finished = false;
+                if (!handle_line(is_value_finished)) {
+                    consumed = offset;
+                    return invalid;
+                }
+
+                if (is_value_finished && finish_value()) {
+                    consumed = offset;
+                    return complete;
+                }
+            } else if (c != '\r' && is_number_type(m_type)) {
+                if (m_line.size() >= max_number_length) {
+                    consumed = offset;
+                    return invalid;
+                }
+                m_line += static_cast<char>(c);
+            }
+            break;
+        }
+
+        case state_bulk: {
+            const size_t take = static_cast<size_t>(std::min<uint64_t>(m_bulk_remaining, length - offset));
+
+            // redis drops a connection whose bulk string does not end with CRLF, with it every client sharing the connection
+            const uint64_t payload_remaining = (m_bulk_remaining > 2) ? m_bulk_remaining - 2 : 0;
+            for (size_t i = static_cast<size_t>(std::min<uint64_t>(payload_remaining, take)); i < take; ++i) {
+                if (data[offset + i] != ((m_bulk_remaining - i == 2) ? '\r' : '\n')) {
+                    consumed = offset + i + 1;
+                    return invalid;
+                }
+            }
+
+            // the command, without the CRLF which ends it
+            if (m_is_capturing) {
+                for (size_t i = 0; i < take && m_bulk_remaining - i > 2 && m_command.size() < max_command_length; ++i) {
+                    m_command += static_cast<char>(std::tolower(data[offset + i]));
+                }
+            }
+
+            offset += take;
+            m_bulk_remaining -= take;
+
+            if (m_bulk_remaining == 0) {
+                m_is_capturing = false;
+                m_state = state_type;
+
+                if (finish_value()) {
+                    consumed = offset;
+                    return complete;
+                }
+            }
+            break;
+        }
+
+        case state_inline: {
+            const unsigned char c = data[offset++];
+
+            if (c == '\n') {
+                m_state = state_type;
+
+                if (!m_command.empty()) {
+                    consumed = offset;
+                    return complete;
+                }
+                break;
+            }
+
+            if (++m_inline_length > max_inline_length) {
+                consumed = offset;
+                return invalid;
+            }
+
+            if (c == ' ' || c == '\t' || c == '\r') {
+                m_is_capturing = m_is_capturing && m_command.empty();
+            } else if (m_is_capturing && m_command.size() < max_command_length) {
+                m_command += static_cast<char>(std::tolower(c));
+            }
+            break;
+        }
+        }
+    }
+
+    consumed = length;
+    return incomplete;
+}
+
+MultiplexParser::Action RespParser::get_action() const
+{
+    if (m_command == "quit") {
+        return quit;
+    }
+
+    const char* const* end = refused_commands + sizeof(refused_commands) / sizeof(refused_commands[0]);
+    const bool is_refused = std::binary_search(refused_commands, end, m_command.c_str(), [](const char* a, const char* b) { return std::strcmp(a, b) < 0; });
+
+    return is_refused ? refuse : forward;
+}
+
+bool RespParser::handle_line(bool& is_value_finished)
+{
+    const bool is_command = m_is_command_next;
+    m_is_command_next = false;
+    m_state = state_type;
+    is_value_finished = true;
+
+    if (!is_number_type(m_type)) {
+        return true;
+    }
+
+    int64_t number = 0;
+    if (!parse_number(m_line, number) || number < -1) {
+        return false;
+    }
+
+    if (m_type == '$' || m_type == '=' || m_type == '!') {
+        if (number > max_bulk_length) {
+            return false;
+        }
+
+        if (number >= 0) {
+            m_bulk_remaining = static_cast<uint64_t>(number) + 2;
+            m_is_capturing = is_command;
+            m_state = state_bulk;
+            is_value_finished = false;
+        }
+        return true;
+    }
+
+    if (number > max_num_of_elements) {
+        return false;
+    }
+
+    // a request is a flat array of bulk strings, an aggregate inside of it would only grow the stack
+    if (m_is_request && !m_remaining_elements.empty()) {
+        return false;
+    }
+
+    // the first element of a request is its command
+    m_is_command_next = m_is_request && m_remaining_elements.empty() && number > 0;
+
+    if (number > 0) {
+        if (m_type == '%') {
+            number *= 2;
+        } else if (m_type == '|') {
+            // the attributes come with the value they belong to
+            number = number * 2 + 1;
+        }
+
+        m_remaining_elements.push_back(number);
+        is_value_finished = false;
+    }
+
+    return true;
+}
+
+bool RespParser::finish_value()
+{
+    while (!m_remaining_elements.empty()) {
+        if (--m_remaining_elements.back() > 0) {
+            return false;
+        }
+        m_remaining_elements.pop_back();
+    }
+
+    return true;
+}
+
+void RespParser::begin_message()
+{
+    m_command.clear();
+    m_is_command_next = false;
+    m_is_capturing = false;
+}
+
+}
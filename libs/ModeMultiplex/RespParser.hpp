@@ -0,0 +1,103 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeMultiplex/RespParser.hpp
+ *
+ * @desc RespParser finds where the Redis (RESP) requests or responses end.
+ */
+
+#ifndef MCT_MODEMULTIPLEX_RESPPARSER_HPP
+#define MCT_MODEMULTIPLEX_RESPPARSER_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <ModeMultiplex/MultiplexParser.hpp>
+#include <ModeMultiplex/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * A message is one RESP2 or RESP3 value, nested aggregates are followed with a stack of the numbers of their
+ * elements still to come. Only lengths are read, the bulk strings are skipped - except the first one of a request,
+ * which is the command. Requests may also be inline commands (a line of words), blank lines in between are skipped.
+ * A request holding a nested aggregate is malformed, only responses nest.
+ *
+ * Commands which keep state in their connection (transactions, pub/sub, SELECT, AUTH, ...) or block it
+ * (BLPOP, WAIT, XREAD, ...) cannot share a backend connection and are refused. Only the command is captured, so
+ * XREAD and XREADGROUP are refused without looking for their BLOCK argument.
+ */
+class MCT_MODEMULTIPLEX_DLL_PUBLIC RespParser : public MultiplexParser
+{
+public:
+    explicit RespParser(bool is_request);
+
+    Result parse(const unsigned char* data, size_t length, size_t& consumed) override;
+
+    const std::string& get_command() const override { return m_command; }
+    Action get_action() const override;
+    uint8_t get_response_kind() const override { return response_value; }
+
+    void set_response_kind(uint8_t) override {}
+
+protected:
+    enum State { state_type, state_line, state_bulk, state_inline };
+    // a number of max_number_length digits cannot overflow int64_t, longer ones are malformed
+    enum { response_value = 1, max_command_length = 32, max_number_length = 18, max_inline_length = 65536 };
+
+    /**
+     * Handles the end of the header line of a value, returns false if it is malformed. The value is finished
+     * unless it is a bulk string or a non-empty aggregate.
+     */
+    bool handle_line(bool& is_value_finished);
+
+    /**
+     * Counts a finished value as an element of the aggregates it belongs to, returns true if it was the last
+     * element of the outermost one (or not in an aggregate at all) - the message is complete.
+     */
+    bool finish_value();
+
+    void begin_message();
+
+protected:
+    const bool m_is_request;
+
+    State m_state;
+    unsigned char m_type;
+    std::string m_line;
+    uint64_t m_bulk_remaining;
+    size_t m_inline_length;
+    std::vector<int64_t> m_remaining_elements;
+
+    std::string m_command;
+    // the next value is the first element of a request
+    bool m_is_command_next;
+    bool m_is_capturing;
+};
+
+}
+
+#endif // MCT_MODEMULTIPLEX_RESPPARSER_HPP
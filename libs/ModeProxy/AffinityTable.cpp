@@ -0,0 +1,198 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/AffinityTable.cpp
+ *
+ * @desc AffinityTable remembers which backend every client (or client network) has been sent to.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+#include <ModeProxy/AffinityTable.hpp>
+
+namespace mct
+{
+
+AffinityTable::AffinityTable(size_t max_entries, uint32_t timeout)
+ : m_timeout(timeout), m_num_of_buckets(1), m_buckets(nullptr)
+{
+    // the number of buckets is a power of two (so a hash is masked, not divided), rounded down to stay within max_entries
+    while (m_num_of_buckets * 2 * entries_per_bucket <= max_entries) {
+        m_num_of_buckets *= 2;
+    }
+
+    m_storage.reset(new unsigned char[m_num_of_buckets * sizeof(Bucket) + cache_line_size]);
+    std::memset(m_storage.get(), 0, m_num_of_buckets * sizeof(Bucket) + cache_line_size);
+
+    uintptr_t address = reinterpret_cast<uintptr_t>(m_storage.get());
+    m_buckets = reinterpret_cast<Bucket*>((address + cache_line_size - 1) & ~static_cast<uintptr_t>(cache_line_size - 1));
+
+    for (auto& shard : m_shards) {
+        shard.num_of_evictions = 0;
+    }
+}
+
+uint64_t AffinityTable::make_key(const boost::asio::ip::address& address, bool by_prefix)
+{
+    // IPv4 clients of a dual-stack listener come as ::ffff:a.b.c.d, they would all share a single /64 prefix
+    if (address.is_v6() && address.to_v6().is_v4_mapped()) {
+        return make_key(address.to_v6().to_v4(), by_prefix);
+    }
+
+    if (address.is_v4()) {
+        uint64_t ip = address.to_v4().to_ulong();
+        if (by_prefix) {
+            ip &= 0xffffff00;
+        }
+        // bit 32 keeps IPv4 keys apart from IPv6 ones (and from 0, which marks unused entries)
+        return ip | (uint64_t(1) << 32);
+    }
+
+    boost::asio::ip::address_v6::bytes_type bytes = address.to_v6().to_bytes();
+    const size_t num_of_bytes = by_prefix ? 8 : bytes.size();
+
+    // FNV-1a of the (network part of the) address
+    uint64_t key = 14695981039346656037ULL;
+    for (size_t byte = 0; byte < num_of_bytes; ++byte) {
+        key = (key ^ bytes[byte]) * 1099511628211ULL;
+    }
+
+    return key | (uint64_t(1) << 63);
+}
+
+uint32_t AffinityTable::get_current_time()
+{
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t AffinityTable::hash(uint64_t key)
+{
+    // finalizer of MurmurHash3, neighbouring addresses end up in unrelated buckets
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+uint16_t AffinityTable::pin(uint64_t key, uint16_t proposed_backend, uint32_t now)
+{
+    const size_t bucket_num = get_bucket_num(key);
+    Shard& shard = get_shard(bucket_num);
+    Entry* entries = m_buckets[bucket_num].entries;
+
+    std::lock_guard<std::mutex> lock(shard.access);
+
+    // entries of a bucket are ordered from the most to the least recently used one
+    size_t position = entries_per_bucket - 1;
+    for (size_t entry_num = 0; entry_num < entries_per_bucket; ++entry_num) {
+        if (entries[entry_num].key == key && is_live(entries[entry_num], now)) {
+            position = entry_num;
+            proposed_backend = entries[entry_num].backend;
+            break;
+        }
+    }
+
+    if (entries[position].key != key) {
+        // an unused (or expired) entry is taken before the least recently used one is evicted
+        auto unused = std::find_if(entries, entries + entries_per_bucket, [&](const Entry& entry) { return !is_live(entry, now); });
+        if (unused != entries + entries_per_bucket) {
+            position = unused - entries;
+        } else {
+            ++shard.num_of_evictions;
+        }
+    }
+
+    std::copy_backward(entries, entries + position, entries + position + 1);
+
+    entries[0].key = key;
+    entries[0].last_used = now;
+    entries[0].backend = proposed_backend;
+    entries[0].reserved = 0;
+
+    return proposed_backend;
+}
+
+bool AffinityTable::find(uint64_t key, uint32_t now, uint16_t& backend) const
+{
+    const size_t bucket_num = get_bucket_num(key);
+    const Bucket& bucket = m_buckets[bucket_num];
+
+    std::lock_guard<std::mutex> lock(get_shard(bucket_num).access);
+
+    for (auto& entry : bucket.entries) {
+        if (entry.key == key && is_live(entry, now)) {
+            backend = entry.backend;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void AffinityTable::unpin(uint64_t key, uint16_t backend)
+{
+    const size_t bucket_num = get_bucket_num(key);
+    Bucket& bucket = m_buckets[bucket_num];
+
+    std::lock_guard<std::mutex> lock(get_shard(bucket_num).access);
+
+    for (auto& entry : bucket.entries) {
+        if (entry.key == key && entry.backend == backend) {
+            entry.key = 0;
+        }
+    }
+}
+
+size_t AffinityTable::get_num_of_entries(uint32_t now) const
+{
+    size_t num_of_entries = 0;
+
+    for (size_t bucket_num = 0; bucket_num < m_num_of_buckets; ++bucket_num) {
+        std::lock_guard<std::mutex> lock(get_shard(bucket_num).access);
+
+        num_of_entries += std::count_if(std::begin(m_buckets[bucket_num].entries), std::end(m_buckets[bucket_num].entries), [&](const Entry& entry) {
+            return is_live(entry, now);
+        });
+    }
+
+    return num_of_entries;
+}
+
+uint64_t AffinityTable::get_num_of_evictions() const
+{
+    uint64_t num_of_evictions = 0;
+
+    for (auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard.access);
+        num_of_evictions += shard.num_of_evictions;
+    }
+
+    return num_of_evictions;
+}
+
+}
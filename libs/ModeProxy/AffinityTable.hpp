@@ -0,0 +1,134 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/AffinityTable.hpp
+ *
+ * @desc AffinityTable remembers which backend every client (or client network) has been sent to.
+ */
+
+#ifndef MCT_MODEPROXY_AFFINITYTABLE_HPP
+#define MCT_MODEPROXY_AFFINITYTABLE_HPP
+
+#include <mutex>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/asio/ip/address.hpp>
+
+#include <ModeProxy/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * The table has a fixed number of entries, allocated once - it never grows, however many clients connect.
+ * Entries are grouped in buckets of one cache line, a key can only live in the bucket its hash points to,
+ * so a lookup touches a single cache line. When a bucket is full, its least recently used entry is evicted
+ * (entries of a bucket are kept in the order of their use, a timestamp of one second would not tell them apart).
+ * An entry expires when it has not been used for timeout seconds.
+ *
+ * Buckets are split between shards with separate locks, so threads pinning different clients rarely wait
+ * for each other.
+ */
+class MCT_MODEPROXY_DLL_PUBLIC AffinityTable
+{
+public:
+    AffinityTable(size_t max_entries, uint32_t timeout);
+
+    AffinityTable(const AffinityTable&) = delete;
+    AffinityTable& operator=(const AffinityTable&) = delete;
+
+    /**
+     * IPv4 addresses are reduced to their /24 network and IPv6 addresses to their /64 network when by_prefix is set.
+     * IPv6 keys are hashed, two IPv6 clients may (very rarely) share an entry.
+     */
+    static uint64_t make_key(const boost::asio::ip::address& address, bool by_prefix);
+
+    // monotonic number of seconds, used as "now" by the listeners
+    static uint32_t get_current_time();
+
+    /**
+     * Returns the backend the key is pinned to and extends its lifetime. A key without a live entry is pinned
+     * to proposed_backend first.
+     */
+    uint16_t pin(uint64_t key, uint16_t proposed_backend, uint32_t now);
+
+    bool find(uint64_t key, uint32_t now, uint16_t& backend) const;
+
+    // forgets the key, unless it has been pinned to another backend meanwhile
+    void unpin(uint64_t key, uint16_t backend);
+
+    size_t get_capacity() const { return m_num_of_buckets * entries_per_bucket; }
+    size_t get_memory_size() const { return m_num_of_buckets * sizeof(Bucket); }
+    size_t get_num_of_entries(uint32_t now) const;
+    uint64_t get_num_of_evictions() const;
+
+protected:
+    struct Entry
+    {
+        // 0 marks an unused entry
+        uint64_t key;
+        uint32_t last_used;
+        uint16_t backend;
+        uint16_t reserved;
+    };
+
+    enum { entries_per_bucket = 4, num_of_shards = 16, cache_line_size = 64 };
+
+    struct Bucket
+    {
+        Entry entries[entries_per_bucket];
+    };
+
+    struct Shard
+    {
+        std::mutex access;
+        uint64_t num_of_evictions;
+        // keeps the locks of neighbouring shards in separate cache lines
+        unsigned char padding[cache_line_size];
+    };
+
+    static uint64_t hash(uint64_t key);
+
+    // every bucket belongs to exactly one shard, whose lock guards it
+    size_t get_bucket_num(uint64_t key) const { return hash(key) & (m_num_of_buckets - 1); }
+    Shard& get_shard(size_t bucket_num) const { return m_shards[bucket_num % num_of_shards]; }
+
+    bool is_live(const Entry& entry, uint32_t now) const { return entry.key != 0 && now - entry.last_used < m_timeout; }
+
+protected:
+    const uint32_t m_timeout;
+    size_t m_num_of_buckets;
+
+    std::unique_ptr<unsigned char[]> m_storage;
+    // m_storage aligned to a cache line
+    Bucket* m_buckets;
+
+    mutable Shard m_shards[num_of_shards];
+};
+
+}
+
+#endif // MCT_MODEPROXY_AFFINITYTABLE_HPP
@@ -0,0 +1,278 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/CachedResolver.cpp
+ *
+ * @desc CachedResolver resolves host names asynchronously and remembers the answers for a while.
+ */
+
+#include <deque>
+#include <thread>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <condition_variable>
+
+#include <boost/asio/ip/tcp.hpp>
+
+#include <Logger/Logger.hpp>
+#include <ModeProxy/CachedResolver.hpp>
+
+namespace mct
+{
+
+/**
+ * Host names waiting for a lookup thread. Owned together by the resolver and its threads, so a thread stuck in
+ * a lookup does not keep the resolver alive and the resolver does not wait for it.
+ */
+class CachedResolver::LookupQueue
+{
+public:
+    LookupQueue() : m_is_stopped(false) {}
+
+    void push(const std::string& host, const std::weak_ptr<CachedResolver>& resolver)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_access);
+            m_hosts.push_back(std::make_pair(host, resolver));
+        }
+        m_ready.notify_one();
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_access);
+            m_is_stopped = true;
+            m_hosts.clear();
+        }
+        m_ready.notify_all();
+    }
+
+    static void run(const std::shared_ptr<LookupQueue>& queue)
+    {
+        // a synchronous lookup only needs the io_service to create the resolver, it is never run
+        boost::asio::io_service lookup_ios;
+        boost::asio::ip::tcp::resolver resolver(lookup_ios);
+
+        for (;;) {
+            std::pair< std::string, std::weak_ptr<CachedResolver> > next;
+            {
+                std::unique_lock<std::mutex> lock(queue->m_access);
+                queue->m_ready.wait(lock, [&queue]() { return queue->m_is_stopped || !queue->m_hosts.empty(); });
+                if (queue->m_is_stopped) {
+                    return;
+                }
+
+                next = queue->m_hosts.front();
+                queue->m_hosts.pop_front();
+            }
+
+            boost::system::error_code error;
+            boost::asio::ip::tcp::resolver::iterator it = resolver.resolve(boost::asio::ip::tcp::resolver::query(next.first, ""), error);
+
+            addresses_type addresses;
+            for (boost::asio::ip::tcp::resolver::iterator end; !error && it != end; ++it) {
+                if (std::find(addresses.begin(), addresses.end(), it->endpoint().address()) == addresses.end()) {
+                    addresses.push_back(it->endpoint().address());
+                }
+            }
+
+            if (std::shared_ptr<CachedResolver> owner = next.second.lock()) {
+                owner->post_answer(next.first, error, addresses);
+            }
+        }
+    }
+
+private:
+    std::mutex m_access;
+    std::condition_variable m_ready;
+    std::deque< std::pair< std::string, std::weak_ptr<CachedResolver> > > m_hosts;
+    bool m_is_stopped;
+};
+
+CachedResolver::CachedResolver(Logger& logger, boost::asio::io_service& ios, size_t max_entries, uint32_t ttl, uint32_t timeout, size_t num_of_threads)
+ : m_log(logger), m_ios(ios), m_max_entries(max_entries), m_ttl(ttl), m_timeout(timeout), m_num_of_threads((num_of_threads > 0) ? num_of_threads : 1),
+   m_num_of_lookups(0), m_num_of_hits(0)
+{
+}
+
+CachedResolver::~CachedResolver()
+{
+    if (m_queue) {
+        m_queue->stop();
+    }
+}
+
+void CachedResolver::async_resolve(const std::string& host, const handler_type& handler)
+{
+    boost::system::error_code error;
+    boost::asio::ip::address address = boost::asio::ip::address::from_string(host, error);
+
+    if (!error) {
+        m_ios.post(std::bind(handler, boost::system::error_code(), addresses_type(1, address)));
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_access);
+
+    auto entry = m_entries.find(host);
+    if (entry != m_entries.end()) {
+        if (entry->second.expires_at > std::chrono::steady_clock::now()) {
+            ++m_num_of_hits;
+            m_ios.post(std::bind(handler, boost::system::error_code(), entry->second.addresses));
+            return;
+        }
+
+        m_entries.erase(entry);
+    }
+
+    Lookup& lookup = m_pending[host];
+    lookup.handlers.push_back(handler);
+
+    if (lookup.handlers.size() == 1) {
+        start_lookup(host, lookup);
+    }
+}
+
+void CachedResolver::start_lookup(const std::string& host, Lookup& lookup)
+{
+    ++m_num_of_lookups;
+    m_log.debug("Resolving host %s.", host.c_str());
+
+    if (!m_queue) {
+        m_queue = std::make_shared<LookupQueue>();
+        for (size_t thread_num = 0; thread_num < m_num_of_threads; ++thread_num) {
+            std::thread(&LookupQueue::run, m_queue).detach();
+        }
+    }
+
+    lookup.work = std::make_shared<boost::asio::io_service::work>(m_ios);
+
+    if (m_timeout > 0) {
+        lookup.timer = std::make_shared<boost::asio::deadline_timer>(m_ios, boost::posix_time::seconds(m_timeout));
+        lookup.timer->async_wait(std::bind(&CachedResolver::handle_timeout, shared_from_this(), host, lookup.timer, std::placeholders::_1));
+    }
+
+    m_queue->push(host, shared_from_this());
+}
+
+void CachedResolver::post_answer(const std::string& host, const boost::system::error_code& error, const addresses_type& addresses)
+{
+    m_ios.post(std::bind(&CachedResolver::handle_resolve, shared_from_this(), host, error, addresses));
+}
+
+size_t CachedResolver::get_num_of_entries()
+{
+    std::lock_guard<std::mutex> lock(m_access);
+    return m_entries.size();
+}
+
+void CachedResolver::handle_resolve(const std::string& host, const boost::system::error_code& error, const addresses_type& addresses)
+{
+    std::vector<handler_type> waiting;
+    {
+        std::lock_guard<std::mutex> lock(m_access);
+
+        // failures are not remembered, the next session asks again
+        if (!error && !addresses.empty()) {
+            store(host, addresses);
+        }
+
+        // nobody waits anymore if the lookup has timed out
+        auto lookup = m_pending.find(host);
+        if (lookup != m_pending.end()) {
+            if (lookup->second.timer) {
+                lookup->second.timer->cancel();
+            }
+            waiting.swap(lookup->second.handlers);
+            m_pending.erase(lookup);
+        }
+    }
+
+    if (error) {
+        m_log.warning("Cannot resolve host %s: %s", host.c_str(), error.message().c_str());
+    } else {
+        m_log.debug("Resolved host %s to %u addresses.", host.c_str(), static_cast<unsigned>(addresses.size()));
+    }
+
+    for (auto& handler : waiting) {
+        handler(error, addresses);
+    }
+}
+
+void CachedResolver::handle_timeout(const std::string& host, const std::shared_ptr<boost::asio::deadline_timer>& timer, const boost::system::error_code& error)
+{
+    if (error == boost::asio::error::operation_aborted) {
+        return;
+    }
+
+    std::vector<handler_type> waiting;
+    {
+        std::lock_guard<std::mutex> lock(m_access);
+
+        // the lookup may have been answered meanwhile and the host name may already be resolved again
+        auto lookup = m_pending.find(host);
+        if (lookup == m_pending.end() || lookup->second.timer != timer) {
+            return;
+        }
+
+        waiting.swap(lookup->second.handlers);
+        m_pending.erase(lookup);
+    }
+
+    m_log.warning("Cannot resolve host %s: no answer within %u seconds.", host.c_str(), m_timeout);
+
+    for (auto& handler : waiting) {
+        handler(boost::asio::error::timed_out, addresses_type());
+    }
+}
+
+void CachedResolver::store(const std::string& host, const addresses_type& addresses)
+{
+    if (m_max_entries == 0 || m_ttl.count() == 0) {
+        return;
+    }
+
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    if (m_entries.size() >= m_max_entries) {
+        for (auto it = m_entries.begin(); it != m_entries.end(); ) {
+            it = (it->second.expires_at <= now) ? m_entries.erase(it) : std::next(it);
+        }
+    }
+
+    if (m_entries.size() >= m_max_entries) {
+        auto oldest = std::min_element(m_entries.begin(), m_entries.end(), [](const std::pair<const std::string, Entry>& left, const std::pair<const std::string, Entry>& right) {
+            return left.second.expires_at < right.second.expires_at;
+        });
+        m_entries.erase(oldest);
+    }
+
+    Entry& entry = m_entries[host];
+    entry.addresses = addresses;
+    entry.expires_at = now + m_ttl;
+}
+
+}
@@ -0,0 +1,130 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/CachedResolver.hpp
+ *
+ * @desc CachedResolver resolves host names asynchronously and remembers the answers for a while.
+ */
+
+#ifndef MCT_MODEPROXY_CACHEDRESOLVER_HPP
+#define MCT_MODEPROXY_CACHEDRESOLVER_HPP
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/address.hpp>
+#include <boost/asio/deadline_timer.hpp>
+
+#include <ModeProxy/Config.hpp>
+
+namespace mct
+{
+
+class Logger;
+
+/**
+ * Sessions connecting to the same host share one cache entry: answers are kept for ttl seconds and at most
+ * max_entries host names are remembered (the entry expiring first makes room for a new one). A host name
+ * which is already being resolved is not resolved again - all the sessions waiting for it get the same answer.
+ * IP addresses are never looked up.
+ *
+ * Lookups run on up to num_of_threads threads of the resolver, so a host name whose name servers do not answer
+ * holds up only one of them. Sessions which wait longer than timeout seconds (0 waits for ever) get
+ * boost::asio::error::timed_out, an answer which comes later is still remembered.
+ */
+class MCT_MODEPROXY_DLL_PUBLIC CachedResolver : public std::enable_shared_from_this<CachedResolver>
+{
+public:
+    typedef std::vector<boost::asio::ip::address> addresses_type;
+    typedef std::function<void (const boost::system::error_code&, const addresses_type&)> handler_type;
+
+    CachedResolver(Logger& logger, boost::asio::io_service& ios, size_t max_entries, uint32_t ttl, uint32_t timeout = 5, size_t num_of_threads = 4);
+    ~CachedResolver();
+
+    CachedResolver(const CachedResolver&) = delete;
+    CachedResolver& operator=(const CachedResolver&) = delete;
+
+    /**
+     * The handler is always called through the io_service, never from inside async_resolve().
+     */
+    void async_resolve(const std::string& host, const handler_type& handler);
+
+    size_t get_num_of_entries();
+    uint64_t get_num_of_lookups() const { return m_num_of_lookups; }
+    uint64_t get_num_of_hits() const { return m_num_of_hits; }
+
+protected:
+    struct Entry
+    {
+        addresses_type addresses;
+        std::chrono::steady_clock::time_point expires_at;
+    };
+
+    struct Lookup
+    {
+        // handlers waiting for the answer
+        std::vector<handler_type> handlers;
+        std::shared_ptr<boost::asio::deadline_timer> timer;
+        // the io_service keeps running while the lookup is on a thread of the resolver
+        std::shared_ptr<boost::asio::io_service::work> work;
+    };
+
+    class LookupQueue;
+
+    void start_lookup(const std::string& host, Lookup& lookup);
+    // called by the lookup threads
+    void post_answer(const std::string& host, const boost::system::error_code& error, const addresses_type& addresses);
+    void handle_resolve(const std::string& host, const boost::system::error_code& error, const addresses_type& addresses);
+    void handle_timeout(const std::string& host, const std::shared_ptr<boost::asio::deadline_timer>& timer, const boost::system::error_code& error);
+    void store(const std::string& host, const addresses_type& addresses);
+
+protected:
+    Logger& m_log;
+    boost::asio::io_service& m_ios;
+
+    const size_t m_max_entries;
+    const std::chrono::seconds m_ttl;
+    const uint32_t m_timeout;
+    const size_t m_num_of_threads;
+
+    std::mutex m_access;
+    std::map<std::string, Entry> m_entries;
+    std::map<std::string, Lookup> m_pending;
+    // shared with the lookup threads, which are started with the first lookup and are not joined - a lookup cannot be interrupted
+    std::shared_ptr<LookupQueue> m_queue;
+
+    uint64_t m_num_of_lookups;
+    uint64_t m_num_of_hits;
+};
+
+}
+
+#endif // MCT_MODEPROXY_CACHEDRESOLVER_HPP
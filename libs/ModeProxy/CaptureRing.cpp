@@ -0,0 +1,307 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/CaptureRing.cpp
+ *
+ * @desc CaptureRing stores timestamped traffic chunks in a ring of fixed-size memory-mapped files,
+ *  CaptureReader reads them back (e.g. for the replay mode).
+ */
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#if !defined(WIN32)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+#include <ModeProxy/CaptureRing.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+const char capture_magic[8] = { 'M', 'C', 'T', 'C', 'A', 'P', '0', '1' };
+const uint64_t capture_file_header_size = 64;
+const uint64_t capture_record_header_size = 24;
+
+// offsets inside the file header
+const uint64_t header_file_size_offset = 8;
+const uint64_t header_sequence_offset = 16;
+const uint64_t header_used_bytes_offset = 24;
+
+uint64_t align_to_8(uint64_t value)
+{
+    return (value + 7) & ~static_cast<uint64_t>(7);
+}
+
+template <typename T>
+void store(unsigned char* dst, const T& value)
+{
+    std::memcpy(dst, &value, sizeof(T));
+}
+
+template <typename T>
+T load(const unsigned char* src)
+{
+    T value;
+    std::memcpy(&value, src, sizeof(T));
+    return value;
+}
+
+}
+
+CaptureRing::CaptureRing(const std::string& prefix, uint64_t file_size, uint16_t file_count)
+ : m_prefix(prefix), m_file_size(align_to_8(file_size)), m_file_count((file_count > 0) ? file_count : 1),
+   m_file_index(0), m_sequence(0), m_last_session_id(0), m_lock_handle(-1), m_begin(nullptr), m_used_bytes(0)
+{
+    if (m_file_size < capture_file_header_size + capture_record_header_size + 8) {
+        throw std::runtime_error(std::string("Capture file size is too small for '") + m_prefix + std::string("'"));
+    }
+
+    lock_prefix();
+
+    try {
+        // files left by a previous run would be mixed into this capture by CaptureReader
+        for (uint16_t index = m_file_count; boost::filesystem::exists(get_file_name(m_prefix, index)); ++index) {
+            boost::filesystem::remove(get_file_name(m_prefix, index));
+        }
+
+        for (uint16_t index = 0; index < m_file_count; ++index) {
+            create_file(index);
+        }
+    } catch (...) {
+#if !defined(WIN32)
+        ::close(m_lock_handle);
+#endif
+        throw;
+    }
+
+    switch_file(0);
+}
+
+CaptureRing::~CaptureRing()
+{
+    m_regions[m_file_index]->flush();
+
+#if !defined(WIN32)
+    // closing the handle releases the lock, the lock file itself stays for the next ring
+    ::close(m_lock_handle);
+#endif
+}
+
+std::string CaptureRing::get_file_name(const std::string& prefix, uint16_t index)
+{
+    return prefix + std::string(".") + boost::lexical_cast<std::string>(index);
+}
+
+std::string CaptureRing::get_lock_file_name(const std::string& prefix)
+{
+    return prefix + std::string(".lock");
+}
+
+void CaptureRing::lock_prefix()
+{
+#if !defined(WIN32)
+    // flock() locks belong to the open file, so a second ring of the same process (e.g. after a reload) is refused as well
+    const std::string file_name = get_lock_file_name(m_prefix);
+
+    m_lock_handle = ::open(file_name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (m_lock_handle < 0) {
+        throw std::runtime_error(std::string("Could not create capture lock file '") + file_name + std::string("'"));
+    }
+
+    if (::flock(m_lock_handle, LOCK_EX | LOCK_NB) != 0) {
+        ::close(m_lock_handle);
+        throw std::runtime_error(std::string("Capture files '") + m_prefix + std::string("' are in use by another capture"));
+    }
+#endif
+}
+
+void CaptureRing::create_file(uint16_t index)
+{
+    const std::string file_name = get_file_name(m_prefix, index);
+
+    try {
+        // a new file instead of truncating the old one, whoever still maps the old one keeps reading its records
+        boost::filesystem::remove(file_name);
+
+        {   // an empty file, CaptureReader accepts it before the ring gets to it
+            unsigned char header[capture_file_header_size] = { 0 };
+            std::memcpy(header, capture_magic, sizeof(capture_magic));
+            store(header + header_file_size_offset, m_file_size);
+            store(header + header_used_bytes_offset, capture_file_header_size);
+
+            std::ofstream create(file_name.c_str(), std::ios::binary | std::ios::trunc);
+            if (!create.write(reinterpret_cast<const char*>(header), sizeof(header))) {
+                throw std::runtime_error("cannot write the file header");
+            }
+        }
+        // the final size right away, so the file never grows after being mapped
+        boost::filesystem::resize_file(file_name, m_file_size);
+
+        boost::interprocess::file_mapping mapping(file_name.c_str(), boost::interprocess::read_write);
+        m_regions.emplace_back(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_write, 0, m_file_size));
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string("Could not create capture file '") + file_name + std::string("': ") + e.what());
+    }
+}
+
+void CaptureRing::switch_file(uint16_t index)
+{
+    if (m_begin) {
+        m_regions[m_file_index]->flush(0, 0, true); // asynchronous flush, the kernel writes pages back on its own anyway
+    }
+
+    m_file_index = index;
+    m_begin = static_cast<unsigned char*>(m_regions[m_file_index]->get_address());
+    m_used_bytes = capture_file_header_size;
+
+    // records of the previous round are dropped before the file becomes the newest one
+    store(m_begin + header_used_bytes_offset, m_used_bytes);
+    store(m_begin + header_sequence_offset, ++m_sequence);
+}
+
+void CaptureRing::append(uint64_t session_id, capture_direction direction, const unsigned char* data, size_t length)
+{
+    const uint64_t timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    const uint64_t max_payload = m_file_size - capture_file_header_size - capture_record_header_size;
+
+    do {
+        const uint32_t chunk = static_cast<uint32_t>((std::min)(static_cast<uint64_t>(length), max_payload));
+        append_record(timestamp_ns, session_id, direction, data, chunk);
+        data += chunk;
+        length -= chunk;
+    } while (length > 0);
+}
+
+void CaptureRing::append_record(uint64_t timestamp_ns, uint64_t session_id, capture_direction direction, const unsigned char* data, uint32_t length)
+{
+    const uint64_t record_size = align_to_8(capture_record_header_size + length);
+
+    if (m_used_bytes + record_size > m_file_size) {
+        switch_file(static_cast<uint16_t>((m_file_index + 1) % m_file_count));
+    }
+
+    unsigned char* record = m_begin + m_used_bytes;
+    store(record, timestamp_ns);
+    store(record + 8, session_id);
+    store(record + 16, length);
+    record[20] = static_cast<unsigned char>(direction);
+    record[21] = record[22] = record[23] = 0;
+
+    if (length > 0) {
+        std::memcpy(record + capture_record_header_size, data, length);
+    }
+
+    // published last, so a reader never sees a partially written record
+    m_used_bytes += record_size;
+    store(m_begin + header_used_bytes_offset, m_used_bytes);
+}
+
+CaptureReader::CaptureReader(const std::string& prefix, uint16_t max_file_count)
+ : m_region_index(0), m_offset(capture_file_header_size)
+{
+    std::vector< std::pair< uint64_t, std::unique_ptr<boost::interprocess::mapped_region> > > found;
+
+    for (uint16_t index = 0; index < max_file_count; ++index) {
+        const std::string file_name = CaptureRing::get_file_name(prefix, index);
+
+        if (!boost::filesystem::exists(file_name)) {
+            break;
+        }
+
+        boost::interprocess::file_mapping mapping(file_name.c_str(), boost::interprocess::read_only);
+        std::unique_ptr<boost::interprocess::mapped_region> region(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_only));
+
+        const unsigned char* begin = static_cast<const unsigned char*>(region->get_address());
+
+        if (region->get_size() < capture_file_header_size || std::memcmp(begin, capture_magic, sizeof(capture_magic)) != 0 ||
+            load<uint64_t>(begin + header_used_bytes_offset) > region->get_size()) {
+            throw std::runtime_error(std::string("'") + file_name + std::string("' is not a valid capture file"));
+        }
+
+        found.push_back(std::make_pair(load<uint64_t>(begin + header_sequence_offset), std::move(region)));
+    }
+
+    if (found.empty()) {
+        throw std::runtime_error(std::string("No capture files found for '") + prefix + std::string("'"));
+    }
+
+    std::sort(found.begin(), found.end(), [](const std::pair< uint64_t, std::unique_ptr<boost::interprocess::mapped_region> >& lhs,
+                                             const std::pair< uint64_t, std::unique_ptr<boost::interprocess::mapped_region> >& rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    for (auto& file : found) {
+        m_regions.push_back(std::move(file.second));
+    }
+}
+
+CaptureReader::~CaptureReader()
+{
+}
+
+bool CaptureReader::next(CaptureRecord& record)
+{
+    while (m_region_index < m_regions.size()) {
+        const unsigned char* begin = static_cast<const unsigned char*>(m_regions[m_region_index]->get_address());
+        const uint64_t used_bytes = load<uint64_t>(begin + header_used_bytes_offset);
+
+        if (m_offset + capture_record_header_size <= used_bytes) {
+            const unsigned char* header = begin + m_offset;
+            const uint32_t length = load<uint32_t>(header + 16);
+
+            if (m_offset + capture_record_header_size + length <= used_bytes) {
+                record.timestamp_ns = load<uint64_t>(header);
+                record.session_id = load<uint64_t>(header + 8);
+                record.length = length;
+                record.direction = static_cast<capture_direction>(header[20]);
+                record.data = header + capture_record_header_size;
+
+                m_offset += align_to_8(capture_record_header_size + length);
+                return true;
+            }
+        }
+
+        ++m_region_index;
+        m_offset = capture_file_header_size;
+    }
+
+    return false;
+}
+
+}
@@ -0,0 +1,156 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/CaptureRing.hpp
+ *
+ * @desc CaptureRing stores timestamped traffic chunks in a ring of fixed-size memory-mapped files,
+ *  CaptureReader reads them back (e.g. for the replay mode).
+ */
+
+#ifndef MCT_MODEPROXY_CAPTURERING_HPP
+#define MCT_MODEPROXY_CAPTURERING_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <ModeProxy/Config.hpp>
+
+namespace boost
+{
+    namespace interprocess
+    {
+        class mapped_region;
+    }
+}
+
+namespace mct
+{
+
+/**
+ * On-disk layout (native byte order), every file is <prefix>.<index> and exactly file_size bytes long. Files which
+ * have not been written yet have sequence 0 and no records.
+ *
+ * file header (capture_file_header_size bytes):
+ *   char[8] magic "MCTCAP01", uint64 file_size, uint64 sequence (grows with every file switch), uint64 used_bytes
+ * records, each aligned to 8 bytes:
+ *   uint64 timestamp (ns since epoch), uint64 session_id, uint32 length, uint8 direction, uint8[3] padding, length bytes of data
+ */
+enum capture_direction
+{
+    capture_client_to_remote = 0,
+    capture_remote_to_client = 1,
+    capture_session_open = 2,
+    capture_session_close = 3
+};
+
+struct CaptureRecord
+{
+    uint64_t timestamp_ns;
+    uint64_t session_id;
+    capture_direction direction;
+    const unsigned char* data;
+    uint32_t length;
+};
+
+class MCT_MODEPROXY_DLL_PUBLIC CaptureRing
+{
+public:
+    /**
+     * All the files are created and mapped up front, so switching files never touches the disk. <prefix>.lock is
+     * held while the ring exists; throws std::runtime_error if another ring owns the prefix or if the files cannot
+     * be created or mapped.
+     */
+    CaptureRing(const std::string& prefix, uint64_t file_size, uint16_t file_count);
+    ~CaptureRing();
+
+    CaptureRing(const CaptureRing&) = delete;
+    CaptureRing& operator=(const CaptureRing&) = delete;
+
+    const std::string& get_prefix() const { return m_prefix; }
+
+    uint64_t next_session_id() { return ++m_last_session_id; }
+
+    /**
+     * Appends one chunk. Not thread-safe - all sessions of the ring have to run on the same io_service thread.
+     * Chunks larger than a file are split into several records.
+     */
+    void append(uint64_t session_id, capture_direction direction, const unsigned char* data, size_t length);
+
+    static std::string get_file_name(const std::string& prefix, uint16_t index);
+
+    static std::string get_lock_file_name(const std::string& prefix);
+
+protected:
+    void lock_prefix();
+    void create_file(uint16_t index);
+    void switch_file(uint16_t index);
+    void append_record(uint64_t timestamp_ns, uint64_t session_id, capture_direction direction, const unsigned char* data, uint32_t length);
+
+protected:
+    const std::string m_prefix;
+    const uint64_t m_file_size;
+    const uint16_t m_file_count;
+
+    uint16_t m_file_index;
+    uint64_t m_sequence;
+    uint64_t m_last_session_id;
+
+    int m_lock_handle;
+    std::vector< std::unique_ptr<boost::interprocess::mapped_region> > m_regions;
+    unsigned char* m_begin;
+    uint64_t m_used_bytes;
+};
+
+class MCT_MODEPROXY_DLL_PUBLIC CaptureReader
+{
+public:
+    /**
+     * Maps every existing <prefix>.<index> file (index < max_file_count), oldest first.
+     * Throws std::runtime_error if no capture file can be found.
+     */
+    CaptureReader(const std::string& prefix, uint16_t max_file_count = 1024);
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    /**
+     * Returns false when there are no more records. record.data points into the mapped file
+     * and stays valid as long as the reader exists.
+     */
+    bool next(CaptureRecord& record);
+
+    size_t get_num_of_files() const { return m_regions.size(); }
+
+protected:
+    std::vector< std::unique_ptr<boost::interprocess::mapped_region> > m_regions;
+    size_t m_region_index;
+    uint64_t m_offset;
+};
+
+}
+
+#endif // MCT_MODEPROXY_CAPTURERING_HPP
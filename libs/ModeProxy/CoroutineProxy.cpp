@@ -0,0 +1,96 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/CoroutineProxy.cpp
+ *
+ * @desc CoroutineProxy is a session which pumps data with stackless coroutines instead of callback chains.
+ */
+
+#include <boost/asio/write.hpp>
+#include <boost/asio/coroutine.hpp>
+
+#include <ModeProxy/CoroutineProxy.hpp>
+
+#include <boost/asio/yield.hpp>
+
+namespace mct
+{
+
+/**
+ * Moves data in one direction - from the client to the remote endpoint (upstream) or back.
+ */
+class CoroutineProxy::Pump : boost::asio::coroutine
+{
+public:
+	Pump(const std::shared_ptr<CoroutineProxy>& session, bool is_upstream) : m_session(session), m_is_upstream(is_upstream) {}
+
+	void operator()(const boost::system::error_code& error = boost::system::error_code(), size_t bytes_transferred = 0)
+	{
+		CoroutineProxy& session = *m_session;
+		Proxy::socket_type& source = m_is_upstream ? session.m_client_socket : session.m_remote_socket;
+		Proxy::socket_type& destination = m_is_upstream ? session.m_remote_socket : session.m_client_socket;
+		unsigned char* data = m_is_upstream ? session.m_client_data : session.m_remote_data;
+
+		reenter (this) {
+			for (;;) {
+				yield source.async_read_some(boost::asio::buffer(data, m_max_data_length), *this);
+
+				if (error) {
+					m_is_upstream ? session.handle_client_read_error(error) : session.handle_remote_read_error(error);
+					yield break;
+				}
+
+				m_is_upstream ? session.process_client_data(bytes_transferred) : session.process_remote_data(bytes_transferred);
+
+				yield boost::asio::async_write(destination, boost::asio::buffer(data, bytes_transferred), *this);
+
+				if (error) {
+					m_is_upstream ? session.handle_remote_write_error(error) : session.handle_client_write_error(error);
+					yield break;
+				}
+			}
+		}
+	}
+
+private:
+	std::shared_ptr<CoroutineProxy> m_session;
+	bool m_is_upstream;
+};
+
+CoroutineProxy::CoroutineProxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, uint16_t backend_num)
+ : Proxy(logger, ios, route, backend_num)
+{
+}
+
+void CoroutineProxy::start_pumps()
+{
+	auto self = std::static_pointer_cast<CoroutineProxy>(shared_from_this());
+
+	Pump(self, false)();
+	Pump(self, true)();
+}
+
+}
+
+#include <boost/asio/unyield.hpp>
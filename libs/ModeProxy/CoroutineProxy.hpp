@@ -0,0 +1,57 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/CoroutineProxy.hpp
+ *
+ * @desc CoroutineProxy is a session which pumps data with stackless coroutines instead of callback chains.
+ */
+
+#ifndef MCT_MODEPROXY_COROUTINEPROXY_HPP
+#define MCT_MODEPROXY_COROUTINEPROXY_HPP
+
+#include <ModeProxy/Proxy.hpp>
+
+namespace mct
+{
+
+/**
+ * Each direction is a single loop (read from one endpoint, write to the other one), written as a stackless
+ * coroutine. The coroutine state is a few bytes copied along with the handler, so the loop can be extended
+ * (timeouts, shaping, protocol parsing) without adding more callbacks or allocations to the session.
+ */
+class CoroutineProxy : public Proxy
+{
+public:
+    CoroutineProxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, uint16_t backend_num = 0);
+
+protected:
+    void start_pumps() override;
+
+protected:
+    class Pump;
+};
+
+}
+
+#endif // MCT_MODEPROXY_COROUTINEPROXY_HPP
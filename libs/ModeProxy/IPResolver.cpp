@@ -27,10 +27,14 @@
  * @desc IPResolver can be used to translate a hostname to IP address (using DNS).
  */
 
+#include <memory>
+#include <stdexcept>
+
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
 #include <ModeProxy/IPResolver.hpp>
+#include <ModeProxy/StreamEndpoint.hpp>
 #include <Logger/Logger.hpp>
 
 namespace mct
@@ -40,13 +44,15 @@ class IPResolverImpl
 {
 public:
     IPResolverImpl(Logger& logger, boost::asio::io_service& ios);
+    IPResolverImpl(Logger& logger, const std::map<std::string, std::string>& resolved);
 
     std::string resolve_only_first_ip(const std::string& address);
 
 private:
     Logger& m_log;
-    boost::asio::io_service& m_ios;
-    boost::asio::ip::tcp::resolver m_resolver;
+    // null if the answers are known beforehand
+    std::unique_ptr<boost::asio::ip::tcp::resolver> m_resolver;
+    std::map<std::string, std::string> m_resolved;
 };
 
 IPResolver::IPResolver(Logger& logger, boost::asio::io_service& ios)
@@ -54,6 +60,11 @@ IPResolver::IPResolver(Logger& logger, boost::asio::io_service& ios)
 {
 }
 
+IPResolver::IPResolver(Logger& logger, const std::map<std::string, std::string>& resolved)
+ : m_pImpl(new IPResolverImpl(logger, resolved))
+{
+}
+
 IPResolver::~IPResolver()
 {
     delete m_pImpl;
@@ -72,14 +83,32 @@ std::string IPResolver::resolve_only_first_ip(const std::string& address)
  **************************************************************************/
 
 IPResolverImpl::IPResolverImpl(Logger& logger, boost::asio::io_service& ios)
- : m_log(logger), m_ios(ios), m_resolver(m_ios)
+ : m_log(logger), m_resolver(new boost::asio::ip::tcp::resolver(ios))
+{
+}
+
+IPResolverImpl::IPResolverImpl(Logger& logger, const std::map<std::string, std::string>& resolved)
+ : m_log(logger), m_resolved(resolved)
 {
 }
 
 std::string IPResolverImpl::resolve_only_first_ip(const std::string& address)
 {
+    // Unix domain socket names are used as they are
+    if (StreamEndpoint::is_local(address)) {
+        return address;
+    }
+
+    if (!m_resolver) {
+        auto resolved = m_resolved.find(address);
+        if (resolved == m_resolved.end()) {
+            throw std::runtime_error("Host " + address + " could not be resolved.");
+        }
+        return resolved->second;
+    }
+
     boost::asio::ip::tcp::resolver::query query_local(address, "");
-    auto i = m_resolver.resolve(query_local);
+    auto i = m_resolver->resolve(query_local);
     boost::asio::ip::tcp::endpoint iend = *i;
     std::string ip = iend.address().to_string();
 
@@ -30,6 +30,7 @@
 #ifndef MCT_MODEPROXY_IPRESOLVER_HPP
 #define MCT_MODEPROXY_IPRESOLVER_HPP
 
+#include <map>
 #include <string>
 
 #include <ModeProxy/Config.hpp>
@@ -44,11 +45,17 @@ class MCT_MODEPROXY_DLL_PUBLIC IPResolver
 {
 public:
     IPResolver(Logger& logger, boost::asio::io_service& ios);
+    /**
+     * Answers only from resolved (host name -> IP address), host names missing from it fail like unknown hosts.
+     * It never blocks, so it is used where the names have been resolved asynchronously beforehand.
+     */
+    IPResolver(Logger& logger, const std::map<std::string, std::string>& resolved);
     ~IPResolver();
 
     IPResolver(const IPResolver&) = delete;
     IPResolver& operator=(const IPResolver&) = delete;
 
+    // names of Unix domain sockets (see StreamEndpoint) are returned unchanged
     std::string resolve_only_first_ip(const std::string& address);
 
 private:
@@ -0,0 +1,278 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/ListenerHandoff.cpp
+ *
+ * @desc ListenerHandoff passes bound listening sockets from a running instance to its successor
+ *  over a Unix domain socket (SCM_RIGHTS), so the program can be upgraded without refusing connections.
+ */
+
+#include <ModeProxy/ListenerHandoff.hpp>
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+#include <cerrno>
+#include <sstream>
+#include <cstring>
+#include <functional>
+
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <Logger/Logger.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+const char handoff_end_message[] = "end";
+const char handoff_confirmation[] = "ok\n";
+const size_t handoff_max_message_length = 512;
+
+}
+
+ListenerHandoff::ListenerHandoff(Logger& logger, boost::asio::io_service& ios, const std::string& socket_path)
+ : m_log(logger), m_ios(ios), m_socket_path(socket_path), m_acceptor(m_ios), m_peer(m_ios)
+{
+}
+
+ListenerHandoff::~ListenerHandoff()
+{
+}
+
+ListenerHandoff::handles_type ListenerHandoff::receive_listeners()
+{
+    handles_type handles;
+
+    boost::system::error_code error;
+    m_peer.connect(boost::asio::local::stream_protocol::endpoint(m_socket_path), error);
+
+    if (error) {
+        m_log.debug("No running instance at handoff socket %s (%s), listeners are going to be bound.", m_socket_path.c_str(), error.message().c_str());
+        m_peer.close(error);
+        return handles;
+    }
+
+    // the previous instance answers immediately; do not hang forever if it is stuck
+    struct timeval timeout = { 5, 0 };
+    ::setsockopt(m_peer.native_handle(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    while (true) {
+        char message[handoff_max_message_length];
+        char control[CMSG_SPACE(sizeof(int))];
+
+        struct iovec iov;
+        iov.iov_base = message;
+        iov.iov_len = sizeof(message) - 1;
+
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t length = ::recvmsg(m_peer.native_handle(), &msg, 0);
+        if (length <= 0) {
+            m_log.error("Handoff from %s has been interrupted, listeners are going to be bound.", m_socket_path.c_str());
+            break;
+        }
+
+        int handle = -1;
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                std::memcpy(&handle, CMSG_DATA(cmsg), sizeof(int));
+            }
+        }
+
+        // every message is "<host>:<port>" (or the terminating "end"), sent with a single sendmsg()
+        message[length] = '\0';
+        std::istringstream parser(message);
+        std::string key;
+        parser >> key;
+
+        if (key == handoff_end_message && handle < 0) {
+            m_log.info("Received %u listening sockets from the running instance at %s.", static_cast<unsigned>(handles.size()), m_socket_path.c_str());
+            return handles;
+        }
+
+        if (handle < 0 || !parser) {
+            m_log.error("Received malformed handoff message from %s.", m_socket_path.c_str());
+            if (handle >= 0) {
+                ::close(handle);
+            }
+            break;
+        }
+
+        handles[key] = handle;
+    }
+
+    // a partial handoff is not used at all - the previous instance keeps its sockets
+    for (auto& handle : handles) {
+        ::close(handle.second);
+    }
+    handles.clear();
+    m_peer.close(error);
+
+    return handles;
+}
+
+void ListenerHandoff::confirm_takeover()
+{
+    if (!m_peer.is_open()) {
+        return;
+    }
+
+    boost::system::error_code error;
+    boost::asio::write(m_peer, boost::asio::buffer(handoff_confirmation, m_confirmation_length), error);
+
+    if (error) {
+        m_log.warning("Could not confirm the takeover to the previous instance: %s", error.message().c_str());
+    }
+
+    m_peer.close(error);
+}
+
+void ListenerHandoff::serve(const std::function<handles_type ()>& get_listeners, const std::function<void ()>& on_handed_off)
+{
+    m_get_listeners = get_listeners;
+    m_on_handed_off = on_handed_off;
+
+    // the path may be left by a crashed instance or still be used by the previous one, which does not need it anymore
+    ::unlink(m_socket_path.c_str());
+
+    boost::asio::local::stream_protocol::endpoint endpoint(m_socket_path);
+    m_acceptor.open(endpoint.protocol());
+    m_acceptor.bind(endpoint);
+    m_acceptor.listen();
+
+    m_log.info("Waiting for the next instance at handoff socket %s.", m_socket_path.c_str());
+
+    start_accept();
+}
+
+void ListenerHandoff::close()
+{
+    boost::system::error_code ignored;
+    m_acceptor.close(ignored);
+    m_peer.close(ignored);
+}
+
+void ListenerHandoff::start_accept()
+{
+    m_acceptor.async_accept(m_peer, std::bind(&ListenerHandoff::handle_accept, shared_from_this(), std::placeholders::_1));
+}
+
+void ListenerHandoff::handle_accept(const boost::system::error_code& error)
+{
+    if (error) {
+        if (error != boost::asio::error::operation_aborted) {
+            m_log.error("Handoff socket %s could not accept connection: %s", m_socket_path.c_str(), error.message().c_str());
+        }
+        return;
+    }
+
+    m_log.info("Next instance connected to handoff socket %s, passing listening sockets.", m_socket_path.c_str());
+
+    bool is_sent = true;
+    for (auto& listener : m_get_listeners()) {
+        is_sent = is_sent && send_handle(listener.first, listener.second);
+    }
+    is_sent = is_sent && send_handle(handoff_end_message, -1);
+
+    if (!is_sent) {
+        boost::system::error_code ignored;
+        m_peer.close(ignored);
+        start_accept();
+        return;
+    }
+
+    boost::asio::async_read(m_peer, boost::asio::buffer(m_confirmation, m_confirmation_length),
+        std::bind(&ListenerHandoff::handle_confirmation, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+}
+
+void ListenerHandoff::handle_confirmation(const boost::system::error_code& error, size_t bytes_transferred)
+{
+    // async_read either fails or fills the whole confirmation
+    (void)bytes_transferred;
+
+    if (error || std::memcmp(m_confirmation, handoff_confirmation, m_confirmation_length) != 0) {
+        // the next instance did not make it - keep accepting and wait for another one
+        m_log.warning("Next instance did not confirm the takeover, still serving connections.");
+
+        boost::system::error_code ignored;
+        m_peer.close(ignored);
+        start_accept();
+        return;
+    }
+
+    m_log.info("Next instance has taken over the listening sockets.");
+
+    close();
+    m_on_handed_off();
+}
+
+bool ListenerHandoff::send_handle(const std::string& message, int handle)
+{
+    char control[CMSG_SPACE(sizeof(int))];
+    std::memset(control, 0, sizeof(control));
+
+    struct iovec iov;
+    iov.iov_base = const_cast<char*>(message.data());
+    iov.iov_len = message.size();
+
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if (handle >= 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &handle, sizeof(int));
+    }
+
+    if (::sendmsg(m_peer.native_handle(), &msg, MSG_NOSIGNAL) != static_cast<ssize_t>(message.size())) {
+        m_log.error("Could not pass listening socket '%s' to the next instance: %s", message.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+}
+
+#endif // BOOST_ASIO_HAS_LOCAL_SOCKETS
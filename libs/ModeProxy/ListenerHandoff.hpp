@@ -0,0 +1,115 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/ListenerHandoff.hpp
+ *
+ * @desc ListenerHandoff passes bound listening sockets from a running instance to its successor
+ *  over a Unix domain socket (SCM_RIGHTS), so the program can be upgraded without refusing connections.
+ */
+
+#ifndef MCT_MODEPROXY_LISTENERHANDOFF_HPP
+#define MCT_MODEPROXY_LISTENERHANDOFF_HPP
+
+#include <map>
+#include <memory>
+#include <string>
+#include <functional>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+
+#include <ModeProxy/Config.hpp>
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+namespace mct
+{
+
+class Logger;
+
+/**
+ * The running instance serves the handoff socket. A new instance connects to it, receives one message per listening
+ * socket ("<host>:<port>" with the descriptor attached) followed by "end", adopts the descriptors and confirms with "ok".
+ * Only then the old instance closes its own copies of the descriptors (the sockets stay open in the new instance),
+ * so the listening sockets never go away and no connection is refused.
+ */
+class MCT_MODEPROXY_DLL_PUBLIC ListenerHandoff : public std::enable_shared_from_this<ListenerHandoff>
+{
+public:
+    // "<host>:<port>" -> listening socket descriptor
+    typedef std::map<std::string, int> handles_type;
+
+    ListenerHandoff(Logger& logger, boost::asio::io_service& ios, const std::string& socket_path);
+    ~ListenerHandoff();
+
+    ListenerHandoff(const ListenerHandoff&) = delete;
+    ListenerHandoff& operator=(const ListenerHandoff&) = delete;
+
+    /**
+     * Takes over the listening sockets of the instance which serves socket_path.
+     * Returns nothing when there is no such instance (e.g. the first start).
+     */
+    handles_type receive_listeners();
+
+    /**
+     * Tells the previous instance that its sockets are in use now, so it can stop accepting and drain.
+     */
+    void confirm_takeover();
+
+    /**
+     * Serves socket_path for the next instance. get_listeners is called when the next instance connects,
+     * on_handed_off when it has confirmed the takeover.
+     */
+    void serve(const std::function<handles_type ()>& get_listeners, const std::function<void ()>& on_handed_off);
+    void close();
+
+protected:
+    void start_accept();
+    void handle_accept(const boost::system::error_code& error);
+    void handle_confirmation(const boost::system::error_code& error, size_t bytes_transferred);
+
+    bool send_handle(const std::string& message, int handle);
+
+protected:
+    Logger& m_log;
+    boost::asio::io_service& m_ios;
+
+    const std::string m_socket_path;
+
+    boost::asio::local::stream_protocol::acceptor m_acceptor;
+    // the next instance (when serving) or the previous instance (when taking over)
+    boost::asio::local::stream_protocol::socket m_peer;
+
+    std::function<handles_type ()> m_get_listeners;
+    std::function<void ()> m_on_handed_off;
+
+    enum { m_confirmation_length = 3 };
+    char m_confirmation[m_confirmation_length];
+};
+
+}
+
+#endif // BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+#endif // MCT_MODEPROXY_LISTENERHANDOFF_HPP
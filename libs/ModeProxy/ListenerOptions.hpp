@@ -0,0 +1,109 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/ListenerOptions.hpp
+ *
+ * @desc Per-listener settings, shared (read-only) by the listener and all of its sessions.
+ */
+
+#ifndef MCT_MODEPROXY_LISTENEROPTIONS_HPP
+#define MCT_MODEPROXY_LISTENEROPTIONS_HPP
+
+#include <memory>
+#include <functional>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include <ModeProxy/SocketOptions.hpp>
+
+namespace boost
+{
+    namespace asio
+    {
+        class io_service;
+    }
+}
+
+namespace mct
+{
+
+class Proxy;
+class Logger;
+struct ProxyRoute;
+class CaptureRing;
+class AffinityTable;
+
+struct ListenerOptions
+{
+    enum session_engine_type { callback_engine, coroutine_engine };
+    // proxy_protocol_any is only meaningful for accepting headers
+    enum proxy_protocol_type { proxy_protocol_none, proxy_protocol_v1, proxy_protocol_v2, proxy_protocol_any };
+
+    typedef std::function<std::shared_ptr<Proxy> (Logger&, boost::asio::io_service&, const std::shared_ptr<const ProxyRoute>&)> session_factory_type;
+
+    ListenerOptions() : shadow_port(0), shadow_buffer_size(0), shadow_close_timeout(0), accept_batch_size(64), session_engine(callback_engine), affinity_by_prefix(false),
+        send_proxy_protocol(proxy_protocol_none), accept_proxy_protocol(proxy_protocol_none) {}
+
+    // client -> remote bytes are duplicated to this endpoint (responses are discarded); empty host disables shadowing
+    std::string shadow_host;
+    uint16_t shadow_port;
+    // maximum number of bytes queued for the shadow endpoint per session, excess is dropped
+    uint64_t shadow_buffer_size;
+    // milliseconds a closed session waits for its queued shadow bytes, then the shadow connection is closed anyway
+    uint32_t shadow_close_timeout;
+
+    // traffic of all sessions is appended here, if set; may be shared by several listeners
+    std::shared_ptr<CaptureRing> capture;
+
+    // maximum number of connections accepted each time the listener is woken up
+    uint16_t accept_batch_size;
+
+    // implementation of the sessions started by the listener
+    session_engine_type session_engine;
+    // creates the sessions instead of session_engine, if set - used by modes whose sessions speak a protocol before pumping data
+    session_factory_type session_factory;
+
+    // (ip, port) of backends used next to the remote endpoint of the listener, new sessions take turns between all of them
+    std::vector< std::pair<std::string, uint16_t> > extra_backends;
+
+    // clients are pinned to the backend they were sent to first, if set; the table belongs to this listener only
+    std::shared_ptr<AffinityTable> affinity;
+    // whole /24 (IPv6: /64) client networks are pinned instead of single addresses
+    bool affinity_by_prefix;
+
+    // a PROXY protocol header with the address of the client is sent to the backend before any data of the client
+    proxy_protocol_type send_proxy_protocol;
+    // clients (i.e. a load balancer in front of the listener) have to start with a PROXY protocol header,
+    // its source address is used as the address of the client from then on
+    proxy_protocol_type accept_proxy_protocol;
+
+    // kernel options of the listening socket and of both sockets of every session
+    SocketOptions socket_options;
+};
+
+}
+
+#endif // MCT_MODEPROXY_LISTENEROPTIONS_HPP
@@ -28,26 +28,65 @@
  */
 
 
+#include <set>
+#include <utility>
+#include <chrono>
 #include <memory>
+#include <thread>
 #include <sstream>
+#include <csignal>
 #include <cstdlib>
 #include <cstddef>
+#include <stdexcept>
 #include <algorithm>
+#include <functional>
+
+#include <unistd.h>
 
 #include <Logger/Logger.hpp>
 #include <Configuration/Configuration.hpp>
+#include <Configuration/ConfigurationBuilder.hpp>
 
 #include <boost/asio/io_service.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include <ModeProxy/ModeProxy.hpp>
 #include <ModeProxy/IPResolver.hpp>
+#include <ModeProxy/CachedResolver.hpp>
 #include <ModeProxy/ProxyManager.hpp>
 #include <ModeProxy/ProxyListener.hpp>
+#include <ModeProxy/CaptureRing.hpp>
+#include <ModeProxy/AffinityTable.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeProxy/ListenerHandoff.hpp>
+#include <ModeProxy/StreamEndpoint.hpp>
+#include <ModeProxy/PortRange.hpp>
+#include <ModeProxy/ProxyRoute.hpp>
 
 namespace mct
 {
 
-ModeProxy::ModeProxy(Configuration& config, Logger& logger) : Mode(config, logger)
+namespace
+{
+
+ListenerOptions::proxy_protocol_type get_proxy_protocol(const std::string& version)
+{
+    if (version == "v1") {
+        return ListenerOptions::proxy_protocol_v1;
+    } else if (version == "v2") {
+        return ListenerOptions::proxy_protocol_v2;
+    } else if (version == "any") {
+        return ListenerOptions::proxy_protocol_any;
+    }
+
+    return ListenerOptions::proxy_protocol_none;
+}
+
+}
+
+ModeProxy::ModeProxy(Configuration& config, Logger& logger) : Mode(config, logger), m_reload_generation(0), m_run_state(nullptr)
 {
 }
 
@@ -61,40 +100,170 @@ const std::string& ModeProxy::get_name() const
     return proxy_name;
 }
 
-bool ModeProxy::validate_configuration() const
+bool ModeProxy::validate_configuration(const Configuration& config) const
 {
-    if (m_config.get_mode_proxy_local_hosts().size() != m_config.get_mode_proxy_remote_hosts().size() != m_config.get_mode_proxy_local_ports().size() != m_config.get_mode_proxy_remote_ports().size()) {
-        uint16_t lh = m_config.get_mode_proxy_local_hosts().size();
-        uint16_t rh = m_config.get_mode_proxy_remote_hosts().size();
-        uint16_t lp = m_config.get_mode_proxy_local_ports().size();
-        uint16_t rp = m_config.get_mode_proxy_remote_ports().size();
-        uint16_t max = (std::max)({lh, rh, lp, rp});
+    uint16_t lh = config.get_mode_proxy_local_hosts().size();
+    uint16_t rh = config.get_mode_proxy_remote_hosts().size();
+    uint16_t lp = config.get_mode_proxy_local_ports().size();
+    uint16_t rp = config.get_mode_proxy_remote_ports().size();
+    uint16_t max = (std::max)({lh, rh, lp, rp});
 
+    if (lh != max || rh != max || lp != max || rp != max) {
         auto report_conf_problem = [&](const std::string& conf_field, uint16_t expected_val, uint16_t actual_val) {
             m_log.fatal("There is a problem with the configuration field '%s'. Since it's a set, it should have %d entries (repeats) - while it only has %d.", conf_field.c_str(), expected_val, actual_val);
         };
 
         if (lh != max) {
-            report_conf_problem("mode_proxy_local_hosts", lh, max);
+            report_conf_problem("mode_proxy_local_hosts", max, lh);
         }
 
         if (rh != max) {
-            report_conf_problem("mode_proxy_remote_hosts", rh, max);
+            report_conf_problem("mode_proxy_remote_hosts", max, rh);
         }
 
         if (lp != max) {
-            report_conf_problem("mode_proxy_local_ports", lp, max);
+            report_conf_problem("mode_proxy_local_ports", max, lp);
         }
 
         if (rp != max) {
-            report_conf_problem("mode_proxy_remote_ports", rp, max);
+            report_conf_problem("mode_proxy_remote_ports", max, rp);
         }
 
         return false;
     }
 
-    for (auto&& port : m_config.get_mode_proxy_local_ports()) {
-        if (port <= 1023) {
+    for (size_t range_num = 0; range_num < config.get_mode_proxy_port_ranges().size(); ++range_num) {
+        const std::string& rule = config.get_mode_proxy_port_ranges()[range_num];
+
+        PortRange range;
+        if (!PortRange::parse(rule, range)) {
+            m_log.fatal("Malformed port range '%s' in 'mode_proxy_port_ranges'. Expected local_host:first-last=remote_host:first[-last], both ranges of the same length.",
+                rule.c_str());
+            return false;
+        }
+
+        if (StreamEndpoint::is_local(range.local_host) || (range.is_port_mapped() && StreamEndpoint::is_local(range.remote_host))) {
+            m_log.fatal("Port range '%s' cannot use Unix domain sockets, except for a single remote endpoint.", rule.c_str());
+            return false;
+        }
+
+        // extra backends are shifted together with the remote endpoint
+        const uint16_t proxy_num = static_cast<uint16_t>(config.get_mode_proxy_local_hosts().size() + range_num);
+        std::vector< std::pair<std::string, uint16_t> > extra_backends;
+        parse_backends(get_listener_option(config.get_mode_proxy_extra_backends(), proxy_num, std::string("none")), extra_backends);
+        for (auto&& backend : extra_backends) {
+            if (range.is_port_mapped() && backend.second + (range.local_last - range.local_first) > 65535) {
+                m_log.fatal("Port range '%s' shifts the port of backend %s:%u past 65535.", rule.c_str(), backend.first.c_str(), backend.second);
+                return false;
+            }
+        }
+
+        if (range.local_first <= 1023) {
+            m_log.warning("Port range '%s' starts at a 'well-known port' (its value is <= 1023). It means that the program might need additional privileges to run correctly.", rule.c_str());
+        }
+    }
+
+    if (!validate_listener_option_size(config, "mode_proxy_shadow_hosts", config.get_mode_proxy_shadow_hosts().size()) ||
+        !validate_listener_option_size(config, "mode_proxy_shadow_ports", config.get_mode_proxy_shadow_ports().size()) ||
+        !validate_listener_option_size(config, "mode_proxy_capture_files", config.get_mode_proxy_capture_files().size())) {
+        return false;
+    }
+
+    const std::vector< std::pair<std::string, const std::vector<int>*> > socket_options = {
+        { "mode_proxy_tcp_nodelay", &config.get_mode_proxy_tcp_nodelay() },
+        { "mode_proxy_receive_buffer_size", &config.get_mode_proxy_receive_buffer_size() },
+        { "mode_proxy_send_buffer_size", &config.get_mode_proxy_send_buffer_size() },
+        { "mode_proxy_tcp_notsent_lowat", &config.get_mode_proxy_tcp_notsent_lowat() },
+        { "mode_proxy_tcp_quickack", &config.get_mode_proxy_tcp_quickack() },
+        { "mode_proxy_keepalive", &config.get_mode_proxy_keepalive() },
+        { "mode_proxy_keepalive_idle", &config.get_mode_proxy_keepalive_idle() },
+        { "mode_proxy_keepalive_interval", &config.get_mode_proxy_keepalive_interval() },
+        { "mode_proxy_keepalive_count", &config.get_mode_proxy_keepalive_count() },
+        { "mode_proxy_busy_poll", &config.get_mode_proxy_busy_poll() },
+        { "mode_proxy_tcp_fastopen_connect", &config.get_mode_proxy_tcp_fastopen_connect() },
+        { "mode_proxy_backlog", &config.get_mode_proxy_backlog() },
+        { "mode_proxy_tcp_defer_accept", &config.get_mode_proxy_tcp_defer_accept() },
+        { "mode_proxy_tcp_fastopen", &config.get_mode_proxy_tcp_fastopen() }
+    };
+
+    for (auto&& socket_option : socket_options) {
+        if (!validate_listener_option_size(config, socket_option.first, socket_option.second->size())) {
+            return false;
+        }
+    }
+
+    if (!validate_listener_option_size(config, "mode_proxy_session_engines", config.get_mode_proxy_session_engines().size())) {
+        return false;
+    }
+
+    for (auto&& session_engine : config.get_mode_proxy_session_engines()) {
+        if (session_engine != "callback" && session_engine != "coroutine") {
+            m_log.fatal("Unknown session engine '%s' in 'mode_proxy_session_engines'. Possible engines: callback, coroutine.", session_engine.c_str());
+            return false;
+        }
+    }
+
+    if (!validate_listener_option_size(config, "mode_proxy_extra_backends", config.get_mode_proxy_extra_backends().size()) ||
+        !validate_listener_option_size(config, "mode_proxy_affinities", config.get_mode_proxy_affinities().size())) {
+        return false;
+    }
+
+    for (auto&& extra_backends : config.get_mode_proxy_extra_backends()) {
+        std::vector< std::pair<std::string, uint16_t> > parsed;
+        if (!parse_backends(extra_backends, parsed)) {
+            m_log.fatal("Malformed backend list '%s' in 'mode_proxy_extra_backends'. Expected 'none' or host:port[,host:port...].", extra_backends.c_str());
+            return false;
+        }
+    }
+
+    if (!validate_listener_option_size(config, "mode_proxy_send_proxy_protocol", config.get_mode_proxy_send_proxy_protocol().size()) ||
+        !validate_listener_option_size(config, "mode_proxy_accept_proxy_protocol", config.get_mode_proxy_accept_proxy_protocol().size())) {
+        return false;
+    }
+
+    for (auto&& version : config.get_mode_proxy_send_proxy_protocol()) {
+        if (version != "none" && version != "v1" && version != "v2") {
+            m_log.fatal("Unknown PROXY protocol version '%s' in 'mode_proxy_send_proxy_protocol'. Possible versions: none, v1, v2.", version.c_str());
+            return false;
+        }
+    }
+
+    for (auto&& version : config.get_mode_proxy_accept_proxy_protocol()) {
+        if (version != "none" && version != "v1" && version != "v2" && version != "any") {
+            m_log.fatal("Unknown PROXY protocol version '%s' in 'mode_proxy_accept_proxy_protocol'. Possible versions: none, v1, v2, any.", version.c_str());
+            return false;
+        }
+    }
+
+    for (auto&& affinity : config.get_mode_proxy_affinities()) {
+        if (affinity != "none" && affinity != "ip" && affinity != "prefix") {
+            m_log.fatal("Unknown affinity '%s' in 'mode_proxy_affinities'. Possible affinities: none, ip, prefix.", affinity.c_str());
+            return false;
+        }
+    }
+
+    if (config.get_mode_proxy_affinity_timeout() == 0 || config.get_mode_proxy_affinity_table_size() == 0) {
+        m_log.fatal("Both 'mode_proxy_affinity_timeout' and 'mode_proxy_affinity_table_size' have to be greater than 0.");
+        return false;
+    }
+
+    for (size_t proxy_num = 0; proxy_num < get_num_of_all_proxies(config); ++proxy_num) {
+        if (get_listener_option(config.get_mode_proxy_shadow_hosts(), proxy_num, std::string("none")) != "none" &&
+            get_listener_option(config.get_mode_proxy_shadow_ports(), proxy_num, uint16_t(0)) == 0) {
+            m_log.fatal("Listener number %u has a shadow host, but no shadow port. Please set 'mode_proxy_shadow_ports'.", static_cast<unsigned>(proxy_num));
+            return false;
+        }
+
+        if (StreamEndpoint::is_local(get_listener_option(config.get_mode_proxy_shadow_hosts(), proxy_num, std::string("none")))) {
+            m_log.fatal("Listener number %u has a Unix domain shadow host, only IP shadow hosts are supported.", static_cast<unsigned>(proxy_num));
+            return false;
+        }
+    }
+
+    for (size_t proxy_num = 0; proxy_num < config.get_mode_proxy_local_ports().size(); ++proxy_num) {
+        // ports of Unix domain listeners are ignored
+        const uint16_t port = config.get_mode_proxy_local_ports()[proxy_num];
+        if (port <= 1023 && !StreamEndpoint::is_local(config.get_mode_proxy_local_hosts()[proxy_num])) {
             m_log.warning("One of supplied mode_proxy_local_ports: %d is a 'well-known port' (its value is <= 1023). It means that the program might need additional privileges to run correctly.", port);
         }
     }
@@ -102,52 +271,614 @@ bool ModeProxy::validate_configuration() const
     return true;
 }
 
-uint16_t ModeProxy::get_num_of_all_proxies() const
+bool ModeProxy::validate_listener_option_size(const Configuration& config, const std::string& conf_field, size_t size) const
+{
+    if (size > 1 && size != get_num_of_all_proxies(config)) {
+        m_log.fatal("There is a problem with the configuration field '%s'. It should have either 1 entry (shared by all listeners) or %d entries (one per listener) - while it has %d.",
+            conf_field.c_str(), get_num_of_all_proxies(config), static_cast<int>(size));
+        return false;
+    }
+
+    return true;
+}
+
+ListenerOptions ModeProxy::build_listener_options(const Configuration& config, IPResolver& ip_resolver, uint16_t proxy_num)
+{
+    ListenerOptions options;
+
+    std::string shadow_host = get_listener_option(config.get_mode_proxy_shadow_hosts(), proxy_num, std::string("none"));
+    if (shadow_host != "none") {
+        options.shadow_host = ip_resolver.resolve_only_first_ip(shadow_host);
+        options.shadow_port = get_listener_option(config.get_mode_proxy_shadow_ports(), proxy_num, uint16_t(0));
+    }
+    options.shadow_buffer_size = config.get_mode_proxy_shadow_buffer_size();
+    options.shadow_close_timeout = config.get_mode_proxy_shadow_close_timeout();
+    options.accept_batch_size = config.get_mode_proxy_accept_batch_size();
+    options.session_engine = (get_listener_option(config.get_mode_proxy_session_engines(), proxy_num, std::string("callback")) == "coroutine") ?
+        ListenerOptions::coroutine_engine : ListenerOptions::callback_engine;
+
+    options.send_proxy_protocol = get_proxy_protocol(get_listener_option(config.get_mode_proxy_send_proxy_protocol(), proxy_num, std::string("none")));
+    options.accept_proxy_protocol = get_proxy_protocol(get_listener_option(config.get_mode_proxy_accept_proxy_protocol(), proxy_num, std::string("none")));
+
+    std::vector< std::pair<std::string, uint16_t> > extra_backends;
+    parse_backends(get_listener_option(config.get_mode_proxy_extra_backends(), proxy_num, std::string("none")), extra_backends);
+    for (auto&& backend : extra_backends) {
+        options.extra_backends.push_back(std::make_pair(ip_resolver.resolve_only_first_ip(backend.first), backend.second));
+    }
+
+    std::string affinity = get_listener_option(config.get_mode_proxy_affinities(), proxy_num, std::string("none"));
+    if (affinity != "none" && !options.extra_backends.empty()) {
+        std::shared_ptr<AffinityTable>& affinity_table = m_affinity_tables[get_affinity_table_key(config, proxy_num)];
+        if (!affinity_table) {
+            affinity_table = std::make_shared<AffinityTable>(config.get_mode_proxy_affinity_table_size(), config.get_mode_proxy_affinity_timeout());
+            m_log.info("Listener number %u pins clients to backends (%s affinity), remembering up to %u clients in %u bytes.", static_cast<unsigned>(proxy_num), affinity.c_str(),
+                static_cast<unsigned>(affinity_table->get_capacity()), static_cast<unsigned>(affinity_table->get_memory_size()));
+        }
+        options.affinity = affinity_table;
+        options.affinity_by_prefix = (affinity == "prefix");
+    }
+
+    std::string capture_file = get_listener_option(config.get_mode_proxy_capture_files(), proxy_num, std::string("none"));
+    if (capture_file != "none") {
+        std::shared_ptr<CaptureRing>& capture = m_capture_rings[capture_file];
+        if (!capture) {
+            m_log.info("Capturing traffic into %u files of %llu bytes: %s.", config.get_mode_proxy_capture_file_count(),
+                static_cast<unsigned long long>(config.get_mode_proxy_capture_file_size()), capture_file.c_str());
+
+            // e.g. the previous instance or a ring dropped by an earlier reload still writes these files, the next reload tries again
+            try {
+                capture = std::make_shared<CaptureRing>(capture_file, config.get_mode_proxy_capture_file_size(), config.get_mode_proxy_capture_file_count());
+            } catch (const std::runtime_error& e) {
+                m_log.error("Listener number %u does not capture its traffic: %s", static_cast<unsigned>(proxy_num), e.what());
+            }
+        }
+        options.capture = capture;
+    }
+
+    SocketOptions& socket_options = options.socket_options;
+    socket_options.tcp_nodelay = get_listener_option(config.get_mode_proxy_tcp_nodelay(), proxy_num, -1);
+    socket_options.receive_buffer_size = get_listener_option(config.get_mode_proxy_receive_buffer_size(), proxy_num, -1);
+    socket_options.send_buffer_size = get_listener_option(config.get_mode_proxy_send_buffer_size(), proxy_num, -1);
+    socket_options.tcp_notsent_lowat = get_listener_option(config.get_mode_proxy_tcp_notsent_lowat(), proxy_num, -1);
+    socket_options.tcp_quickack = get_listener_option(config.get_mode_proxy_tcp_quickack(), proxy_num, -1);
+    socket_options.keepalive = get_listener_option(config.get_mode_proxy_keepalive(), proxy_num, -1);
+    socket_options.keepalive_idle = get_listener_option(config.get_mode_proxy_keepalive_idle(), proxy_num, -1);
+    socket_options.keepalive_interval = get_listener_option(config.get_mode_proxy_keepalive_interval(), proxy_num, -1);
+    socket_options.keepalive_count = get_listener_option(config.get_mode_proxy_keepalive_count(), proxy_num, -1);
+    socket_options.busy_poll = get_listener_option(config.get_mode_proxy_busy_poll(), proxy_num, -1);
+    socket_options.tcp_fastopen_connect = get_listener_option(config.get_mode_proxy_tcp_fastopen_connect(), proxy_num, -1);
+    socket_options.backlog = get_listener_option(config.get_mode_proxy_backlog(), proxy_num, -1);
+    socket_options.tcp_defer_accept = get_listener_option(config.get_mode_proxy_tcp_defer_accept(), proxy_num, -1);
+    socket_options.tcp_fastopen = get_listener_option(config.get_mode_proxy_tcp_fastopen(), proxy_num, -1);
+
+    return options;
+}
+
+uint16_t ModeProxy::get_num_of_all_proxies(const Configuration& config) const
 {   // since all vectors are equal (checked with validate_configuration()), return the size of the first one
-    return m_config.get_mode_proxy_local_hosts().size();
+    return config.get_mode_proxy_local_hosts().size() + config.get_mode_proxy_port_ranges().size();
+}
+
+bool ModeProxy::is_port_range(const Configuration& config, uint16_t proxy_num)
+{
+    return proxy_num >= config.get_mode_proxy_local_hosts().size();
+}
+
+std::string ModeProxy::get_listener_key(const std::string& listen_host, uint16_t listen_port)
+{
+    return listen_host + std::string(":") + boost::lexical_cast<std::string>(listen_port);
+}
+
+bool ModeProxy::parse_backends(const std::string& backends, std::vector< std::pair<std::string, uint16_t> >& parsed)
+{
+    if (backends == "none") {
+        return true;
+    }
+
+    std::stringstream list(backends);
+    std::string backend;
+
+    while (std::getline(list, backend, ',')) {
+        size_t colon = backend.rfind(':');
+        if (colon == std::string::npos || colon == 0) {
+            return false;
+        }
+
+        try {
+            uint16_t port = boost::lexical_cast<uint16_t>(backend.substr(colon + 1));
+            if (port == 0) {
+                return false;
+            }
+            parsed.push_back(std::make_pair(backend.substr(0, colon), port));
+        } catch (const boost::bad_lexical_cast&) {
+            return false;
+        }
+    }
+
+    return !parsed.empty();
+}
+
+std::string ModeProxy::get_affinity_table_key(const Configuration& config, uint16_t proxy_num)
+{
+    std::stringstream key;
+    if (is_port_range(config, proxy_num)) {
+        key << config.get_mode_proxy_port_ranges()[proxy_num - config.get_mode_proxy_local_hosts().size()];
+    } else {
+        key << config.get_mode_proxy_local_hosts()[proxy_num] << ":" << config.get_mode_proxy_local_ports()[proxy_num]
+            << " " << config.get_mode_proxy_remote_hosts()[proxy_num] << ":" << config.get_mode_proxy_remote_ports()[proxy_num];
+    }
+    key << " " << get_listener_option(config.get_mode_proxy_extra_backends(), proxy_num, std::string("none"))
+        << " " << get_listener_option(config.get_mode_proxy_affinities(), proxy_num, std::string("none"))
+        << " " << config.get_mode_proxy_affinity_table_size() << " " << config.get_mode_proxy_affinity_timeout();
+    return key.str();
+}
+
+void ModeProxy::start_listener(const Configuration& config, boost::asio::io_service& ios, ProxyManager& manager, IPResolver& ip_resolver, uint16_t proxy_num,
+    std::map<std::string, int>& inherited_handles)
+{
+    if (is_port_range(config, proxy_num)) {
+        PortRange range;
+        std::shared_ptr<const ProxyRoute> route = build_port_range_route(config, ip_resolver, proxy_num, range);
+
+        // all the listeners of the range share one route, so the options and backends are resolved only once
+        for (uint32_t port = range.local_first; port <= range.local_last; ++port) {
+            add_listener(ios, manager, route, static_cast<uint16_t>(port), inherited_handles);
+        }
+        return;
+    }
+
+    std::string remote_ip = ip_resolver.resolve_only_first_ip(config.get_mode_proxy_remote_hosts()[proxy_num]);
+    std::string local_ip = ip_resolver.resolve_only_first_ip(config.get_mode_proxy_local_hosts()[proxy_num]);
+    uint16_t local_port = config.get_mode_proxy_local_ports()[proxy_num];
+
+    add_listener(ios, manager, std::make_shared<ProxyRoute>(local_ip, local_port, remote_ip, config.get_mode_proxy_remote_ports()[proxy_num],
+        build_listener_options(config, ip_resolver, proxy_num)), local_port, inherited_handles);
+}
+
+void ModeProxy::add_listener(boost::asio::io_service& ios, ProxyManager& manager, const std::shared_ptr<const ProxyRoute>& route, uint16_t listen_port,
+    std::map<std::string, int>& inherited_handles)
+{
+    int inherited_handle = -1;
+    auto inherited = inherited_handles.find(get_listener_key(route->listen_host, listen_port));
+    if (inherited != inherited_handles.end()) {
+        inherited_handle = inherited->second;
+        inherited_handles.erase(inherited);
+    }
+
+    try {
+        manager.add_listener(std::make_shared<ProxyListener>(ios, m_log, route, listen_port, inherited_handle));
+    } catch (const boost::system::system_error& e) {
+        std::stringstream sStr;
+        sStr << "Cannot start listener using given address and port: " << route->listen_host << ":" << listen_port << std::endl;
+        sStr << "Error code: " << e.code().value() << std::endl;
+        sStr << "System message: " << e.what() << std::endl;
+        throw std::runtime_error(sStr.str());
+    }
+}
+
+std::shared_ptr<const ProxyRoute> ModeProxy::build_port_range_route(const Configuration& config, IPResolver& ip_resolver, uint16_t proxy_num, PortRange& range)
+{
+    PortRange::parse(config.get_mode_proxy_port_ranges()[proxy_num - config.get_mode_proxy_local_hosts().size()], range);
+
+    return std::make_shared<ProxyRoute>(ip_resolver.resolve_only_first_ip(range.local_host), range.local_first, ip_resolver.resolve_only_first_ip(range.remote_host),
+        range.remote_first, build_listener_options(config, ip_resolver, proxy_num), range.is_port_mapped());
 }
 
+void ModeProxy::collect_host_names(const Configuration& config, std::set<std::string>& host_names) const
+{
+    auto add_host_name = [&host_names](const std::string& host_name) {
+        if (!StreamEndpoint::is_local(host_name)) {
+            host_names.insert(host_name);
+        }
+    };
+
+    for (uint16_t proxy_num = 0; proxy_num < get_num_of_all_proxies(config); ++proxy_num) {
+        if (is_port_range(config, proxy_num)) {
+            PortRange range;
+            PortRange::parse(config.get_mode_proxy_port_ranges()[proxy_num - config.get_mode_proxy_local_hosts().size()], range);
+            add_host_name(range.local_host);
+            add_host_name(range.remote_host);
+        } else {
+            add_host_name(config.get_mode_proxy_local_hosts()[proxy_num]);
+            add_host_name(config.get_mode_proxy_remote_hosts()[proxy_num]);
+        }
+
+        const std::string shadow_host = get_listener_option(config.get_mode_proxy_shadow_hosts(), proxy_num, std::string("none"));
+        if (shadow_host != "none") {
+            add_host_name(shadow_host);
+        }
+
+        std::vector< std::pair<std::string, uint16_t> > extra_backends;
+        parse_backends(get_listener_option(config.get_mode_proxy_extra_backends(), proxy_num, std::string("none")), extra_backends);
+        for (auto&& backend : extra_backends) {
+            add_host_name(backend.first);
+        }
+    }
+}
+
+void ModeProxy::reload_configuration(boost::asio::io_service& ios, ProxyManager& manager)
+{
+    m_log.info("Reloading configuration file '%s'.", m_config.get_config_filename().c_str());
+
+    // the file is read again with the original command line, so command line overrides still apply
+    auto reloaded = std::make_shared<Configuration>(m_config.get_app_argument_count(), const_cast<char**>(m_config.get_app_argument_array()));
+    {
+        std::string message_to_user;
+        ConfigurationBuilder config_builder(*reloaded);
+
+        if (!config_builder.build_configuration(message_to_user)) {
+            m_log.error("Configuration has not been reloaded, because it could not be parsed: %s", message_to_user.c_str());
+            return;
+        }
+    }
+
+    if (reloaded->get_app_mode() != get_name()) {
+        m_log.error("Configuration has not been reloaded, because mode cannot be changed at runtime ('%s' -> '%s').", get_name().c_str(), reloaded->get_app_mode().c_str());
+        return;
+    }
+
+    if (!validate_configuration(*reloaded)) {
+        m_log.error("Configuration has not been reloaded, because it is not valid.");
+        return;
+    }
+
+    std::set<std::string> host_names;
+    collect_host_names(*reloaded, host_names);
+
+    const uint64_t reload_generation = ++m_reload_generation;
+    if (host_names.empty()) {
+        apply_configuration(ios, manager, *reloaded, std::map<std::string, std::string>());
+        return;
+    }
+
+    // the lookups run on the resolver thread, the sessions keep going meanwhile; a host which does not resolve
+    // is left out of resolved, so only the listeners using it keep their old configuration
+    auto resolver = std::make_shared<CachedResolver>(m_log, ios, 0, 0);
+    auto resolved = std::make_shared< std::map<std::string, std::string> >();
+    auto num_of_pending = std::make_shared<size_t>(host_names.size());
+
+    for (auto&& host_name : host_names) {
+        resolver->async_resolve(host_name, [this, &ios, &manager, reloaded, resolver, resolved, num_of_pending, reload_generation, host_name](
+            const boost::system::error_code& error, const CachedResolver::addresses_type& addresses) {
+            if (!error && !addresses.empty()) {
+                (*resolved)[host_name] = addresses.front().to_string();
+            }
+
+            if (--*num_of_pending > 0) {
+                return;
+            }
+
+            if (reload_generation != m_reload_generation) {
+                m_log.warning("Configuration reload has been abandoned, it was overtaken before its host names were resolved.");
+                return;
+            }
+
+            apply_configuration(ios, manager, *reloaded, *resolved);
+        });
+    }
+}
+
+void ModeProxy::apply_configuration(boost::asio::io_service& ios, ProxyManager& manager, const Configuration& reloaded, const std::map<std::string, std::string>& resolved)
+{
+    std::vector< std::shared_ptr<ProxyListener> > listeners = manager.get_listeners();
+    std::vector<bool> is_listener_kept(listeners.size(), false);
+
+    std::set<std::string> capture_files;
+    std::set<std::string> affinity_tables;
+    IPResolver ip_resolver(m_log, resolved);
+
+    // running listeners are looked up by their key, instead of searching all of them for every configured port
+    std::map<std::string, size_t> listener_nums;
+    for (size_t listener_num = 0; listener_num < listeners.size(); ++listener_num) {
+        listener_nums[get_listener_key(listeners[listener_num]->get_listen_host(), listeners[listener_num]->get_listen_port())] = listener_num;
+    }
+
+    auto apply_route = [&](const std::shared_ptr<const ProxyRoute>& route, uint16_t listen_port) {
+        auto found = listener_nums.find(get_listener_key(route->listen_host, listen_port));
+        if (found == listener_nums.end()) {
+            std::map<std::string, int> no_inherited_handles;
+            add_listener(ios, manager, route, listen_port, no_inherited_handles);
+            return;
+        }
+
+        // a listener that is already running keeps its socket (and pending connections), only its route is replaced
+        const std::shared_ptr<ProxyListener>& listener = listeners[found->second];
+        const uint16_t remote_port = static_cast<uint16_t>(route->remote_port + route->get_port_offset(listen_port));
+
+        if (listener->get_remote_host() != route->remote_host || listener->get_remote_port() != remote_port) {
+            m_log.info("Listener at %s:%u will redirect new sessions to %s:%u (instead of %s:%u).", route->listen_host.c_str(), listen_port,
+                route->remote_host.c_str(), remote_port, listener->get_remote_host().c_str(), listener->get_remote_port());
+        }
+
+        listener->set_route(route);
+        is_listener_kept[found->second] = true;
+    };
+
+    for (uint16_t proxy_num = 0; proxy_num < get_num_of_all_proxies(reloaded); ++proxy_num) {
+        capture_files.insert(get_listener_option(reloaded.get_mode_proxy_capture_files(), proxy_num, std::string("none")));
+        affinity_tables.insert(get_affinity_table_key(reloaded, proxy_num));
+
+        if (is_port_range(reloaded, proxy_num)) {
+            PortRange range;
+            std::shared_ptr<const ProxyRoute> route;
+
+            try {
+                route = build_port_range_route(reloaded, ip_resolver, proxy_num, range);
+            } catch (const std::exception& e) {
+                m_log.error("Cannot apply configuration of port range %s: %s", reloaded.get_mode_proxy_port_ranges()[proxy_num - reloaded.get_mode_proxy_local_hosts().size()].c_str(),
+                    e.what());
+                continue;
+            }
+
+            for (uint32_t port = range.local_first; port <= range.local_last; ++port) {
+                try {
+                    apply_route(route, static_cast<uint16_t>(port));
+                } catch (const std::exception& e) {
+                    m_log.error("Cannot apply configuration of listener %s:%u: %s", route->listen_host.c_str(), port, e.what());
+                }
+            }
+            continue;
+        }
+
+        const std::string& local_interface = reloaded.get_mode_proxy_local_hosts()[proxy_num];
+        uint16_t local_port = reloaded.get_mode_proxy_local_ports()[proxy_num];
+
+        try {
+            std::string local_ip = ip_resolver.resolve_only_first_ip(local_interface);
+            std::string remote_ip = ip_resolver.resolve_only_first_ip(reloaded.get_mode_proxy_remote_hosts()[proxy_num]);
+
+            apply_route(std::make_shared<ProxyRoute>(local_ip, local_port, remote_ip, reloaded.get_mode_proxy_remote_ports()[proxy_num],
+                build_listener_options(reloaded, ip_resolver, proxy_num)), local_port);
+        } catch (const std::exception& e) {
+            m_log.error("Cannot apply configuration of listener %s:%u: %s", local_interface.c_str(), local_port, e.what());
+        }
+    }
+
+    for (size_t listener_num = 0; listener_num < listeners.size(); ++listener_num) {
+        if (!is_listener_kept[listener_num]) {
+            manager.remove_listener(listeners[listener_num]);
+        }
+    }
+
+    // rings which are no longer configured are closed once their last session ends
+    for (auto it = m_capture_rings.begin(); it != m_capture_rings.end(); ) {
+        if (capture_files.count(it->first) == 0) {
+            it = m_capture_rings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // a listener whose backends (or affinity settings) have changed starts with an empty table
+    for (auto it = m_affinity_tables.begin(); it != m_affinity_tables.end(); ) {
+        if (affinity_tables.count(it->first) == 0) {
+            it = m_affinity_tables.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    m_log.info("Configuration has been reloaded: %u listeners.", static_cast<unsigned>(manager.get_listeners().size()));
+}
+
+// state of run() its signal and drain handlers work with, it lives on the stack of run()
+struct ModeProxy::RunState
+{
+    RunState(boost::asio::io_service& ios, ProxyManager& manager)
+        : ios(ios)
+        , manager(manager)
+        , is_draining(false)
+        , drain_timer(ios)
+        , stop_signals(ios, SIGINT, SIGTERM)
+#if defined(SIGHUP)
+        , reload_signals(ios, SIGHUP)
+#endif
+    {
+    }
+
+    boost::asio::io_service& ios;
+    ProxyManager& manager;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    std::shared_ptr<ListenerHandoff> handoff;
+#endif
+
+    // draining: acceptors are closed and established sessions are given drain_timeout seconds to finish
+    bool is_draining;
+    std::chrono::steady_clock::time_point drain_deadline;
+    boost::asio::deadline_timer drain_timer;
+
+    // SIGTERM (or SIGINT) stops accepting and drains sessions, the second one closes the remaining sessions immediately
+    boost::asio::signal_set stop_signals;
+#if defined(SIGHUP)
+    // SIGHUP re-reads the configuration file and applies listener changes without touching established sessions
+    boost::asio::signal_set reload_signals;
+#endif
+};
+
+void ModeProxy::finish()
+{
+    m_run_state->manager.close_sessions();
+
+    boost::system::error_code ignored;
+    m_run_state->drain_timer.cancel(ignored);
+    m_run_state->stop_signals.cancel(ignored);
+#if defined(SIGHUP)
+    m_run_state->reload_signals.cancel(ignored);
+#endif
+
+    m_run_state->ios.stop();
+}
+
+void ModeProxy::check_drain(const boost::system::error_code& error)
+{
+    if (error) {
+        return;
+    }
+
+    const size_t num_of_active_sessions = m_run_state->manager.get_num_of_active_sessions();
+
+    if (num_of_active_sessions == 0) {
+        m_log.info("All sessions have been drained.");
+        finish();
+    } else if (std::chrono::steady_clock::now() >= m_run_state->drain_deadline) {
+        m_log.warning("Drain timeout has passed, closing %u remaining sessions.", static_cast<unsigned>(num_of_active_sessions));
+        finish();
+    } else {
+        m_run_state->drain_timer.expires_from_now(boost::posix_time::milliseconds(100));
+        m_run_state->drain_timer.async_wait(std::bind(&ModeProxy::check_drain, this, std::placeholders::_1));
+    }
+}
+
+void ModeProxy::start_drain(const char* reason)
+{
+    if (m_run_state->is_draining) {
+        return;
+    }
+
+    m_log.info("Stopping listeners (%s), draining sessions for up to %u seconds.", reason, m_config.get_mode_proxy_drain_timeout());
+
+    m_run_state->is_draining = true;
+    // a reload still resolving its host names must not open listeners again
+    ++m_reload_generation;
+    m_run_state->drain_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(m_config.get_mode_proxy_drain_timeout());
+    m_run_state->manager.stop_listeners();
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    // a draining instance has nothing to hand over anymore
+    if (m_run_state->handoff) {
+        m_run_state->handoff->close();
+    }
+#endif
+
+    check_drain(boost::system::error_code());
+}
+
+void ModeProxy::handle_stop_signal(const boost::system::error_code& error, int signal_number)
+{
+    if (error) {
+        return;
+    }
+
+    if (m_run_state->is_draining) {
+        m_log.warning("Received signal %d while draining, closing %u remaining sessions.", signal_number, static_cast<unsigned>(m_run_state->manager.get_num_of_active_sessions()));
+        finish();
+        return;
+    }
+
+    // waits for the second signal before draining, a drain which finishes right away cancels the wait again
+    m_run_state->stop_signals.async_wait(std::bind(&ModeProxy::handle_stop_signal, this, std::placeholders::_1, std::placeholders::_2));
+    start_drain((signal_number == SIGINT) ? "SIGINT received" : "SIGTERM received");
+}
+
+#if defined(SIGHUP)
+void ModeProxy::handle_reload_signal(const boost::system::error_code& error, int)
+{
+    if (error) {
+        return;
+    }
+
+    if (m_run_state->is_draining) {
+        m_log.warning("Configuration is not reloaded while draining.");
+    } else {
+        reload_configuration(m_run_state->ios, m_run_state->manager);
+    }
+    m_run_state->reload_signals.async_wait(std::bind(&ModeProxy::handle_reload_signal, this, std::placeholders::_1, std::placeholders::_2));
+}
+#endif
+
 bool ModeProxy::run()
 {
     m_log.log_if_not_silent("Initialized mode '%s'.", get_name().c_str());
 
-    if (!validate_configuration()) {
+    if (!validate_configuration(m_config)) {
         return false;
     }
 
     // provides the core I/O functionality (OS calls etc.)
     boost::asio::io_service ios;
 
+    // listening sockets taken over from the previous instance, if there is one
+    std::map<std::string, int> inherited_handles;
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    std::shared_ptr<ListenerHandoff> handoff;
+
+    if (m_config.get_mode_proxy_handoff_socket() != "none") {
+        handoff = std::make_shared<ListenerHandoff>(m_log, ios, m_config.get_mode_proxy_handoff_socket());
+        inherited_handles = handoff->receive_listeners();
+    }
+#endif
+
     ProxyManager manager(m_log);
     {
         IPResolver ip_resolver(m_log, ios);
 
-        const uint16_t num_of_all_proxies = get_num_of_all_proxies();
+        const uint16_t num_of_all_proxies = get_num_of_all_proxies(m_config);
 
         for (uint16_t proxy_num = 0; proxy_num < num_of_all_proxies; ++proxy_num) {
-            std::string local_interface = m_config.get_mode_proxy_local_hosts()[proxy_num];
-            uint16_t local_port = m_config.get_mode_proxy_local_ports()[proxy_num];
-            std::string remote_host = m_config.get_mode_proxy_remote_hosts()[proxy_num];
-            uint16_t remote_port = m_config.get_mode_proxy_remote_ports()[proxy_num];
+            start_listener(m_config, ios, manager, ip_resolver, proxy_num, inherited_handles);
+        }
+    }
 
-            std::string local_ip = ip_resolver.resolve_only_first_ip(local_interface);
-            std::string remote_ip = ip_resolver.resolve_only_first_ip(remote_host);
+    // the previous instance had listeners which are not configured anymore
+    for (auto& inherited : inherited_handles) {
+        m_log.info("Closing inherited listener %s, it is not configured anymore.", inherited.first.c_str());
+        ::close(inherited.second);
+    }
 
-            try {
-                manager.add_listener(std::make_shared<ProxyListener>(ios, m_log, local_ip, local_port, remote_ip, remote_port));
-            } catch (const boost::system::system_error& e) {
-                std::stringstream sStr;
-                sStr << "Cannot start listener using given address and port: (" << local_interface << ") " << local_ip << ":" << local_port << std::endl;
-                sStr << "Error code: " << e.code().value() << std::endl;
-                sStr << "System message: " << e.what() << std::endl;
-                throw std::runtime_error(sStr.str());
-            }
+    RunState state(ios, manager);
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    state.handoff = handoff;
+#endif
+    m_run_state = &state;
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    if (handoff) {
+        // the previous instance stops accepting only now, when this one already accepts on the same sockets
+        handoff->confirm_takeover();
+
+        try {
+            handoff->serve([&]() {
+                ListenerHandoff::handles_type handles;
+                for (auto& listener : manager.get_listeners()) {
+                    if (!listener->is_stopped()) {
+                        handles[get_listener_key(listener->get_listen_host(), listener->get_listen_port())] = listener->get_native_handle();
+                    }
+                }
+                return handles;
+            }, [this]() {
+                start_drain("handed over to the next instance");
+            });
+        } catch (const boost::system::system_error& e) {
+            m_log.error("Cannot serve handoff socket %s, upgrades without downtime are not possible: %s", m_config.get_mode_proxy_handoff_socket().c_str(), e.what());
         }
     }
+#endif
+
+    state.stop_signals.async_wait(std::bind(&ModeProxy::handle_stop_signal, this, std::placeholders::_1, std::placeholders::_2));
+#if defined(SIGHUP)
+    state.reload_signals.async_wait(std::bind(&ModeProxy::handle_reload_signal, this, std::placeholders::_1, std::placeholders::_2));
+#endif
 
     // gives control away to Boost.Asio to asynchronously handle connections
     ios.run();
 
+    // closing the sessions has only started their last handlers: shadow sinks write what they have queued (for at most
+    // shadow_close_timeout), captures record the close. poll() marks ios stopped again once nothing is pending anymore.
+    ios.reset();
+    const auto flush_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_config.get_mode_proxy_shadow_close_timeout()) + std::chrono::seconds(1);
+
+    while (!ios.stopped() && std::chrono::steady_clock::now() < flush_deadline) {
+        if (ios.poll() == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    m_run_state = nullptr;
+
+    manager.log_statistics();
+    m_log.flush();
+
     return true;
 }
 
@@ -30,16 +30,40 @@
 #ifndef MCT_MODEPROXY_MODEPROXY_HPP
 #define MCT_MODEPROXY_MODEPROXY_HPP
 
+#include <map>
+#include <set>
+#include <memory>
 #include <string>
+#include <vector>
+#include <cstdint>
 
 #include <Mode/Mode.hpp>
 #include <ModeProxy/Config.hpp>
 
+namespace boost
+{
+    namespace asio
+    {
+        class io_service;
+    }
+    namespace system
+    {
+        class error_code;
+    }
+}
+
 namespace mct
 {
 
 class Configuration;
 class Logger;
+class IPResolver;
+class ProxyManager;
+class CaptureRing;
+class AffinityTable;
+struct ListenerOptions;
+struct ProxyRoute;
+struct PortRange;
 
 class MCT_MODEPROXY_DLL_PUBLIC ModeProxy : public Mode
 {
@@ -55,8 +79,93 @@ public:
     virtual bool run();
 
 protected:
-    uint16_t get_num_of_all_proxies() const;
-    bool validate_configuration() const;
+    /**
+     * Rules of mode.proxy.port_range are numbered after the listeners of mode.proxy.local_host, each of them starts
+     * a listener for every port of its range.
+     */
+    uint16_t get_num_of_all_proxies(const Configuration& config) const;
+    static bool is_port_range(const Configuration& config, uint16_t proxy_num);
+    bool validate_configuration(const Configuration& config) const;
+    bool validate_listener_option_size(const Configuration& config, const std::string& conf_field, size_t size) const;
+
+    ListenerOptions build_listener_options(const Configuration& config, IPResolver& ip_resolver, uint16_t proxy_num);
+    /**
+     * The route shared by all the listeners of a port range, range is filled with the parsed rule.
+     */
+    std::shared_ptr<const ProxyRoute> build_port_range_route(const Configuration& config, IPResolver& ip_resolver, uint16_t proxy_num, PortRange& range);
+    /**
+     * Listening sockets found in inherited_handles (keyed by get_listener_key()) are used instead of binding new ones
+     * and removed from the map.
+     */
+    void start_listener(const Configuration& config, boost::asio::io_service& ios, ProxyManager& manager, IPResolver& ip_resolver, uint16_t proxy_num,
+        std::map<std::string, int>& inherited_handles);
+    void add_listener(boost::asio::io_service& ios, ProxyManager& manager, const std::shared_ptr<const ProxyRoute>& route, uint16_t listen_port,
+        std::map<std::string, int>& inherited_handles);
+    static std::string get_listener_key(const std::string& listen_host, uint16_t listen_port);
+
+    /**
+     * Parses a comma separated list of host:port, returns false if any of them is malformed. "none" is an empty list.
+     */
+    static bool parse_backends(const std::string& backends, std::vector< std::pair<std::string, uint16_t> >& parsed);
+
+    /**
+     * Listeners keep their affinity table across reloads as long as everything the table depends on stays the same.
+     */
+    static std::string get_affinity_table_key(const Configuration& config, uint16_t proxy_num);
+
+    /**
+     * Builds a new configuration from the same command line and configuration file and resolves its host names
+     * asynchronously, then (apply_configuration) opens listeners which were added, stops (and drains) listeners
+     * which were removed and changes the route of the remaining ones for new sessions. Established sessions are
+     * not interrupted. Invalid configuration is ignored, so is a reload overtaken by a newer one or by draining.
+     */
+    void reload_configuration(boost::asio::io_service& ios, ProxyManager& manager);
+    void apply_configuration(boost::asio::io_service& ios, ProxyManager& manager, const Configuration& reloaded, const std::map<std::string, std::string>& resolved);
+
+    /**
+     * Draining stops the listeners (and the handoff socket) and waits until the established sessions finish or
+     * mode.proxy.drain_timeout passes, finish() then closes the remaining sessions and leaves run().
+     */
+    void start_drain(const char* reason);
+    void check_drain(const boost::system::error_code& error);
+    void finish();
+
+    /**
+     * The first SIGTERM (or SIGINT) starts draining, the second one finishes right away. SIGHUP reloads the
+     * configuration unless draining has started.
+     */
+    void handle_stop_signal(const boost::system::error_code& error, int signal_number);
+    void handle_reload_signal(const boost::system::error_code& error, int signal_number);
+
+    /**
+     * Every host name the listeners of config use (Unix domain socket names excepted).
+     */
+    void collect_host_names(const Configuration& config, std::set<std::string>& host_names) const;
+
+    /**
+     * Per-listener options may be left empty (default_value is used), given once (shared by all listeners)
+     * or given once per listener.
+     */
+    template <typename T>
+    static T get_listener_option(const std::vector<T>& values, uint16_t proxy_num, const T& default_value)
+    {
+        if (values.empty()) {
+            return default_value;
+        }
+
+        return (values.size() == 1) ? values.front() : values[proxy_num];
+    }
+
+protected:
+    // listeners using the same capture prefix share one ring
+    std::map< std::string, std::shared_ptr<CaptureRing> > m_capture_rings;
+    std::map< std::string, std::shared_ptr<AffinityTable> > m_affinity_tables;
+    // incremented by every reload (and by draining), a reload whose host names resolve late applies only if it is still the latest
+    uint64_t m_reload_generation;
+
+    struct RunState;
+    // set only while run() is running
+    RunState* m_run_state;
 };
 
 }
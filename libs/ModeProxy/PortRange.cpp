@@ -0,0 +1,85 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/PortRange.cpp
+ *
+ * @desc PortRange is a single rule forwarding a whole range of local ports.
+ */
+
+#include <boost/lexical_cast.hpp>
+
+#include <ModeProxy/PortRange.hpp>
+#include <ModeProxy/StreamEndpoint.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+// host:first-last or host:port, hosts may contain colons (IPv6)
+bool parse_endpoint_range(const std::string& endpoint, std::string& host, uint16_t& first, uint16_t& last)
+{
+    const size_t colon = endpoint.rfind(':');
+    if (colon == std::string::npos || colon == 0) {
+        return false;
+    }
+
+    host = endpoint.substr(0, colon);
+    const std::string ports = endpoint.substr(colon + 1);
+    const size_t dash = ports.find('-');
+
+    try {
+        first = boost::lexical_cast<uint16_t>(ports.substr(0, dash));
+        last = (dash == std::string::npos) ? first : boost::lexical_cast<uint16_t>(ports.substr(dash + 1));
+    } catch (const boost::bad_lexical_cast&) {
+        return false;
+    }
+
+    return first <= last;
+}
+
+}
+
+bool PortRange::parse(const std::string& rule, PortRange& range)
+{
+    const size_t separator = rule.find('=');
+    if (separator == std::string::npos) {
+        return false;
+    }
+
+    if (!parse_endpoint_range(rule.substr(0, separator), range.local_host, range.local_first, range.local_last) ||
+        !parse_endpoint_range(rule.substr(separator + 1), range.remote_host, range.remote_first, range.remote_last)) {
+        return false;
+    }
+
+    // the port of a Unix domain socket backend is ignored, so it may be 0 there
+    if (range.local_first == 0 || (range.remote_first == 0 && !StreamEndpoint::is_local(range.remote_host))) {
+        return false;
+    }
+
+    return !range.is_port_mapped() || (range.remote_last - range.remote_first == range.local_last - range.local_first);
+}
+
+}
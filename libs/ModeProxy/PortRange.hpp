@@ -0,0 +1,68 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/PortRange.hpp
+ *
+ * @desc PortRange is a single rule forwarding a whole range of local ports.
+ */
+
+#ifndef MCT_MODEPROXY_PORTRANGE_HPP
+#define MCT_MODEPROXY_PORTRANGE_HPP
+
+#include <string>
+#include <cstdint>
+
+#include <ModeProxy/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * local_host:first-last=remote_host:first[-last] - with a remote range (of the same length) every local port
+ * is forwarded to its counterpart, with a single remote port all of them are forwarded to it.
+ */
+struct MCT_MODEPROXY_DLL_PUBLIC PortRange
+{
+    PortRange() : local_first(0), local_last(0), remote_first(0), remote_last(0) {}
+
+    /**
+     * Returns false if the rule is malformed or its ranges are empty or of different lengths.
+     */
+    static bool parse(const std::string& rule, PortRange& range);
+
+    uint32_t get_num_of_ports() const { return static_cast<uint32_t>(local_last) - local_first + 1; }
+    bool is_port_mapped() const { return remote_first != remote_last; }
+
+    std::string local_host;
+    uint16_t local_first;
+    uint16_t local_last;
+
+    std::string remote_host;
+    uint16_t remote_first;
+    uint16_t remote_last;
+};
+
+}
+
+#endif // MCT_MODEPROXY_PORTRANGE_HPP
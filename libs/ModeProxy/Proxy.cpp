@@ -27,134 +27,395 @@
  * @desc Proxy holds one session.
  */
 
+#include <array>
+#include <cstring>
 #include <functional>
 
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/write.hpp>
 #include <Logger/Logger.hpp>
 #include <ModeProxy/Proxy.hpp>
+#include <ModeProxy/ShadowSink.hpp>
+#include <ModeProxy/CaptureRing.hpp>
+#include <ModeProxy/ProxyRoute.hpp>
+#include <ModeProxy/AffinityTable.hpp>
+#include <ModeProxy/ProxyProtocol.hpp>
 
 namespace mct
 {
 
-Proxy::Proxy(Logger& logger, boost::asio::io_service& ios, const std::string& remote_host, uint16_t remote_port)
- : m_log(logger), m_ios(ios), m_remote_host(remote_host), m_remote_port(remote_port), m_client_host("none"), m_client_port(0),
-   m_client_socket(new boost::asio::ip::tcp::socket(m_ios)), m_remote_socket(new boost::asio::ip::tcp::socket(m_ios)), m_has_started(false)
+Proxy::Proxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, uint16_t backend_num)
+ : m_log(logger), m_ios(ios), m_route(route), m_client_socket(m_ios), m_remote_socket(m_ios), m_capture_session_id(0), m_client_family(-1), m_backend_num(backend_num), m_port_offset(0), m_pending_length(0), m_has_started(false),
+   m_is_client_finished(false), m_is_remote_finished(false)
 {
 }
 
 Proxy::~Proxy()
 {
-	m_log.info("Releasing client %s:%u.", m_client_host.c_str(), m_client_port);
+	m_log.info("Releasing client %s:%u.", get_client_host().c_str(), get_client_port());
 }
 
-void Proxy::start(const std::string& listen_host, uint16_t listen_port)
+const ProxyBackend& Proxy::get_backend() const
+{
+	return m_route->backends[m_backend_num];
+}
+
+uint16_t Proxy::get_backend_port() const
+{
+	return static_cast<uint16_t>(get_backend().port + m_port_offset);
+}
+
+void Proxy::start()
 {
 	if (has_started()) {
 		return;
 	}
 
 	m_has_started = true;
-    m_client_host = m_client_socket->remote_endpoint().address().to_string();
-    m_client_port = m_client_socket->remote_endpoint().port();
+    boost::system::error_code error;
+    m_client_endpoint = StreamEndpoint::to_ip(m_client_socket.remote_endpoint(error));
+
+	m_route->options.socket_options.apply_to_connection(m_log, static_cast<int>(m_client_socket.native_handle()), m_client_family);
+
+	if (m_route->options.accept_proxy_protocol != ListenerOptions::proxy_protocol_none) {
+		read_proxy_header();
+	} else {
+		connect_remote();
+	}
+
+	if (m_route->options.capture) {
+		m_capture_session_id = m_route->options.capture->next_session_id();
+		m_route->options.capture->append(m_capture_session_id, capture_session_open, nullptr, 0);
+	}
+
+	if (!m_route->options.shadow_host.empty()) {
+		m_shadow = std::make_shared<ShadowSink>(m_log, m_ios, m_route->options.shadow_host, m_route->options.shadow_port, m_route->options.shadow_buffer_size,
+			m_route->options.shadow_close_timeout);
+		m_shadow->start();
+	}
+}
+
+void Proxy::connect_remote()
+{
+    m_log.info("Accepted client %s:%u with listener %s:%u. Redirecting connection to %s:%u.", get_client_host().c_str(), get_client_port(),
+        m_route->listen_host.c_str(), m_route->listen_port, get_backend().host.c_str(), get_backend_port());
 
-    m_log.info("Accepted client %s:%u with listener %s:%u. Redirecting connection to %s:%u.", m_client_host.c_str(), m_client_port, listen_host.c_str(), listen_port, m_remote_host.c_str(), m_remote_port);
+	const StreamEndpoint::endpoint_type endpoint = get_backend_endpoint();
+	open_remote_socket(endpoint);
 
-	m_remote_socket->async_connect(
-		boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(m_remote_host), m_remote_port),
-		std::bind(&Proxy::handle_remote_connect, shared_from_this(), std::placeholders::_1)
+	m_remote_socket.async_connect(endpoint, std::bind(&Proxy::handle_remote_connect, shared_from_this(), std::placeholders::_1));
+}
+
+StreamEndpoint::endpoint_type Proxy::get_backend_endpoint() const
+{
+	if (m_port_offset == 0) {
+		return get_backend().endpoint;
+	}
+
+	// port ranges are forwarded to IP backends only
+	boost::asio::ip::tcp::endpoint endpoint = StreamEndpoint::to_ip(get_backend().endpoint);
+	endpoint.port(get_backend_port());
+	return endpoint;
+}
+
+void Proxy::open_remote_socket(const StreamEndpoint::endpoint_type& endpoint)
+{
+	boost::system::error_code error;
+	m_remote_socket.close(error);
+
+	// the remote socket is opened before connecting, so its options are already in place for the handshake
+	m_remote_socket.open(endpoint.protocol(), error);
+	if (!error) {
+		m_route->options.socket_options.apply_before_connect(m_log, static_cast<int>(m_remote_socket.native_handle()), endpoint.protocol().family());
+	}
+}
+
+void Proxy::read_proxy_header()
+{
+	m_client_socket.async_read_some(
+		boost::asio::buffer(m_client_data + m_pending_length, m_max_data_length - m_pending_length),
+		std::bind(&Proxy::handle_proxy_header_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2)
 	);
 }
 
+void Proxy::handle_proxy_header_read(const boost::system::error_code& error, size_t bytes_transferred)
+{
+	if (error) {
+		m_log.warning("Cannot read PROXY protocol header of client %s:%u, because: %s", get_client_host().c_str(), get_client_port(), error.message().c_str());
+		close();
+		return;
+	}
+
+	m_pending_length += bytes_transferred;
+
+	ProxyHeader header;
+	const ProxyProtocol::Result result = ProxyProtocol::parse_header(m_route->options.accept_proxy_protocol, m_client_data, m_pending_length, m_max_data_length, header);
+
+	if (result == ProxyProtocol::incomplete) {
+		read_proxy_header();
+		return;
+	}
+
+	if (result == ProxyProtocol::invalid) {
+		m_log.warning("Client %s:%u did not start with a valid PROXY protocol header.", get_client_host().c_str(), get_client_port());
+		close();
+		return;
+	}
+
+	if (header.has_addresses) {
+		m_log.debug("Client %s:%u is %s:%u according to its PROXY protocol header.", get_client_host().c_str(), get_client_port(),
+			header.source.address().to_string().c_str(), header.source.port());
+		m_client_endpoint = header.source;
+	}
+
+	// whatever followed the header is sent to the remote endpoint before the pumps start
+	m_pending_length -= header.length;
+	std::memmove(m_client_data, m_client_data + header.length, m_pending_length);
+
+	connect_remote();
+}
+
+void Proxy::send_first_bytes()
+{
+	size_t header_length = 0;
+
+	if (m_route->options.send_proxy_protocol != ListenerOptions::proxy_protocol_none) {
+		// the client usually speaks first - its data which is already here goes out in the same segment as the header,
+		// while a client which waits for the server does not make the header wait
+		boost::system::error_code error;
+		if (m_client_socket.available(error) > 0 && m_pending_length < m_max_data_length) {
+			m_pending_length += m_client_socket.read_some(boost::asio::buffer(m_client_data + m_pending_length, m_max_data_length - m_pending_length), error);
+		}
+
+		const StreamEndpoint::endpoint_type listen_endpoint = m_client_socket.local_endpoint(error);
+		// the remote buffer is not used before the pumps start; clients of Unix domain listeners have no address to pass on
+		if (m_client_endpoint.port() != 0 && StreamEndpoint::is_ip(listen_endpoint)) {
+			header_length = ProxyProtocol::write_header(m_route->options.send_proxy_protocol, m_client_endpoint, StreamEndpoint::to_ip(listen_endpoint), m_remote_data);
+		} else {
+			header_length = ProxyProtocol::write_local_header(m_route->options.send_proxy_protocol, m_remote_data);
+		}
+	}
+
+	if (m_pending_length > 0) {
+		process_client_data(m_pending_length);
+	}
+
+	std::array<boost::asio::const_buffer, 2> buffers = {{
+		boost::asio::buffer(m_remote_data, header_length),
+		boost::asio::buffer(m_client_data, m_pending_length)
+	}};
+
+	boost::asio::async_write(m_remote_socket, buffers, std::bind(&Proxy::handle_first_bytes_write, shared_from_this(), std::placeholders::_1));
+}
+
+void Proxy::handle_first_bytes_write(const boost::system::error_code& error)
+{
+	if (error) {
+		handle_remote_write_error(error);
+		return;
+	}
+
+	m_pending_length = 0;
+	start_pumps();
+}
+
 void Proxy::close()
 {
-	m_log.debug("Closing sockets for client %s:%u.", m_client_host.c_str(), m_client_port);
+	m_log.debug("Closing sockets for client %s:%u.", get_client_host().c_str(), get_client_port());
+
+    if (m_route->options.capture && (m_client_socket.is_open() || m_remote_socket.is_open())) {
+        m_route->options.capture->append(m_capture_session_id, capture_session_close, nullptr, 0);
+    }
 
-    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_client_socket.is_open()) {
+        m_client_socket.close();
+    }
 
-    if (m_client_socket->is_open()) {
-        m_client_socket->close();
+    if (m_remote_socket.is_open()) {
+        m_remote_socket.close();
     }
 
-    if (m_remote_socket->is_open()) {
-        m_remote_socket->close();
+    if (m_shadow) {
+        m_shadow->close();
     }
 }
 
 void Proxy::handle_remote_connect(const boost::system::error_code& error)
 {
 	if (!error) {
-		m_log.warning("Tunnel for client %s:%u to remote endpoint %s:%u is now up and running.", m_client_host.c_str(), m_client_port, m_remote_host.c_str(), m_remote_port);
-
-		m_remote_socket->async_read_some(
-			boost::asio::buffer(m_remote_data, m_max_data_length),
-			std::bind(&Proxy::handle_remote_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2)
-		);
+		m_log.warning("Tunnel for client %s:%u to remote endpoint %s:%u is now up and running.", get_client_host().c_str(), get_client_port(), get_backend().host.c_str(), get_backend_port());
 
-		m_client_socket->async_read_some(
-			boost::asio::buffer(m_client_data, m_max_data_length),
-			std::bind(&Proxy::handle_client_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2)
-		);
+		if (m_route->options.send_proxy_protocol != ListenerOptions::proxy_protocol_none || m_pending_length > 0) {
+			send_first_bytes();
+		} else {
+			start_pumps();
+		}
     } else {
-    	m_log.error("Cannot create tunnel for client %s:%u to remote endpoint %s:%u. Error: %s", m_client_host.c_str(), m_client_port, m_remote_host.c_str(), m_remote_port, error.message().c_str());
+    	m_log.error("Cannot create tunnel for client %s:%u to remote endpoint %s:%u. Error: %s", get_client_host().c_str(), get_client_port(), get_backend().host.c_str(), get_backend_port(), error.message().c_str());
+
+    	// the client is sent to another backend next time, instead of being stuck with this one
+    	if (m_route->options.affinity) {
+    		// pinned by the listener, so by the address of the connection - not the one from a PROXY protocol header
+    		boost::system::error_code ignored;
+    		const StreamEndpoint::endpoint_type client_endpoint = m_client_socket.remote_endpoint(ignored);
+    		if (StreamEndpoint::is_ip(client_endpoint)) {
+    			m_route->options.affinity->unpin(AffinityTable::make_key(StreamEndpoint::to_ip(client_endpoint).address(), m_route->options.affinity_by_prefix), m_backend_num);
+    		}
+    	}
+
         close();
     }
 }
 
+void Proxy::start_pumps()
+{
+	m_remote_socket.async_read_some(
+		boost::asio::buffer(m_remote_data, m_max_data_length),
+		std::bind(&Proxy::handle_remote_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2)
+	);
+
+	m_client_socket.async_read_some(
+		boost::asio::buffer(m_client_data, m_max_data_length),
+		std::bind(&Proxy::handle_client_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2)
+	);
+}
+
 void Proxy::handle_remote_read(const boost::system::error_code& error, const size_t& bytes_transferred)
 {
     if (!error) {
-    	m_log.debug("[Client %s:%u] Read %u bytes from remote endpoint.", m_client_host.c_str(), m_client_port, bytes_transferred);
+        process_remote_data(bytes_transferred);
 
         boost::asio::async_write(
-        	*m_client_socket, boost::asio::buffer(m_remote_data, bytes_transferred),
+        	m_client_socket, boost::asio::buffer(m_remote_data, bytes_transferred),
         	std::bind(&Proxy::handle_client_write, shared_from_this(), std::placeholders::_1)
         );
     } else {
-    	m_log.warning("Client %s:%u cannot read data from remote endpoint %s:%u, because: %s", m_client_host.c_str(), m_client_port, m_remote_host.c_str(), m_remote_port, error.message().c_str());
-        close();
+        handle_remote_read_error(error);
     }
 }
 
 void Proxy::handle_client_read(const boost::system::error_code& error, const size_t& bytes_transferred)
 {
     if (!error) {
-    	m_log.debug("[Client %s:%u] Read %u bytes from client endpoint.", m_client_host.c_str(), m_client_port, bytes_transferred);
+        process_client_data(bytes_transferred);
 
         boost::asio::async_write(
-        	*m_remote_socket, boost::asio::buffer(m_client_data, bytes_transferred),
+        	m_remote_socket, boost::asio::buffer(m_client_data, bytes_transferred),
         	std::bind(&Proxy::handle_remote_write, shared_from_this(), std::placeholders::_1)
         );
     } else {
-    	m_log.warning("Client %s:%u cannot read data from client endpoint, because: %s", m_client_host.c_str(), m_client_port, error.message().c_str());
-        close();
+        handle_client_read_error(error);
     }
 }
 
 void Proxy::handle_remote_write(const boost::system::error_code& error)
 {
 	if (!error) {
-        m_client_socket->async_read_some(
+        m_client_socket.async_read_some(
             boost::asio::buffer(m_client_data, m_max_data_length),
             std::bind(&Proxy::handle_client_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2)
         );
     } else {
-    	m_log.warning("Client %s:%u cannot write data to remote endpoint %s:%u, because: %s", m_client_host.c_str(), m_client_port, m_remote_host.c_str(), m_remote_port, error.message().c_str());
-        close();
+        handle_remote_write_error(error);
     }
 }
 
 void Proxy::handle_client_write(const boost::system::error_code& error)
 {
 	if (!error) {
-        m_remote_socket->async_read_some(
+        m_remote_socket.async_read_some(
             boost::asio::buffer(m_remote_data, m_max_data_length),
             std::bind(&Proxy::handle_remote_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2)
         );
     } else {
-    	m_log.warning("Client %s:%u cannot write data to client endpoint, because: %s", m_client_host.c_str(), m_client_port, error.message().c_str());
-        close();
+        handle_client_write_error(error);
     }
 }
 
+void Proxy::process_remote_data(size_t bytes_transferred)
+{
+	m_log.debug("[Client %s:%u] Read %u bytes from remote endpoint.", get_client_host().c_str(), get_client_port(), bytes_transferred);
+
+	if (m_route->options.capture) {
+		m_route->options.capture->append(m_capture_session_id, capture_remote_to_client, m_remote_data, bytes_transferred);
+	}
+}
+
+void Proxy::process_client_data(size_t bytes_transferred)
+{
+	m_log.debug("[Client %s:%u] Read %u bytes from client endpoint.", get_client_host().c_str(), get_client_port(), bytes_transferred);
+
+	if (m_route->options.capture) {
+		m_route->options.capture->append(m_capture_session_id, capture_client_to_remote, m_client_data, bytes_transferred);
+	}
+
+	if (m_shadow) {
+		m_shadow->push(m_client_data, bytes_transferred);
+	}
+}
+
+void Proxy::handle_remote_read_error(const boost::system::error_code& error)
+{
+	if (error == boost::asio::error::eof) {
+		handle_remote_eof();
+	} else {
+		m_log.warning("Client %s:%u cannot read data from remote endpoint %s:%u, because: %s", get_client_host().c_str(), get_client_port(), get_backend().host.c_str(), get_backend_port(), error.message().c_str());
+		close();
+	}
+}
+
+void Proxy::handle_client_read_error(const boost::system::error_code& error)
+{
+	if (error == boost::asio::error::eof) {
+		handle_client_eof();
+	} else {
+		m_log.warning("Client %s:%u cannot read data from client endpoint, because: %s", get_client_host().c_str(), get_client_port(), error.message().c_str());
+		close();
+	}
+}
+
+void Proxy::handle_remote_write_error(const boost::system::error_code& error)
+{
+	m_log.warning("Client %s:%u cannot write data to remote endpoint %s:%u, because: %s", get_client_host().c_str(), get_client_port(), get_backend().host.c_str(), get_backend_port(), error.message().c_str());
+	close();
+}
+
+void Proxy::handle_client_write_error(const boost::system::error_code& error)
+{
+	m_log.warning("Client %s:%u cannot write data to client endpoint, because: %s", get_client_host().c_str(), get_client_port(), error.message().c_str());
+	close();
+}
+
+void Proxy::handle_client_eof()
+{
+	m_log.debug("[Client %s:%u] Client endpoint has finished sending, shutting down sending to remote endpoint.", get_client_host().c_str(), get_client_port());
+
+	m_is_client_finished = true;
+
+	boost::system::error_code ignored;
+	m_remote_socket.shutdown(boost::asio::socket_base::shutdown_send, ignored);
+
+	if (m_shadow) {
+		m_shadow->close();
+	}
+
+	if (m_is_remote_finished) {
+		close();
+	}
+}
+
+void Proxy::handle_remote_eof()
+{
+	m_log.debug("[Client %s:%u] Remote endpoint has finished sending, shutting down sending to client endpoint.", get_client_host().c_str(), get_client_port());
+
+	m_is_remote_finished = true;
+
+	boost::system::error_code ignored;
+	m_client_socket.shutdown(boost::asio::socket_base::shutdown_send, ignored);
+
+	if (m_is_client_finished) {
+		close();
+	}
+}
+
 }
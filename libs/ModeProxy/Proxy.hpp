@@ -30,81 +30,144 @@
 #ifndef MCT_MODEPROXY_PROXY_HPP
 #define MCT_MODEPROXY_PROXY_HPP
 
-#include <mutex>
 #include <memory>
+#include <string>
 #include <cstdint>
 
-namespace boost
-{
-    namespace system
-    {
-        class error_code;
-    }
-
-    namespace asio
-    {
-        class io_service;
-
-        namespace ip
-        {
-            class tcp;
-        }
-
-        template <typename Protocol>
-        class stream_socket_service;
-
-        template <typename Protocol, typename StreamSocketService >
-        class basic_stream_socket;
-    }
-}
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/generic/stream_protocol.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <ModeProxy/Config.hpp>
+#include <ModeProxy/StreamEndpoint.hpp>
 
 namespace mct
 {
 
 class Logger;
+class ShadowSink;
+struct ProxyRoute;
+struct ProxyBackend;
 
-class Proxy : public std::enable_shared_from_this<Proxy>
+/**
+ * Everything the session shares with the other sessions of its listener is kept in the route, so a session
+ * holds little more than its two sockets and their buffers. Both sockets may be TCP or Unix domain sockets.
+ */
+class MCT_MODEPROXY_DLL_PUBLIC Proxy : public std::enable_shared_from_this<Proxy>
 {
 public:
-    Proxy(Logger& logger, boost::asio::io_service& ios, const std::string& remote_host, uint16_t remote_port);
-    ~Proxy();
+    typedef boost::asio::generic::stream_protocol::socket socket_type;
 
-    const std::unique_ptr< boost::asio::basic_stream_socket<boost::asio::ip::tcp> >& get_client_socket() const { return m_client_socket; }
-    const std::unique_ptr< boost::asio::basic_stream_socket<boost::asio::ip::tcp> >& get_remote_socket() const { return m_remote_socket; }
+    // backend_num selects one of the backends of the route
+    Proxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, uint16_t backend_num = 0);
+    virtual ~Proxy();
+
+    socket_type& get_client_socket() { return m_client_socket; }
+    const socket_type& get_client_socket() const { return m_client_socket; }
+    const socket_type& get_remote_socket() const { return m_remote_socket; }
 
     bool has_started() const { return m_has_started; }
 
-    void start(const std::string& listen_host, uint16_t listen_port);
-    void close();
+    void start();
+    // sessions which hold more than the two sockets (e.g. a tunnel stream) release the rest here as well
+    virtual void close();
+
+    std::string get_client_host() const { return m_client_endpoint.address().to_string(); }
+    const uint16_t get_client_port() const { return m_client_endpoint.port(); }
+
+    virtual const ProxyBackend& get_backend() const;
+
+    /**
+     * Sessions of a port range listener connect to the port of their backend shifted by port_offset (see ProxyRoute::get_port_offset).
+     */
+    void set_port_offset(uint16_t port_offset) { m_port_offset = port_offset; }
+    /**
+     * Address family of the client socket as known by the listener, so applying socket options does not have to ask the kernel.
+     */
+    void set_client_family(int family) { m_client_family = family; }
+    uint16_t get_backend_port() const;
 
-    const std::string& get_client_host() const { return m_client_host; }
-    const uint16_t get_client_port() const { return m_client_port; }
+    static size_t get_buffers_size() { return sizeof(m_remote_data) + sizeof(m_client_data); }
 
 protected:
+	/**
+	 * Connects the remote socket to the backend of the route and calls handle_remote_connect. Sessions which
+	 * negotiate their destination with the client first (e.g. SOCKS) override it.
+	 */
+	virtual void connect_remote();
 	void handle_remote_connect(const boost::system::error_code& error);
+
+	StreamEndpoint::endpoint_type get_backend_endpoint() const;
+
+	/**
+	 * (Re)opens the remote socket for the given endpoint and applies the socket options of the route to it.
+	 */
+	void open_remote_socket(const StreamEndpoint::endpoint_type& endpoint);
+
+	/**
+	 * Reads the PROXY protocol header of the client (ListenerOptions::accept_proxy_protocol) before connect_remote.
+	 */
+	void read_proxy_header();
+	void handle_proxy_header_read(const boost::system::error_code& error, size_t bytes_transferred);
+
+	/**
+	 * Sends the PROXY protocol header (ListenerOptions::send_proxy_protocol) and the client data which is already
+	 * here in a single write, then starts the pumps.
+	 */
+	void send_first_bytes();
+	void handle_first_bytes_write(const boost::system::error_code& error);
+
+	/**
+	 * Starts moving data in both directions once the remote endpoint is connected. The callback engine
+	 * chains handle_*_read and handle_*_write, other session engines override it.
+	 */
+	virtual void start_pumps();
+
 	void handle_remote_read(const boost::system::error_code& error, const size_t& bytes_transferred);
 	void handle_client_read(const boost::system::error_code& error, const size_t& bytes_transferred);
 	void handle_remote_write(const boost::system::error_code& error);
 	void handle_client_write(const boost::system::error_code& error);
 
+	// shared by the session engines - capture and shadow the data read from an endpoint, report errors
+	void process_remote_data(size_t bytes_transferred);
+	void process_client_data(size_t bytes_transferred);
+	void handle_remote_read_error(const boost::system::error_code& error);
+	// virtual for sessions whose client socket reports more than data and EOF (e.g. kernel TLS)
+	virtual void handle_client_read_error(const boost::system::error_code& error);
+	void handle_remote_write_error(const boost::system::error_code& error);
+	void handle_client_write_error(const boost::system::error_code& error);
+
+	// EOF in one direction is forwarded as shutdown(send) to the other endpoint, the opposite direction keeps going
+	void handle_client_eof();
+	virtual void handle_remote_eof();
+
 protected:
 	Logger& m_log;
 	boost::asio::io_service& m_ios;
 
-	const std::string m_remote_host;
-	const uint16_t m_remote_port;
-	std::string m_client_host;
-	uint16_t m_client_port;
+	const std::shared_ptr<const ProxyRoute> m_route;
+	// unspecified (port 0) for clients of Unix domain listeners, unless they send a PROXY protocol header
+	boost::asio::ip::tcp::endpoint m_client_endpoint;
 
     enum { m_max_data_length = 8192 }; //8KB
     unsigned char m_remote_data[m_max_data_length];
     unsigned char m_client_data[m_max_data_length];
 
-    std::unique_ptr< boost::asio::basic_stream_socket<boost::asio::ip::tcp> > m_client_socket;
-    std::unique_ptr< boost::asio::basic_stream_socket<boost::asio::ip::tcp> > m_remote_socket;
+    socket_type m_client_socket;
+    socket_type m_remote_socket;
+
+    std::shared_ptr<ShadowSink> m_shadow;
+    uint64_t m_capture_session_id;
+    // -1 until the listener tells it
+    int m_client_family;
 
+    uint16_t m_backend_num;
+    uint16_t m_port_offset;
+    // client data in m_client_data which has not been sent to the remote endpoint yet (read together with a PROXY protocol header)
+    uint16_t m_pending_length;
     bool m_has_started;
-    std::mutex m_mutex;
+    bool m_is_client_finished;
+    bool m_is_remote_finished;
 };
 
 }
@@ -28,24 +28,112 @@
  */
 
 #include <thread>
-
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <algorithm>
 #include <functional>
 
+#if defined(__linux__)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 #include <boost/asio/basic_socket_acceptor.hpp>
-#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/generic/stream_protocol.hpp>
+#include <boost/system/system_error.hpp>
 
 #include <Logger/Logger.hpp>
 #include <ModeProxy/Proxy.hpp>
+#include <ModeProxy/CoroutineProxy.hpp>
 #include <ModeProxy/ProxyListener.hpp>
+#include <ModeProxy/ProxyRoute.hpp>
+#include <ModeProxy/SessionSlab.hpp>
+#include <ModeProxy/AffinityTable.hpp>
+#include <ModeProxy/StreamEndpoint.hpp>
 
 namespace mct
 {
 
-ProxyListener::ProxyListener(boost::asio::io_service& ios, Logger& logger, const std::string& listen_host, uint16_t listen_port, const std::string& remote_host, uint16_t remote_port)
-: m_ios(ios), m_log(logger), m_listen_host(listen_host), m_listen_port(listen_port), m_remote_host(remote_host), m_remote_port(remote_port), m_is_dead(false),
-  m_acceptor(new boost::asio::ip::tcp::acceptor(m_ios, boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(m_listen_host), m_listen_port)))
+namespace
 {
-	m_log.debug("Creating listener %s:%u.", m_listen_host.c_str(), m_listen_port);
+
+typedef boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol> acceptor_type;
+
+// a socket file is only stale when nobody listens on it anymore, a live one is in use just as a bound TCP port
+void remove_stale_socket_file(boost::asio::io_service& ios, const StreamEndpoint::endpoint_type& endpoint, const std::string& path)
+{
+	boost::asio::generic::stream_protocol::socket probe(ios, endpoint.protocol());
+	probe.non_blocking(true);
+
+	boost::system::error_code error;
+	probe.connect(endpoint, error);
+
+	if (error == boost::asio::error::connection_refused) {
+		// a socket file left by an instance which did not hand its listeners off
+		std::remove(path.c_str());
+	} else if (!error || error == boost::asio::error::would_block || error == boost::asio::error::try_again) {
+		throw boost::system::system_error(boost::asio::error::address_in_use, "bind");
+	}
+}
+
+acceptor_type* create_acceptor(boost::asio::io_service& ios, Logger& logger, const std::string& listen_host, uint16_t listen_port, const SocketOptions& options,
+	int inherited_handle)
+{
+	const int backlog = (options.backlog < 0) ? static_cast<int>(boost::asio::socket_base::max_connections) : options.backlog;
+	const StreamEndpoint::endpoint_type endpoint = StreamEndpoint::make(listen_host, listen_port);
+
+	if (inherited_handle < 0) {
+		std::unique_ptr<acceptor_type> acceptor(new acceptor_type(ios));
+		acceptor->open(endpoint.protocol());
+
+		if (StreamEndpoint::is_ip(endpoint)) {
+			acceptor->set_option(boost::asio::socket_base::reuse_address(true));
+		} else if (!StreamEndpoint::get_path(listen_host).empty()) {
+			remove_stale_socket_file(ios, endpoint, StreamEndpoint::get_path(listen_host));
+		}
+
+		options.apply_to_acceptor(logger, static_cast<int>(acceptor->native_handle()));
+		acceptor->bind(endpoint);
+		acceptor->listen(backlog);
+		return acceptor.release();
+	}
+
+	std::unique_ptr<acceptor_type> acceptor(new acceptor_type(ios, endpoint.protocol(), inherited_handle));
+	options.apply_to_acceptor(logger, inherited_handle);
+
+	// listening again on a listening socket only changes its backlog
+	if (options.backlog >= 0) {
+		acceptor->listen(backlog);
+	}
+
+	return acceptor.release();
+}
+
+}
+
+ProxyListener::ProxyListener(boost::asio::io_service& ios, Logger& logger, const std::string& listen_host, uint16_t listen_port, const std::string& remote_host, uint16_t remote_port,
+	const ListenerOptions& options, int inherited_handle)
+: ProxyListener(ios, logger, std::make_shared<ProxyRoute>(listen_host, listen_port, remote_host, remote_port, options), listen_port, inherited_handle)
+{
+}
+
+ProxyListener::ProxyListener(boost::asio::io_service& ios, Logger& logger, const std::shared_ptr<const ProxyRoute>& route, uint16_t listen_port, int inherited_handle)
+: m_ios(ios), m_log(logger), m_listen_host(route->listen_host), m_listen_port(listen_port),
+  m_route(route), m_port_offset(route->get_port_offset(listen_port)), m_is_dead(false), m_is_stopped(false), m_num_of_accepted_sessions(0),
+  m_acceptor(create_acceptor(m_ios, m_log, m_listen_host, m_listen_port, route->options.socket_options, inherited_handle)),
+  m_accepted_socket(new Proxy::socket_type(m_ios))
+{
+	// the accept queue is drained without blocking once the listener is woken up
+	m_acceptor->non_blocking(true);
+
+	const boost::asio::generic::stream_protocol protocol = m_acceptor->local_endpoint().protocol();
+	m_acceptor_family = protocol.family();
+	m_acceptor_protocol = protocol.protocol();
+
+	m_log.debug("Creating listener %s:%u%s.", m_listen_host.c_str(), m_listen_port, (inherited_handle < 0) ? "" : " (inherited socket)");
 }
 
 ProxyListener::~ProxyListener()
@@ -55,22 +143,170 @@ ProxyListener::~ProxyListener()
 
 void ProxyListener::async_listen()
 {
-	m_next_session = create_session();
-	m_acceptor->async_accept(*m_next_session->get_client_socket(), std::bind(&ProxyListener::handle_accept, shared_from_this(), std::placeholders::_1));
+	m_acceptor->async_accept(*m_accepted_socket, std::bind(&ProxyListener::handle_accept, shared_from_this(), std::placeholders::_1));
 }
 
-std::shared_ptr<Proxy> ProxyListener::create_session()
+const std::string& ProxyListener::get_remote_host() const
 {
-	std::lock_guard<std::mutex> lock(m_sessions_access);
-	m_sessions.push_back(std::make_shared<Proxy>(m_log, m_ios, get_remote_host(), get_remote_port()));
-	return m_sessions.back();
+	return m_route->remote_host;
+}
+
+const uint16_t ProxyListener::get_remote_port() const
+{
+	return static_cast<uint16_t>(m_route->remote_port + m_port_offset);
+}
+
+const ListenerOptions& ProxyListener::get_options() const
+{
+	return m_route->options;
+}
+
+int ProxyListener::get_native_handle() const
+{
+	return static_cast<int>(m_acceptor->native_handle());
+}
+
+void ProxyListener::stop()
+{
+	m_log.info("Listener %s:%u stops accepting connections.", get_listen_host().c_str(), get_listen_port());
+
+	m_is_stopped = true;
+
+	boost::system::error_code ignored;
+	m_acceptor->close(ignored);
+}
+
+void ProxyListener::set_route(const std::string& remote_host, uint16_t remote_port, const ListenerOptions& options)
+{
+	set_route(std::make_shared<ProxyRoute>(get_listen_host(), get_listen_port(), remote_host, remote_port, options));
+}
+
+void ProxyListener::set_route(const std::shared_ptr<const ProxyRoute>& route)
+{
+	m_route = route;
+	m_port_offset = route->get_port_offset(get_listen_port());
+
+	const ListenerOptions& options = route->options;
+	if (m_acceptor->is_open()) {
+		options.socket_options.apply_to_acceptor(m_log, get_native_handle());
+
+		if (options.socket_options.backlog >= 0) {
+			boost::system::error_code ignored;
+			m_acceptor->listen(options.socket_options.backlog, ignored);
+		}
+	}
+}
+
+void ProxyListener::start_session()
+{
+	// the session is created only now, so it always uses the current route; its memory comes from the slab of this thread
+	const uint16_t backend_num = select_backend();
+
+	std::shared_ptr<Proxy> session;
+	if (m_route->options.session_factory) {
+		session = m_route->options.session_factory(m_log, m_ios, m_route);
+	} else if (m_route->options.session_engine == ListenerOptions::coroutine_engine) {
+		session = std::allocate_shared<CoroutineProxy>(SessionAllocator<CoroutineProxy>(m_ios), m_log, m_ios, m_route, backend_num);
+	} else {
+		session = std::allocate_shared<Proxy>(SessionAllocator<Proxy>(m_ios), m_log, m_ios, m_route, backend_num);
+	}
+	session->set_port_offset(m_port_offset);
+	session->set_client_family(m_acceptor_family);
+	session->get_client_socket() = std::move(*m_accepted_socket);
+	m_accepted_socket.reset(new Proxy::socket_type(m_ios));
+
+	{
+		std::lock_guard<std::mutex> lock(m_sessions_access);
+		m_sessions.push_back(session);
+	}
+
+	++m_num_of_accepted_sessions;
+	session->start();
+}
+
+uint16_t ProxyListener::select_backend()
+{
+	const uint16_t num_of_backends = static_cast<uint16_t>(m_route->backends.size());
+	if (num_of_backends == 1) {
+		return 0;
+	}
+
+	uint16_t backend_num = static_cast<uint16_t>(m_num_of_accepted_sessions % num_of_backends);
+
+	const ListenerOptions& options = m_route->options;
+	if (options.affinity) {
+		boost::system::error_code error;
+		const StreamEndpoint::endpoint_type client_endpoint = m_accepted_socket->remote_endpoint(error);
+
+		// clients of Unix domain listeners have no address to be pinned by
+		if (!error && StreamEndpoint::is_ip(client_endpoint)) {
+			backend_num = options.affinity->pin(AffinityTable::make_key(StreamEndpoint::to_ip(client_endpoint).address(), options.affinity_by_prefix), backend_num,
+				AffinityTable::get_current_time());
+		}
+	}
+
+	// a table kept across a reload may still point past the backends of the new route
+	return (backend_num < num_of_backends) ? backend_num : 0;
+}
+
+bool ProxyListener::accept_pending()
+{
+	for (;;) {
+#if defined(__linux__)
+		int handle = ::accept4(get_native_handle(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (handle >= 0) {
+			boost::system::error_code error;
+			m_accepted_socket->assign(boost::asio::generic::stream_protocol(m_acceptor_family, m_acceptor_protocol), handle, error);
+			if (error) {
+				::close(handle);
+				m_log.warning("Listener at %s:%u cannot use accepted connection: %s", get_listen_host().c_str(), get_listen_port(), error.message().c_str());
+				return false;
+			}
+			return true;
+		}
+
+		const int accept_errno = errno;
+		if (accept_errno == EINTR || accept_errno == ECONNABORTED) {
+			continue;
+		}
+
+		if (accept_errno != EAGAIN && accept_errno != EWOULDBLOCK) {
+			m_log.warning("Listener at %s:%u cannot drain its accept queue: %s", get_listen_host().c_str(), get_listen_port(), std::strerror(accept_errno));
+		}
+		return false;
+#else
+		boost::system::error_code error;
+		m_acceptor->accept(*m_accepted_socket, error);
+		if (!error) {
+			return true;
+		}
+
+		if (error == boost::asio::error::connection_aborted) {
+			continue;
+		}
+
+		if (error != boost::asio::error::would_block && error != boost::asio::error::try_again) {
+			m_log.warning("Listener at %s:%u cannot drain its accept queue: %s", get_listen_host().c_str(), get_listen_port(), error.message().c_str());
+		}
+		return false;
+#endif
+	}
 }
 
 void ProxyListener::handle_accept(const boost::system::error_code& error)
 {
 	if (!error) {
-		m_next_session->start(get_listen_host(), get_listen_port());
+		start_session();
+
+		// connections which arrived meanwhile are accepted right away, without going through the reactor for each of them
+		for (uint16_t batch = 1; (batch < m_route->options.accept_batch_size) && accept_pending(); ++batch) {
+			start_session();
+		}
+
 		async_listen();
+	} else if (m_is_stopped) {
+		m_log.debug("Listener at %s:%u has been stopped.", get_listen_host().c_str(), get_listen_port());
+		m_is_dead = true;
 	} else {
 		m_log.error("Listener at %s:%u which redirects to %s:%u could not accept connection. No more connections will be accepted by this listener. Error: %s",
 			         get_listen_host().c_str(), get_listen_port(), get_remote_host().c_str(), get_remote_port(), error.message().c_str());
@@ -82,15 +318,41 @@ void ProxyListener::remove_dead_sessions()
 {
 	std::lock_guard<std::mutex> lock(m_sessions_access);
 
-	for (auto it = m_sessions.begin(); it != m_sessions.end(); ++it) {
+	for (auto it = m_sessions.begin(); it != m_sessions.end(); ) {
 #if 0		
 		m_log.debug("\tremove_dead_sessions(), processing %s:%u. use_count(): %u",
 			(*it)->get_client_host().c_str(), (*it)->get_client_port(), (*it).use_count());
 #endif
 
-		if ((*it)->has_started() && !(*it)->get_client_socket()->is_open() && !(*it)->get_remote_socket()->is_open() && (*it).unique()) {
+		if ((*it)->has_started() && !(*it)->get_client_socket().is_open() && !(*it)->get_remote_socket().is_open() && (*it).unique()) {
 			m_log.warning("Removing dead session %s:%u.", (*it)->get_client_host().c_str(), (*it)->get_client_port());
 			it = m_sessions.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+size_t ProxyListener::get_num_of_active_sessions()
+{
+	std::lock_guard<std::mutex> lock(m_sessions_access);
+
+	return std::count_if(m_sessions.begin(), m_sessions.end(), [](const std::shared_ptr<Proxy>& session) {
+		return session->has_started() && (session->get_client_socket().is_open() || session->get_remote_socket().is_open());
+	});
+}
+
+void ProxyListener::close_sessions()
+{
+	std::vector< std::shared_ptr<Proxy> > sessions;
+	{
+		std::lock_guard<std::mutex> lock(m_sessions_access);
+		sessions = m_sessions;
+	}
+
+	for (auto& session : sessions) {
+		if (session->has_started()) {
+			session->close();
 		}
 	}
 }
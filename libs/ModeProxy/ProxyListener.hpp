@@ -35,6 +35,8 @@
 #include <vector>
 #include <cstdint>
 
+#include <ModeProxy/Config.hpp>
+
 namespace boost
 {
     namespace system
@@ -46,9 +48,9 @@ namespace boost
     {
         class io_service;
 
-        namespace ip
+        namespace generic
         {
-            class tcp;
+            class stream_protocol;
         }
 
         template <typename Protocol>
@@ -56,6 +58,12 @@ namespace boost
 
 		template <typename Protocol, typename SocketAcceptorService >
 		class basic_socket_acceptor;
+
+        template <typename Protocol>
+        class stream_socket_service;
+
+        template <typename Protocol, typename StreamSocketService >
+        class basic_stream_socket;
     }
 }
 
@@ -64,26 +72,79 @@ namespace mct
 
 class Proxy;
 class Logger;
+struct ListenerOptions;
+struct ProxyRoute;
 
-class ProxyListener : public std::enable_shared_from_this<ProxyListener>
+class MCT_MODEPROXY_DLL_PUBLIC ProxyListener : public std::enable_shared_from_this<ProxyListener>
 {
 public:
-	ProxyListener(boost::asio::io_service& ios, Logger& logger, const std::string& listen_host, uint16_t listen_port, const std::string& remote_host, uint16_t remote_port);
+	/**
+	 * listen_host and remote_host are IP addresses or Unix domain socket names (see StreamEndpoint), the ports of the latter are ignored.
+	 * inherited_handle is an already bound and listening socket (e.g. received from the previous instance),
+	 * if it is negative a new socket is bound to listen_host:listen_port.
+	 */
+	ProxyListener(boost::asio::io_service& ios, Logger& logger, const std::string& listen_host, uint16_t listen_port, const std::string& remote_host, uint16_t remote_port,
+		const ListenerOptions& options, int inherited_handle = -1);
+
+	/**
+	 * Listens on listen_port of a route shared with other listeners (e.g. all the listeners of a port range).
+	 */
+	ProxyListener(boost::asio::io_service& ios, Logger& logger, const std::shared_ptr<const ProxyRoute>& route, uint16_t listen_port, int inherited_handle = -1);
 	~ProxyListener();
 
 	void async_listen();
 
+	/**
+	 * Closes the acceptor. Established sessions are not touched - they drain on their own.
+	 */
+	void stop();
+
+	/**
+	 * Sessions accepted from now on are redirected to the new remote endpoint with the new options,
+	 * established sessions keep the ones they were started with.
+	 */
+	void set_route(const std::string& remote_host, uint16_t remote_port, const ListenerOptions& options);
+	void set_route(const std::shared_ptr<const ProxyRoute>& route);
+
 	const std::string& get_listen_host() const { return m_listen_host; }
 	const uint16_t get_listen_port() const { return m_listen_port; }
-	const std::string& get_remote_host() const { return m_remote_host; }
-	const uint16_t get_remote_port() const { return m_remote_port; }
+	const std::string& get_remote_host() const;
+	const uint16_t get_remote_port() const;
+	const ListenerOptions& get_options() const;
+	int get_native_handle() const;
 
 	bool is_dead() const { return m_is_dead; }
+	bool is_stopped() const { return m_is_stopped; }
 
 	void remove_dead_sessions();
 
+	/**
+	 * Number of accepted sessions which still have an open client or remote socket.
+	 */
+	size_t get_num_of_active_sessions();
+	uint64_t get_num_of_accepted_sessions() const { return m_num_of_accepted_sessions; }
+
+	/**
+	 * Closes every accepted session which is still running (e.g. when the drain timeout passes).
+	 */
+	void close_sessions();
+
 protected:
-	std::shared_ptr<Proxy> create_session();
+	/**
+	 * Starts a session for the connection held by m_accepted_socket, which is then replaced with a fresh socket.
+	 */
+	void start_session();
+
+	/**
+	 * Picks the backend of the route for the connection held by m_accepted_socket - clients known to the affinity table
+	 * go to their pinned backend, the others take turns.
+	 */
+	uint16_t select_backend();
+
+	/**
+	 * Accepts a connection waiting in the accept queue into m_accepted_socket without blocking, returns false if there is none.
+	 */
+	bool accept_pending();
 	void handle_accept(const boost::system::error_code& error);
 
 protected:
@@ -92,16 +153,24 @@ protected:
 
 	const std::string m_listen_host;
 	const uint16_t m_listen_port;
-	const std::string m_remote_host;
-	const uint16_t m_remote_port;
+	// shared with the sessions started since the last route change
+	std::shared_ptr<const ProxyRoute> m_route;
+	// see ProxyRoute::get_port_offset
+	uint16_t m_port_offset;
 
 	bool m_is_dead;
+	bool m_is_stopped;
+	uint64_t m_num_of_accepted_sessions;
 
-	std::unique_ptr< boost::asio::basic_socket_acceptor<boost::asio::ip::tcp, boost::asio::socket_acceptor_service<boost::asio::ip::tcp> > > m_acceptor;
+	std::unique_ptr< boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol, boost::asio::socket_acceptor_service<boost::asio::generic::stream_protocol> > > m_acceptor;
+	// protocol of the opened or inherited acceptor, taken once instead of asking the socket for every accepted connection
+	int m_acceptor_family;
+	int m_acceptor_protocol;
+	// sessions are created only after a connection is accepted into this socket
+	std::unique_ptr< boost::asio::basic_stream_socket<boost::asio::generic::stream_protocol> > m_accepted_socket;
 
 	std::mutex m_sessions_access;
 	std::vector< std::shared_ptr< Proxy > > m_sessions;
-	std::shared_ptr<Proxy> m_next_session;
 };
 
 }
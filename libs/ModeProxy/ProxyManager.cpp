@@ -28,6 +28,7 @@
  */
 
 #include <chrono>
+#include <algorithm>
 
 #include <Logger/Logger.hpp>
 #include <ModeProxy/ProxyManager.hpp>
@@ -43,7 +44,11 @@ ProxyManager::ProxyManager(Logger& logger)
 
 ProxyManager::~ProxyManager()
 {
-	m_cleanup_listeners_run = false;
+	{
+		std::lock_guard<std::mutex> lock(m_listeners_access);
+		m_cleanup_listeners_run = false;
+	}
+	m_cleanup_listeners_wakeup.notify_all();
 
 	if (m_cleanup_listeners) {
 		m_cleanup_listeners->join();
@@ -59,23 +64,110 @@ void ProxyManager::add_listener(std::shared_ptr<ProxyListener> listener)
 	listener->async_listen();
 }
 
+void ProxyManager::remove_listener(std::shared_ptr<ProxyListener> listener)
+{
+	m_log.info("Unregistering listener at %s:%u, its sessions are going to be drained.", listener->get_listen_host().c_str(), listener->get_listen_port());
+
+	std::lock_guard<std::mutex> lock(m_listeners_access);
+	m_listeners.erase(std::remove(m_listeners.begin(), m_listeners.end(), listener), m_listeners.end());
+	m_draining_listeners.push_back(listener);
+	listener->stop();
+}
+
+std::vector< std::shared_ptr<ProxyListener> > ProxyManager::get_listeners()
+{
+	std::lock_guard<std::mutex> lock(m_listeners_access);
+	return m_listeners;
+}
+
+void ProxyManager::stop_listeners()
+{
+	std::lock_guard<std::mutex> lock(m_listeners_access);
+
+	for (auto& listener : m_listeners) {
+		if (!listener->is_stopped()) {
+			listener->stop();
+		}
+	}
+}
+
+size_t ProxyManager::get_num_of_active_sessions()
+{
+	std::lock_guard<std::mutex> lock(m_listeners_access);
+	size_t num_of_active_sessions = 0;
+
+	for (auto& listener : m_listeners) {
+		num_of_active_sessions += listener->get_num_of_active_sessions();
+	}
+
+	for (auto& listener : m_draining_listeners) {
+		num_of_active_sessions += listener->get_num_of_active_sessions();
+	}
+
+	return num_of_active_sessions;
+}
+
+void ProxyManager::close_sessions()
+{
+	std::lock_guard<std::mutex> lock(m_listeners_access);
+
+	for (auto& listener : m_listeners) {
+		listener->close_sessions();
+	}
+
+	for (auto& listener : m_draining_listeners) {
+		listener->close_sessions();
+	}
+}
+
+void ProxyManager::log_statistics()
+{
+	std::lock_guard<std::mutex> lock(m_listeners_access);
+
+	for (auto& listener : m_listeners) {
+		m_log.info("Listener %s:%u accepted %llu sessions, %u of them are still active.", listener->get_listen_host().c_str(), listener->get_listen_port(),
+			static_cast<unsigned long long>(listener->get_num_of_accepted_sessions()), static_cast<unsigned>(listener->get_num_of_active_sessions()));
+	}
+
+	for (auto& listener : m_draining_listeners) {
+		m_log.info("Removed listener %s:%u accepted %llu sessions, %u of them are still active.", listener->get_listen_host().c_str(), listener->get_listen_port(),
+			static_cast<unsigned long long>(listener->get_num_of_accepted_sessions()), static_cast<unsigned>(listener->get_num_of_active_sessions()));
+	}
+}
+
 void ProxyManager::cleanup_listeners()
 {
 	std::chrono::seconds sleep_duration(10);
 
+	std::unique_lock<std::mutex> lock(m_listeners_access);
+
 	while (m_cleanup_listeners_run) {
-		std::this_thread::sleep_for(sleep_duration);
-		std::lock_guard<std::mutex> lock(m_listeners_access);
+		if (m_cleanup_listeners_wakeup.wait_for(lock, sleep_duration, [this]() { return !m_cleanup_listeners_run; })) {
+			break;
+		}
 
-		for (auto it = m_listeners.begin(); it != m_listeners.end(); ++it) {
+		for (auto it = m_listeners.begin(); it != m_listeners.end(); ) {
 #if 0
 			m_log.debug("cleanup_listeners(), processing %s:%u. use_count(): %u", (*it)->get_listen_host().c_str(), (*it)->get_listen_port(), (*it).use_count());
 #endif
 			(*it)->remove_dead_sessions();
 
-			if ((*it)->is_dead() && (*it).unique()) {
+			if ((*it)->is_dead() && (*it).unique() && (*it)->get_num_of_active_sessions() == 0) {
 				m_log.info("Removing dead listener %s:%u.", (*it)->get_listen_host().c_str(), (*it)->get_listen_port());
 				it = m_listeners.erase(it);
+			} else {
+				++it;
+			}
+		}
+
+		for (auto it = m_draining_listeners.begin(); it != m_draining_listeners.end(); ) {
+			(*it)->remove_dead_sessions();
+
+			if ((*it)->get_num_of_active_sessions() == 0) {
+				m_log.info("Listener %s:%u has been drained.", (*it)->get_listen_host().c_str(), (*it)->get_listen_port());
+				it = m_draining_listeners.erase(it);
+			} else {
+				++it;
 			}
 		}
 	}
@@ -34,6 +34,9 @@
 #include <memory>
 #include <vector>
 #include <thread>
+#include <condition_variable>
+
+#include <ModeProxy/Config.hpp>
 
 namespace mct
 {
@@ -49,6 +52,30 @@ public:
 
 	void add_listener(std::shared_ptr<ProxyListener> listener);
 
+	/**
+	 * Stops the listener and forgets about it; its established sessions keep running until they close.
+	 */
+	void remove_listener(std::shared_ptr<ProxyListener> listener);
+
+	std::vector< std::shared_ptr<ProxyListener> > get_listeners();
+
+	/**
+	 * Stops accepting on every listener, established sessions keep running.
+	 */
+	void stop_listeners();
+
+	/**
+	 * Number of sessions which are still running, including sessions of removed listeners.
+	 */
+	size_t get_num_of_active_sessions();
+
+	/**
+	 * Closes all sessions which are still running, including sessions of removed listeners.
+	 */
+	void close_sessions();
+
+	void log_statistics();
+
 protected:
 	void cleanup_listeners();
 
@@ -57,7 +84,10 @@ protected:
 
 	std::mutex m_listeners_access;
 	std::vector< std::shared_ptr<ProxyListener> > m_listeners;
+	// removed listeners are kept until their sessions are drained
+	std::vector< std::shared_ptr<ProxyListener> > m_draining_listeners;
 
+	std::condition_variable m_cleanup_listeners_wakeup;
 	volatile bool m_cleanup_listeners_run;
 	std::unique_ptr< std::thread > m_cleanup_listeners;
 };
@@ -0,0 +1,303 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/ProxyProtocol.cpp
+ *
+ * @desc ProxyProtocol writes and parses PROXY protocol (v1 and v2) headers, which tell a backend who the client is.
+ */
+
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+#include <ModeProxy/ProxyProtocol.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+const unsigned char v2_signature[] = { 0x0d, 0x0a, 0x0d, 0x0a, 0x00, 0x0d, 0x0a, 0x51, 0x55, 0x49, 0x54, 0x0a };
+const size_t v2_header_length = sizeof(v2_signature) + 4;
+
+const unsigned char v2_command_local = 0x20;
+const unsigned char v2_command_proxy = 0x21;
+const unsigned char v2_family_tcp4 = 0x11;
+const unsigned char v2_family_tcp6 = 0x21;
+
+const char v1_prefix[] = "PROXY ";
+const size_t v1_prefix_length = sizeof(v1_prefix) - 1;
+const char v1_unknown[] = "PROXY UNKNOWN\r\n";
+const size_t v1_unknown_length = sizeof(v1_unknown) - 1;
+// the longest line allowed by the specification, including CRLF
+const size_t v1_max_length = 107;
+
+boost::asio::ip::address_v6 to_v6(const boost::asio::ip::address& address)
+{
+	return address.is_v6() ? address.to_v6() : boost::asio::ip::address_v6::v4_mapped(address.to_v4());
+}
+
+/**
+ * Compares the part of data which has been received so far.
+ */
+bool starts_with(const unsigned char* data, size_t length, const unsigned char* prefix, size_t prefix_length)
+{
+	return std::memcmp(data, prefix, (length < prefix_length) ? length : prefix_length) == 0;
+}
+
+/**
+ * Parses one space-terminated field of a v1 line (the last one is terminated by the end of the line).
+ */
+bool next_field(const char*& field, const char* end, char* value, size_t value_size)
+{
+	const char* field_end = static_cast<const char*>(std::memchr(field, ' ', end - field));
+	if (!field_end) {
+		field_end = end;
+	}
+
+	const size_t length = field_end - field;
+	if (length == 0 || length >= value_size) {
+		return false;
+	}
+
+	std::memcpy(value, field, length);
+	value[length] = '\0';
+	field = (field_end == end) ? end : field_end + 1;
+	return true;
+}
+
+bool parse_port(const char* text, unsigned short& port)
+{
+	char* end = nullptr;
+	const unsigned long value = std::strtoul(text, &end, 10);
+	if (*text < '0' || *text > '9' || *end != '\0' || value > 65535) {
+		return false;
+	}
+
+	port = static_cast<unsigned short>(value);
+	return true;
+}
+
+}
+
+size_t ProxyProtocol::write_header(ListenerOptions::proxy_protocol_type version, const boost::asio::ip::tcp::endpoint& source,
+	const boost::asio::ip::tcp::endpoint& destination, unsigned char* buffer)
+{
+	const bool is_v6 = source.address().is_v6() || destination.address().is_v6();
+
+	if (version == ListenerOptions::proxy_protocol_v1) {
+		const std::string source_address = is_v6 ? to_v6(source.address()).to_string() : source.address().to_string();
+		const std::string destination_address = is_v6 ? to_v6(destination.address()).to_string() : destination.address().to_string();
+
+		const int length = std::snprintf(reinterpret_cast<char*>(buffer), max_header_length, "PROXY %s %s %s %u %u\r\n", is_v6 ? "TCP6" : "TCP4",
+			source_address.c_str(), destination_address.c_str(), source.port(), destination.port());
+		return (length > 0) ? static_cast<size_t>(length) : 0;
+	}
+
+	std::memcpy(buffer, v2_signature, sizeof(v2_signature));
+	buffer[12] = v2_command_proxy;
+	buffer[13] = is_v6 ? v2_family_tcp6 : v2_family_tcp4;
+
+	size_t length = v2_header_length;
+	if (is_v6) {
+		const boost::asio::ip::address_v6::bytes_type source_bytes = to_v6(source.address()).to_bytes();
+		const boost::asio::ip::address_v6::bytes_type destination_bytes = to_v6(destination.address()).to_bytes();
+		std::memcpy(buffer + length, source_bytes.data(), source_bytes.size());
+		std::memcpy(buffer + length + source_bytes.size(), destination_bytes.data(), destination_bytes.size());
+		length += source_bytes.size() + destination_bytes.size();
+	} else {
+		const boost::asio::ip::address_v4::bytes_type source_bytes = source.address().to_v4().to_bytes();
+		const boost::asio::ip::address_v4::bytes_type destination_bytes = destination.address().to_v4().to_bytes();
+		std::memcpy(buffer + length, source_bytes.data(), source_bytes.size());
+		std::memcpy(buffer + length + source_bytes.size(), destination_bytes.data(), destination_bytes.size());
+		length += source_bytes.size() + destination_bytes.size();
+	}
+
+	buffer[length++] = static_cast<unsigned char>(source.port() >> 8);
+	buffer[length++] = static_cast<unsigned char>(source.port() & 0xff);
+	buffer[length++] = static_cast<unsigned char>(destination.port() >> 8);
+	buffer[length++] = static_cast<unsigned char>(destination.port() & 0xff);
+
+	// length of the addresses, behind the fixed part
+	buffer[14] = static_cast<unsigned char>((length - v2_header_length) >> 8);
+	buffer[15] = static_cast<unsigned char>((length - v2_header_length) & 0xff);
+
+	return length;
+}
+
+size_t ProxyProtocol::write_local_header(ListenerOptions::proxy_protocol_type version, unsigned char* buffer)
+{
+	if (version == ListenerOptions::proxy_protocol_v1) {
+		std::memcpy(buffer, v1_unknown, v1_unknown_length);
+		return v1_unknown_length;
+	}
+
+	std::memcpy(buffer, v2_signature, sizeof(v2_signature));
+	buffer[12] = v2_command_local;
+	buffer[13] = 0;
+	buffer[14] = 0;
+	buffer[15] = 0;
+
+	return v2_header_length;
+}
+
+ProxyProtocol::Result ProxyProtocol::parse_header(ListenerOptions::proxy_protocol_type accepted_version, const unsigned char* data, size_t length,
+	size_t max_length, ProxyHeader& header)
+{
+	if (length == 0) {
+		return incomplete;
+	}
+
+	// both versions can be told apart by the first byte
+	if (data[0] == v1_prefix[0] && (accepted_version == ListenerOptions::proxy_protocol_v1 || accepted_version == ListenerOptions::proxy_protocol_any)) {
+		return parse_v1(data, length, max_length, header);
+	}
+
+	if (data[0] == v2_signature[0] && (accepted_version == ListenerOptions::proxy_protocol_v2 || accepted_version == ListenerOptions::proxy_protocol_any)) {
+		return parse_v2(data, length, max_length, header);
+	}
+
+	return invalid;
+}
+
+ProxyProtocol::Result ProxyProtocol::parse_v1(const unsigned char* data, size_t length, size_t max_length, ProxyHeader& header)
+{
+	if (!starts_with(data, length, reinterpret_cast<const unsigned char*>(v1_prefix), v1_prefix_length)) {
+		return invalid;
+	}
+
+	const size_t limit = (max_length < v1_max_length) ? max_length : v1_max_length;
+	const unsigned char* line_end = static_cast<const unsigned char*>(std::memchr(data, '\n', (length < limit) ? length : limit));
+	if (!line_end) {
+		return (length < limit) ? incomplete : invalid;
+	}
+
+	if (line_end == data || line_end[-1] != '\r') {
+		return invalid;
+	}
+
+	const char* field = reinterpret_cast<const char*>(data) + v1_prefix_length;
+	const char* end = reinterpret_cast<const char*>(line_end) - 1;
+
+	char protocol[8];
+	if (!next_field(field, end, protocol, sizeof(protocol))) {
+		return invalid;
+	}
+
+	header.length = line_end + 1 - data;
+
+	// the rest of an UNKNOWN line is ignored
+	if (std::strcmp(protocol, "UNKNOWN") == 0) {
+		header.has_addresses = false;
+		return complete;
+	}
+
+	if (std::strcmp(protocol, "TCP4") != 0 && std::strcmp(protocol, "TCP6") != 0) {
+		return invalid;
+	}
+
+	char source[48], destination[48], source_port[8], destination_port[8];
+	if (!next_field(field, end, source, sizeof(source)) || !next_field(field, end, destination, sizeof(destination)) ||
+		!next_field(field, end, source_port, sizeof(source_port)) || !next_field(field, end, destination_port, sizeof(destination_port)) || field != end) {
+		return invalid;
+	}
+
+	boost::system::error_code source_error, destination_error;
+	const boost::asio::ip::address source_address = boost::asio::ip::address::from_string(source, source_error);
+	const boost::asio::ip::address destination_address = boost::asio::ip::address::from_string(destination, destination_error);
+	unsigned short source_port_num, destination_port_num;
+
+	if (source_error || destination_error || source_address.is_v6() != (protocol[3] == '6') || destination_address.is_v6() != (protocol[3] == '6') ||
+		!parse_port(source_port, source_port_num) || !parse_port(destination_port, destination_port_num)) {
+		return invalid;
+	}
+
+	header.has_addresses = true;
+	header.source = boost::asio::ip::tcp::endpoint(source_address, source_port_num);
+	header.destination = boost::asio::ip::tcp::endpoint(destination_address, destination_port_num);
+	return complete;
+}
+
+ProxyProtocol::Result ProxyProtocol::parse_v2(const unsigned char* data, size_t length, size_t max_length, ProxyHeader& header)
+{
+	if (!starts_with(data, length, v2_signature, sizeof(v2_signature))) {
+		return invalid;
+	}
+
+	if (length < v2_header_length) {
+		return incomplete;
+	}
+
+	const unsigned char command = data[12];
+	const unsigned char family = data[13];
+	const size_t addresses_length = (static_cast<size_t>(data[14]) << 8) | data[15];
+
+	if ((command != v2_command_local && command != v2_command_proxy) || v2_header_length + addresses_length > max_length) {
+		return invalid;
+	}
+
+	if (length < v2_header_length + addresses_length) {
+		return incomplete;
+	}
+
+	header.length = v2_header_length + addresses_length;
+	header.has_addresses = false;
+
+	// the addresses of LOCAL connections and of other families (UDP, unix sockets) are ignored
+	if (command == v2_command_local) {
+		return complete;
+	}
+
+	const unsigned char* addresses = data + v2_header_length;
+
+	if (family == v2_family_tcp4) {
+		if (addresses_length < 12) {
+			return invalid;
+		}
+
+		boost::asio::ip::address_v4::bytes_type source, destination;
+		std::memcpy(source.data(), addresses, 4);
+		std::memcpy(destination.data(), addresses + 4, 4);
+		header.source = boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4(source), (addresses[8] << 8) | addresses[9]);
+		header.destination = boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4(destination), (addresses[10] << 8) | addresses[11]);
+		header.has_addresses = true;
+	} else if (family == v2_family_tcp6) {
+		if (addresses_length < 36) {
+			return invalid;
+		}
+
+		boost::asio::ip::address_v6::bytes_type source, destination;
+		std::memcpy(source.data(), addresses, 16);
+		std::memcpy(destination.data(), addresses + 16, 16);
+		header.source = boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v6(source), (addresses[32] << 8) | addresses[33]);
+		header.destination = boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v6(destination), (addresses[34] << 8) | addresses[35]);
+		header.has_addresses = true;
+	}
+
+	return complete;
+}
+
+}
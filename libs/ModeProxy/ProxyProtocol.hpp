@@ -0,0 +1,95 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/ProxyProtocol.hpp
+ *
+ * @desc ProxyProtocol writes and parses PROXY protocol (v1 and v2) headers, which tell a backend who the client is.
+ */
+
+#ifndef MCT_MODEPROXY_PROXYPROTOCOL_HPP
+#define MCT_MODEPROXY_PROXYPROTOCOL_HPP
+
+#include <cstddef>
+
+#include <boost/asio/ip/tcp.hpp>
+
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeProxy/Config.hpp>
+
+namespace mct
+{
+
+struct ProxyHeader
+{
+    ProxyHeader() : length(0), has_addresses(false) {}
+
+    // number of bytes of the header, the data of the client follows it
+    size_t length;
+
+    // false for LOCAL (v2) and UNKNOWN (v1) connections, e.g. health checks of the load balancer
+    bool has_addresses;
+    boost::asio::ip::tcp::endpoint source;
+    boost::asio::ip::tcp::endpoint destination;
+};
+
+class MCT_MODEPROXY_DLL_PUBLIC ProxyProtocol
+{
+public:
+    enum Result
+    {
+        incomplete,
+        complete,
+        invalid
+    };
+
+    // longest header written by write_header (a v1 line with two IPv6 addresses)
+    enum { max_header_length = 108 };
+
+    /**
+     * Writes the header for a TCP connection from source to destination, returns its length. If only one of
+     * the addresses is IPv6, the other one is written as an IPv4-mapped IPv6 address.
+     */
+    static size_t write_header(ListenerOptions::proxy_protocol_type version, const boost::asio::ip::tcp::endpoint& source,
+        const boost::asio::ip::tcp::endpoint& destination, unsigned char* buffer);
+
+    /**
+     * Writes the header for a connection without addresses to pass on (UNKNOWN in v1, LOCAL in v2), returns its length.
+     */
+    static size_t write_local_header(ListenerOptions::proxy_protocol_type version, unsigned char* buffer);
+
+    /**
+     * Parses the header at the beginning of data[0, length) in one of the accepted versions. Headers longer
+     * than max_length are invalid. Nothing is allocated, TLVs of v2 are skipped.
+     */
+    static Result parse_header(ListenerOptions::proxy_protocol_type accepted_version, const unsigned char* data, size_t length,
+        size_t max_length, ProxyHeader& header);
+
+protected:
+    static Result parse_v1(const unsigned char* data, size_t length, size_t max_length, ProxyHeader& header);
+    static Result parse_v2(const unsigned char* data, size_t length, size_t max_length, ProxyHeader& header);
+};
+
+}
+
+#endif // MCT_MODEPROXY_PROXYPROTOCOL_HPP
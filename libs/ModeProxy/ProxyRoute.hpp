@@ -0,0 +1,99 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/ProxyRoute.hpp
+ *
+ * @desc ProxyRoute describes where the sessions of one listener are redirected to.
+ */
+
+#ifndef MCT_MODEPROXY_PROXYROUTE_HPP
+#define MCT_MODEPROXY_PROXYROUTE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeProxy/StreamEndpoint.hpp>
+
+namespace mct
+{
+
+struct ProxyBackend
+{
+    ProxyBackend(const std::string& host, uint16_t port) : host(host), port(port), endpoint(StreamEndpoint::make(host, port))
+    {
+    }
+
+    std::string host;
+    uint16_t port;
+    // parsed once, instead of for every session; an IP or Unix domain endpoint
+    StreamEndpoint::endpoint_type endpoint;
+};
+
+/**
+ * A route is immutable and shared by all the sessions started with it - a listener creates a new one
+ * when its route changes, sessions which are already running keep the previous one alive. All listeners
+ * of a port range share one route, listen_port is the first port of the range then.
+ */
+struct ProxyRoute
+{
+    ProxyRoute(const std::string& listen_host, uint16_t listen_port, const std::string& remote_host, uint16_t remote_port, const ListenerOptions& options,
+        bool is_port_mapped = false)
+    : listen_host(listen_host), listen_port(listen_port), remote_host(remote_host), remote_port(remote_port),
+      backends(make_backends(remote_host, remote_port, options)), options(options), is_port_mapped(is_port_mapped)
+    {
+    }
+
+    /**
+     * Ports of the backends are shifted by this much for the sessions of the listener at listen_port.
+     */
+    uint16_t get_port_offset(uint16_t listen_port) const
+    {
+        return is_port_mapped ? static_cast<uint16_t>(listen_port - this->listen_port) : 0;
+    }
+
+    static std::vector<ProxyBackend> make_backends(const std::string& remote_host, uint16_t remote_port, const ListenerOptions& options)
+    {
+        std::vector<ProxyBackend> backends(1, ProxyBackend(remote_host, remote_port));
+        for (auto&& backend : options.extra_backends) {
+            backends.push_back(ProxyBackend(backend.first, backend.second));
+        }
+        return backends;
+    }
+
+    const std::string listen_host;
+    const uint16_t listen_port;
+    const std::string remote_host;
+    const uint16_t remote_port;
+    // the remote endpoint comes first, followed by ListenerOptions::extra_backends
+    const std::vector<ProxyBackend> backends;
+    const ListenerOptions options;
+    // every listener of the port range is forwarded to its own port (shifted by get_port_offset), instead of all to remote_port
+    const bool is_port_mapped;
+};
+
+}
+
+#endif // MCT_MODEPROXY_PROXYROUTE_HPP
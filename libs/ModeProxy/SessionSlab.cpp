@@ -0,0 +1,419 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/SessionSlab.cpp
+ *
+ * @desc SessionSlab hands out fixed-size slots for session objects from per-thread chunks of memory.
+ */
+
+#include <ModeProxy/SessionSlab.hpp>
+
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(WIN32)
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace mct
+{
+
+namespace
+{
+
+const size_t slot_alignment = alignof(std::max_align_t);
+
+// guards the links between slabs and the io_services they are registered with, taken before SessionSlab::m_remote_access
+std::mutex registration_access;
+
+size_t align_up(size_t size)
+{
+    return (size + slot_alignment - 1) / slot_alignment * slot_alignment;
+}
+
+unsigned char* map_chunk(size_t size)
+{
+#if defined(WIN32)
+    void* memory = std::malloc(size);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+#else
+    void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+#endif
+
+    return static_cast<unsigned char*>(memory);
+}
+
+void unmap_chunk(unsigned char* memory, size_t size)
+{
+#if defined(WIN32)
+    (void)size;
+    std::free(memory);
+#else
+    ::munmap(memory, size);
+#endif
+}
+
+}
+
+/**
+ * Slabs of the current thread, orphaned when the thread exits.
+ */
+class SessionSlab::ThreadSlabs
+{
+public:
+    ~ThreadSlabs()
+    {
+        for (auto slab : m_slabs) {
+            slab->orphan();
+        }
+    }
+
+    SessionSlab& get(size_t slot_size)
+    {
+        for (auto slab : m_slabs) {
+            if (slab->get_slot_size() == slot_size) {
+                return *slab;
+            }
+        }
+
+        m_slabs.push_back(new SessionSlab(slot_size));
+        return *m_slabs.back();
+    }
+
+private:
+    std::vector<SessionSlab*> m_slabs;
+};
+
+/**
+ * Slabs which reclaim through an io_service, they forget it when the io_service is destroyed.
+ */
+class SessionSlab::ReclaimRegistration : public boost::asio::io_service::service
+{
+public:
+    static boost::asio::io_service::id id;
+
+    explicit ReclaimRegistration(boost::asio::io_service& ios) : boost::asio::io_service::service(ios) {}
+
+    // both are called with registration_access held
+    void add(SessionSlab* slab) { m_slabs.push_back(slab); }
+    void remove(SessionSlab* slab) { m_slabs.erase(std::remove(m_slabs.begin(), m_slabs.end(), slab), m_slabs.end()); }
+
+private:
+    void shutdown_service()
+    {
+        std::lock_guard<std::mutex> lock(registration_access);
+        for (auto slab : m_slabs) {
+            slab->clear_reclaim_service();
+        }
+        m_slabs.clear();
+    }
+
+    std::vector<SessionSlab*> m_slabs;
+};
+
+boost::asio::io_service::id SessionSlab::ReclaimRegistration::id;
+
+/**
+ * Shared by the copies of a posted reclaim handler, the last copy finishes the reclaim whether it has run or not.
+ */
+class SessionSlab::PendingReclaim
+{
+public:
+    explicit PendingReclaim(SessionSlab* slab) : m_slab(slab) {}
+    ~PendingReclaim() { m_slab->finish_reclaim(); }
+
+    PendingReclaim(const PendingReclaim&) = delete;
+    PendingReclaim& operator=(const PendingReclaim&) = delete;
+
+    void run() { m_slab->handle_reclaim(); }
+
+private:
+    SessionSlab* m_slab;
+};
+
+SessionSlab& SessionSlab::for_this_thread(size_t slot_size)
+{
+    static thread_local ThreadSlabs slabs;
+    return slabs.get(slot_size);
+}
+
+void SessionSlab::release(void* slot)
+{
+    if (slot == nullptr) {
+        return;
+    }
+
+    SlotHeader* header = get_header(slot);
+    SessionSlab* slab = header->slab;
+
+    if (slab->m_owner == std::this_thread::get_id() && !slab->m_is_orphaned) {
+        slab->release_local(header);
+    } else {
+        slab->release_remote(header);
+    }
+}
+
+SessionSlab::SessionSlab(size_t slot_size)
+: m_slot_size(slot_size), m_slot_stride(align_up(sizeof(SlotHeader)) + align_up(slot_size)),
+  m_slots_per_chunk((std::max)(size_t(1), chunk_size / m_slot_stride)), m_owner(std::this_thread::get_id()),
+  m_num_of_empty_chunks(0), m_num_of_live_slots(0), m_has_remote_slots(false), m_remote_slots(nullptr), m_reclaim_service(nullptr), m_reclaim_registration(nullptr),
+  m_num_of_pending_reclaims(0), m_is_orphaned(false)
+{
+}
+
+SessionSlab::~SessionSlab()
+{
+    {
+        std::lock_guard<std::mutex> lock(registration_access);
+        if (m_reclaim_registration != nullptr) {
+            m_reclaim_registration->remove(this);
+        }
+    }
+
+    for (auto chunk : m_chunks) {
+        unmap_chunk(chunk->memory, m_slot_stride * m_slots_per_chunk);
+        delete chunk;
+    }
+}
+
+SessionSlab::SlotHeader* SessionSlab::get_header(void* slot)
+{
+    return reinterpret_cast<SlotHeader*>(static_cast<unsigned char*>(slot) - align_up(sizeof(SlotHeader)));
+}
+
+void* SessionSlab::allocate()
+{
+    if (m_has_remote_slots.load(std::memory_order_acquire)) {
+        reclaim_remote();
+    }
+
+    if (m_available_chunks.empty()) {
+        add_chunk();
+    }
+
+    Chunk* chunk = m_available_chunks.back();
+    if (chunk->num_of_free_slots == m_slots_per_chunk) {
+        --m_num_of_empty_chunks;
+    }
+
+    SlotHeader* slot = chunk->free_slots;
+    if (slot != nullptr) {
+        chunk->free_slots = slot->next_free;
+    } else {
+        // slots are carved only when needed, so pages of a fresh chunk are not touched in advance
+        slot = reinterpret_cast<SlotHeader*>(chunk->memory + m_slot_stride * chunk->num_of_carved_slots++);
+        slot->slab = this;
+        slot->chunk = chunk;
+    }
+
+    if (--chunk->num_of_free_slots == 0) {
+        chunk->is_available = false;
+        m_available_chunks.pop_back();
+    }
+
+    ++m_num_of_live_slots;
+    return reinterpret_cast<unsigned char*>(slot) + align_up(sizeof(SlotHeader));
+}
+
+void SessionSlab::set_reclaim_service(boost::asio::io_service& ios)
+{
+    // only the owner sets it and a destroyed io_service only clears it, so it is compared without the lock here
+    if (m_reclaim_service.load(std::memory_order_relaxed) == &ios) {
+        return;
+    }
+
+    ReclaimRegistration& registration = boost::asio::use_service<ReclaimRegistration>(ios);
+
+    std::lock_guard<std::mutex> registration_lock(registration_access);
+    if (m_reclaim_registration != nullptr) {
+        m_reclaim_registration->remove(this);
+    }
+    registration.add(this);
+
+    std::lock_guard<std::mutex> lock(m_remote_access);
+    m_reclaim_service.store(&ios, std::memory_order_relaxed);
+    m_reclaim_registration = &registration;
+}
+
+void SessionSlab::clear_reclaim_service()
+{
+    std::lock_guard<std::mutex> lock(m_remote_access);
+    m_reclaim_service.store(nullptr, std::memory_order_relaxed);
+    m_reclaim_registration = nullptr;
+}
+
+void SessionSlab::add_chunk()
+{
+    std::unique_ptr<Chunk> chunk(new Chunk());
+    chunk->memory = map_chunk(m_slot_stride * m_slots_per_chunk);
+    chunk->free_slots = nullptr;
+    chunk->num_of_free_slots = m_slots_per_chunk;
+    chunk->num_of_carved_slots = 0;
+    chunk->is_available = true;
+
+    m_chunks.push_back(chunk.get());
+    m_available_chunks.push_back(chunk.release());
+    ++m_num_of_empty_chunks;
+}
+
+void SessionSlab::release_chunk(Chunk* chunk)
+{
+    m_available_chunks.erase(std::find(m_available_chunks.begin(), m_available_chunks.end(), chunk));
+    m_chunks.erase(std::find(m_chunks.begin(), m_chunks.end(), chunk));
+    --m_num_of_empty_chunks;
+
+    unmap_chunk(chunk->memory, m_slot_stride * m_slots_per_chunk);
+    delete chunk;
+}
+
+void SessionSlab::release_local(SlotHeader* slot)
+{
+    Chunk* chunk = slot->chunk;
+
+    slot->next_free = chunk->free_slots;
+    chunk->free_slots = slot;
+    --m_num_of_live_slots;
+
+    if (!chunk->is_available) {
+        chunk->is_available = true;
+        m_available_chunks.push_back(chunk);
+    }
+
+    if (++chunk->num_of_free_slots == m_slots_per_chunk) {
+        ++m_num_of_empty_chunks;
+
+        // one empty chunk is kept for the next burst, any other one goes back to the operating system
+        if (m_num_of_empty_chunks > 1) {
+            release_chunk(chunk);
+        }
+    }
+}
+
+void SessionSlab::release_remote(SlotHeader* slot)
+{
+    bool is_unused = false;
+    {
+        std::lock_guard<std::mutex> lock(m_remote_access);
+
+        if (m_is_orphaned) {
+            // there is no owner any more, so the slot is released right here (serialized by the lock)
+            release_local(slot);
+            is_unused = (m_num_of_live_slots == 0 && m_num_of_pending_reclaims == 0);
+        } else {
+            // the first queued slot asks the owner for a reclaim, the following ones are picked up by the same one;
+            // posted under the lock, so the io_service cannot be destroyed in between
+            boost::asio::io_service* reclaim_service = m_reclaim_service.load(std::memory_order_relaxed);
+            if (m_remote_slots == nullptr && reclaim_service != nullptr && !reclaim_service->stopped()) {
+                ++m_num_of_pending_reclaims;
+                std::shared_ptr<PendingReclaim> pending = std::make_shared<PendingReclaim>(this);
+                reclaim_service->post([pending]() { pending->run(); });
+            }
+
+            slot->next_free = m_remote_slots;
+            m_remote_slots = slot;
+            m_has_remote_slots.store(true, std::memory_order_release);
+        }
+    }
+
+    if (is_unused) {
+        delete this;
+    }
+}
+
+void SessionSlab::reclaim_remote()
+{
+    SlotHeader* slots = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_remote_access);
+        slots = m_remote_slots;
+        m_remote_slots = nullptr;
+        m_has_remote_slots.store(false, std::memory_order_relaxed);
+    }
+
+    while (slots != nullptr) {
+        SlotHeader* next = slots->next_free;
+        release_local(slots);
+        slots = next;
+    }
+}
+
+void SessionSlab::handle_reclaim()
+{
+    bool is_orphaned = false;
+    {
+        std::lock_guard<std::mutex> lock(m_remote_access);
+        is_orphaned = m_is_orphaned;
+    }
+
+    // an io_service run by several threads may call this elsewhere, the slots are left for the next allocation then
+    if (!is_orphaned && m_owner == std::this_thread::get_id()) {
+        reclaim_remote();
+    }
+}
+
+void SessionSlab::finish_reclaim()
+{
+    bool is_unused = false;
+    {
+        std::lock_guard<std::mutex> lock(m_remote_access);
+        --m_num_of_pending_reclaims;
+        is_unused = (m_is_orphaned && m_num_of_live_slots == 0 && m_num_of_pending_reclaims == 0);
+    }
+
+    if (is_unused) {
+        delete this;
+    }
+}
+
+void SessionSlab::orphan()
+{
+    bool is_unused = false;
+    {
+        std::lock_guard<std::mutex> lock(m_remote_access);
+        m_is_orphaned = true;
+
+        while (m_remote_slots != nullptr) {
+            SlotHeader* next = m_remote_slots->next_free;
+            release_local(m_remote_slots);
+            m_remote_slots = next;
+        }
+
+        is_unused = (m_num_of_live_slots == 0 && m_num_of_pending_reclaims == 0);
+    }
+
+    if (is_unused) {
+        delete this;
+    }
+}
+
+}
@@ -0,0 +1,212 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/SessionSlab.hpp
+ *
+ * @desc SessionSlab hands out fixed-size slots for session objects from per-thread chunks of memory.
+ */
+
+#ifndef MCT_MODEPROXY_SESSIONSLAB_HPP
+#define MCT_MODEPROXY_SESSIONSLAB_HPP
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <new>
+
+#include <boost/asio/io_service.hpp>
+
+#include <ModeProxy/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * Every thread has its own slab per slot size, so allocating never takes a lock. Chunks are mapped straight
+ * from the operating system and carved into slots on demand; freed slots are recycled by the next allocation.
+ * A chunk whose slots are all free is returned to the operating system, unless it is the only empty one
+ * (which is kept to absorb the next burst of connections).
+ *
+ * Slots may be released by any thread - a slot released outside of its owning thread is queued and recycled
+ * by the owner on its next allocation. When the slab knows the io_service of its owner, the owner is also asked
+ * to reclaim the queued slots right away, so chunks go back to the operating system even if no session follows.
+ * The slab forgets an io_service when it is destroyed and does not ask a stopped one, the queue is left for the
+ * next allocation then. A slab outlives its thread until all of its slots are released (and all reclaims it asked
+ * for have either run or been dropped with their io_service).
+ */
+class MCT_MODEPROXY_DLL_PUBLIC SessionSlab
+{
+public:
+    static SessionSlab& for_this_thread(size_t slot_size);
+    static void release(void* slot);
+
+    SessionSlab(const SessionSlab&) = delete;
+    SessionSlab& operator=(const SessionSlab&) = delete;
+
+    void* allocate();
+
+    /**
+     * Slots released by other threads are reclaimed through this io_service, which has to be run by the owning thread.
+     * The slab is registered with the io_service, which unregisters it when it is destroyed.
+     */
+    void set_reclaim_service(boost::asio::io_service& ios);
+
+    size_t get_slot_size() const { return m_slot_size; }
+    size_t get_slots_per_chunk() const { return m_slots_per_chunk; }
+    size_t get_num_of_chunks() const { return m_chunks.size(); }
+    size_t get_num_of_live_slots() const { return m_num_of_live_slots; }
+
+    static const size_t chunk_size = 1024 * 1024;
+
+protected:
+    struct Chunk;
+
+    struct SlotHeader
+    {
+        SessionSlab* slab;
+        Chunk* chunk;
+        // only valid while the slot is free
+        SlotHeader* next_free;
+    };
+
+    struct Chunk
+    {
+        unsigned char* memory;
+        SlotHeader* free_slots;
+        size_t num_of_free_slots;
+        size_t num_of_carved_slots;
+        bool is_available;
+    };
+
+    explicit SessionSlab(size_t slot_size);
+    ~SessionSlab();
+
+    void add_chunk();
+    void release_chunk(Chunk* chunk);
+    void release_local(SlotHeader* slot);
+    void release_remote(SlotHeader* slot);
+    void reclaim_remote();
+    void handle_reclaim();
+    // called once per posted reclaim, when its handler has run or the io_service has dropped it
+    void finish_reclaim();
+    void clear_reclaim_service();
+
+    /**
+     * Called when the owning thread exits, the slab is destroyed right away if none of its slots is in use.
+     */
+    void orphan();
+
+    static SlotHeader* get_header(void* slot);
+
+protected:
+    class ThreadSlabs;
+    class ReclaimRegistration;
+    class PendingReclaim;
+
+    const size_t m_slot_size;
+    const size_t m_slot_stride;
+    const size_t m_slots_per_chunk;
+    const std::thread::id m_owner;
+
+    std::vector<Chunk*> m_chunks;
+    // chunks with at least one free (or not yet carved) slot, the most recently freed one is used first
+    std::vector<Chunk*> m_available_chunks;
+    size_t m_num_of_empty_chunks;
+    size_t m_num_of_live_slots;
+
+    std::mutex m_remote_access;
+    std::atomic<bool> m_has_remote_slots;
+    SlotHeader* m_remote_slots;
+    // written under m_remote_access, the owner compares it without the lock
+    std::atomic<boost::asio::io_service*> m_reclaim_service;
+    ReclaimRegistration* m_reclaim_registration;
+    size_t m_num_of_pending_reclaims;
+    bool m_is_orphaned;
+};
+
+/**
+ * Allocator for std::allocate_shared - the object and its control block share one slab slot.
+ * Sessions pass the io_service of the allocating thread, which reclaims the slots released elsewhere.
+ */
+template <typename T>
+class SessionAllocator
+{
+public:
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef SessionAllocator<U> other;
+    };
+
+    SessionAllocator() : m_ios(nullptr) {}
+
+    explicit SessionAllocator(boost::asio::io_service& ios) : m_ios(&ios) {}
+
+    template <typename U>
+    SessionAllocator(const SessionAllocator<U>& other) : m_ios(other.m_ios) {}
+
+    T* allocate(size_t n)
+    {
+        if (n != 1) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+
+        SessionSlab& slab = SessionSlab::for_this_thread(sizeof(T));
+        if (m_ios != nullptr) {
+            slab.set_reclaim_service(*m_ios);
+        }
+
+        return static_cast<T*>(slab.allocate());
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        if (n != 1) {
+            ::operator delete(p);
+            return;
+        }
+
+        SessionSlab::release(p);
+    }
+
+private:
+    template <typename U>
+    friend class SessionAllocator;
+
+    boost::asio::io_service* m_ios;
+};
+
+template <typename T, typename U>
+bool operator==(const SessionAllocator<T>&, const SessionAllocator<U>&) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const SessionAllocator<T>&, const SessionAllocator<U>&) { return false; }
+
+}
+
+#endif // MCT_MODEPROXY_SESSIONSLAB_HPP
@@ -0,0 +1,194 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/ShadowSink.cpp
+ *
+ * @desc ShadowSink mirrors client bytes of one session to a shadow backend, whose responses are discarded.
+ */
+
+#include <algorithm>
+#include <functional>
+
+#include <boost/asio/write.hpp>
+
+#include <Logger/Logger.hpp>
+#include <ModeProxy/ShadowSink.hpp>
+
+namespace mct
+{
+
+ShadowSink::ShadowSink(Logger& logger, boost::asio::io_service& ios, const std::string& shadow_host, uint16_t shadow_port, uint64_t buffer_size,
+    uint32_t close_timeout)
+ : m_log(logger), m_endpoint(boost::asio::ip::address::from_string(shadow_host), shadow_port), m_buffer_size(buffer_size), m_close_timeout(close_timeout),
+   m_socket(ios), m_close_timer(ios),
+   m_is_connected(false), m_is_failed(false), m_write_in_progress(false), m_close_requested(false), m_forwarded_bytes(0), m_dropped_bytes(0)
+{
+}
+
+ShadowSink::~ShadowSink()
+{
+    m_log.info("Releasing shadow connection to %s:%u. Forwarded %llu bytes, dropped %llu bytes.", m_endpoint.address().to_string().c_str(), m_endpoint.port(),
+        static_cast<unsigned long long>(m_forwarded_bytes), static_cast<unsigned long long>(m_dropped_bytes));
+}
+
+void ShadowSink::start()
+{
+    m_socket.async_connect(m_endpoint, std::bind(&ShadowSink::handle_connect, shared_from_this(), std::placeholders::_1));
+}
+
+void ShadowSink::push(const unsigned char* data, size_t length)
+{
+    if (m_is_failed || m_close_requested) {
+        m_dropped_bytes += length;
+        return;
+    }
+
+    const uint64_t queued = m_pending.size() + m_writing.size();
+    const size_t accepted = (queued >= m_buffer_size) ? 0 : static_cast<size_t>((std::min)(static_cast<uint64_t>(length), m_buffer_size - queued));
+
+    m_pending.insert(m_pending.end(), data, data + accepted);
+    m_dropped_bytes += length - accepted;
+
+    if (m_is_connected && !m_write_in_progress) {
+        flush();
+    }
+}
+
+void ShadowSink::close()
+{
+    if (m_close_requested) {
+        return;
+    }
+
+    m_close_requested = true;
+
+    // when still connecting, handle_connect() flushes the queue and shuts down afterwards
+    if (m_is_connected && !m_write_in_progress) {
+        flush();
+    }
+
+    if (m_socket.is_open()) {
+        m_close_timer.expires_from_now(boost::posix_time::milliseconds(m_close_timeout));
+        m_close_timer.async_wait(std::bind(&ShadowSink::handle_close_timeout, shared_from_this(), std::placeholders::_1));
+    }
+}
+
+void ShadowSink::flush()
+{
+    if (m_pending.empty()) {
+        if (m_close_requested) {
+            shutdown();
+        }
+        return;
+    }
+
+    m_writing.swap(m_pending);
+    m_pending.clear();
+    m_write_in_progress = true;
+
+    boost::asio::async_write(m_socket, boost::asio::buffer(m_writing),
+        std::bind(&ShadowSink::handle_write, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+}
+
+void ShadowSink::shutdown()
+{
+    m_dropped_bytes += m_pending.size();
+    m_pending.clear();
+
+    boost::system::error_code ignored;
+    m_close_timer.cancel(ignored);
+
+    if (m_socket.is_open()) {
+        m_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+        m_socket.close(ignored);
+    }
+}
+
+void ShadowSink::handle_connect(const boost::system::error_code& error)
+{
+    if (error == boost::asio::error::operation_aborted) {
+        return; // closed by the close timeout while still connecting
+    }
+
+    if (error) {
+        m_log.warning("Cannot connect to shadow endpoint %s:%u, shadow traffic of this session will be dropped. Error: %s",
+            m_endpoint.address().to_string().c_str(), m_endpoint.port(), error.message().c_str());
+        m_is_failed = true;
+        shutdown();
+        return;
+    }
+
+    m_is_connected = true;
+
+    m_socket.async_read_some(boost::asio::buffer(m_discard, m_discard_length),
+        std::bind(&ShadowSink::handle_read, shared_from_this(), std::placeholders::_1));
+
+    flush();
+}
+
+void ShadowSink::handle_write(const boost::system::error_code& error, size_t bytes_transferred)
+{
+    m_write_in_progress = false;
+    m_forwarded_bytes += bytes_transferred;
+    // a write cut short (by the close timeout or an error) drops the rest
+    m_dropped_bytes += m_writing.size() - bytes_transferred;
+    m_writing.clear();
+
+    if (error) {
+        if (error != boost::asio::error::operation_aborted) {
+            m_log.warning("Cannot write to shadow endpoint %s:%u, because: %s", m_endpoint.address().to_string().c_str(), m_endpoint.port(), error.message().c_str());
+        }
+        m_is_failed = true;
+        shutdown();
+        return;
+    }
+
+    flush();
+}
+
+void ShadowSink::handle_read(const boost::system::error_code& error)
+{
+    if (error) {
+        return; // shadow closed its side or the socket was closed; writes report their own errors
+    }
+
+    m_socket.async_read_some(boost::asio::buffer(m_discard, m_discard_length),
+        std::bind(&ShadowSink::handle_read, shared_from_this(), std::placeholders::_1));
+}
+
+void ShadowSink::handle_close_timeout(const boost::system::error_code& error)
+{
+    if (error || !m_socket.is_open()) {
+        return; // the queue has been written (or the connection failed) in time
+    }
+
+    m_log.warning("Shadow endpoint %s:%u did not take the remaining %llu bytes within %u ms after the session was closed, dropping them.",
+        m_endpoint.address().to_string().c_str(), m_endpoint.port(), static_cast<unsigned long long>(m_pending.size() + m_writing.size()), m_close_timeout);
+
+    // the write in progress (or the connect) is aborted, its handler counts what was not written
+    m_is_failed = true;
+    shutdown();
+}
+
+}
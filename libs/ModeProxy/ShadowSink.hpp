@@ -0,0 +1,114 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/ShadowSink.hpp
+ *
+ * @desc ShadowSink mirrors client bytes of one session to a shadow backend, whose responses are discarded.
+ */
+
+#ifndef MCT_MODEPROXY_SHADOWSINK_HPP
+#define MCT_MODEPROXY_SHADOWSINK_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <ModeProxy/Config.hpp>
+
+namespace mct
+{
+
+class Logger;
+
+/**
+ * Bytes are queued in a buffer bounded by buffer_size. Anything that does not fit (because the shadow backend
+ * is slow, still connecting or gone) is dropped and counted, so the shadow never backpressures the primary path.
+ * A closed sink waits at most close_timeout milliseconds for the queue to drain, so a shadow backend which stops
+ * reading cannot keep the socket and the queued bytes alive after the session.
+ */
+class MCT_MODEPROXY_DLL_PUBLIC ShadowSink : public std::enable_shared_from_this<ShadowSink>
+{
+public:
+    ShadowSink(Logger& logger, boost::asio::io_service& ios, const std::string& shadow_host, uint16_t shadow_port, uint64_t buffer_size,
+        uint32_t close_timeout = 5000);
+    ~ShadowSink();
+
+    ShadowSink(const ShadowSink&) = delete;
+    ShadowSink& operator=(const ShadowSink&) = delete;
+
+    void start();
+    void push(const unsigned char* data, size_t length);
+
+    /**
+     * Closes the shadow connection once the already queued bytes are written (after connecting, if still needed),
+     * or when close_timeout expires first; the bytes not written by then are dropped.
+     */
+    void close();
+
+    uint64_t get_forwarded_bytes() const { return m_forwarded_bytes; }
+    uint64_t get_dropped_bytes() const { return m_dropped_bytes; }
+
+protected:
+    void flush();
+    void shutdown();
+
+    void handle_connect(const boost::system::error_code& error);
+    void handle_write(const boost::system::error_code& error, size_t bytes_transferred);
+    void handle_read(const boost::system::error_code& error);
+    void handle_close_timeout(const boost::system::error_code& error);
+
+protected:
+    Logger& m_log;
+
+    const boost::asio::ip::tcp::endpoint m_endpoint;
+    const uint64_t m_buffer_size;
+    const uint32_t m_close_timeout;
+
+    boost::asio::ip::tcp::socket m_socket;
+    boost::asio::deadline_timer m_close_timer;
+
+    // bytes accepted while a write is in progress go to m_pending, m_writing is owned by the write in progress
+    std::vector<unsigned char> m_pending;
+    std::vector<unsigned char> m_writing;
+
+    enum { m_discard_length = 2048 };
+    unsigned char m_discard[m_discard_length];
+
+    bool m_is_connected;
+    bool m_is_failed;
+    bool m_write_in_progress;
+    bool m_close_requested;
+
+    uint64_t m_forwarded_bytes;
+    uint64_t m_dropped_bytes;
+};
+
+}
+
+#endif // MCT_MODEPROXY_SHADOWSINK_HPP
@@ -0,0 +1,224 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/SocketOptions.cpp
+ *
+ * @desc SocketOptions holds the kernel socket options of one listener and applies them to its sockets.
+ */
+
+#include <ModeProxy/SocketOptions.hpp>
+
+#include <cerrno>
+#include <cstring>
+
+#if defined(WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+#include <Logger/Logger.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+bool set_option(Logger& logger, int handle, int level, int name, const char* option_name, int value)
+{
+	if (value < 0) {
+		return true;
+	}
+
+#if defined(WIN32)
+	int result = ::setsockopt(handle, level, name, reinterpret_cast<const char*>(&value), sizeof(value));
+#else
+	int result = ::setsockopt(handle, level, name, &value, sizeof(value));
+#endif
+
+	if (result != 0) {
+		logger.warning("Cannot set socket option %s to %d: %s", option_name, value, std::strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+// asked once per apply_* call instead of once per option, the family of a socket does not change
+bool is_tcp_socket(int handle, int family)
+{
+	if (family >= 0) {
+		return family == AF_INET || family == AF_INET6;
+	}
+
+	sockaddr_storage address;
+#if defined(WIN32)
+	int length = sizeof(address);
+#else
+	socklen_t length = sizeof(address);
+#endif
+
+	if (::getsockname(handle, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+		return true;
+	}
+
+	return address.ss_family == AF_INET || address.ss_family == AF_INET6;
+}
+
+// TCP options of Unix domain sockets are left alone instead of being reported as failures
+bool set_tcp_option(Logger& logger, int handle, bool is_tcp, int name, const char* option_name, int value)
+{
+	if (value < 0 || !is_tcp) {
+		return true;
+	}
+
+	return set_option(logger, handle, IPPROTO_TCP, name, option_name, value);
+}
+
+bool unsupported_option(Logger& logger, const char* option_name, int value)
+{
+	if (value < 0) {
+		return true;
+	}
+
+	logger.warning("Socket option %s is not supported on this system, value %d is ignored.", option_name, value);
+	return false;
+}
+
+// sessions whose listener has no options at all do not pay for a single system call
+bool has_connection_options(const SocketOptions& options)
+{
+	return options.tcp_nodelay >= 0 || options.receive_buffer_size >= 0 || options.send_buffer_size >= 0 || options.tcp_notsent_lowat >= 0 ||
+		options.tcp_quickack >= 0 || options.keepalive >= 0 || options.keepalive_idle >= 0 || options.keepalive_interval >= 0 ||
+		options.keepalive_count >= 0 || options.busy_poll >= 0;
+}
+
+// shared by apply_to_connection and apply_before_connect, so the latter does not ask for the family twice
+bool apply_connection_options(const SocketOptions& options, Logger& logger, int handle, bool is_tcp)
+{
+	bool is_applied = true;
+
+	is_applied &= set_tcp_option(logger, handle, is_tcp, TCP_NODELAY, "TCP_NODELAY", options.tcp_nodelay);
+	is_applied &= set_option(logger, handle, SOL_SOCKET, SO_RCVBUF, "SO_RCVBUF", options.receive_buffer_size);
+	is_applied &= set_option(logger, handle, SOL_SOCKET, SO_SNDBUF, "SO_SNDBUF", options.send_buffer_size);
+	is_applied &= set_option(logger, handle, SOL_SOCKET, SO_KEEPALIVE, "SO_KEEPALIVE", options.keepalive);
+
+#if defined(TCP_NOTSENT_LOWAT)
+	is_applied &= set_tcp_option(logger, handle, is_tcp, TCP_NOTSENT_LOWAT, "TCP_NOTSENT_LOWAT", options.tcp_notsent_lowat);
+#else
+	is_applied &= unsupported_option(logger, "TCP_NOTSENT_LOWAT", options.tcp_notsent_lowat);
+#endif
+
+	// the kernel may leave the quick ack mode on its own later on, so this only affects the start of the connection
+#if defined(TCP_QUICKACK)
+	is_applied &= set_tcp_option(logger, handle, is_tcp, TCP_QUICKACK, "TCP_QUICKACK", options.tcp_quickack);
+#else
+	is_applied &= unsupported_option(logger, "TCP_QUICKACK", options.tcp_quickack);
+#endif
+
+#if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+	is_applied &= set_tcp_option(logger, handle, is_tcp, TCP_KEEPIDLE, "TCP_KEEPIDLE", options.keepalive_idle);
+	is_applied &= set_tcp_option(logger, handle, is_tcp, TCP_KEEPINTVL, "TCP_KEEPINTVL", options.keepalive_interval);
+	is_applied &= set_tcp_option(logger, handle, is_tcp, TCP_KEEPCNT, "TCP_KEEPCNT", options.keepalive_count);
+#else
+	is_applied &= unsupported_option(logger, "TCP_KEEPIDLE", options.keepalive_idle);
+	is_applied &= unsupported_option(logger, "TCP_KEEPINTVL", options.keepalive_interval);
+	is_applied &= unsupported_option(logger, "TCP_KEEPCNT", options.keepalive_count);
+#endif
+
+#if defined(SO_BUSY_POLL)
+	is_applied &= set_option(logger, handle, SOL_SOCKET, SO_BUSY_POLL, "SO_BUSY_POLL", options.busy_poll);
+#else
+	is_applied &= unsupported_option(logger, "SO_BUSY_POLL", options.busy_poll);
+#endif
+
+	return is_applied;
+}
+
+}
+
+SocketOptions::SocketOptions()
+: tcp_nodelay(-1), receive_buffer_size(-1), send_buffer_size(-1), tcp_notsent_lowat(-1), tcp_quickack(-1),
+  keepalive(-1), keepalive_idle(-1), keepalive_interval(-1), keepalive_count(-1), busy_poll(-1), tcp_fastopen_connect(-1),
+  backlog(-1), tcp_defer_accept(-1), tcp_fastopen(-1)
+{
+}
+
+bool SocketOptions::apply_to_acceptor(Logger& logger, int handle) const
+{
+	const bool is_tcp = is_tcp_socket(handle, -1);
+	bool is_applied = true;
+
+	// buffer sizes have to be known before the handshake, so they are set on the listening socket as well
+	is_applied &= set_option(logger, handle, SOL_SOCKET, SO_RCVBUF, "SO_RCVBUF", receive_buffer_size);
+	is_applied &= set_option(logger, handle, SOL_SOCKET, SO_SNDBUF, "SO_SNDBUF", send_buffer_size);
+
+#if defined(TCP_DEFER_ACCEPT)
+	is_applied &= set_tcp_option(logger, handle, is_tcp, TCP_DEFER_ACCEPT, "TCP_DEFER_ACCEPT", tcp_defer_accept);
+#else
+	is_applied &= unsupported_option(logger, "TCP_DEFER_ACCEPT", tcp_defer_accept);
+#endif
+
+#if defined(TCP_FASTOPEN)
+	is_applied &= set_tcp_option(logger, handle, is_tcp, TCP_FASTOPEN, "TCP_FASTOPEN", tcp_fastopen);
+#else
+	is_applied &= unsupported_option(logger, "TCP_FASTOPEN", tcp_fastopen);
+#endif
+
+	return is_applied;
+}
+
+bool SocketOptions::apply_to_connection(Logger& logger, int handle, int family) const
+{
+	if (!has_connection_options(*this)) {
+		return true;
+	}
+
+	return apply_connection_options(*this, logger, handle, is_tcp_socket(handle, family));
+}
+
+bool SocketOptions::apply_before_connect(Logger& logger, int handle, int family) const
+{
+	if (!has_connection_options(*this) && tcp_fastopen_connect < 0) {
+		return true;
+	}
+
+	const bool is_tcp = is_tcp_socket(handle, family);
+	bool is_applied = apply_connection_options(*this, logger, handle, is_tcp);
+
+#if defined(TCP_FASTOPEN_CONNECT)
+	is_applied &= set_tcp_option(logger, handle, is_tcp, TCP_FASTOPEN_CONNECT, "TCP_FASTOPEN_CONNECT", tcp_fastopen_connect);
+#else
+	is_applied &= unsupported_option(logger, "TCP_FASTOPEN_CONNECT", tcp_fastopen_connect);
+#endif
+
+	return is_applied;
+}
+
+}
@@ -0,0 +1,87 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/SocketOptions.hpp
+ *
+ * @desc SocketOptions holds the kernel socket options of one listener and applies them to its sockets.
+ */
+
+#ifndef MCT_MODEPROXY_SOCKETOPTIONS_HPP
+#define MCT_MODEPROXY_SOCKETOPTIONS_HPP
+
+#include <ModeProxy/Config.hpp>
+
+namespace mct
+{
+
+class Logger;
+
+/**
+ * Every option set to a negative value keeps the system default. Options which cannot be set (e.g. because
+ * the kernel does not know them) are reported as warnings and the socket is used anyway. TCP options are
+ * skipped for Unix domain sockets.
+ */
+struct MCT_MODEPROXY_DLL_PUBLIC SocketOptions
+{
+    SocketOptions();
+
+    /**
+     * Applied to the listening socket before it is bound. Accepted sockets inherit buffer sizes from it.
+     */
+    bool apply_to_acceptor(Logger& logger, int handle) const;
+
+    /**
+     * Applied to both sockets of a session - the accepted one and the one connected to the remote endpoint.
+     * The address family of the socket is asked for only when it is not given (-1) and some option is set.
+     */
+    bool apply_to_connection(Logger& logger, int handle, int family = -1) const;
+
+    /**
+     * Applied to the socket connected to the remote endpoint after it is opened, but before it connects.
+     */
+    bool apply_before_connect(Logger& logger, int handle, int family = -1) const;
+
+    // connection sockets
+    int tcp_nodelay;
+    int receive_buffer_size;
+    int send_buffer_size;
+    int tcp_notsent_lowat;
+    int tcp_quickack;
+    int keepalive;
+    int keepalive_idle;
+    int keepalive_interval;
+    int keepalive_count;
+    int busy_poll;
+    // connecting socket, sends data with SYN when the remote endpoint supports it
+    int tcp_fastopen_connect;
+
+    // listening socket
+    int backlog;
+    int tcp_defer_accept;
+    int tcp_fastopen;
+};
+
+}
+
+#endif // MCT_MODEPROXY_SOCKETOPTIONS_HPP
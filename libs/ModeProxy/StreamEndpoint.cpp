@@ -0,0 +1,103 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/StreamEndpoint.cpp
+ *
+ * @desc StreamEndpoint turns configured hosts into endpoints of TCP or Unix domain stream sockets.
+ */
+
+#include <cstring>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/system/system_error.hpp>
+
+#include <ModeProxy/StreamEndpoint.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+const char local_prefix[] = "unix:";
+const size_t local_prefix_length = sizeof(local_prefix) - 1;
+
+}
+
+bool StreamEndpoint::is_local(const std::string& host)
+{
+	return host.compare(0, local_prefix_length, local_prefix) == 0;
+}
+
+StreamEndpoint::endpoint_type StreamEndpoint::make(const std::string& host, uint16_t port)
+{
+	if (!is_local(host)) {
+		return endpoint_type(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(host), port));
+	}
+
+	std::string name = host.substr(local_prefix_length);
+	if (name.empty() || name == "@") {
+		throw boost::system::system_error(boost::asio::error::invalid_argument);
+	}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+	// names in the abstract namespace start with a NUL byte instead of '@'
+	if (name[0] == '@') {
+		name[0] = '\0';
+	}
+
+	return endpoint_type(boost::asio::local::stream_protocol::endpoint(name));
+#else
+	throw boost::system::system_error(boost::asio::error::operation_not_supported);
+#endif
+}
+
+std::string StreamEndpoint::get_path(const std::string& host)
+{
+	if (!is_local(host) || host.compare(local_prefix_length, 1, "@") == 0) {
+		return std::string();
+	}
+
+	return host.substr(local_prefix_length);
+}
+
+bool StreamEndpoint::is_ip(const endpoint_type& endpoint)
+{
+	return endpoint.protocol().family() == AF_INET || endpoint.protocol().family() == AF_INET6;
+}
+
+boost::asio::ip::tcp::endpoint StreamEndpoint::to_ip(const endpoint_type& endpoint)
+{
+	boost::asio::ip::tcp::endpoint ip_endpoint;
+
+	if (is_ip(endpoint) && endpoint.size() <= ip_endpoint.capacity()) {
+		std::memcpy(ip_endpoint.data(), endpoint.data(), endpoint.size());
+		ip_endpoint.resize(endpoint.size());
+	}
+
+	return ip_endpoint;
+}
+
+}
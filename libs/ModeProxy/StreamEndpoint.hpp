@@ -0,0 +1,75 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeProxy/StreamEndpoint.hpp
+ *
+ * @desc StreamEndpoint turns configured hosts into endpoints of TCP or Unix domain stream sockets.
+ */
+
+#ifndef MCT_MODEPROXY_STREAMENDPOINT_HPP
+#define MCT_MODEPROXY_STREAMENDPOINT_HPP
+
+#include <string>
+#include <cstdint>
+
+#include <boost/asio/generic/stream_protocol.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <ModeProxy/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * Hosts which start with "unix:" name Unix domain sockets - "unix:/run/backend.sock" is a path and
+ * "unix:@backend" a socket in the abstract namespace (Linux only). Their port is ignored.
+ */
+class MCT_MODEPROXY_DLL_PUBLIC StreamEndpoint
+{
+public:
+    typedef boost::asio::generic::stream_protocol::endpoint endpoint_type;
+
+    static bool is_local(const std::string& host);
+
+    /**
+     * Throws boost::system::system_error if host is neither an IP address nor a valid Unix domain socket name.
+     */
+    static endpoint_type make(const std::string& host, uint16_t port);
+
+    /**
+     * Path of the socket file of a Unix domain host, empty for IP hosts and for the abstract namespace.
+     */
+    static std::string get_path(const std::string& host);
+
+    static bool is_ip(const endpoint_type& endpoint);
+
+    /**
+     * IP endpoints are converted, endpoints of other families give an unspecified address and port 0.
+     */
+    static boost::asio::ip::tcp::endpoint to_ip(const endpoint_type& endpoint);
+};
+
+}
+
+#endif // MCT_MODEPROXY_STREAMENDPOINT_HPP
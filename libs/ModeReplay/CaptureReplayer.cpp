@@ -0,0 +1,267 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeReplay/CaptureReplayer.cpp
+ *
+ * @desc CaptureReplayer replays client traffic stored by CaptureRing against a backend.
+ */
+
+#include <deque>
+#include <utility>
+#include <functional>
+
+#include <boost/asio/write.hpp>
+
+#include <Logger/Logger.hpp>
+#include <ModeReplay/CaptureReplayer.hpp>
+
+namespace mct
+{
+
+class ReplaySession : public std::enable_shared_from_this<ReplaySession>
+{
+public:
+    ReplaySession(CaptureReplayer& replayer, uint64_t session_id)
+     : m_replayer(replayer), m_session_id(session_id), m_socket(replayer.m_ios),
+       m_is_connected(false), m_is_failed(false), m_write_in_progress(false), m_finish_requested(false)
+    {
+    }
+
+    void start()
+    {
+        m_socket.async_connect(m_replayer.m_remote_endpoint, std::bind(&ReplaySession::handle_connect, shared_from_this(), std::placeholders::_1));
+    }
+
+    // data points into the mapped capture file, which outlives the replay
+    void send(const unsigned char* data, uint32_t length)
+    {
+        if (m_is_failed) {
+            return;
+        }
+
+        m_queue.push_back(std::make_pair(data, length));
+
+        if (m_is_connected && !m_write_in_progress) {
+            write_next();
+        }
+    }
+
+    void finish()
+    {
+        m_finish_requested = true;
+
+        if (m_is_connected && !m_write_in_progress) {
+            write_next();
+        }
+    }
+
+protected:
+    void write_next()
+    {
+        if (m_queue.empty()) {
+            if (m_finish_requested) {
+                boost::system::error_code ignored;
+                m_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_send, ignored);
+            }
+            return;
+        }
+
+        m_write_in_progress = true;
+        boost::asio::async_write(m_socket, boost::asio::buffer(m_queue.front().first, m_queue.front().second),
+            std::bind(&ReplaySession::handle_write, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+    }
+
+    void handle_connect(const boost::system::error_code& error)
+    {
+        if (error) {
+            m_replayer.m_log.warning("[Replay session %llu] Cannot connect to %s:%u. Error: %s", static_cast<unsigned long long>(m_session_id),
+                m_replayer.m_remote_endpoint.address().to_string().c_str(), m_replayer.m_remote_endpoint.port(), error.message().c_str());
+            fail();
+            return;
+        }
+
+        m_is_connected = true;
+
+        m_socket.async_read_some(boost::asio::buffer(m_data, m_max_data_length),
+            std::bind(&ReplaySession::handle_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+
+        write_next();
+    }
+
+    void handle_write(const boost::system::error_code& error, size_t bytes_transferred)
+    {
+        m_write_in_progress = false;
+        m_replayer.m_sent_bytes += bytes_transferred;
+
+        if (error) {
+            m_replayer.m_log.warning("[Replay session %llu] Cannot write to remote endpoint, because: %s", static_cast<unsigned long long>(m_session_id), error.message().c_str());
+            fail();
+            return;
+        }
+
+        m_queue.pop_front();
+        write_next();
+    }
+
+    void handle_read(const boost::system::error_code& error, size_t bytes_transferred)
+    {
+        m_replayer.m_received_bytes += bytes_transferred;
+
+        if (error) {
+            boost::system::error_code ignored;
+            m_socket.close(ignored);
+            return;
+        }
+
+        m_socket.async_read_some(boost::asio::buffer(m_data, m_max_data_length),
+            std::bind(&ReplaySession::handle_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+    }
+
+    void fail()
+    {
+        if (!m_is_failed) {
+            ++m_replayer.m_failed_sessions;
+        }
+
+        m_is_failed = true;
+        m_queue.clear();
+
+        boost::system::error_code ignored;
+        m_socket.close(ignored);
+    }
+
+protected:
+    CaptureReplayer& m_replayer;
+    const uint64_t m_session_id;
+
+    boost::asio::ip::tcp::socket m_socket;
+    std::deque< std::pair<const unsigned char*, uint32_t> > m_queue;
+
+    bool m_is_connected;
+    bool m_is_failed;
+    bool m_write_in_progress;
+    bool m_finish_requested;
+
+    enum { m_max_data_length = 8192 }; //8KB
+    unsigned char m_data[m_max_data_length];
+};
+
+CaptureReplayer::CaptureReplayer(boost::asio::io_service& ios, Logger& logger, CaptureReader& reader, const std::string& remote_host, uint16_t remote_port, uint16_t speed)
+ : m_ios(ios), m_log(logger), m_reader(reader), m_remote_endpoint(boost::asio::ip::address::from_string(remote_host), remote_port), m_speed(speed),
+   m_timer(m_ios), m_has_next_record(false), m_first_timestamp_ns(0),
+   m_replayed_sessions(0), m_failed_sessions(0), m_sent_bytes(0), m_received_bytes(0), m_captured_response_bytes(0)
+{
+}
+
+CaptureReplayer::~CaptureReplayer()
+{
+}
+
+void CaptureReplayer::start()
+{
+    m_has_next_record = m_reader.next(m_next_record);
+    m_first_timestamp_ns = m_has_next_record ? m_next_record.timestamp_ns : 0;
+    m_started = std::chrono::steady_clock::now();
+
+    dispatch();
+}
+
+void CaptureReplayer::dispatch()
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    while (m_has_next_record) {
+        if (m_speed > 0) {
+            const uint64_t offset_ns = (m_next_record.timestamp_ns > m_first_timestamp_ns) ? m_next_record.timestamp_ns - m_first_timestamp_ns : 0;
+            const auto due = m_started + std::chrono::nanoseconds(offset_ns / m_speed);
+
+            if (due > now) {
+                m_timer.expires_from_now(boost::posix_time::microseconds(std::chrono::duration_cast<std::chrono::microseconds>(due - now).count()));
+                m_timer.async_wait(std::bind(&CaptureReplayer::handle_timer, shared_from_this(), std::placeholders::_1));
+                return;
+            }
+        }
+
+        process_record(m_next_record);
+        m_has_next_record = m_reader.next(m_next_record);
+    }
+
+    // sessions whose close was overwritten in the capture ring (or never happened) are finished here
+    for (auto& session : m_sessions) {
+        session.second->finish();
+    }
+    m_sessions.clear();
+}
+
+void CaptureReplayer::handle_timer(const boost::system::error_code& error)
+{
+    if (!error) {
+        dispatch();
+    }
+}
+
+std::shared_ptr<ReplaySession> CaptureReplayer::get_session(uint64_t session_id)
+{
+    auto it = m_sessions.find(session_id);
+    if (it != m_sessions.end()) {
+        return it->second;
+    }
+
+    // the opening record may have been overwritten by the capture ring, so sessions are also created on demand
+    auto session = std::make_shared<ReplaySession>(*this, session_id);
+    m_sessions.insert(std::make_pair(session_id, session));
+    ++m_replayed_sessions;
+    session->start();
+
+    return session;
+}
+
+void CaptureReplayer::process_record(const CaptureRecord& record)
+{
+    switch (record.direction) {
+    case capture_session_open:
+        get_session(record.session_id);
+        break;
+    case capture_client_to_remote:
+        get_session(record.session_id)->send(record.data, record.length);
+        break;
+    case capture_remote_to_client:
+        m_captured_response_bytes += record.length;
+        break;
+    case capture_session_close:
+        {
+            auto it = m_sessions.find(record.session_id);
+            if (it != m_sessions.end()) {
+                it->second->finish();
+                m_sessions.erase(it);
+            }
+        }
+        break;
+    default:
+        m_log.warning("Skipping capture record of unknown type %u.", static_cast<unsigned>(record.direction));
+        break;
+    }
+}
+
+}
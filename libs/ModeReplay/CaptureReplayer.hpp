@@ -0,0 +1,107 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeReplay/CaptureReplayer.hpp
+ *
+ * @desc CaptureReplayer replays client traffic stored by CaptureRing against a backend.
+ */
+
+#ifndef MCT_MODEREPLAY_CAPTUREREPLAYER_HPP
+#define MCT_MODEREPLAY_CAPTUREREPLAYER_HPP
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/deadline_timer.hpp>
+
+#include <ModeProxy/CaptureRing.hpp>
+#include <ModeReplay/Config.hpp>
+
+namespace mct
+{
+
+class Logger;
+class ReplaySession;
+
+/**
+ * Every captured session is replayed over its own connection: client -> remote chunks are sent in the
+ * captured order, responses are read and discarded. With speed == 1 chunks are sent at their original
+ * pace, speed == N replays N times faster and speed == 0 sends everything as fast as possible.
+ */
+class MCT_MODEREPLAY_DLL_PUBLIC CaptureReplayer : public std::enable_shared_from_this<CaptureReplayer>
+{
+    friend class ReplaySession;
+public:
+    CaptureReplayer(boost::asio::io_service& ios, Logger& logger, CaptureReader& reader, const std::string& remote_host, uint16_t remote_port, uint16_t speed);
+    ~CaptureReplayer();
+
+    CaptureReplayer(const CaptureReplayer&) = delete;
+    CaptureReplayer& operator=(const CaptureReplayer&) = delete;
+
+    void start();
+
+    uint64_t get_replayed_sessions() const { return m_replayed_sessions; }
+    uint64_t get_failed_sessions() const { return m_failed_sessions; }
+    uint64_t get_sent_bytes() const { return m_sent_bytes; }
+    uint64_t get_received_bytes() const { return m_received_bytes; }
+    uint64_t get_captured_response_bytes() const { return m_captured_response_bytes; }
+
+protected:
+    void dispatch();
+    void handle_timer(const boost::system::error_code& error);
+    void process_record(const CaptureRecord& record);
+    std::shared_ptr<ReplaySession> get_session(uint64_t session_id);
+
+protected:
+    boost::asio::io_service& m_ios;
+    Logger& m_log;
+    CaptureReader& m_reader;
+
+    const boost::asio::ip::tcp::endpoint m_remote_endpoint;
+    const uint16_t m_speed;
+
+    boost::asio::deadline_timer m_timer;
+
+    CaptureRecord m_next_record;
+    bool m_has_next_record;
+    uint64_t m_first_timestamp_ns;
+    std::chrono::steady_clock::time_point m_started;
+
+    std::unordered_map< uint64_t, std::shared_ptr<ReplaySession> > m_sessions;
+
+    uint64_t m_replayed_sessions;
+    uint64_t m_failed_sessions;
+    uint64_t m_sent_bytes;
+    uint64_t m_received_bytes;
+    uint64_t m_captured_response_bytes;
+};
+
+}
+
+#endif // MCT_MODEREPLAY_CAPTUREREPLAYER_HPP
@@ -0,0 +1,96 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeReplay/ModeReplay.cpp
+ *
+ * @desc ModeReplay class which is one of the possible program runtime modes.
+ */
+
+#include <chrono>
+#include <memory>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+
+#include <boost/asio/io_service.hpp>
+
+#include <ModeReplay/ModeReplay.hpp>
+#include <ModeReplay/CaptureReplayer.hpp>
+#include <ModeProxy/CaptureRing.hpp>
+#include <ModeProxy/IPResolver.hpp>
+
+namespace mct
+{
+
+ModeReplay::ModeReplay(Configuration& config, Logger& logger) : Mode(config, logger)
+{
+}
+
+ModeReplay::~ModeReplay()
+{
+}
+
+const std::string& ModeReplay::get_name() const
+{
+    static std::string replay_name("replay");
+    return replay_name;
+}
+
+bool ModeReplay::run()
+{
+    m_log.log_if_not_silent("Initialized mode '%s'.", get_name().c_str());
+
+    // throws when there is no (valid) capture file to replay
+    CaptureReader reader(m_config.get_mode_replay_capture_file());
+
+    // provides the core I/O functionality (OS calls etc.)
+    boost::asio::io_service ios;
+
+    std::string remote_ip;
+    {
+        IPResolver ip_resolver(m_log, ios);
+        remote_ip = ip_resolver.resolve_only_first_ip(m_config.get_mode_replay_remote_host());
+    }
+
+    auto replayer = std::make_shared<CaptureReplayer>(ios, m_log, reader, remote_ip, m_config.get_mode_replay_remote_port(), m_config.get_mode_replay_speed());
+
+    const auto started = std::chrono::steady_clock::now();
+
+    replayer->start();
+
+    // runs until all captured sessions are sent and their connections closed
+    ios.run();
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    m_log.info("Replayed %llu sessions (%llu failed) from %u capture files in %.3f seconds: sent %llu bytes, received %llu bytes (%llu bytes in the capture).",
+        static_cast<unsigned long long>(replayer->get_replayed_sessions()), static_cast<unsigned long long>(replayer->get_failed_sessions()),
+        static_cast<unsigned>(reader.get_num_of_files()), elapsed,
+        static_cast<unsigned long long>(replayer->get_sent_bytes()), static_cast<unsigned long long>(replayer->get_received_bytes()),
+        static_cast<unsigned long long>(replayer->get_captured_response_bytes()));
+
+    return true;
+}
+
+}
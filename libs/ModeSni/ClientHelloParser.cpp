@@ -0,0 +1,195 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeSni/ClientHelloParser.cpp
+ *
+ * @desc ClientHelloParser finds the server name (SNI) in the TLS ClientHello of a client.
+ */
+
+#include <ModeSni/ClientHelloParser.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+const unsigned char record_handshake = 0x16;
+const unsigned char handshake_client_hello = 0x01;
+
+const size_t record_header_length = 5;
+const size_t handshake_header_length = 4;
+const size_t random_length = 32;
+
+const unsigned extension_server_name = 0x0000;
+const unsigned char name_type_host_name = 0x00;
+
+unsigned read_uint16(const unsigned char* data)
+{
+	return (static_cast<unsigned>(data[0]) << 8) | data[1];
+}
+
+size_t read_uint24(const unsigned char* data)
+{
+	return (static_cast<size_t>(data[0]) << 16) | (static_cast<size_t>(data[1]) << 8) | data[2];
+}
+
+/**
+ * Skips a vector with a length prefix of prefix_length bytes, returns false if it does not fit before end.
+ */
+bool skip_vector(const unsigned char* data, size_t& offset, size_t end, size_t prefix_length)
+{
+	if (offset + prefix_length > end) {
+		return false;
+	}
+
+	const size_t length = (prefix_length == 1) ? data[offset] : read_uint16(data + offset);
+	offset += prefix_length + length;
+
+	return offset <= end;
+}
+
+}
+
+ClientHelloParser::ClientHelloParser(size_t max_record_length)
+ : m_max_record_length(max_record_length), m_server_name_offset(0), m_server_name_length(0)
+{
+}
+
+ClientHelloParser::Result ClientHelloParser::parse(const unsigned char* data, size_t length)
+{
+	// type, legacy version (3.x), length
+	if (length >= 1 && data[0] != record_handshake) {
+		return invalid;
+	}
+
+	if (length >= 2 && data[1] != 0x03) {
+		return invalid;
+	}
+
+	if (length < record_header_length) {
+		return incomplete;
+	}
+
+	const size_t record_length = read_uint16(data + 3);
+	if (record_length == 0 || record_header_length + record_length > m_max_record_length) {
+		return invalid;
+	}
+
+	if (length < record_header_length + record_length) {
+		return incomplete;
+	}
+
+	return parse_client_hello(data, record_header_length, record_header_length + record_length);
+}
+
+ClientHelloParser::Result ClientHelloParser::parse_client_hello(const unsigned char* data, size_t offset, size_t end)
+{
+	if (offset + handshake_header_length > end || data[offset] != handshake_client_hello) {
+		return invalid;
+	}
+
+	// a hello continued in the next record is cut at the end of this one, its server name is usually in front anyway
+	const size_t hello_end = offset + handshake_header_length + read_uint24(data + offset + 1);
+	if (hello_end < end) {
+		end = hello_end;
+	}
+	offset += handshake_header_length;
+
+	// legacy version, random, session id, cipher suites, compression methods
+	offset += 2 + random_length;
+	if (offset > end || !skip_vector(data, offset, end, 1) || !skip_vector(data, offset, end, 2) || !skip_vector(data, offset, end, 1)) {
+		return invalid;
+	}
+
+	if (offset == end) {
+		return no_server_name;
+	}
+
+	if (offset + 2 > end) {
+		return invalid;
+	}
+
+	const size_t extensions_end = offset + 2 + read_uint16(data + offset);
+	return parse_extensions(data, offset + 2, (extensions_end < end) ? extensions_end : end);
+}
+
+ClientHelloParser::Result ClientHelloParser::parse_extensions(const unsigned char* data, size_t offset, size_t end)
+{
+	while (offset + 4 <= end) {
+		const unsigned type = read_uint16(data + offset);
+		const size_t extension_end = offset + 4 + read_uint16(data + offset + 2);
+
+		if (extension_end > end) {
+			// cut by the end of the record
+			return no_server_name;
+		}
+
+		if (type == extension_server_name) {
+			return parse_server_name(data, offset + 4, extension_end);
+		}
+
+		offset = extension_end;
+	}
+
+	return no_server_name;
+}
+
+ClientHelloParser::Result ClientHelloParser::parse_server_name(const unsigned char* data, size_t offset, size_t end)
+{
+	if (offset + 2 > end) {
+		return invalid;
+	}
+
+	const size_t list_end = offset + 2 + read_uint16(data + offset);
+	if (list_end > end) {
+		return invalid;
+	}
+	offset += 2;
+
+	while (offset + 3 <= list_end) {
+		const unsigned char name_type = data[offset];
+		const size_t name_length = read_uint16(data + offset + 1);
+
+		if (offset + 3 + name_length > list_end) {
+			return invalid;
+		}
+
+		if (name_type == name_type_host_name) {
+			if (name_length == 0 || name_length > 255) {
+				return invalid;
+			}
+
+			m_server_name_offset = offset + 3;
+			m_server_name_length = name_length;
+			return complete;
+		}
+
+		offset += 3 + name_length;
+	}
+
+	return no_server_name;
+}
+
+}
@@ -0,0 +1,82 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeSni/ClientHelloParser.hpp
+ *
+ * @desc ClientHelloParser finds the server name (SNI) in the TLS ClientHello of a client.
+ */
+
+#ifndef MCT_MODESNI_CLIENTHELLOPARSER_HPP
+#define MCT_MODESNI_CLIENTHELLOPARSER_HPP
+
+#include <cstddef>
+
+#include <ModeSni/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * Parses the first TLS record sent by a client, which has to hold the whole ClientHello (every client does
+ * so unless its hello is larger than a record). Nothing is copied or allocated - the server name is
+ * remembered as a position in the buffer of the caller, and every length is checked against the record
+ * before it is used.
+ */
+class MCT_MODESNI_DLL_PUBLIC ClientHelloParser
+{
+public:
+    enum Result
+    {
+        incomplete,
+        complete,
+        no_server_name,
+        invalid
+    };
+
+    explicit ClientHelloParser(size_t max_record_length);
+
+    /**
+     * Parses data[0, length), the record is looked at once it has been received as a whole.
+     */
+    Result parse(const unsigned char* data, size_t length);
+
+    // valid once parse() returned complete
+    size_t get_server_name_offset() const { return m_server_name_offset; }
+    size_t get_server_name_length() const { return m_server_name_length; }
+
+protected:
+    Result parse_client_hello(const unsigned char* data, size_t offset, size_t end);
+    Result parse_extensions(const unsigned char* data, size_t offset, size_t end);
+    Result parse_server_name(const unsigned char* data, size_t offset, size_t end);
+
+protected:
+    const size_t m_max_record_length;
+
+    size_t m_server_name_offset;
+    size_t m_server_name_length;
+};
+
+}
+
+#endif // MCT_MODESNI_CLIENTHELLOPARSER_HPP
@@ -0,0 +1,204 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeSni/ModeSni.cpp
+ *
+ * @desc ModeSni class which is one of the possible program runtime modes.
+ */
+
+#include <memory>
+#include <sstream>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+
+#include <boost/asio/io_service.hpp>
+
+#include <ModeSni/ModeSni.hpp>
+#include <ModeSni/SniProxy.hpp>
+#include <ModeSni/SniRouter.hpp>
+#include <ModeProxy/IPResolver.hpp>
+#include <ModeProxy/ProxyManager.hpp>
+#include <ModeProxy/ProxyListener.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+
+namespace mct
+{
+
+ModeSni::ModeSni(Configuration& config, Logger& logger) : Mode(config, logger)
+{
+}
+
+ModeSni::~ModeSni()
+{
+}
+
+const std::string& ModeSni::get_name() const
+{
+    static std::string sni_name("sni");
+    return sni_name;
+}
+
+bool ModeSni::validate_configuration() const
+{
+    uint16_t lh = m_config.get_mode_sni_local_hosts().size();
+    uint16_t lp = m_config.get_mode_sni_local_ports().size();
+
+    if (lh != lp) {
+        m_log.fatal("There is a problem with the configuration fields 'mode_sni_local_hosts' and 'mode_sni_local_ports'. Since they are sets, they should have the same number of entries (repeats) - while they have %d and %d.", lh, lp);
+        return false;
+    }
+
+    // the router checks the names, backends are not resolved yet
+    SniRouter router;
+    for (auto&& route : m_config.get_mode_sni_routes()) {
+        const size_t equals = route.find('=');
+        std::string host;
+        uint16_t port;
+
+        if (equals == std::string::npos || !parse_backend(route.substr(equals + 1), host, port) || !router.add_route(route.substr(0, equals), "0.0.0.0", port)) {
+            m_log.fatal("Invalid or repeated 'mode_sni_routes' entry '%s', expected server_name=host:port (e.g. www.example.com=10.0.0.1:443, *.example.org=backend:8443).", route.c_str());
+            return false;
+        }
+    }
+
+    std::string host;
+    uint16_t port;
+    if (m_config.get_mode_sni_default_backend() != "none" && !parse_backend(m_config.get_mode_sni_default_backend(), host, port)) {
+        m_log.fatal("Malformed 'mode_sni_default_backend' '%s'. Expected 'none' or host:port.", m_config.get_mode_sni_default_backend().c_str());
+        return false;
+    }
+
+    if (router.get_num_of_routes() == 0 && m_config.get_mode_sni_default_backend() == "none") {
+        m_log.fatal("There are neither 'mode_sni_routes' nor 'mode_sni_default_backend', no client could be redirected anywhere.");
+        return false;
+    }
+
+    for (auto&& port : m_config.get_mode_sni_local_ports()) {
+        if (port <= 1023) {
+            m_log.warning("One of supplied mode_sni_local_ports: %d is a 'well-known port' (its value is <= 1023). It means that the program might need additional privileges to run correctly.", port);
+        }
+    }
+
+    return true;
+}
+
+uint16_t ModeSni::get_num_of_all_listeners() const
+{   // since both vectors are equal (checked with validate_configuration()), return the size of the first one
+    return m_config.get_mode_sni_local_hosts().size();
+}
+
+bool ModeSni::parse_backend(const std::string& backend, std::string& host, uint16_t& port)
+{
+    const size_t colon = backend.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == backend.size() || colon + 6 < backend.size() ||
+        backend.find_first_not_of("0123456789", colon + 1) != std::string::npos) {
+        return false;
+    }
+
+    const unsigned long value = std::stoul(backend.substr(colon + 1));
+    if (value == 0 || value > 65535) {
+        return false;
+    }
+
+    host = backend.substr(0, colon);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    port = static_cast<uint16_t>(value);
+    return true;
+}
+
+bool ModeSni::run()
+{
+    m_log.log_if_not_silent("Initialized mode '%s'.", get_name().c_str());
+
+    if (!validate_configuration()) {
+        return false;
+    }
+
+    // provides the core I/O functionality (OS calls etc.)
+    boost::asio::io_service ios;
+
+    auto settings = std::make_shared<SniSettings>();
+
+    ProxyManager manager(m_log);
+    {
+        IPResolver ip_resolver(m_log, ios);
+
+        // backends are resolved once, the sessions only look their server names up
+        for (auto&& route : m_config.get_mode_sni_routes()) {
+            const size_t equals = route.find('=');
+            std::string host;
+            uint16_t port = 0;
+
+            parse_backend(route.substr(equals + 1), host, port);
+            settings->router.add_route(route.substr(0, equals), ip_resolver.resolve_only_first_ip(host), port);
+        }
+
+        if (m_config.get_mode_sni_default_backend() != "none") {
+            std::string host;
+            uint16_t port = 0;
+
+            parse_backend(m_config.get_mode_sni_default_backend(), host, port);
+            settings->router.set_default_backend(ip_resolver.resolve_only_first_ip(host), port);
+        }
+
+        m_log.info("Routing %u server names to %u backends.", static_cast<unsigned>(settings->router.get_num_of_routes()), static_cast<unsigned>(settings->router.get_num_of_backends()));
+
+        ListenerOptions options;
+        options.session_factory = SniProxy::create_factory(settings);
+
+        const uint16_t num_of_all_listeners = get_num_of_all_listeners();
+
+        for (uint16_t listener_num = 0; listener_num < num_of_all_listeners; ++listener_num) {
+            std::string local_interface = m_config.get_mode_sni_local_hosts()[listener_num];
+            uint16_t local_port = m_config.get_mode_sni_local_ports()[listener_num];
+
+            std::string local_ip = ip_resolver.resolve_only_first_ip(local_interface);
+
+            try {
+                // the backend of every session comes from the router, the remote endpoint of the listener is not used
+                manager.add_listener(std::make_shared<ProxyListener>(ios, m_log, local_ip, local_port, "0.0.0.0", 0, options));
+            } catch (const boost::system::system_error& e) {
+                std::stringstream sStr;
+                sStr << "Cannot start sni listener using given address and port: (" << local_interface << ") " << local_ip << ":" << local_port << std::endl;
+                sStr << "Error code: " << e.code().value() << std::endl;
+                sStr << "System message: " << e.what() << std::endl;
+                throw std::runtime_error(sStr.str());
+            }
+        }
+    }
+
+    // gives control away to Boost.Asio to asynchronously handle connections
+    ios.run();
+
+    manager.log_statistics();
+    m_log.flush();
+
+    return true;
+}
+
+}
@@ -0,0 +1,74 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeSni/ModeSni.hpp
+ *
+ * @desc ModeSni class which is one of the possible program runtime modes.
+ */
+
+#ifndef MCT_MODESNI_MODESNI_HPP
+#define MCT_MODESNI_MODESNI_HPP
+
+#include <string>
+#include <cstdint>
+
+#include <Mode/Mode.hpp>
+#include <ModeSni/Config.hpp>
+
+namespace mct
+{
+
+class Configuration;
+class Logger;
+
+/**
+ * TLS router - every session is a Proxy whose backend is selected by the server name (SNI) in the ClientHello of its client,
+ * so a single port serves any number of backends.
+ */
+class MCT_MODESNI_DLL_PUBLIC ModeSni : public Mode
+{
+public:
+    ModeSni(Configuration& config, Logger& logger);
+    virtual ~ModeSni();
+
+    ModeSni(const ModeSni&) = delete;
+    ModeSni& operator=(const ModeSni&) = delete;
+
+    virtual const std::string& get_name() const;
+
+    virtual bool run();
+
+protected:
+    uint16_t get_num_of_all_listeners() const;
+    bool validate_configuration() const;
+
+    /**
+     * Splits "host:port" ([addr]:port for IPv6), returns false if it is malformed.
+     */
+    static bool parse_backend(const std::string& backend, std::string& host, uint16_t& port);
+};
+
+}
+
+#endif // MCT_MODESNI_MODESNI_HPP
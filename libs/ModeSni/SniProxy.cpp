@@ -0,0 +1,160 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeSni/SniProxy.cpp
+ *
+ * @desc SniProxy is a session which selects its backend by the server name the client asks for.
+ */
+
+#include <boost/asio/write.hpp>
+
+#include <Logger/Logger.hpp>
+#include <ModeProxy/SessionSlab.hpp>
+#include <ModeSni/SniProxy.hpp>
+#include <ModeSni/ClientHelloParser.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+const unsigned char alert_handshake_failure = 40;
+const unsigned char alert_decode_error = 50;
+const unsigned char alert_unrecognized_name = 112;
+
+}
+
+SniProxy::SniProxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, const std::shared_ptr<const SniSettings>& settings)
+ : Proxy(logger, ios, route), m_settings(settings), m_target(&Proxy::get_backend()), m_received(0)
+{
+}
+
+ListenerOptions::session_factory_type SniProxy::create_factory(const std::shared_ptr<const SniSettings>& settings)
+{
+	return [settings](Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route) -> std::shared_ptr<Proxy> {
+		return std::allocate_shared<SniProxy>(SessionAllocator<SniProxy>(ios), logger, ios, route, settings);
+	};
+}
+
+void SniProxy::connect_remote()
+{
+	m_log.info("Accepted TLS client %s:%u with listener %s:%u.", get_client_host().c_str(), get_client_port(), m_route->listen_host.c_str(), m_route->listen_port);
+
+	m_client_socket.async_read_some(
+		boost::asio::buffer(m_client_data, m_max_data_length),
+		std::bind(&SniProxy::handle_client_hello_read, std::static_pointer_cast<SniProxy>(shared_from_this()), std::placeholders::_1, std::placeholders::_2)
+	);
+}
+
+void SniProxy::handle_client_hello_read(const boost::system::error_code& error, size_t bytes_transferred)
+{
+	if (error) {
+		m_log.warning("Cannot read the ClientHello of client %s:%u, because: %s", get_client_host().c_str(), get_client_port(), error.message().c_str());
+		close();
+		return;
+	}
+
+	m_received += bytes_transferred;
+
+	ClientHelloParser parser(m_max_data_length);
+	const ClientHelloParser::Result result = parser.parse(m_client_data, m_received);
+
+	if (result == ClientHelloParser::incomplete) {
+		m_client_socket.async_read_some(
+			boost::asio::buffer(m_client_data + m_received, m_max_data_length - m_received),
+			std::bind(&SniProxy::handle_client_hello_read, std::static_pointer_cast<SniProxy>(shared_from_this()), std::placeholders::_1, std::placeholders::_2)
+		);
+		return;
+	}
+
+	if (result == ClientHelloParser::invalid) {
+		m_log.warning("Client %s:%u did not start with a valid TLS ClientHello.", get_client_host().c_str(), get_client_port());
+		reject(alert_decode_error);
+		return;
+	}
+
+	const char* server_name = reinterpret_cast<const char*>(m_client_data) + parser.get_server_name_offset();
+	const size_t server_name_length = (result == ClientHelloParser::complete) ? parser.get_server_name_length() : 0;
+
+	const ProxyBackend* backend = m_settings->router.find_backend(server_name, server_name_length);
+	if (!backend) {
+		m_log.warning("There is no backend for server name '%.*s' requested by client %s:%u.", static_cast<int>(server_name_length), server_name,
+			get_client_host().c_str(), get_client_port());
+		reject((result == ClientHelloParser::complete) ? alert_unrecognized_name : alert_handshake_failure);
+		return;
+	}
+
+	m_target = backend;
+	m_log.info("Client %s:%u requested server name '%.*s'. Redirecting connection to %s:%u.", get_client_host().c_str(), get_client_port(),
+		static_cast<int>(server_name_length), server_name, m_target->host.c_str(), m_target->port);
+
+	open_remote_socket(m_target->endpoint);
+	m_remote_socket.async_connect(m_target->endpoint, std::bind(&SniProxy::handle_backend_connect, std::static_pointer_cast<SniProxy>(shared_from_this()), std::placeholders::_1));
+}
+
+void SniProxy::handle_backend_connect(const boost::system::error_code& error)
+{
+	if (error) {
+		handle_remote_connect(error);
+		return;
+	}
+
+	// the backend terminates TLS, so it gets the ClientHello exactly as the client sent it
+	process_client_data(m_received);
+
+	boost::asio::async_write(
+		m_remote_socket, boost::asio::buffer(m_client_data, m_received),
+		std::bind(&SniProxy::handle_client_hello_write, std::static_pointer_cast<SniProxy>(shared_from_this()), std::placeholders::_1)
+	);
+}
+
+void SniProxy::handle_client_hello_write(const boost::system::error_code& error)
+{
+	if (error) {
+		handle_remote_write_error(error);
+		return;
+	}
+
+	handle_remote_connect(error);
+}
+
+void SniProxy::reject(unsigned char alert)
+{
+	// alert record: level fatal, description
+	m_remote_data[0] = 0x15;
+	m_remote_data[1] = 0x03;
+	m_remote_data[2] = 0x01;
+	m_remote_data[3] = 0x00;
+	m_remote_data[4] = 0x02;
+	m_remote_data[5] = 0x02;
+	m_remote_data[6] = alert;
+
+	auto self = shared_from_this();
+	boost::asio::async_write(m_client_socket, boost::asio::buffer(m_remote_data, 7), [self](const boost::system::error_code&, size_t) {
+		self->close();
+	});
+}
+
+}
@@ -0,0 +1,89 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeSni/SniProxy.hpp
+ *
+ * @desc SniProxy is a session which selects its backend by the server name the client asks for.
+ */
+
+#ifndef MCT_MODESNI_SNIPROXY_HPP
+#define MCT_MODESNI_SNIPROXY_HPP
+
+#include <memory>
+
+#include <ModeProxy/Proxy.hpp>
+#include <ModeProxy/ProxyRoute.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeSni/SniRouter.hpp>
+#include <ModeSni/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * Shared (read-only) by all the sessions of the mode.
+ */
+struct SniSettings
+{
+    SniRouter router;
+};
+
+/**
+ * The ClientHello is read into the client buffer of the session. TLS is not terminated - once the backend
+ * is connected, the bytes already read are sent to it and the session moves data exactly like Proxy does.
+ */
+class MCT_MODESNI_DLL_PUBLIC SniProxy : public Proxy
+{
+public:
+    SniProxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, const std::shared_ptr<const SniSettings>& settings);
+
+    const ProxyBackend& get_backend() const override { return *m_target; }
+
+    /**
+     * Session factory for ListenerOptions, so ProxyListener starts SniProxy sessions.
+     */
+    static ListenerOptions::session_factory_type create_factory(const std::shared_ptr<const SniSettings>& settings);
+
+protected:
+    void connect_remote() override;
+
+    void handle_client_hello_read(const boost::system::error_code& error, size_t bytes_transferred);
+    void handle_backend_connect(const boost::system::error_code& error);
+    void handle_client_hello_write(const boost::system::error_code& error);
+
+    /**
+     * Sends a fatal TLS alert and closes the session.
+     */
+    void reject(unsigned char alert);
+
+protected:
+    std::shared_ptr<const SniSettings> m_settings;
+
+    const ProxyBackend* m_target;
+    size_t m_received;
+};
+
+}
+
+#endif // MCT_MODESNI_SNIPROXY_HPP
@@ -0,0 +1,125 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeSni/SniRouter.cpp
+ *
+ * @desc SniRouter selects the backend for a TLS server name.
+ */
+
+#include <cctype>
+#include <algorithm>
+
+#include <ModeSni/SniRouter.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+const size_t no_backend = static_cast<size_t>(-1);
+
+std::string to_lower(const char* text, size_t length)
+{
+	std::string lower(text, length);
+	std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+	return lower;
+}
+
+bool is_valid_name(const std::string& name)
+{
+	return !name.empty() && name.size() <= 255 && name.front() != '.' && name.back() != '.' &&
+		name.find_first_not_of("abcdefghijklmnopqrstuvwxyz0123456789.-_") == std::string::npos;
+}
+
+}
+
+SniRouter::SniRouter() : m_default_backend_num(no_backend)
+{
+}
+
+bool SniRouter::add_route(const std::string& server_name, const std::string& host, uint16_t port)
+{
+	std::string name = to_lower(server_name.data(), server_name.size());
+
+	const bool is_wildcard = name.compare(0, 2, "*.") == 0;
+	if (is_wildcard) {
+		name.erase(0, 2);
+	}
+
+	if (!is_valid_name(name)) {
+		return false;
+	}
+
+	std::unordered_map<std::string, size_t>& routes = is_wildcard ? m_wildcards : m_names;
+	if (routes.count(name) != 0) {
+		return false;
+	}
+
+	routes[name] = get_backend_num(host, port);
+	return true;
+}
+
+void SniRouter::set_default_backend(const std::string& host, uint16_t port)
+{
+	m_default_backend_num = get_backend_num(host, port);
+}
+
+const ProxyBackend* SniRouter::find_backend(const char* server_name, size_t server_name_length) const
+{
+	if (server_name_length > 0 && server_name[server_name_length - 1] == '.') {
+		--server_name_length;
+	}
+
+	const std::string name = to_lower(server_name, server_name_length);
+
+	auto exact = m_names.find(name);
+	if (exact != m_names.end()) {
+		return &m_backends[exact->second];
+	}
+
+	const size_t dot = name.find('.');
+	if (dot != std::string::npos && dot != 0 && !m_wildcards.empty()) {
+		auto wildcard = m_wildcards.find(name.substr(dot + 1));
+		if (wildcard != m_wildcards.end()) {
+			return &m_backends[wildcard->second];
+		}
+	}
+
+	return (m_default_backend_num != no_backend) ? &m_backends[m_default_backend_num] : nullptr;
+}
+
+size_t SniRouter::get_backend_num(const std::string& host, uint16_t port)
+{
+	for (size_t backend_num = 0; backend_num < m_backends.size(); ++backend_num) {
+		if (m_backends[backend_num].host == host && m_backends[backend_num].port == port) {
+			return backend_num;
+		}
+	}
+
+	m_backends.push_back(ProxyBackend(host, port));
+	return m_backends.size() - 1;
+}
+
+}
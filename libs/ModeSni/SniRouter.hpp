@@ -0,0 +1,86 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeSni/SniRouter.hpp
+ *
+ * @desc SniRouter selects the backend for a TLS server name.
+ */
+
+#ifndef MCT_MODESNI_SNIROUTER_HPP
+#define MCT_MODESNI_SNIROUTER_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include <ModeProxy/ProxyRoute.hpp>
+#include <ModeSni/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * Server names are looked up in a hash map - an exact name first, then the wildcard "*.example.com"
+ * matching a single label in front of example.com (like a wildcard certificate does), then the default backend.
+ * Names ignore the case and a trailing dot.
+ */
+class MCT_MODESNI_DLL_PUBLIC SniRouter
+{
+public:
+    SniRouter();
+
+    /**
+     * Routes server_name (or the wildcard) to the backend, which is added once however many names use it.
+     * Returns false if the name is malformed or already routed.
+     */
+    bool add_route(const std::string& server_name, const std::string& host, uint16_t port);
+    void set_default_backend(const std::string& host, uint16_t port);
+
+    /**
+     * Returns nullptr if the name is not routed and there is no default backend.
+     */
+    const ProxyBackend* find_backend(const char* server_name, size_t server_name_length) const;
+    const ProxyBackend* find_backend(const std::string& server_name) const { return find_backend(server_name.data(), server_name.size()); }
+
+    size_t get_num_of_routes() const { return m_names.size() + m_wildcards.size(); }
+    size_t get_num_of_backends() const { return m_backends.size(); }
+
+protected:
+    size_t get_backend_num(const std::string& host, uint16_t port);
+
+protected:
+    // the maps keep indexes, so the vector can grow while routes are added
+    std::vector<ProxyBackend> m_backends;
+    size_t m_default_backend_num;
+
+    std::unordered_map<std::string, size_t> m_names;
+    // "*.example.com" is stored as "example.com"
+    std::unordered_map<std::string, size_t> m_wildcards;
+};
+
+}
+
+#endif // MCT_MODESNI_SNIROUTER_HPP
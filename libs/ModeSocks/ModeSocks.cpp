@@ -0,0 +1,156 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeSocks/ModeSocks.cpp
+ *
+ * @desc ModeSocks class which is one of the possible program runtime modes.
+ */
+
+#include <memory>
+#include <sstream>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+
+#include <boost/asio/io_service.hpp>
+
+#include <ModeSocks/ModeSocks.hpp>
+#include <ModeSocks/Socks5Proxy.hpp>
+#include <ModeProxy/IPResolver.hpp>
+#include <ModeProxy/ProxyManager.hpp>
+#include <ModeProxy/ProxyListener.hpp>
+#include <ModeProxy/CachedResolver.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+
+namespace mct
+{
+
+ModeSocks::ModeSocks(Configuration& config, Logger& logger) : Mode(config, logger)
+{
+}
+
+ModeSocks::~ModeSocks()
+{
+}
+
+const std::string& ModeSocks::get_name() const
+{
+    static std::string socks_name("socks5");
+    return socks_name;
+}
+
+bool ModeSocks::validate_configuration() const
+{
+    uint16_t lh = m_config.get_mode_socks_local_hosts().size();
+    uint16_t lp = m_config.get_mode_socks_local_ports().size();
+
+    if (lh != lp) {
+        m_log.fatal("There is a problem with the configuration fields 'mode_socks_local_hosts' and 'mode_socks_local_ports'. Since they are sets, they should have the same number of entries (repeats) - while they have %d and %d.", lh, lp);
+        return false;
+    }
+
+    // RFC 1929 sends both lengths in a single byte
+    if (m_config.get_mode_socks_username().size() > 255 || m_config.get_mode_socks_password().size() > 255) {
+        m_log.fatal("Both 'mode_socks_username' and 'mode_socks_password' have to be shorter than 256 characters.");
+        return false;
+    }
+
+    if (m_config.get_mode_socks_username() != "none" && m_config.get_mode_socks_username().empty()) {
+        m_log.fatal("Empty 'mode_socks_username' is not allowed, use 'none' to let clients connect without authentication.");
+        return false;
+    }
+
+    for (auto&& port : m_config.get_mode_socks_local_ports()) {
+        if (port <= 1023) {
+            m_log.warning("One of supplied mode_socks_local_ports: %d is a 'well-known port' (its value is <= 1023). It means that the program might need additional privileges to run correctly.", port);
+        }
+    }
+
+    return true;
+}
+
+uint16_t ModeSocks::get_num_of_all_listeners() const
+{   // since both vectors are equal (checked with validate_configuration()), return the size of the first one
+    return m_config.get_mode_socks_local_hosts().size();
+}
+
+bool ModeSocks::run()
+{
+    m_log.log_if_not_silent("Initialized mode '%s'.", get_name().c_str());
+
+    if (!validate_configuration()) {
+        return false;
+    }
+
+    // provides the core I/O functionality (OS calls etc.)
+    boost::asio::io_service ios;
+
+    auto settings = std::make_shared<Socks5Settings>();
+    if (m_config.get_mode_socks_username() != "none") {
+        settings->username = m_config.get_mode_socks_username();
+        settings->password = m_config.get_mode_socks_password();
+    }
+    settings->resolver = std::make_shared<CachedResolver>(m_log, ios, m_config.get_mode_socks_resolver_cache_size(), m_config.get_mode_socks_resolver_cache_ttl(),
+        m_config.get_mode_socks_resolver_timeout());
+
+    ListenerOptions options;
+    options.session_factory = Socks5Proxy::create_factory(settings);
+
+    ProxyManager manager(m_log);
+    {
+        IPResolver ip_resolver(m_log, ios);
+
+        const uint16_t num_of_all_listeners = get_num_of_all_listeners();
+
+        for (uint16_t listener_num = 0; listener_num < num_of_all_listeners; ++listener_num) {
+            std::string local_interface = m_config.get_mode_socks_local_hosts()[listener_num];
+            uint16_t local_port = m_config.get_mode_socks_local_ports()[listener_num];
+
+            std::string local_ip = ip_resolver.resolve_only_first_ip(local_interface);
+
+            try {
+                // the destination of every session comes from its client, the remote endpoint of the listener is not used
+                manager.add_listener(std::make_shared<ProxyListener>(ios, m_log, local_ip, local_port, "0.0.0.0", 0, options));
+            } catch (const boost::system::system_error& e) {
+                std::stringstream sStr;
+                sStr << "Cannot start socks5 listener using given address and port: (" << local_interface << ") " << local_ip << ":" << local_port << std::endl;
+                sStr << "Error code: " << e.code().value() << std::endl;
+                sStr << "System message: " << e.what() << std::endl;
+                throw std::runtime_error(sStr.str());
+            }
+        }
+    }
+
+    // gives control away to Boost.Asio to asynchronously handle connections
+    ios.run();
+
+    manager.log_statistics();
+    m_log.info("Resolver cache answered %llu of %llu lookups.", static_cast<unsigned long long>(settings->resolver->get_num_of_hits()),
+        static_cast<unsigned long long>(settings->resolver->get_num_of_hits() + settings->resolver->get_num_of_lookups()));
+    m_log.flush();
+
+    return true;
+}
+
+}
@@ -0,0 +1,68 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeSocks/ModeSocks.hpp
+ *
+ * @desc ModeSocks class which is one of the possible program runtime modes.
+ */
+
+#ifndef MCT_MODESOCKS_MODESOCKS_HPP
+#define MCT_MODESOCKS_MODESOCKS_HPP
+
+#include <string>
+#include <cstdint>
+
+#include <Mode/Mode.hpp>
+#include <ModeSocks/Config.hpp>
+
+namespace mct
+{
+
+class Configuration;
+class Logger;
+
+/**
+ * SOCKS5 server - every session is a Proxy whose destination comes from the SOCKS5 handshake of its client.
+ */
+class MCT_MODESOCKS_DLL_PUBLIC ModeSocks : public Mode
+{
+public:
+    ModeSocks(Configuration& config, Logger& logger);
+    virtual ~ModeSocks();
+
+    ModeSocks(const ModeSocks&) = delete;
+    ModeSocks& operator=(const ModeSocks&) = delete;
+
+    virtual const std::string& get_name() const;
+
+    virtual bool run();
+
+protected:
+    uint16_t get_num_of_all_listeners() const;
+    bool validate_configuration() const;
+};
+
+}
+
+#endif // MCT_MODESOCKS_MODESOCKS_HPP
@@ -0,0 +1,373 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeSocks/Socks5Proxy.cpp
+ *
+ * @desc Socks5Proxy is a session which learns its destination from a SOCKS5 handshake.
+ */
+
+#include <cstring>
+#include <algorithm>
+
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/coroutine.hpp>
+
+#include <Logger/Logger.hpp>
+#include <ModeProxy/SessionSlab.hpp>
+#include <ModeProxy/StreamEndpoint.hpp>
+#include <ModeSocks/Socks5Proxy.hpp>
+
+#include <boost/asio/yield.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+const unsigned char socks_version = 0x05;
+const unsigned char auth_version = 0x01;
+
+const unsigned char method_no_authentication = 0x00;
+const unsigned char method_username_password = 0x02;
+const unsigned char method_not_acceptable = 0xff;
+
+const unsigned char command_connect = 0x01;
+
+const unsigned char address_ipv4 = 0x01;
+const unsigned char address_domain = 0x03;
+const unsigned char address_ipv6 = 0x04;
+
+const unsigned char reply_succeeded = 0x00;
+const unsigned char reply_general_failure = 0x01;
+const unsigned char reply_network_unreachable = 0x03;
+const unsigned char reply_host_unreachable = 0x04;
+const unsigned char reply_connection_refused = 0x05;
+const unsigned char reply_command_not_supported = 0x07;
+const unsigned char reply_address_type_not_supported = 0x08;
+
+/**
+ * Length of the address of a request (including the length byte of a domain name), 0 if its type is unknown.
+ */
+size_t get_address_length(unsigned char address_type, unsigned char first_byte)
+{
+	switch (address_type) {
+	case address_ipv4:
+		return 4;
+	case address_ipv6:
+		return 16;
+	case address_domain:
+		return 1 + first_byte;
+	default:
+		return 0;
+	}
+}
+
+}
+
+/**
+ * Runs the whole handshake - every step reads exactly the bytes it needs, so data sent by the client right
+ * after its request is left for the pumps.
+ */
+class Socks5Proxy::Handshake : boost::asio::coroutine
+{
+public:
+	explicit Handshake(const std::shared_ptr<Socks5Proxy>& session) : m_session(session), m_length(0), m_address_num(0) {}
+
+	void operator()(const boost::system::error_code& error = boost::system::error_code(), size_t bytes_transferred = 0)
+	{
+		// every step reads or writes exactly the bytes it asked for
+		(void)bytes_transferred;
+
+		Socks5Proxy& session = *m_session;
+		Proxy::socket_type& client = session.m_client_socket;
+		unsigned char* request = session.m_client_data;
+		unsigned char* reply = session.m_remote_data;
+
+		reenter (this) {
+			// greeting: version, number of methods, methods
+			yield boost::asio::async_read(client, boost::asio::buffer(request, 2), *this);
+			if (error || request[0] != socks_version) {
+				fail(error, "greeting");
+				yield break;
+			}
+
+			yield boost::asio::async_read(client, boost::asio::buffer(request + 2, request[1]), *this);
+			if (error) {
+				fail(error, "greeting");
+				yield break;
+			}
+
+			reply[0] = socks_version;
+			reply[1] = session.select_method(request + 2, request[1]);
+			yield boost::asio::async_write(client, boost::asio::buffer(reply, 2), *this);
+			if (error || reply[1] == method_not_acceptable) {
+				fail(error, "authentication method selection");
+				yield break;
+			}
+
+			if (reply[1] == method_username_password) {
+				// version, username length, username, password length, password
+				yield boost::asio::async_read(client, boost::asio::buffer(request, 2), *this);
+				if (error || request[0] != auth_version) {
+					fail(error, "authentication");
+					yield break;
+				}
+
+				m_length = request[1];
+				yield boost::asio::async_read(client, boost::asio::buffer(request + 2, m_length + 1), *this);
+				if (!error) {
+					yield boost::asio::async_read(client, boost::asio::buffer(request + 3 + m_length, request[2 + m_length]), *this);
+				}
+				if (error) {
+					fail(error, "authentication");
+					yield break;
+				}
+
+				reply[0] = auth_version;
+				reply[1] = session.is_authorized(std::string(reinterpret_cast<char*>(request) + 2, m_length),
+					std::string(reinterpret_cast<char*>(request) + 3 + m_length, request[2 + m_length])) ? 0x00 : 0x01;
+				yield boost::asio::async_write(client, boost::asio::buffer(reply, 2), *this);
+				if (error || reply[1] != 0x00) {
+					fail(error, "authentication");
+					yield break;
+				}
+			}
+
+			// request: version, command, reserved, address type, address, port
+			yield boost::asio::async_read(client, boost::asio::buffer(request, 5), *this);
+			if (error || request[0] != socks_version) {
+				fail(error, "request");
+				yield break;
+			}
+
+			m_length = get_address_length(request[3], request[4]);
+			if (m_length == 0) {
+				session.reject(reply_address_type_not_supported);
+				yield break;
+			}
+
+			yield boost::asio::async_read(client, boost::asio::buffer(request + 5, m_length - 1 + 2), *this);
+			if (error) {
+				fail(error, "request");
+				yield break;
+			}
+
+			if (request[1] != command_connect) {
+				session.m_log.warning("SOCKS5 client %s:%u sent unsupported command %u.", session.get_client_host().c_str(), session.get_client_port(), request[1]);
+				session.reject(reply_command_not_supported);
+				yield break;
+			}
+
+			session.parse_target(request + 3);
+			session.m_log.info("SOCKS5 client %s:%u requested %s:%u.", session.get_client_host().c_str(), session.get_client_port(),
+				session.m_target.host.c_str(), session.m_target.port);
+
+			if (session.m_target_addresses.empty()) {
+				yield session.m_settings->resolver->async_resolve(session.m_target.host, *this);
+				if (error || session.m_target_addresses.empty()) {
+					session.reject(reply_host_unreachable);
+					yield break;
+				}
+			}
+
+			// every address of the destination is tried in turn
+			for (m_address_num = 0; m_address_num < session.m_target_addresses.size(); ++m_address_num) {
+				session.m_target.endpoint = boost::asio::ip::tcp::endpoint(session.m_target_addresses[m_address_num], session.m_target.port);
+
+				session.open_remote_socket(session.m_target.endpoint);
+				yield session.m_remote_socket.async_connect(session.m_target.endpoint, *this);
+				if (!error) {
+					break;
+				}
+			}
+
+			if (error) {
+				session.m_log.error("Cannot connect SOCKS5 client %s:%u to %s:%u. Error: %s", session.get_client_host().c_str(), session.get_client_port(),
+					session.m_target.host.c_str(), session.m_target.port, error.message().c_str());
+				session.reject(get_reply_code(error));
+				yield break;
+			}
+
+			yield boost::asio::async_write(client, boost::asio::buffer(reply, session.prepare_reply(reply_succeeded)), *this);
+			if (error) {
+				fail(error, "reply");
+				yield break;
+			}
+
+			session.handle_remote_connect(error);
+		}
+	}
+
+	// completion of the resolver
+	void operator()(const boost::system::error_code& error, const CachedResolver::addresses_type& addresses)
+	{
+		m_session->m_target_addresses = addresses;
+		(*this)(error);
+	}
+
+private:
+	void fail(const boost::system::error_code& error, const char* step)
+	{
+		m_session->m_log.warning("SOCKS5 handshake with client %s:%u failed at %s%s%s.", m_session->get_client_host().c_str(), m_session->get_client_port(),
+			step, error ? ": " : "", error ? error.message().c_str() : "");
+		m_session->close();
+	}
+
+private:
+	std::shared_ptr<Socks5Proxy> m_session;
+	size_t m_length;
+	size_t m_address_num;
+};
+
+Socks5Proxy::Socks5Proxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, const std::shared_ptr<const Socks5Settings>& settings)
+ : Proxy(logger, ios, route), m_settings(settings), m_target("0.0.0.0", 0)
+{
+}
+
+ListenerOptions::session_factory_type Socks5Proxy::create_factory(const std::shared_ptr<const Socks5Settings>& settings)
+{
+	return [settings](Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route) -> std::shared_ptr<Proxy> {
+		return std::allocate_shared<Socks5Proxy>(SessionAllocator<Socks5Proxy>(ios), logger, ios, route, settings);
+	};
+}
+
+void Socks5Proxy::connect_remote()
+{
+	m_log.info("Accepted SOCKS5 client %s:%u with listener %s:%u.", get_client_host().c_str(), get_client_port(), m_route->listen_host.c_str(), m_route->listen_port);
+
+	Handshake(std::static_pointer_cast<Socks5Proxy>(shared_from_this()))();
+}
+
+unsigned char Socks5Proxy::select_method(const unsigned char* methods, size_t num_of_methods) const
+{
+	const unsigned char method = m_settings->username.empty() ? method_no_authentication : method_username_password;
+
+	return (std::find(methods, methods + num_of_methods, method) != methods + num_of_methods) ? method : method_not_acceptable;
+}
+
+bool Socks5Proxy::is_authorized(const std::string& username, const std::string& password) const
+{
+	// compares all the bytes, so the time it takes does not tell how much of the credentials was right
+	const std::string expected = m_settings->username + '\0' + m_settings->password;
+	const std::string received = username + '\0' + password;
+
+	unsigned char difference = (expected.size() == received.size()) ? 0 : 1;
+	for (size_t i = 0; i < received.size(); ++i) {
+		difference |= static_cast<unsigned char>(received[i] ^ expected[i % expected.size()]);
+	}
+
+	return difference == 0;
+}
+
+bool Socks5Proxy::parse_target(const unsigned char* address)
+{
+	const unsigned char* port;
+
+	m_target_addresses.clear();
+
+	if (address[0] == address_ipv4) {
+		boost::asio::ip::address_v4::bytes_type bytes;
+		std::memcpy(bytes.data(), address + 1, bytes.size());
+		m_target_addresses.push_back(boost::asio::ip::address_v4(bytes));
+		m_target.host = m_target_addresses.front().to_string();
+		port = address + 1 + bytes.size();
+	} else if (address[0] == address_ipv6) {
+		boost::asio::ip::address_v6::bytes_type bytes;
+		std::memcpy(bytes.data(), address + 1, bytes.size());
+		m_target_addresses.push_back(boost::asio::ip::address_v6(bytes));
+		m_target.host = m_target_addresses.front().to_string();
+		port = address + 1 + bytes.size();
+	} else if (address[0] == address_domain) {
+		m_target.host.assign(reinterpret_cast<const char*>(address) + 2, address[1]);
+		port = address + 2 + address[1];
+	} else {
+		return false;
+	}
+
+	m_target.port = static_cast<uint16_t>((port[0] << 8) | port[1]);
+	return true;
+}
+
+size_t Socks5Proxy::prepare_reply(unsigned char reply_code)
+{
+	boost::asio::ip::tcp::endpoint bound_endpoint(boost::asio::ip::address_v4::any(), 0);
+
+	if (reply_code == reply_succeeded) {
+		boost::system::error_code error;
+		boost::asio::ip::tcp::endpoint local_endpoint = StreamEndpoint::to_ip(m_remote_socket.local_endpoint(error));
+		if (!error) {
+			bound_endpoint = local_endpoint;
+		}
+	}
+
+	unsigned char* reply = m_remote_data;
+	reply[0] = socks_version;
+	reply[1] = reply_code;
+	reply[2] = 0x00;
+
+	size_t length = 4;
+	if (bound_endpoint.address().is_v6()) {
+		reply[3] = address_ipv6;
+		boost::asio::ip::address_v6::bytes_type bytes = bound_endpoint.address().to_v6().to_bytes();
+		std::memcpy(reply + length, bytes.data(), bytes.size());
+		length += bytes.size();
+	} else {
+		reply[3] = address_ipv4;
+		boost::asio::ip::address_v4::bytes_type bytes = bound_endpoint.address().to_v4().to_bytes();
+		std::memcpy(reply + length, bytes.data(), bytes.size());
+		length += bytes.size();
+	}
+
+	reply[length++] = static_cast<unsigned char>(bound_endpoint.port() >> 8);
+	reply[length++] = static_cast<unsigned char>(bound_endpoint.port() & 0xff);
+
+	return length;
+}
+
+unsigned char Socks5Proxy::get_reply_code(const boost::system::error_code& error)
+{
+	if (error == boost::asio::error::connection_refused) {
+		return reply_connection_refused;
+	} else if (error == boost::asio::error::network_unreachable) {
+		return reply_network_unreachable;
+	} else if (error == boost::asio::error::host_unreachable || error == boost::asio::error::timed_out) {
+		return reply_host_unreachable;
+	}
+
+	return reply_general_failure;
+}
+
+void Socks5Proxy::reject(unsigned char reply_code)
+{
+	auto self = shared_from_this();
+	boost::asio::async_write(m_client_socket, boost::asio::buffer(m_remote_data, prepare_reply(reply_code)), [self](const boost::system::error_code&, size_t) {
+		self->close();
+	});
+}
+
+}
+
+#include <boost/asio/unyield.hpp>
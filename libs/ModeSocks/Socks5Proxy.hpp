@@ -0,0 +1,106 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeSocks/Socks5Proxy.hpp
+ *
+ * @desc Socks5Proxy is a session which learns its destination from a SOCKS5 handshake.
+ */
+
+#ifndef MCT_MODESOCKS_SOCKS5PROXY_HPP
+#define MCT_MODESOCKS_SOCKS5PROXY_HPP
+
+#include <memory>
+#include <string>
+
+#include <ModeProxy/Proxy.hpp>
+#include <ModeProxy/ProxyRoute.hpp>
+#include <ModeProxy/CachedResolver.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeSocks/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * Shared (read-only) by all the sessions of the mode.
+ */
+struct Socks5Settings
+{
+    // username/password authentication (RFC 1929) is required if username is not empty, no authentication otherwise
+    std::string username;
+    std::string password;
+
+    std::shared_ptr<CachedResolver> resolver;
+};
+
+/**
+ * The handshake (RFC 1928, CONNECT only) runs on the client socket of the session, using the session buffers.
+ * Once the destination is connected, the session moves data exactly like Proxy does.
+ */
+class MCT_MODESOCKS_DLL_PUBLIC Socks5Proxy : public Proxy
+{
+public:
+    Socks5Proxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, const std::shared_ptr<const Socks5Settings>& settings);
+
+    const ProxyBackend& get_backend() const override { return m_target; }
+
+    /**
+     * Session factory for ListenerOptions, so ProxyListener starts Socks5Proxy sessions.
+     */
+    static ListenerOptions::session_factory_type create_factory(const std::shared_ptr<const Socks5Settings>& settings);
+
+protected:
+    void connect_remote() override;
+
+    unsigned char select_method(const unsigned char* methods, size_t num_of_methods) const;
+    bool is_authorized(const std::string& username, const std::string& password) const;
+
+    /**
+     * Parses the destination of a request (starting with its address type), returns false if it is not supported.
+     */
+    bool parse_target(const unsigned char* address);
+
+    /**
+     * Writes the reply into m_remote_data, returns its length.
+     */
+    size_t prepare_reply(unsigned char reply_code);
+    static unsigned char get_reply_code(const boost::system::error_code& error);
+
+    /**
+     * Sends a failure reply and closes the session.
+     */
+    void reject(unsigned char reply_code);
+
+protected:
+    class Handshake;
+
+    std::shared_ptr<const Socks5Settings> m_settings;
+
+    ProxyBackend m_target;
+    CachedResolver::addresses_type m_target_addresses;
+};
+
+}
+
+#endif // MCT_MODESOCKS_SOCKS5PROXY_HPP
@@ -0,0 +1,168 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTls/ModeTls.cpp
+ *
+ * @desc ModeTls class which is one of the possible program runtime modes.
+ */
+
+#include <memory>
+#include <sstream>
+#include <algorithm>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+
+#include <boost/asio/io_service.hpp>
+
+#include <ModeTls/ModeTls.hpp>
+#include <ModeTls/TlsProxy.hpp>
+#include <ModeTls/TlsContext.hpp>
+#include <ModeProxy/IPResolver.hpp>
+#include <ModeProxy/ProxyManager.hpp>
+#include <ModeProxy/ProxyListener.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+
+namespace mct
+{
+
+ModeTls::ModeTls(Configuration& config, Logger& logger) : Mode(config, logger)
+{
+}
+
+ModeTls::~ModeTls()
+{
+}
+
+const std::string& ModeTls::get_name() const
+{
+    static std::string tls_name("tls");
+    return tls_name;
+}
+
+bool ModeTls::validate_configuration() const
+{
+    uint16_t lh = m_config.get_mode_tls_local_hosts().size();
+    uint16_t rh = m_config.get_mode_tls_remote_hosts().size();
+    uint16_t lp = m_config.get_mode_tls_local_ports().size();
+    uint16_t rp = m_config.get_mode_tls_remote_ports().size();
+    uint16_t max = (std::max)({lh, rh, lp, rp});
+
+    if (lh != max || rh != max || lp != max || rp != max) {
+        m_log.fatal("There is a problem with the configuration fields 'mode_tls_local_hosts', 'mode_tls_local_ports', 'mode_tls_remote_hosts' and 'mode_tls_remote_ports'. Since they are sets, they should have the same number of entries (repeats) - while they have %d, %d, %d and %d.", lh, lp, rh, rp);
+        return false;
+    }
+
+    if (m_config.get_mode_tls_certificate().empty() || m_config.get_mode_tls_private_key().empty()) {
+        m_log.fatal("Both 'mode_tls_certificate' and 'mode_tls_private_key' are required in tls mode.");
+        return false;
+    }
+
+    for (auto&& port : m_config.get_mode_tls_local_ports()) {
+        if (port <= 1023) {
+            m_log.warning("One of supplied mode_tls_local_ports: %d is a 'well-known port' (its value is <= 1023). It means that the program might need additional privileges to run correctly.", port);
+        }
+    }
+
+    return true;
+}
+
+uint16_t ModeTls::get_num_of_all_listeners() const
+{   // since all vectors are equal (checked with validate_configuration()), return the size of the first one
+    return m_config.get_mode_tls_local_hosts().size();
+}
+
+bool ModeTls::run()
+{
+    m_log.log_if_not_silent("Initialized mode '%s'.", get_name().c_str());
+
+    if (!validate_configuration()) {
+        return false;
+    }
+
+    TlsSettings settings;
+    settings.certificate_file = m_config.get_mode_tls_certificate();
+    settings.private_key_file = m_config.get_mode_tls_private_key();
+    settings.session_cache_size = m_config.get_mode_tls_session_cache_size();
+    settings.session_timeout = m_config.get_mode_tls_session_timeout();
+    settings.ktls = m_config.get_mode_tls_ktls();
+
+    // one context for all the listeners, so they share the session cache and the ticket keys
+    auto context = std::make_shared<TlsContext>();
+    std::string message;
+    if (!context->initialize(settings, message)) {
+        m_log.fatal("%s", message.c_str());
+        return false;
+    }
+
+    if (settings.ktls && !context->is_ktls_enabled()) {
+        m_log.warning("OpenSSL is built without kernel TLS, the sessions encrypt in user space.");
+    }
+
+    // provides the core I/O functionality (OS calls etc.)
+    boost::asio::io_service ios;
+
+    ProxyManager manager(m_log);
+    {
+        IPResolver ip_resolver(m_log, ios);
+
+        ListenerOptions options;
+        options.session_factory = TlsProxy::create_factory(context);
+
+        const uint16_t num_of_all_listeners = get_num_of_all_listeners();
+
+        for (uint16_t listener_num = 0; listener_num < num_of_all_listeners; ++listener_num) {
+            std::string local_interface = m_config.get_mode_tls_local_hosts()[listener_num];
+            std::string remote_interface = m_config.get_mode_tls_remote_hosts()[listener_num];
+            uint16_t local_port = m_config.get_mode_tls_local_ports()[listener_num];
+            uint16_t remote_port = m_config.get_mode_tls_remote_ports()[listener_num];
+
+            std::string local_ip = ip_resolver.resolve_only_first_ip(local_interface);
+            std::string remote_ip = ip_resolver.resolve_only_first_ip(remote_interface);
+
+            try {
+                manager.add_listener(std::make_shared<ProxyListener>(ios, m_log, local_ip, local_port, remote_ip, remote_port, options));
+            } catch (const boost::system::system_error& e) {
+                std::stringstream sStr;
+                sStr << "Cannot start tls listener using given address and port: (" << local_interface << ") " << local_ip << ":" << local_port << std::endl;
+                sStr << "Error code: " << e.code().value() << std::endl;
+                sStr << "System message: " << e.what() << std::endl;
+                throw std::runtime_error(sStr.str());
+            }
+        }
+    }
+
+    // gives control away to Boost.Asio to asynchronously handle connections
+    ios.run();
+
+    manager.log_statistics();
+    m_log.info("Finished %llu TLS handshakes, %llu of them resumed a session and %llu moved the record crypto to the kernel.",
+        static_cast<unsigned long long>(context->get_num_of_handshakes()), static_cast<unsigned long long>(context->get_num_of_resumed_sessions()),
+        static_cast<unsigned long long>(context->get_num_of_offloaded_sessions()));
+    m_log.flush();
+
+    return true;
+}
+
+}
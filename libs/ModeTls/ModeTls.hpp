@@ -0,0 +1,69 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTls/ModeTls.hpp
+ *
+ * @desc ModeTls class which is one of the possible program runtime modes.
+ */
+
+#ifndef MCT_MODETLS_MODETLS_HPP
+#define MCT_MODETLS_MODETLS_HPP
+
+#include <string>
+#include <cstdint>
+
+#include <Mode/Mode.hpp>
+#include <ModeTls/Config.hpp>
+
+namespace mct
+{
+
+class Configuration;
+class Logger;
+
+/**
+ * TLS terminator - every listener accepts TLS clients and forwards the plain data to its backend, all of them
+ * with the same certificate and the same session cache.
+ */
+class MCT_MODETLS_DLL_PUBLIC ModeTls : public Mode
+{
+public:
+    ModeTls(Configuration& config, Logger& logger);
+    virtual ~ModeTls();
+
+    ModeTls(const ModeTls&) = delete;
+    ModeTls& operator=(const ModeTls&) = delete;
+
+    virtual const std::string& get_name() const;
+
+    virtual bool run();
+
+protected:
+    uint16_t get_num_of_all_listeners() const;
+    bool validate_configuration() const;
+};
+
+}
+
+#endif // MCT_MODETLS_MODETLS_HPP
@@ -0,0 +1,137 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTls/TlsContext.cpp
+ *
+ * @desc TlsContext holds the certificate, the key and the session cache which every TLS session of the mode uses.
+ */
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include <ModeTls/TlsContext.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+const unsigned char session_id_context[] = "mct";
+
+}
+
+TlsContext::TlsContext()
+ : m_context(nullptr), m_is_ktls_enabled(false), m_num_of_handshakes(0), m_num_of_resumed_sessions(0), m_num_of_offloaded_sessions(0)
+{
+}
+
+TlsContext::~TlsContext()
+{
+	if (m_context) {
+		SSL_CTX_free(m_context);
+	}
+}
+
+bool TlsContext::initialize(const TlsSettings& settings, std::string& message)
+{
+	ERR_clear_error();
+
+	m_context = SSL_CTX_new(TLS_server_method());
+	if (!m_context) {
+		message = "Cannot create the TLS context: " + get_last_error();
+		return false;
+	}
+
+	SSL_CTX_set_min_proto_version(m_context, TLS1_2_VERSION);
+	SSL_CTX_set_options(m_context, SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_NO_RENEGOTIATION);
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+	// a client which closes the connection without close_notify ends its stream like a plain TCP client does
+	SSL_CTX_set_options(m_context, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+	// idle sessions give their record buffers back
+	SSL_CTX_set_mode(m_context, SSL_MODE_RELEASE_BUFFERS);
+
+	if (SSL_CTX_use_certificate_chain_file(m_context, settings.certificate_file.c_str()) != 1) {
+		message = "Cannot load the certificate '" + settings.certificate_file + "': " + get_last_error();
+		return false;
+	}
+
+	if (SSL_CTX_use_PrivateKey_file(m_context, settings.private_key_file.c_str(), SSL_FILETYPE_PEM) != 1) {
+		message = "Cannot load the private key '" + settings.private_key_file + "': " + get_last_error();
+		return false;
+	}
+
+	if (SSL_CTX_check_private_key(m_context) != 1) {
+		message = "The private key '" + settings.private_key_file + "' does not match the certificate '" + settings.certificate_file + "': " + get_last_error();
+		return false;
+	}
+
+	// tickets are on by default, their keys are generated with the context and live as long as it does
+	SSL_CTX_set_session_cache_mode(m_context, SSL_SESS_CACHE_SERVER);
+	SSL_CTX_sess_set_cache_size(m_context, settings.session_cache_size);
+	SSL_CTX_set_timeout(m_context, settings.session_timeout);
+	SSL_CTX_set_session_id_context(m_context, session_id_context, sizeof(session_id_context) - 1);
+
+#ifdef SSL_OP_ENABLE_KTLS
+	if (settings.ktls) {
+		SSL_CTX_set_options(m_context, SSL_OP_ENABLE_KTLS);
+		m_is_ktls_enabled = true;
+	}
+#endif
+
+	return true;
+}
+
+void TlsContext::count_handshake(bool is_resumed, bool is_offloaded)
+{
+	++m_num_of_handshakes;
+
+	if (is_resumed) {
+		++m_num_of_resumed_sessions;
+	}
+
+	if (is_offloaded) {
+		++m_num_of_offloaded_sessions;
+	}
+}
+
+std::string TlsContext::get_last_error()
+{
+	std::string errors;
+	char buffer[256];
+
+	while (const unsigned long error = ERR_get_error()) {
+		ERR_error_string_n(error, buffer, sizeof(buffer));
+
+		if (!errors.empty()) {
+			errors += "; ";
+		}
+		errors += buffer;
+	}
+
+	return errors.empty() ? std::string("unknown error") : errors;
+}
+
+}
@@ -0,0 +1,105 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTls/TlsContext.hpp
+ *
+ * @desc TlsContext holds the certificate, the key and the session cache which every TLS session of the mode uses.
+ */
+
+#ifndef MCT_MODETLS_TLSCONTEXT_HPP
+#define MCT_MODETLS_TLSCONTEXT_HPP
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+#include <ModeTls/Config.hpp>
+
+struct ssl_ctx_st;
+
+namespace mct
+{
+
+struct TlsSettings
+{
+    TlsSettings() : session_cache_size(20480), session_timeout(300), ktls(true) {}
+
+    // PEM files, the certificate file may hold the whole chain (server certificate first)
+    std::string certificate_file;
+    std::string private_key_file;
+
+    uint32_t session_cache_size;
+    // seconds, for both the cached sessions and the session tickets
+    uint32_t session_timeout;
+    // lets OpenSSL hand the record crypto over to the kernel after the handshake
+    bool ktls;
+};
+
+/**
+ * A single SSL_CTX shared by all the listeners of the mode - so a client resumes its session (from the cache or
+ * with a ticket, whose keys belong to the context) whichever listener it comes back to. OpenSSL locks the cache
+ * itself, the context may be used from more than one thread.
+ */
+class MCT_MODETLS_DLL_PUBLIC TlsContext
+{
+public:
+    TlsContext();
+    ~TlsContext();
+
+    TlsContext(const TlsContext&) = delete;
+    TlsContext& operator=(const TlsContext&) = delete;
+
+    /**
+     * Returns false and a message for the user if the certificate or the key cannot be used.
+     */
+    bool initialize(const TlsSettings& settings, std::string& message);
+
+    ssl_ctx_st* get_native() const { return m_context; }
+    // false if kernel TLS was not asked for or OpenSSL is built without it
+    bool is_ktls_enabled() const { return m_is_ktls_enabled; }
+
+    // every finished handshake is counted once, by the session which made it
+    void count_handshake(bool is_resumed, bool is_offloaded);
+
+    uint64_t get_num_of_handshakes() const { return m_num_of_handshakes; }
+    uint64_t get_num_of_resumed_sessions() const { return m_num_of_resumed_sessions; }
+    uint64_t get_num_of_offloaded_sessions() const { return m_num_of_offloaded_sessions; }
+
+    /**
+     * The error queue of OpenSSL (of the calling thread) as a single line, the queue is cleared.
+     */
+    static std::string get_last_error();
+
+protected:
+    ssl_ctx_st* m_context;
+    bool m_is_ktls_enabled;
+
+    std::atomic<uint64_t> m_num_of_handshakes;
+    std::atomic<uint64_t> m_num_of_resumed_sessions;
+    std::atomic<uint64_t> m_num_of_offloaded_sessions;
+};
+
+}
+
+#endif // MCT_MODETLS_TLSCONTEXT_HPP
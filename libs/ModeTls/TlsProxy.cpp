@@ -0,0 +1,337 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTls/TlsProxy.cpp
+ *
+ * @desc TlsProxy is a session which terminates the TLS of its client and sends the plain data to the backend.
+ */
+
+#include <cerrno>
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include <boost/asio/write.hpp>
+
+#include <Logger/Logger.hpp>
+#include <ModeProxy/SessionSlab.hpp>
+#include <ModeTls/TlsProxy.hpp>
+#include <ModeTls/TlsContext.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+// BIO_get_ktls_send and BIO_get_ktls_recv come with OpenSSL 3.0, records are never encrypted by the kernel before
+bool is_kernel_sending(SSL* ssl)
+{
+#if defined(BIO_get_ktls_send)
+	return BIO_get_ktls_send(SSL_get_wbio(ssl)) != 0;
+#else
+	(void)ssl;
+	return false;
+#endif
+}
+
+bool is_kernel_receiving(SSL* ssl)
+{
+#if defined(BIO_get_ktls_recv)
+	return BIO_get_ktls_recv(SSL_get_rbio(ssl)) != 0;
+#else
+	(void)ssl;
+	return false;
+#endif
+}
+
+}
+
+TlsProxy::TlsProxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, const std::shared_ptr<TlsContext>& context)
+ : Proxy(logger, ios, route), m_context(context), m_ssl(nullptr), m_outbound_offset(0), m_outbound_length(0), m_is_offloaded(false)
+{
+}
+
+TlsProxy::~TlsProxy()
+{
+	if (m_ssl) {
+		// the socket belongs to the session, SSL_set_fd does not close it
+		SSL_free(m_ssl);
+	}
+}
+
+ListenerOptions::session_factory_type TlsProxy::create_factory(const std::shared_ptr<TlsContext>& context)
+{
+	return [context](Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route) -> std::shared_ptr<Proxy> {
+		return std::allocate_shared<TlsProxy>(SessionAllocator<TlsProxy>(ios), logger, ios, route, context);
+	};
+}
+
+void TlsProxy::connect_remote()
+{
+	m_log.debug("Accepted TLS client %s:%u with listener %s:%u, starting the handshake.", get_client_host().c_str(), get_client_port(), m_route->listen_host.c_str(), m_route->listen_port);
+
+	m_ssl = SSL_new(m_context->get_native());
+	if (!m_ssl) {
+		m_log.error("Cannot create the TLS session of client %s:%u, because: %s", get_client_host().c_str(), get_client_port(), TlsContext::get_last_error().c_str());
+		close();
+		return;
+	}
+
+	// OpenSSL reads and writes the socket itself, it must not block the io_service
+	boost::system::error_code error;
+	m_client_socket.non_blocking(true, error);
+
+	if (error || SSL_set_fd(m_ssl, static_cast<int>(m_client_socket.native_handle())) != 1) {
+		m_log.error("Cannot attach the TLS session to client %s:%u.", get_client_host().c_str(), get_client_port());
+		ERR_clear_error();
+		close();
+		return;
+	}
+
+	accept_client();
+}
+
+void TlsProxy::accept_client()
+{
+	const int result = SSL_accept(m_ssl);
+
+	if (result == 1) {
+		m_is_offloaded = is_kernel_sending(m_ssl) && is_kernel_receiving(m_ssl);
+
+		const bool is_resumed = (SSL_session_reused(m_ssl) == 1);
+		m_context->count_handshake(is_resumed, m_is_offloaded);
+
+		m_log.info("Client %s:%u finished a %s%s handshake (%s), the records are encrypted %s.", get_client_host().c_str(), get_client_port(),
+			is_resumed ? "resumed " : "", SSL_get_version(m_ssl), SSL_get_cipher_name(m_ssl),
+			m_is_offloaded ? "by the kernel" : (is_kernel_sending(m_ssl) ? "by the kernel when sent and in user space when received" : "in user space"));
+
+		Proxy::connect_remote();
+		return;
+	}
+
+	if (!wait_for_client(result, &TlsProxy::handle_client_ready_for_accept)) {
+		m_log.warning("TLS handshake with client %s:%u failed: %s", get_client_host().c_str(), get_client_port(), TlsContext::get_last_error().c_str());
+		close();
+	}
+}
+
+void TlsProxy::handle_client_ready_for_accept(const boost::system::error_code& error)
+{
+	if (error) {
+		if (error != boost::asio::error::operation_aborted) {
+			m_log.warning("TLS handshake with client %s:%u failed, because: %s", get_client_host().c_str(), get_client_port(), error.message().c_str());
+			close();
+		}
+		return;
+	}
+
+	accept_client();
+}
+
+void TlsProxy::start_pumps()
+{
+	if (m_is_offloaded) {
+		// the client socket carries plain data now
+		Proxy::start_pumps();
+		return;
+	}
+
+	m_remote_socket.async_read_some(
+		boost::asio::buffer(m_remote_data, m_max_data_length),
+		std::bind(&TlsProxy::handle_remote_data_read, std::static_pointer_cast<TlsProxy>(shared_from_this()), std::placeholders::_1, std::placeholders::_2)
+	);
+
+	read_client();
+}
+
+void TlsProxy::read_client()
+{
+	errno = 0;
+	const int result = SSL_read(m_ssl, m_client_data, m_max_data_length);
+
+	if (result > 0) {
+		process_client_data(result);
+
+		boost::asio::async_write(
+			m_remote_socket, boost::asio::buffer(m_client_data, result),
+			std::bind(&TlsProxy::handle_remote_data_write, std::static_pointer_cast<TlsProxy>(shared_from_this()), std::placeholders::_1)
+		);
+		return;
+	}
+
+	const int ssl_error = SSL_get_error(m_ssl, result);
+
+	// close_notify, or (OpenSSL 1.1.1) a bare FIN
+	if (ssl_error == SSL_ERROR_ZERO_RETURN || (ssl_error == SSL_ERROR_SYSCALL && errno == 0 && ERR_peek_error() == 0)) {
+		handle_client_eof();
+		return;
+	}
+
+	if (!wait_for_client(result, &TlsProxy::handle_client_ready_for_read)) {
+		m_log.warning("Client %s:%u cannot read data from client endpoint, because: %s", get_client_host().c_str(), get_client_port(), TlsContext::get_last_error().c_str());
+		close();
+	}
+}
+
+void TlsProxy::handle_client_ready_for_read(const boost::system::error_code& error)
+{
+	if (error) {
+		if (error != boost::asio::error::operation_aborted) {
+			Proxy::handle_client_read_error(error);
+		}
+		return;
+	}
+
+	read_client();
+}
+
+void TlsProxy::handle_remote_data_write(const boost::system::error_code& error)
+{
+	if (error) {
+		handle_remote_write_error(error);
+		return;
+	}
+
+	read_client();
+}
+
+void TlsProxy::handle_remote_data_read(const boost::system::error_code& error, size_t bytes_transferred)
+{
+	if (error) {
+		handle_remote_read_error(error);
+		return;
+	}
+
+	process_remote_data(bytes_transferred);
+
+	m_outbound_offset = 0;
+	m_outbound_length = static_cast<uint16_t>(bytes_transferred);
+	write_client();
+}
+
+void TlsProxy::write_client()
+{
+	// without SSL_MODE_ENABLE_PARTIAL_WRITE a successful SSL_write takes everything, a failed one is repeated with the same arguments
+	while (m_outbound_offset < m_outbound_length) {
+		const int result = SSL_write(m_ssl, m_remote_data + m_outbound_offset, m_outbound_length - m_outbound_offset);
+
+		if (result <= 0) {
+			if (!wait_for_client(result, &TlsProxy::handle_client_ready_for_write)) {
+				m_log.warning("Client %s:%u cannot write data to client endpoint, because: %s", get_client_host().c_str(), get_client_port(), TlsContext::get_last_error().c_str());
+				close();
+			}
+			return;
+		}
+
+		m_outbound_offset += static_cast<uint16_t>(result);
+	}
+
+	m_remote_socket.async_read_some(
+		boost::asio::buffer(m_remote_data, m_max_data_length),
+		std::bind(&TlsProxy::handle_remote_data_read, std::static_pointer_cast<TlsProxy>(shared_from_this()), std::placeholders::_1, std::placeholders::_2)
+	);
+}
+
+void TlsProxy::handle_client_ready_for_write(const boost::system::error_code& error)
+{
+	if (error) {
+		if (error != boost::asio::error::operation_aborted) {
+			handle_client_write_error(error);
+		}
+		return;
+	}
+
+	write_client();
+}
+
+bool TlsProxy::wait_for_client(int result, ready_handler_type handler)
+{
+	const int ssl_error = SSL_get_error(m_ssl, result);
+
+	if (ssl_error == SSL_ERROR_WANT_READ) {
+		m_client_socket.async_read_some(boost::asio::null_buffers(), std::bind(handler, std::static_pointer_cast<TlsProxy>(shared_from_this()), std::placeholders::_1));
+		return true;
+	}
+
+	if (ssl_error == SSL_ERROR_WANT_WRITE) {
+		m_client_socket.async_write_some(boost::asio::null_buffers(), std::bind(handler, std::static_pointer_cast<TlsProxy>(shared_from_this()), std::placeholders::_1));
+		return true;
+	}
+
+	return false;
+}
+
+void TlsProxy::handle_client_read_error(const boost::system::error_code& error)
+{
+	// kTLS refuses to read a record which is not application data (close_notify, a key update) into a plain buffer,
+	// OpenSSL reads it with the record type
+	if (m_is_offloaded && error == boost::system::errc::io_error) {
+		const int result = SSL_read(m_ssl, m_client_data, m_max_data_length);
+
+		if (result > 0) {
+			handle_client_read(boost::system::error_code(), result);
+			return;
+		}
+
+		const int ssl_error = SSL_get_error(m_ssl, result);
+
+		if (ssl_error == SSL_ERROR_ZERO_RETURN) {
+			handle_client_eof();
+			return;
+		}
+
+		if (ssl_error == SSL_ERROR_WANT_READ) {
+			m_client_socket.async_read_some(
+				boost::asio::buffer(m_client_data, m_max_data_length),
+				std::bind(&TlsProxy::handle_client_read, std::static_pointer_cast<TlsProxy>(shared_from_this()), std::placeholders::_1, std::placeholders::_2)
+			);
+			return;
+		}
+
+		ERR_clear_error();
+	}
+
+	Proxy::handle_client_read_error(error);
+}
+
+void TlsProxy::handle_remote_eof()
+{
+	send_close_notify();
+	Proxy::handle_remote_eof();
+}
+
+void TlsProxy::send_close_notify()
+{
+	if (!m_ssl || !m_client_socket.is_open()) {
+		return;
+	}
+
+	// best effort, the FIN follows anyway
+	if (SSL_shutdown(m_ssl) < 0) {
+		ERR_clear_error();
+	}
+}
+
+}
@@ -0,0 +1,108 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTls/TlsProxy.hpp
+ *
+ * @desc TlsProxy is a session which terminates the TLS of its client and sends the plain data to the backend.
+ */
+
+#ifndef MCT_MODETLS_TLSPROXY_HPP
+#define MCT_MODETLS_TLSPROXY_HPP
+
+#include <memory>
+
+#include <ModeProxy/Proxy.hpp>
+#include <ModeProxy/ProxyRoute.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeTls/Config.hpp>
+
+struct ssl_st;
+
+namespace mct
+{
+
+class TlsContext;
+
+/**
+ * The handshake is made on the client socket before the backend is connected. If OpenSSL moved the record
+ * crypto of both directions to the kernel (kTLS), the client socket carries plain data and the session moves it
+ * exactly like Proxy does. Otherwise the client side goes through SSL_read and SSL_write, which still use the
+ * kernel for the direction it took over.
+ */
+class MCT_MODETLS_DLL_PUBLIC TlsProxy : public Proxy
+{
+public:
+    TlsProxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, const std::shared_ptr<TlsContext>& context);
+    virtual ~TlsProxy();
+
+    /**
+     * Session factory for ListenerOptions, so ProxyListener starts TlsProxy sessions.
+     */
+    static ListenerOptions::session_factory_type create_factory(const std::shared_ptr<TlsContext>& context);
+
+    bool is_offloaded() const { return m_is_offloaded; }
+
+protected:
+    typedef void (TlsProxy::*ready_handler_type)(const boost::system::error_code&);
+
+    void connect_remote() override;
+    void start_pumps() override;
+    void handle_client_read_error(const boost::system::error_code& error) override;
+    void handle_remote_eof() override;
+
+    void accept_client();
+    void handle_client_ready_for_accept(const boost::system::error_code& error);
+
+    // user-space TLS on the client side, the remote side is read and written like in Proxy
+    void read_client();
+    void handle_client_ready_for_read(const boost::system::error_code& error);
+    void handle_remote_data_write(const boost::system::error_code& error);
+    void handle_remote_data_read(const boost::system::error_code& error, size_t bytes_transferred);
+    void write_client();
+    void handle_client_ready_for_write(const boost::system::error_code& error);
+
+    /**
+     * Waits for the client socket if the failed OpenSSL call (which returned result) wants to read or write,
+     * calls handler once the socket is ready. Returns false on any other error.
+     */
+    bool wait_for_client(int result, ready_handler_type handler);
+
+    /**
+     * Sends close_notify, which is what a TLS client expects instead of a bare FIN.
+     */
+    void send_close_notify();
+
+protected:
+    std::shared_ptr<TlsContext> m_context;
+    ssl_st* m_ssl;
+
+    // remote data in m_remote_data which SSL_write has not taken yet
+    uint16_t m_outbound_offset;
+    uint16_t m_outbound_length;
+    bool m_is_offloaded;
+};
+
+}
+
+#endif // MCT_MODETLS_TLSPROXY_HPP
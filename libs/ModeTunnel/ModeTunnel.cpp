@@ -0,0 +1,101 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/ModeTunnel.cpp
+ *
+ * @desc ModeTunnel is the common part of the tunnel_edge and tunnel_core program runtime modes.
+ */
+
+#include <set>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+
+#include <ModeProxy/StreamEndpoint.hpp>
+#include <ModeTunnel/ModeTunnel.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+const uint32_t min_window = 1024;
+// the ring of every stream is allocated in one piece
+const uint32_t max_window = 64 * 1024 * 1024;
+
+}
+
+ModeTunnel::ModeTunnel(Configuration& config, Logger& logger) : Mode(config, logger)
+{
+}
+
+ModeTunnel::~ModeTunnel()
+{
+}
+
+bool ModeTunnel::validate_configuration(std::vector<TunnelService>& services, TunnelCodec::Type& codec) const
+{
+    std::set<std::string> names;
+
+    for (auto&& entry : m_config.get_mode_tunnel_services()) {
+        TunnelService service;
+
+        if (!TunnelService::parse(entry, service) || !names.insert(service.name).second) {
+            m_log.fatal("Invalid or repeated 'mode_tunnel_services' entry '%s', expected name=host:port (e.g. db=10.0.0.1:5432).", entry.c_str());
+            return false;
+        }
+
+        services.push_back(service);
+    }
+
+    if (services.empty()) {
+        m_log.fatal("There are no 'mode_tunnel_services', the tunnel would not carry anything.");
+        return false;
+    }
+
+    if (m_config.get_mode_tunnel_peer_port() == 0 && !StreamEndpoint::is_local(m_config.get_mode_tunnel_peer_host())) {
+        m_log.fatal("'mode_tunnel_peer_port' cannot be 0.");
+        return false;
+    }
+
+    if (m_config.get_mode_tunnel_window() < min_window || m_config.get_mode_tunnel_window() > max_window) {
+        m_log.fatal("'mode_tunnel_window' is %u, while it has to be between %u and %u bytes.", m_config.get_mode_tunnel_window(), min_window, max_window);
+        return false;
+    }
+
+    if (!TunnelCodec::parse(m_config.get_mode_tunnel_compression(), codec)) {
+        m_log.fatal("Unknown 'mode_tunnel_compression' '%s', expected none, lz4 or zstd.", m_config.get_mode_tunnel_compression().c_str());
+        return false;
+    }
+
+    if (!TunnelCodec::is_supported(codec)) {
+        m_log.fatal("'mode_tunnel_compression' is %s, but mct was built without it.", TunnelCodec::get_name(codec));
+        return false;
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,69 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/ModeTunnel.hpp
+ *
+ * @desc ModeTunnel is the common part of the tunnel_edge and tunnel_core program runtime modes.
+ */
+
+#ifndef MCT_MODETUNNEL_MODETUNNEL_HPP
+#define MCT_MODETUNNEL_MODETUNNEL_HPP
+
+#include <vector>
+
+#include <Mode/Mode.hpp>
+#include <ModeTunnel/TunnelService.hpp>
+#include <ModeTunnel/TunnelCodec.hpp>
+#include <ModeTunnel/Config.hpp>
+
+namespace mct
+{
+
+class Configuration;
+class Logger;
+
+/**
+ * Many client connections carried over a few long-lived connections between two instances - the edge accepts
+ * the clients of every service and opens a stream for each of them, the core forwards the streams to the backends
+ * of the services. Both ends read the same mode.tunnel.* options.
+ */
+class MCT_MODETUNNEL_DLL_PUBLIC ModeTunnel : public Mode
+{
+public:
+    ModeTunnel(Configuration& config, Logger& logger);
+    virtual ~ModeTunnel();
+
+    ModeTunnel(const ModeTunnel&) = delete;
+    ModeTunnel& operator=(const ModeTunnel&) = delete;
+
+protected:
+    /**
+     * Checks the options shared by both ends, parses the services and the codec of the data this end sends.
+     */
+    bool validate_configuration(std::vector<TunnelService>& services, TunnelCodec::Type& codec) const;
+};
+
+}
+
+#endif // MCT_MODETUNNEL_MODETUNNEL_HPP
@@ -0,0 +1,109 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/ModeTunnelCore.cpp
+ *
+ * @desc ModeTunnelCore class which is one of the possible program runtime modes.
+ */
+
+#include <memory>
+#include <sstream>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+
+#include <boost/asio/io_service.hpp>
+
+#include <ModeProxy/IPResolver.hpp>
+#include <ModeProxy/ProxyRoute.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeTunnel/TunnelListener.hpp>
+#include <ModeTunnel/ModeTunnelCore.hpp>
+
+namespace mct
+{
+
+ModeTunnelCore::ModeTunnelCore(Configuration& config, Logger& logger) : ModeTunnel(config, logger)
+{
+}
+
+ModeTunnelCore::~ModeTunnelCore()
+{
+}
+
+const std::string& ModeTunnelCore::get_name() const
+{
+    static std::string tunnel_core_name("tunnel_core");
+    return tunnel_core_name;
+}
+
+bool ModeTunnelCore::run()
+{
+    m_log.log_if_not_silent("Initialized mode '%s'.", get_name().c_str());
+
+    std::vector<TunnelService> services;
+    TunnelCodec::Type codec = TunnelCodec::none;
+    if (!validate_configuration(services, codec)) {
+        return false;
+    }
+
+    // provides the core I/O functionality (OS calls etc.)
+    boost::asio::io_service ios;
+
+    std::shared_ptr<TunnelListener> listener;
+    {
+        IPResolver ip_resolver(m_log, ios);
+
+        const std::string listen_host = ip_resolver.resolve_only_first_ip(m_config.get_mode_tunnel_peer_host());
+        const uint16_t listen_port = m_config.get_mode_tunnel_peer_port();
+
+        // backends are resolved once, every stream of a service shares its route
+        TunnelListener::services_type routes;
+        for (auto&& service : services) {
+            routes[service.name] = std::make_shared<ProxyRoute>(listen_host, listen_port, ip_resolver.resolve_only_first_ip(service.host), service.port, ListenerOptions());
+        }
+
+        try {
+            listener = std::make_shared<TunnelListener>(ios, m_log, listen_host, listen_port, m_config.get_mode_tunnel_window(), routes, codec);
+        } catch (const boost::system::system_error& e) {
+            std::stringstream sStr;
+            sStr << "Cannot start tunnel_core listener using given address and port: (" << m_config.get_mode_tunnel_peer_host() << ") " << listen_host << ":" << listen_port << std::endl;
+            sStr << "Error code: " << e.code().value() << std::endl;
+            sStr << "System message: " << e.what() << std::endl;
+            throw std::runtime_error(sStr.str());
+        }
+
+        listener->async_listen();
+        m_log.info("Forwarding %u services to their backends.", static_cast<unsigned>(routes.size()));
+    }
+
+    // gives control away to Boost.Asio to asynchronously handle connections
+    ios.run();
+
+    m_log.flush();
+
+    return true;
+}
+
+}
@@ -0,0 +1,129 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/ModeTunnelEdge.cpp
+ *
+ * @desc ModeTunnelEdge class which is one of the possible program runtime modes.
+ */
+
+#include <memory>
+#include <sstream>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+
+#include <boost/asio/io_service.hpp>
+
+#include <ModeProxy/IPResolver.hpp>
+#include <ModeProxy/ProxyManager.hpp>
+#include <ModeProxy/ProxyListener.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeTunnel/TunnelPool.hpp>
+#include <ModeTunnel/TunnelProxy.hpp>
+#include <ModeTunnel/ModeTunnelEdge.hpp>
+
+namespace mct
+{
+
+ModeTunnelEdge::ModeTunnelEdge(Configuration& config, Logger& logger) : ModeTunnel(config, logger)
+{
+}
+
+ModeTunnelEdge::~ModeTunnelEdge()
+{
+}
+
+const std::string& ModeTunnelEdge::get_name() const
+{
+    static std::string tunnel_edge_name("tunnel_edge");
+    return tunnel_edge_name;
+}
+
+bool ModeTunnelEdge::run()
+{
+    m_log.log_if_not_silent("Initialized mode '%s'.", get_name().c_str());
+
+    std::vector<TunnelService> services;
+    TunnelCodec::Type codec = TunnelCodec::none;
+    if (!validate_configuration(services, codec)) {
+        return false;
+    }
+
+    if (m_config.get_mode_tunnel_connections() == 0) {
+        m_log.fatal("'mode_tunnel_connections' cannot be 0, there has to be a connection to the core to carry the streams.");
+        return false;
+    }
+
+    for (auto&& service : services) {
+        if (service.port != 0 && service.port <= 1023) {
+            m_log.warning("Service '%s' listens on port %d which is a 'well-known port' (its value is <= 1023). It means that the program might need additional privileges to run correctly.",
+                service.name.c_str(), service.port);
+        }
+    }
+
+    // provides the core I/O functionality (OS calls etc.)
+    boost::asio::io_service ios;
+
+    std::shared_ptr<TunnelPool> pool;
+    ProxyManager manager(m_log);
+    {
+        IPResolver ip_resolver(m_log, ios);
+
+        pool = std::make_shared<TunnelPool>(m_log, ios, ip_resolver.resolve_only_first_ip(m_config.get_mode_tunnel_peer_host()), m_config.get_mode_tunnel_peer_port(),
+            m_config.get_mode_tunnel_connections(), m_config.get_mode_tunnel_window(), codec);
+        pool->start();
+
+        for (auto&& service : services) {
+            auto settings = std::make_shared<TunnelEdgeSettings>();
+            settings->pool = pool;
+            settings->service = service.name;
+
+            ListenerOptions options;
+            options.session_factory = TunnelProxy::create_factory(settings);
+
+            std::string local_ip = ip_resolver.resolve_only_first_ip(service.host);
+
+            try {
+                // the backend is chosen by the core, the remote endpoint of the listener is not used
+                manager.add_listener(std::make_shared<ProxyListener>(ios, m_log, local_ip, service.port, "0.0.0.0", 0, options));
+            } catch (const boost::system::system_error& e) {
+                std::stringstream sStr;
+                sStr << "Cannot start tunnel_edge listener of service '" << service.name << "' using given address and port: (" << service.host << ") " << local_ip << ":" << service.port << std::endl;
+                sStr << "Error code: " << e.code().value() << std::endl;
+                sStr << "System message: " << e.what() << std::endl;
+                throw std::runtime_error(sStr.str());
+            }
+        }
+    }
+
+    // gives control away to Boost.Asio to asynchronously handle connections
+    ios.run();
+
+    manager.log_statistics();
+    m_log.flush();
+
+    return true;
+}
+
+}
@@ -0,0 +1,312 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelCodec.cpp
+ *
+ * @desc TunnelCodec compresses the data frames of a tunnel connection with lz4 or zstd.
+ */
+
+#include <cstring>
+
+#ifdef MCT_WITH_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef MCT_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <ModeTunnel/TunnelCodec.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+#ifdef MCT_WITH_LZ4
+
+static_assert(TunnelCodec::max_compressed_length >= LZ4_COMPRESSBOUND(TunnelCodec::max_block_length), "lz4 blocks may not fit into a frame");
+
+class Lz4Compressor : public TunnelCompressor
+{
+public:
+    Lz4Compressor() : m_stream(LZ4_createStream()), m_ring(new unsigned char[ring_size]), m_offset(0) {}
+    ~Lz4Compressor() { LZ4_freeStream(m_stream); }
+
+    TunnelCodec::Type get_codec() const override { return TunnelCodec::lz4; }
+
+    void reset() override
+    {
+        LZ4_resetStream_fast(m_stream);
+        m_offset = 0;
+    }
+
+    size_t compress(const unsigned char* data, size_t length, unsigned char* output) override
+    {
+        if (length > TunnelCodec::max_block_length) {
+            return 0;
+        }
+
+        // lz4 refers to the last 64 KB of the stream where it has compressed them, so the data is kept in a ring first
+        if (m_offset + length > ring_size) {
+            m_offset = 0;
+        }
+
+        unsigned char* source = m_ring.get() + m_offset;
+        std::memcpy(source, data, length);
+        m_offset += length;
+
+        const int compressed_length = LZ4_compress_fast_continue(m_stream, reinterpret_cast<const char*>(source), reinterpret_cast<char*>(output),
+            static_cast<int>(length), TunnelCodec::max_compressed_length, 1);
+        return compressed_length > 0 ? static_cast<size_t>(compressed_length) : 0;
+    }
+
+private:
+    enum { ring_size = 64 * 1024 + TunnelCodec::max_block_length };
+
+    LZ4_stream_t* m_stream;
+    std::unique_ptr<unsigned char[]> m_ring;
+    size_t m_offset;
+};
+
+class Lz4Decompressor : public TunnelDecompressor
+{
+public:
+    Lz4Decompressor()
+    : m_stream(LZ4_createStreamDecode()), m_ring_size(LZ4_decoderRingBufferSize(TunnelCodec::max_block_length)), m_ring(new unsigned char[m_ring_size]), m_offset(0)
+    {
+    }
+
+    ~Lz4Decompressor() { LZ4_freeStreamDecode(m_stream); }
+
+    TunnelCodec::Type get_codec() const override { return TunnelCodec::lz4; }
+
+    void reset() override
+    {
+        LZ4_setStreamDecode(m_stream, nullptr, 0);
+        m_offset = 0;
+    }
+
+    bool decompress(const unsigned char* block, size_t length, const unsigned char*& data, size_t& data_length) override
+    {
+        // the ring is large enough to decode blocks independently of where the peer put them into its own ring
+        if (m_ring_size - m_offset < TunnelCodec::max_block_length) {
+            m_offset = 0;
+        }
+
+        unsigned char* destination = m_ring.get() + m_offset;
+        const int decompressed_length = LZ4_decompress_safe_continue(m_stream, reinterpret_cast<const char*>(block), reinterpret_cast<char*>(destination),
+            static_cast<int>(length), TunnelCodec::max_block_length);
+
+        if (decompressed_length < 0) {
+            return false;
+        }
+
+        m_offset += static_cast<size_t>(decompressed_length);
+        data = destination;
+        data_length = static_cast<size_t>(decompressed_length);
+        return true;
+    }
+
+private:
+    LZ4_streamDecode_t* m_stream;
+    const size_t m_ring_size;
+    std::unique_ptr<unsigned char[]> m_ring;
+    size_t m_offset;
+};
+
+#endif
+
+#ifdef MCT_WITH_ZSTD
+
+static_assert(TunnelCodec::max_compressed_length >= ZSTD_COMPRESSBOUND(TunnelCodec::max_block_length) + 32, "zstd blocks may not fit into a frame");
+
+/**
+ * A window of 128 KB keeps both contexts of a connection well below a megabyte, while it still covers many frames
+ * of a chatty text protocol. Both ends use the same value, the decompressor refuses streams with larger windows.
+ */
+const int zstd_window_log = 17;
+const int zstd_compression_level = 3;
+
+class ZstdCompressor : public TunnelCompressor
+{
+public:
+    ZstdCompressor() : m_context(ZSTD_createCCtx())
+    {
+        ZSTD_CCtx_setParameter(m_context, ZSTD_c_compressionLevel, zstd_compression_level);
+        ZSTD_CCtx_setParameter(m_context, ZSTD_c_windowLog, zstd_window_log);
+    }
+
+    ~ZstdCompressor() { ZSTD_freeCCtx(m_context); }
+
+    TunnelCodec::Type get_codec() const override { return TunnelCodec::zstd; }
+
+    // the parameters stay
+    void reset() override { ZSTD_CCtx_reset(m_context, ZSTD_reset_session_only); }
+
+    size_t compress(const unsigned char* data, size_t length, unsigned char* output) override
+    {
+        if (length > TunnelCodec::max_block_length) {
+            return 0;
+        }
+
+        ZSTD_inBuffer input_buffer = { data, length, 0 };
+        ZSTD_outBuffer output_buffer = { output, TunnelCodec::max_compressed_length, 0 };
+
+        // flushing ends the block, so the peer can decompress all of it right away
+        size_t remaining = 0;
+        do {
+            remaining = ZSTD_compressStream2(m_context, &output_buffer, &input_buffer, ZSTD_e_flush);
+            if (ZSTD_isError(remaining)) {
+                return 0;
+            }
+        } while (remaining != 0 && output_buffer.pos < output_buffer.size);
+
+        return remaining == 0 ? output_buffer.pos : 0;
+    }
+
+private:
+    ZSTD_CCtx* m_context;
+};
+
+class ZstdDecompressor : public TunnelDecompressor
+{
+public:
+    ZstdDecompressor() : m_context(ZSTD_createDCtx()), m_output(new unsigned char[TunnelCodec::max_block_length + 1])
+    {
+        ZSTD_DCtx_setParameter(m_context, ZSTD_d_windowLogMax, zstd_window_log);
+    }
+
+    ~ZstdDecompressor() { ZSTD_freeDCtx(m_context); }
+
+    TunnelCodec::Type get_codec() const override { return TunnelCodec::zstd; }
+
+    void reset() override { ZSTD_DCtx_reset(m_context, ZSTD_reset_session_only); }
+
+    bool decompress(const unsigned char* block, size_t length, const unsigned char*& data, size_t& data_length) override
+    {
+        ZSTD_inBuffer input_buffer = { block, length, 0 };
+        // one byte more than a block may hold reveals the blocks which are too long
+        ZSTD_outBuffer output_buffer = { m_output.get(), TunnelCodec::max_block_length + 1, 0 };
+
+        while (input_buffer.pos < input_buffer.size) {
+            const size_t result = ZSTD_decompressStream(m_context, &output_buffer, &input_buffer);
+            if (ZSTD_isError(result) || output_buffer.pos == output_buffer.size) {
+                return false;
+            }
+        }
+
+        data = m_output.get();
+        data_length = output_buffer.pos;
+        return true;
+    }
+
+private:
+    ZSTD_DCtx* m_context;
+    std::unique_ptr<unsigned char[]> m_output;
+};
+
+#endif
+
+}
+
+bool TunnelCodec::parse(const std::string& name, Type& codec)
+{
+    if (name == "none") {
+        codec = none;
+    } else if (name == "lz4") {
+        codec = lz4;
+    } else if (name == "zstd") {
+        codec = zstd;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+const char* TunnelCodec::get_name(Type codec)
+{
+    switch (codec) {
+    case lz4:
+        return "lz4";
+    case zstd:
+        return "zstd";
+    default:
+        return "none";
+    }
+}
+
+bool TunnelCodec::is_supported(Type codec)
+{
+    switch (codec) {
+    case none:
+        return true;
+#ifdef MCT_WITH_LZ4
+    case lz4:
+        return true;
+#endif
+#ifdef MCT_WITH_ZSTD
+    case zstd:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+std::unique_ptr<TunnelCompressor> TunnelCompressor::create(TunnelCodec::Type codec)
+{
+    switch (codec) {
+#ifdef MCT_WITH_LZ4
+    case TunnelCodec::lz4:
+        return std::unique_ptr<TunnelCompressor>(new Lz4Compressor());
+#endif
+#ifdef MCT_WITH_ZSTD
+    case TunnelCodec::zstd:
+        return std::unique_ptr<TunnelCompressor>(new ZstdCompressor());
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+std::unique_ptr<TunnelDecompressor> TunnelDecompressor::create(TunnelCodec::Type codec)
+{
+    switch (codec) {
+#ifdef MCT_WITH_LZ4
+    case TunnelCodec::lz4:
+        return std::unique_ptr<TunnelDecompressor>(new Lz4Decompressor());
+#endif
+#ifdef MCT_WITH_ZSTD
+    case TunnelCodec::zstd:
+        return std::unique_ptr<TunnelDecompressor>(new ZstdDecompressor());
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+}
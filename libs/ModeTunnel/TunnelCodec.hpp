@@ -0,0 +1,117 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelCodec.hpp
+ *
+ * @desc TunnelCodec compresses the data frames of a tunnel connection with lz4 or zstd.
+ */
+
+#ifndef MCT_MODETUNNEL_TUNNELCODEC_HPP
+#define MCT_MODETUNNEL_TUNNELCODEC_HPP
+
+#include <memory>
+#include <string>
+#include <cstddef>
+
+#include <ModeTunnel/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * Both codecs are optional dependencies, mct built without one of them refuses to use it (see is_supported).
+ */
+class MCT_MODETUNNEL_DLL_PUBLIC TunnelCodec
+{
+public:
+    // sent in the hello frame
+    enum Type
+    {
+        none = 0,
+        lz4 = 1,
+        zstd = 2
+    };
+
+    /**
+     * A compressed data frame never holds more than max_block_length bytes of the stream, which take at most
+     * max_compressed_length bytes after any of the codecs.
+     */
+    enum { max_block_length = 16384, max_compressed_length = max_block_length + max_block_length / 64 + 256 };
+
+    // shorter data is sent as it is, it would hardly shrink and it tells nothing about the data which follows
+    enum { min_block_length = 64 };
+
+    // none, lz4 or zstd
+    static bool parse(const std::string& name, Type& codec);
+    static const char* get_name(Type codec);
+
+    static bool is_supported(Type codec);
+};
+
+/**
+ * Compresses the data frames of one connection as a single stream, so every block can refer to the data of the
+ * blocks before it - even those of other streams of the connection. The peer decompresses the blocks in the same order.
+ */
+class MCT_MODETUNNEL_DLL_PUBLIC TunnelCompressor
+{
+public:
+    virtual ~TunnelCompressor() {}
+
+    // returns nullptr if the codec is not supported
+    static std::unique_ptr<TunnelCompressor> create(TunnelCodec::Type codec);
+
+    virtual TunnelCodec::Type get_codec() const = 0;
+
+    // forgets the stream, so the compressor can serve another connection
+    virtual void reset() = 0;
+
+    /**
+     * Compresses length (at most max_block_length) bytes of data into output, which holds max_compressed_length bytes.
+     * Returns the length of the block or 0 if the compressor failed, which leaves the stream broken.
+     */
+    virtual size_t compress(const unsigned char* data, size_t length, unsigned char* output) = 0;
+};
+
+class MCT_MODETUNNEL_DLL_PUBLIC TunnelDecompressor
+{
+public:
+    virtual ~TunnelDecompressor() {}
+
+    // returns nullptr if the codec is not supported
+    static std::unique_ptr<TunnelDecompressor> create(TunnelCodec::Type codec);
+
+    virtual TunnelCodec::Type get_codec() const = 0;
+
+    virtual void reset() = 0;
+
+    /**
+     * Decompresses the next block of the stream. The data stays valid until the next call. Returns false if the block
+     * is corrupt or holds more than max_block_length bytes.
+     */
+    virtual bool decompress(const unsigned char* block, size_t length, const unsigned char*& data, size_t& data_length) = 0;
+};
+
+}
+
+#endif // MCT_MODETUNNEL_TUNNELCODEC_HPP
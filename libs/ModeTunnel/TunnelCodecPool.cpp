@@ -0,0 +1,114 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelCodecPool.cpp
+ *
+ * @desc TunnelCodecPool keeps the compression contexts of the closed tunnel connections for the next ones.
+ */
+
+#include <ModeTunnel/TunnelCodecPool.hpp>
+
+namespace mct
+{
+
+TunnelCodecPool::TunnelCodecPool(TunnelCodec::Type codec) : m_codec(codec)
+{
+}
+
+std::unique_ptr<TunnelCompressor> TunnelCodecPool::acquire_compressor()
+{
+    if (m_codec == TunnelCodec::none) {
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_compressors.empty()) {
+            std::unique_ptr<TunnelCompressor> compressor = std::move(m_compressors.back());
+            m_compressors.pop_back();
+            return compressor;
+        }
+    }
+
+    return TunnelCompressor::create(m_codec);
+}
+
+std::unique_ptr<TunnelDecompressor> TunnelCodecPool::acquire_decompressor(TunnelCodec::Type codec)
+{
+    if (codec == TunnelCodec::none) {
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // peers may compress with any codec, not only with the one of this end
+        for (auto it = m_decompressors.begin(); it != m_decompressors.end(); ++it) {
+            if ((*it)->get_codec() == codec) {
+                std::unique_ptr<TunnelDecompressor> decompressor = std::move(*it);
+                m_decompressors.erase(it);
+                return decompressor;
+            }
+        }
+    }
+
+    return TunnelDecompressor::create(codec);
+}
+
+void TunnelCodecPool::release(std::unique_ptr<TunnelCompressor> compressor)
+{
+    if (!compressor) {
+        return;
+    }
+
+    compressor->reset();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_compressors.size() < max_idle_contexts) {
+        m_compressors.push_back(std::move(compressor));
+    }
+}
+
+void TunnelCodecPool::release(std::unique_ptr<TunnelDecompressor> decompressor)
+{
+    if (!decompressor) {
+        return;
+    }
+
+    decompressor->reset();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_decompressors.size() < max_idle_contexts) {
+        m_decompressors.push_back(std::move(decompressor));
+    }
+}
+
+size_t TunnelCodecPool::get_num_of_idle_contexts() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_compressors.size() + m_decompressors.size();
+}
+
+}
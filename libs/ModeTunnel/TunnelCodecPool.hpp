@@ -0,0 +1,80 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelCodecPool.hpp
+ *
+ * @desc TunnelCodecPool keeps the compression contexts of the closed tunnel connections for the next ones.
+ */
+
+#ifndef MCT_MODETUNNEL_TUNNELCODECPOOL_HPP
+#define MCT_MODETUNNEL_TUNNELCODECPOOL_HPP
+
+#include <mutex>
+#include <memory>
+#include <vector>
+
+#include <ModeTunnel/Config.hpp>
+#include <ModeTunnel/TunnelCodec.hpp>
+
+namespace mct
+{
+
+/**
+ * Contexts of lz4 and especially zstd are expensive to set up, so the connections of a listener or a pool share
+ * them - a connection takes one when it starts and gives it back when it closes. Streams never own one.
+ */
+class MCT_MODETUNNEL_DLL_PUBLIC TunnelCodecPool
+{
+public:
+    // codec compresses the data frames this end sends
+    explicit TunnelCodecPool(TunnelCodec::Type codec);
+
+    TunnelCodecPool(const TunnelCodecPool&) = delete;
+    TunnelCodecPool& operator=(const TunnelCodecPool&) = delete;
+
+    TunnelCodec::Type get_codec() const { return m_codec; }
+
+    // nullptr if the codec is none or not supported
+    std::unique_ptr<TunnelCompressor> acquire_compressor();
+    std::unique_ptr<TunnelDecompressor> acquire_decompressor(TunnelCodec::Type codec);
+
+    void release(std::unique_ptr<TunnelCompressor> compressor);
+    void release(std::unique_ptr<TunnelDecompressor> decompressor);
+
+    size_t get_num_of_idle_contexts() const;
+
+protected:
+    // more are only kept around after a burst of reconnects
+    enum { max_idle_contexts = 8 };
+
+    const TunnelCodec::Type m_codec;
+
+    mutable std::mutex m_mutex;
+    std::vector< std::unique_ptr<TunnelCompressor> > m_compressors;
+    std::vector< std::unique_ptr<TunnelDecompressor> > m_decompressors;
+};
+
+}
+
+#endif // MCT_MODETUNNEL_TUNNELCODECPOOL_HPP
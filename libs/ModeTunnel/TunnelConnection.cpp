@@ -0,0 +1,422 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelConnection.cpp
+ *
+ * @desc TunnelConnection is one long-lived connection between an edge and a core which carries many streams.
+ */
+
+#include <cstring>
+#include <sstream>
+
+#include <boost/asio/write.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <Logger/Logger.hpp>
+#include <ModeTunnel/TunnelProxy.hpp>
+#include <ModeTunnel/TunnelConnection.hpp>
+
+namespace mct
+{
+
+TunnelConnection::TunnelConnection(Logger& logger, boost::asio::io_service& ios, uint32_t window, const std::shared_ptr<TunnelCodecPool>& codecs)
+ : m_log(logger), m_ios(ios), m_socket(m_ios), m_window(window), m_peer_window(0), m_last_stream_id(0), m_is_writing(false),
+   m_read_buffer(new unsigned char[read_buffer_size]), m_read_length(0), m_codecs(codecs), m_compression_input_bytes(0),
+   m_compression_output_bytes(0), m_uncompressed_bytes(0)
+{
+}
+
+TunnelConnection::~TunnelConnection()
+{
+	release_codecs();
+	m_log.debug("Releasing tunnel connection %s.", m_peer_name.c_str());
+}
+
+void TunnelConnection::start()
+{
+	boost::system::error_code error;
+	const StreamEndpoint::endpoint_type peer_endpoint = m_socket.remote_endpoint(error);
+
+	std::stringstream name;
+	if (!error && StreamEndpoint::is_ip(peer_endpoint)) {
+		name << StreamEndpoint::to_ip(peer_endpoint);
+	} else {
+		name << "(local)";
+	}
+	m_peer_name = name.str();
+
+	// frames are already batched by write_frames, Nagle would only delay them
+	m_socket.set_option(boost::asio::ip::tcp::no_delay(true), error);
+
+	m_compressor = m_codecs->acquire_compressor();
+	if (m_compressor) {
+		m_compressed_data.reset(new unsigned char[max_data_frames_per_write * TunnelCodec::max_compressed_length]);
+	}
+
+	// peers which do not compress leave the codec out
+	unsigned char hello[TunnelFrame::hello_payload_length + 1];
+	hello[0] = TunnelFrame::protocol_version;
+	TunnelFrame::write_uint32(m_window, hello + 1);
+	hello[TunnelFrame::hello_payload_length] = static_cast<unsigned char>(m_codecs->get_codec());
+	send_control(TunnelFrame::hello, 0, hello, m_compressor ? sizeof(hello) : static_cast<size_t>(TunnelFrame::hello_payload_length));
+
+	read_frames();
+}
+
+void TunnelConnection::close()
+{
+	if (!m_socket.is_open()) {
+		return;
+	}
+
+	m_log.warning("Closing tunnel connection %s carrying %u streams.", m_peer_name.c_str(), static_cast<unsigned>(m_streams.size()));
+
+	if (m_compressor) {
+		m_log.info("Tunnel connection %s compressed %llu bytes to %llu bytes and sent %llu bytes as they were.", m_peer_name.c_str(),
+			static_cast<unsigned long long>(m_compression_input_bytes), static_cast<unsigned long long>(m_compression_output_bytes),
+			static_cast<unsigned long long>(m_uncompressed_bytes));
+	}
+
+	boost::system::error_code ignored;
+	m_socket.close(ignored);
+	release_codecs();
+
+	std::unordered_map< uint32_t, std::shared_ptr<TunnelProxy> > streams;
+	streams.swap(m_streams);
+	m_ready.clear();
+
+	for (auto& stream : streams) {
+		stream.second->handle_peer_reset();
+	}
+
+	close_handler_type close_handler;
+	close_handler.swap(m_close_handler);
+	if (close_handler) {
+		close_handler();
+	}
+}
+
+uint32_t TunnelConnection::open_stream(const std::shared_ptr<TunnelProxy>& stream, const std::string& service)
+{
+	const uint32_t stream_id = ++m_last_stream_id;
+	m_streams[stream_id] = stream;
+
+	send_control(TunnelFrame::open, stream_id, reinterpret_cast<const unsigned char*>(service.data()), static_cast<uint16_t>(service.size()));
+	return stream_id;
+}
+
+void TunnelConnection::send_data(const std::shared_ptr<TunnelProxy>& stream)
+{
+	m_ready.push_back(stream);
+	write_frames();
+}
+
+void TunnelConnection::send_window(uint32_t stream_id, uint32_t increment)
+{
+	unsigned char payload[TunnelFrame::window_payload_length];
+	TunnelFrame::write_uint32(increment, payload);
+	send_control(TunnelFrame::window, stream_id, payload, sizeof(payload));
+}
+
+void TunnelConnection::send_close(uint32_t stream_id)
+{
+	send_control(TunnelFrame::close, stream_id, nullptr, 0);
+}
+
+void TunnelConnection::remove_stream(uint32_t stream_id, bool send_reset)
+{
+	if (m_streams.erase(stream_id) > 0 && send_reset) {
+		send_control(TunnelFrame::reset, stream_id, nullptr, 0);
+	}
+}
+
+void TunnelConnection::send_control(TunnelFrame::Type type, uint32_t stream_id, const unsigned char* payload, uint16_t length)
+{
+	if (!m_socket.is_open()) {
+		return;
+	}
+
+	const size_t offset = m_control.size();
+	m_control.resize(offset + TunnelFrame::header_length + length);
+	TunnelFrame::write_header(type, stream_id, length, &m_control[offset]);
+	if (length > 0) {
+		std::memcpy(&m_control[offset + TunnelFrame::header_length], payload, length);
+	}
+
+	write_frames();
+}
+
+void TunnelConnection::write_frames()
+{
+	if (m_is_writing || !m_socket.is_open()) {
+		return;
+	}
+
+	m_write_buffers.clear();
+
+	// whatever queued up while the previous write was in progress goes out in this one
+	m_writing_control.clear();
+	m_writing_control.swap(m_control);
+	if (!m_writing_control.empty()) {
+		m_write_buffers.push_back(boost::asio::buffer(m_writing_control));
+	}
+
+	// a stream has at most one data frame at a time, so taking the front ones serves all of them in turns
+	while (!m_ready.empty() && m_writing_streams.size() < max_data_frames_per_write) {
+		std::shared_ptr<TunnelProxy> stream = std::move(m_ready.front());
+		m_ready.pop_front();
+
+		// reset since it was queued
+		if (m_streams.find(stream->get_stream_id()) == m_streams.end()) {
+			continue;
+		}
+
+		const size_t slot = m_writing_streams.size();
+		const unsigned char* data = stream->get_outbound_data();
+		size_t length = stream->get_outbound_length();
+		uint8_t flags = 0;
+
+		if (m_compressor && length >= TunnelCodec::min_block_length && length <= TunnelCodec::max_block_length && stream->take_compression_turn()) {
+			unsigned char* compressed_data = m_compressed_data.get() + slot * TunnelCodec::max_compressed_length;
+			const size_t compressed_length = m_compressor->compress(data, length, compressed_data);
+
+			// the peer could not decompress anything after a lost block
+			if (compressed_length == 0) {
+				m_log.error("Cannot compress the data of tunnel connection %s with %s.", m_peer_name.c_str(), TunnelCodec::get_name(m_compressor->get_codec()));
+				m_ready.push_front(std::move(stream));
+				m_ios.post(std::bind(&TunnelConnection::close, shared_from_this()));
+				break;
+			}
+
+			stream->handle_compression_sample(length, compressed_length);
+			m_compression_input_bytes += length;
+			m_compression_output_bytes += compressed_length;
+
+			data = compressed_data;
+			length = compressed_length;
+			flags = TunnelFrame::compressed;
+		} else {
+			m_uncompressed_bytes += length;
+		}
+
+		unsigned char* header = m_data_headers[slot];
+		TunnelFrame::write_header(TunnelFrame::data, stream->get_stream_id(), static_cast<uint16_t>(length), header, flags);
+
+		m_write_buffers.push_back(boost::asio::buffer(header, TunnelFrame::header_length));
+		m_write_buffers.push_back(boost::asio::buffer(data, length));
+		m_writing_streams.push_back(std::move(stream));
+	}
+
+	if (m_write_buffers.empty()) {
+		return;
+	}
+
+	m_is_writing = true;
+	boost::asio::async_write(m_socket, m_write_buffers, std::bind(&TunnelConnection::handle_write, shared_from_this(), std::placeholders::_1));
+}
+
+void TunnelConnection::handle_write(const boost::system::error_code& error)
+{
+	m_is_writing = false;
+
+	if (error) {
+		if (error != boost::asio::error::operation_aborted) {
+			m_log.warning("Cannot write to tunnel connection %s, because: %s", m_peer_name.c_str(), error.message().c_str());
+		}
+		close();
+		return;
+	}
+
+	// the streams may queue new frames right away, which start the next write
+	m_sent_streams.swap(m_writing_streams);
+	for (auto& stream : m_sent_streams) {
+		stream->handle_outbound_sent();
+	}
+	m_sent_streams.clear();
+
+	write_frames();
+}
+
+void TunnelConnection::read_frames()
+{
+	m_socket.async_read_some(
+		boost::asio::buffer(m_read_buffer.get() + m_read_length, read_buffer_size - m_read_length),
+		std::bind(&TunnelConnection::handle_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2)
+	);
+}
+
+void TunnelConnection::handle_read(const boost::system::error_code& error, size_t bytes_transferred)
+{
+	if (error) {
+		if (error == boost::asio::error::eof) {
+			m_log.info("Tunnel connection %s was closed by the peer.", m_peer_name.c_str());
+		} else if (error != boost::asio::error::operation_aborted) {
+			m_log.warning("Cannot read from tunnel connection %s, because: %s", m_peer_name.c_str(), error.message().c_str());
+		}
+		close();
+		return;
+	}
+
+	m_read_length += bytes_transferred;
+
+	const unsigned char* data = m_read_buffer.get();
+	size_t offset = 0;
+	TunnelFrameHeader header;
+
+	while (TunnelFrame::parse_header(data + offset, m_read_length - offset, header) &&
+		m_read_length - offset >= static_cast<size_t>(TunnelFrame::header_length) + header.length) {
+		if (!process_frame(header, data + offset + TunnelFrame::header_length)) {
+			m_log.error("Tunnel connection %s broke the protocol with a frame of type %u for stream %u.", m_peer_name.c_str(),
+				static_cast<unsigned>(header.type), header.stream_id);
+			close();
+			return;
+		}
+
+		if (!m_socket.is_open()) {
+			return;
+		}
+
+		offset += TunnelFrame::header_length + header.length;
+	}
+
+	m_read_length -= offset;
+	std::memmove(m_read_buffer.get(), data + offset, m_read_length);
+
+	read_frames();
+}
+
+bool TunnelConnection::process_frame(const TunnelFrameHeader& header, const unsigned char* payload)
+{
+	switch (header.type) {
+	case TunnelFrame::hello:
+		if (header.stream_id != 0 || header.length < TunnelFrame::hello_payload_length || payload[0] != TunnelFrame::protocol_version) {
+			return false;
+		}
+
+		m_peer_window = TunnelFrame::read_uint32(payload + 1);
+		m_log.info("Tunnel connection %s is up, stream window of the peer: %u bytes.", m_peer_name.c_str(), m_peer_window);
+
+		if (header.length > TunnelFrame::hello_payload_length && payload[TunnelFrame::hello_payload_length] != TunnelCodec::none) {
+			const TunnelCodec::Type codec = static_cast<TunnelCodec::Type>(payload[TunnelFrame::hello_payload_length]);
+
+			m_codecs->release(std::move(m_decompressor));
+			m_decompressor = m_codecs->acquire_decompressor(codec);
+			if (!m_decompressor) {
+				m_log.error("Tunnel connection %s compresses its data with codec %u, which is not supported.", m_peer_name.c_str(), static_cast<unsigned>(codec));
+				return false;
+			}
+
+			m_log.info("Tunnel connection %s compresses its data with %s.", m_peer_name.c_str(), TunnelCodec::get_name(codec));
+		}
+
+		return m_peer_window != 0;
+
+	case TunnelFrame::open:
+	{
+		// only the core accepts streams, their ids grow
+		if (!is_ready() || !m_open_handler || header.stream_id <= m_last_stream_id) {
+			return false;
+		}
+
+		m_last_stream_id = header.stream_id;
+
+		const std::string service(reinterpret_cast<const char*>(payload), header.length);
+		std::shared_ptr<TunnelProxy> stream = m_open_handler(shared_from_this(), header.stream_id, service);
+
+		if (!stream) {
+			send_control(TunnelFrame::reset, header.stream_id, nullptr, 0);
+			return true;
+		}
+
+		m_streams[header.stream_id] = stream;
+		stream->connect_backend();
+		return true;
+	}
+
+	case TunnelFrame::data:
+	{
+		const unsigned char* data = payload;
+		size_t length = header.length;
+
+		// blocks of the streams which are gone are decompressed as well, the next blocks may refer to them
+		if ((header.flags & TunnelFrame::compressed) && (!m_decompressor || !m_decompressor->decompress(payload, header.length, data, length))) {
+			return false;
+		}
+
+		// frames sent before the peer learnt about a reset are dropped
+		std::shared_ptr<TunnelProxy> stream = find_stream(header.stream_id);
+		return !stream || stream->push_inbound(data, length);
+	}
+
+	case TunnelFrame::window:
+	{
+		if (header.length < TunnelFrame::window_payload_length) {
+			return false;
+		}
+
+		std::shared_ptr<TunnelProxy> stream = find_stream(header.stream_id);
+		if (stream) {
+			stream->add_send_window(TunnelFrame::read_uint32(payload));
+		}
+		return true;
+	}
+
+	case TunnelFrame::close:
+	{
+		std::shared_ptr<TunnelProxy> stream = find_stream(header.stream_id);
+		if (stream) {
+			stream->handle_peer_close();
+		}
+		return true;
+	}
+
+	case TunnelFrame::reset:
+	{
+		std::shared_ptr<TunnelProxy> stream = find_stream(header.stream_id);
+		if (stream) {
+			m_streams.erase(header.stream_id);
+			stream->handle_peer_reset();
+		}
+		return true;
+	}
+
+	default:
+		// frame types of later versions are skipped
+		return true;
+	}
+}
+
+std::shared_ptr<TunnelProxy> TunnelConnection::find_stream(uint32_t stream_id) const
+{
+	auto it = m_streams.find(stream_id);
+	return (it != m_streams.end()) ? it->second : std::shared_ptr<TunnelProxy>();
+}
+
+void TunnelConnection::release_codecs()
+{
+	m_codecs->release(std::move(m_compressor));
+	m_codecs->release(std::move(m_decompressor));
+}
+
+}
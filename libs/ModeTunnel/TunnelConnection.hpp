@@ -0,0 +1,192 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelConnection.hpp
+ *
+ * @desc TunnelConnection is one long-lived connection between an edge and a core which carries many streams.
+ */
+
+#ifndef MCT_MODETUNNEL_TUNNELCONNECTION_HPP
+#define MCT_MODETUNNEL_TUNNELCONNECTION_HPP
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_service.hpp>
+
+#include <ModeProxy/Proxy.hpp>
+#include <ModeTunnel/TunnelFrame.hpp>
+#include <ModeTunnel/TunnelCodecPool.hpp>
+#include <ModeTunnel/Config.hpp>
+
+namespace mct
+{
+
+class Logger;
+class TunnelProxy;
+
+/**
+ * Every stream is a TunnelProxy session. Frames are read into one buffer and the payload of a data frame is
+ * handed to its stream right away - a stream never receives more than its window, so a slow stream cannot
+ * hold up the others. Control frames go out first in every write, then at most one data frame from each of the
+ * streams waiting to send, in turns, so a busy stream cannot starve the rest of the link.
+ *
+ * With a codec the data frames of all the streams form one compressed stream per direction. Every stream samples
+ * how well its data compresses and sends it as it is for a while after a block which did not shrink (e.g. TLS).
+ */
+class MCT_MODETUNNEL_DLL_PUBLIC TunnelConnection : public std::enable_shared_from_this<TunnelConnection>
+{
+public:
+    typedef Proxy::socket_type socket_type;
+
+    // core - creates the session of a stream the edge has opened, returns nullptr if the service is unknown
+    typedef std::function<std::shared_ptr<TunnelProxy> (const std::shared_ptr<TunnelConnection>&, uint32_t, const std::string&)> open_handler_type;
+    typedef std::function<void ()> close_handler_type;
+
+    // window is the number of bytes the peer may send on every stream before this end passes them on
+    TunnelConnection(Logger& logger, boost::asio::io_service& ios, uint32_t window, const std::shared_ptr<TunnelCodecPool>& codecs);
+    ~TunnelConnection();
+
+    TunnelConnection(const TunnelConnection&) = delete;
+    TunnelConnection& operator=(const TunnelConnection&) = delete;
+
+    socket_type& get_socket() { return m_socket; }
+    const std::string& get_peer_name() const { return m_peer_name; }
+
+    void set_open_handler(const open_handler_type& handler) { m_open_handler = handler; }
+    void set_close_handler(const close_handler_type& handler) { m_close_handler = handler; }
+
+    /**
+     * Sends hello and starts reading frames, the socket has to be connected.
+     */
+    void start();
+
+    /**
+     * Closes the socket and every stream it carries.
+     */
+    void close();
+
+    bool is_open() const { return m_socket.is_open(); }
+    // the hello of the peer has arrived, so streams can be opened
+    bool is_ready() const { return m_peer_window != 0 && is_open(); }
+
+    size_t get_num_of_streams() const { return m_streams.size(); }
+    uint32_t get_window() const { return m_window; }
+    uint32_t get_peer_window() const { return m_peer_window; }
+
+    // stream bytes sent in compressed frames, the length of those frames and the stream bytes sent as they are
+    uint64_t get_compression_input_bytes() const { return m_compression_input_bytes; }
+    uint64_t get_compression_output_bytes() const { return m_compression_output_bytes; }
+    uint64_t get_uncompressed_bytes() const { return m_uncompressed_bytes; }
+
+    /**
+     * Edge - opens a stream to the given service of the core, returns its id.
+     */
+    uint32_t open_stream(const std::shared_ptr<TunnelProxy>& stream, const std::string& service);
+
+    /**
+     * Queues the outbound data of the stream (TunnelProxy::get_outbound_data), TunnelProxy::handle_outbound_sent is called once it is written.
+     */
+    void send_data(const std::shared_ptr<TunnelProxy>& stream);
+    void send_window(uint32_t stream_id, uint32_t increment);
+    void send_close(uint32_t stream_id);
+
+    /**
+     * Forgets the stream. send_reset tells the peer to drop its end as well, which is not needed once both ends have sent close.
+     */
+    void remove_stream(uint32_t stream_id, bool send_reset);
+
+protected:
+    void send_control(TunnelFrame::Type type, uint32_t stream_id, const unsigned char* payload, uint16_t length);
+
+    void write_frames();
+    void handle_write(const boost::system::error_code& error);
+
+    void read_frames();
+    void handle_read(const boost::system::error_code& error, size_t bytes_transferred);
+
+    /**
+     * Returns false if the peer broke the protocol.
+     */
+    bool process_frame(const TunnelFrameHeader& header, const unsigned char* payload);
+
+    std::shared_ptr<TunnelProxy> find_stream(uint32_t stream_id) const;
+
+    // gives the contexts back to the pool
+    void release_codecs();
+
+protected:
+    enum { max_data_frames_per_write = 16 };
+    // two of the longest frames, so a partial frame at the end of the buffer never has to wait for space
+    enum { read_buffer_size = 2 * (TunnelFrame::header_length + TunnelFrame::max_payload_length) };
+
+    Logger& m_log;
+    boost::asio::io_service& m_ios;
+
+    socket_type m_socket;
+    std::string m_peer_name;
+
+    const uint32_t m_window;
+    uint32_t m_peer_window;
+    uint32_t m_last_stream_id;
+
+    std::unordered_map< uint32_t, std::shared_ptr<TunnelProxy> > m_streams;
+
+    // control frames waiting for the next write and the ones being written
+    std::vector<unsigned char> m_control;
+    std::vector<unsigned char> m_writing_control;
+
+    // streams with a data frame to send, served in turns
+    std::deque< std::shared_ptr<TunnelProxy> > m_ready;
+    std::vector< std::shared_ptr<TunnelProxy> > m_writing_streams;
+    std::vector< std::shared_ptr<TunnelProxy> > m_sent_streams;
+    unsigned char m_data_headers[max_data_frames_per_write][TunnelFrame::header_length];
+    std::vector<boost::asio::const_buffer> m_write_buffers;
+    bool m_is_writing;
+
+    std::unique_ptr<unsigned char[]> m_read_buffer;
+    size_t m_read_length;
+
+    std::shared_ptr<TunnelCodecPool> m_codecs;
+    std::unique_ptr<TunnelCompressor> m_compressor;
+    std::unique_ptr<TunnelDecompressor> m_decompressor;
+    // compressed data frames of the write in progress, max_compressed_length bytes for each
+    std::unique_ptr<unsigned char[]> m_compressed_data;
+    uint64_t m_compression_input_bytes;
+    uint64_t m_compression_output_bytes;
+    uint64_t m_uncompressed_bytes;
+
+    open_handler_type m_open_handler;
+    close_handler_type m_close_handler;
+};
+
+}
+
+#endif // MCT_MODETUNNEL_TUNNELCONNECTION_HPP
@@ -0,0 +1,70 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelFrame.cpp
+ *
+ * @desc TunnelFrame writes and parses the frames which carry many streams over one connection between an edge and a core.
+ */
+
+#include <ModeTunnel/TunnelFrame.hpp>
+
+namespace mct
+{
+
+void TunnelFrame::write_header(Type type, uint32_t stream_id, uint16_t length, unsigned char* buffer, uint8_t flags)
+{
+    buffer[0] = static_cast<unsigned char>(type);
+    buffer[1] = flags;
+    buffer[2] = static_cast<unsigned char>(length >> 8);
+    buffer[3] = static_cast<unsigned char>(length);
+    write_uint32(stream_id, buffer + 4);
+}
+
+bool TunnelFrame::parse_header(const unsigned char* data, size_t length, TunnelFrameHeader& header)
+{
+    if (length < header_length) {
+        return false;
+    }
+
+    header.type = data[0];
+    header.flags = data[1];
+    header.length = static_cast<uint16_t>((data[2] << 8) | data[3]);
+    header.stream_id = read_uint32(data + 4);
+    return true;
+}
+
+void TunnelFrame::write_uint32(uint32_t value, unsigned char* buffer)
+{
+    buffer[0] = static_cast<unsigned char>(value >> 24);
+    buffer[1] = static_cast<unsigned char>(value >> 16);
+    buffer[2] = static_cast<unsigned char>(value >> 8);
+    buffer[3] = static_cast<unsigned char>(value);
+}
+
+uint32_t TunnelFrame::read_uint32(const unsigned char* buffer)
+{
+    return (static_cast<uint32_t>(buffer[0]) << 24) | (static_cast<uint32_t>(buffer[1]) << 16) | (static_cast<uint32_t>(buffer[2]) << 8) | buffer[3];
+}
+
+}
@@ -0,0 +1,101 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelFrame.hpp
+ *
+ * @desc TunnelFrame writes and parses the frames which carry many streams over one connection between an edge and a core.
+ */
+
+#ifndef MCT_MODETUNNEL_TUNNELFRAME_HPP
+#define MCT_MODETUNNEL_TUNNELFRAME_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <ModeTunnel/Config.hpp>
+
+namespace mct
+{
+
+struct TunnelFrameHeader
+{
+    TunnelFrameHeader() : type(0), flags(0), length(0), stream_id(0) {}
+
+    uint8_t type;
+    uint8_t flags;
+    // number of bytes of the payload, which follows the header
+    uint16_t length;
+    uint32_t stream_id;
+};
+
+/**
+ * Every frame is an 8 byte header - type, flags, payload length (16 bits) and stream id (32 bits), both
+ * big-endian - followed by the payload:
+ *
+ *   hello  (stream 0)  protocol version (8 bits), the receive window of every stream of the sender (32 bits) and
+ *                      optionally the codec (8 bits, see TunnelCodec) of the compressed data frames of the sender
+ *   open               name of the service the stream is forwarded to, sent by the edge
+ *   data               bytes of the stream, never more than the receiver allowed with its window; with the compressed
+ *                      flag the next block of the compressed stream of the connection, which holds at most
+ *                      TunnelCodec::max_block_length bytes of the stream
+ *   window             number of bytes (32 bits) the receiver has passed on, the sender may send that much more
+ *   close              the sender will not send any more data, the opposite direction keeps going
+ *   reset              the stream is gone in both directions
+ */
+class MCT_MODETUNNEL_DLL_PUBLIC TunnelFrame
+{
+public:
+    enum Type
+    {
+        hello = 1,
+        open = 2,
+        data = 3,
+        window = 4,
+        close = 5,
+        reset = 6
+    };
+
+    enum Flags
+    {
+        compressed = 0x01
+    };
+
+    enum { header_length = 8, max_payload_length = 65535, hello_payload_length = 5, window_payload_length = 4 };
+
+    enum { protocol_version = 1 };
+
+    static void write_header(Type type, uint32_t stream_id, uint16_t length, unsigned char* buffer, uint8_t flags = 0);
+
+    /**
+     * Returns false if data[0, length) does not hold a whole header yet.
+     */
+    static bool parse_header(const unsigned char* data, size_t length, TunnelFrameHeader& header);
+
+    static void write_uint32(uint32_t value, unsigned char* buffer);
+    static uint32_t read_uint32(const unsigned char* buffer);
+};
+
+}
+
+#endif // MCT_MODETUNNEL_TUNNELFRAME_HPP
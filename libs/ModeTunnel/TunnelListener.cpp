@@ -0,0 +1,135 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelListener.cpp
+ *
+ * @desc TunnelListener accepts the connections of edges on the core and forwards their streams to the backends of the services.
+ */
+
+#include <cstdio>
+#include <algorithm>
+
+#include <Logger/Logger.hpp>
+#include <ModeProxy/ProxyRoute.hpp>
+#include <ModeProxy/SessionSlab.hpp>
+#include <ModeProxy/StreamEndpoint.hpp>
+#include <ModeTunnel/TunnelProxy.hpp>
+#include <ModeTunnel/TunnelListener.hpp>
+#include <ModeTunnel/TunnelConnection.hpp>
+
+namespace mct
+{
+
+TunnelListener::TunnelListener(boost::asio::io_service& ios, Logger& logger, const std::string& listen_host, uint16_t listen_port, uint32_t window,
+	const services_type& services, TunnelCodec::Type codec)
+ : m_ios(ios), m_log(logger), m_listen_host(listen_host), m_listen_port(listen_port), m_window(window), m_services(services),
+   m_codecs(std::make_shared<TunnelCodecPool>(codec)), m_acceptor(m_ios)
+{
+	const StreamEndpoint::endpoint_type endpoint = StreamEndpoint::make(listen_host, listen_port);
+
+	m_acceptor.open(endpoint.protocol());
+	if (StreamEndpoint::is_ip(endpoint)) {
+		m_acceptor.set_option(boost::asio::socket_base::reuse_address(true));
+	} else if (!StreamEndpoint::get_path(listen_host).empty()) {
+		std::remove(StreamEndpoint::get_path(listen_host).c_str());
+	}
+	m_acceptor.bind(endpoint);
+	m_acceptor.listen();
+
+	m_log.debug("Creating tunnel listener %s:%u with %u services.", m_listen_host.c_str(), m_listen_port, static_cast<unsigned>(m_services.size()));
+}
+
+TunnelListener::~TunnelListener()
+{
+	m_log.info("Releasing tunnel listener %s:%u.", m_listen_host.c_str(), m_listen_port);
+}
+
+void TunnelListener::async_listen()
+{
+	auto connection = std::make_shared<TunnelConnection>(m_log, m_ios, m_window, m_codecs);
+
+	m_acceptor.async_accept(connection->get_socket(),
+		std::bind(&TunnelListener::handle_accept, shared_from_this(), connection, std::placeholders::_1));
+}
+
+void TunnelListener::stop()
+{
+	boost::system::error_code ignored;
+	m_acceptor.close(ignored);
+
+	for (auto& connection : m_connections) {
+		if (auto open_connection = connection.lock()) {
+			open_connection->close();
+		}
+	}
+	m_connections.clear();
+}
+
+size_t TunnelListener::get_num_of_connections()
+{
+	return std::count_if(m_connections.begin(), m_connections.end(), [](const std::weak_ptr<TunnelConnection>& connection) {
+		auto open_connection = connection.lock();
+		return open_connection && open_connection->is_open();
+	});
+}
+
+void TunnelListener::handle_accept(const std::shared_ptr<TunnelConnection>& connection, const boost::system::error_code& error)
+{
+	if (error) {
+		if (error != boost::asio::error::operation_aborted) {
+			m_log.error("Tunnel listener %s:%u cannot accept a connection, because: %s", m_listen_host.c_str(), m_listen_port, error.message().c_str());
+			async_listen();
+		}
+		return;
+	}
+
+	m_connections.erase(std::remove_if(m_connections.begin(), m_connections.end(), [](const std::weak_ptr<TunnelConnection>& connection) {
+		return connection.expired();
+	}), m_connections.end());
+
+	std::weak_ptr<TunnelListener> listener = shared_from_this();
+	connection->set_open_handler([listener](const std::shared_ptr<TunnelConnection>& connection, uint32_t stream_id, const std::string& service) {
+		auto self = listener.lock();
+		return self ? self->open_stream(connection, stream_id, service) : std::shared_ptr<TunnelProxy>();
+	});
+
+	connection->start();
+	m_log.warning("Accepted tunnel connection %s with listener %s:%u.", connection->get_peer_name().c_str(), m_listen_host.c_str(), m_listen_port);
+
+	m_connections.push_back(connection);
+	async_listen();
+}
+
+std::shared_ptr<TunnelProxy> TunnelListener::open_stream(const std::shared_ptr<TunnelConnection>& connection, uint32_t stream_id, const std::string& service)
+{
+	auto it = m_services.find(service);
+	if (it == m_services.end()) {
+		m_log.warning("Tunnel connection %s asked for unknown service '%s', resetting stream %u.", connection->get_peer_name().c_str(), service.c_str(), stream_id);
+		return std::shared_ptr<TunnelProxy>();
+	}
+
+	return std::allocate_shared<TunnelProxy>(SessionAllocator<TunnelProxy>(m_ios), m_log, m_ios, it->second, connection, stream_id);
+}
+
+}
@@ -0,0 +1,103 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelListener.hpp
+ *
+ * @desc TunnelListener accepts the connections of edges on the core and forwards their streams to the backends of the services.
+ */
+
+#ifndef MCT_MODETUNNEL_TUNNELLISTENER_HPP
+#define MCT_MODETUNNEL_TUNNELLISTENER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/basic_socket_acceptor.hpp>
+#include <boost/asio/generic/stream_protocol.hpp>
+
+#include <ModeTunnel/Config.hpp>
+#include <ModeTunnel/TunnelCodec.hpp>
+
+namespace mct
+{
+
+class Logger;
+class TunnelProxy;
+class TunnelConnection;
+class TunnelCodecPool;
+struct ProxyRoute;
+
+class MCT_MODETUNNEL_DLL_PUBLIC TunnelListener : public std::enable_shared_from_this<TunnelListener>
+{
+public:
+    typedef std::unordered_map< std::string, std::shared_ptr<const ProxyRoute> > services_type;
+
+    /**
+     * listen_host is an IP address or a Unix domain socket name (see StreamEndpoint). services maps the names the edges
+     * ask for to the routes of their backends, window is the stream window of every accepted connection and codec
+     * compresses the data the core sends.
+     */
+    TunnelListener(boost::asio::io_service& ios, Logger& logger, const std::string& listen_host, uint16_t listen_port, uint32_t window, const services_type& services,
+        TunnelCodec::Type codec = TunnelCodec::none);
+    ~TunnelListener();
+
+    TunnelListener(const TunnelListener&) = delete;
+    TunnelListener& operator=(const TunnelListener&) = delete;
+
+    void async_listen();
+
+    /**
+     * Closes the acceptor and all the connections of edges.
+     */
+    void stop();
+
+    size_t get_num_of_connections();
+
+protected:
+    void handle_accept(const std::shared_ptr<TunnelConnection>& connection, const boost::system::error_code& error);
+
+    std::shared_ptr<TunnelProxy> open_stream(const std::shared_ptr<TunnelConnection>& connection, uint32_t stream_id, const std::string& service);
+
+protected:
+    boost::asio::io_service& m_ios;
+    Logger& m_log;
+
+    const std::string m_listen_host;
+    const uint16_t m_listen_port;
+    const uint32_t m_window;
+    const services_type m_services;
+    const std::shared_ptr<TunnelCodecPool> m_codecs;
+
+    boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol> m_acceptor;
+    // the connections keep themselves alive while they are open
+    std::vector< std::weak_ptr<TunnelConnection> > m_connections;
+};
+
+}
+
+#endif // MCT_MODETUNNEL_TUNNELLISTENER_HPP
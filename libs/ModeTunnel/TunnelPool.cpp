@@ -0,0 +1,172 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelPool.cpp
+ *
+ * @desc TunnelPool keeps the connections of an edge to its core up.
+ */
+
+#include <sstream>
+
+#include <Logger/Logger.hpp>
+#include <ModeTunnel/TunnelPool.hpp>
+#include <ModeTunnel/TunnelConnection.hpp>
+
+namespace mct
+{
+
+namespace
+{
+
+std::string make_name(const std::string& host, uint16_t port)
+{
+    std::stringstream name;
+    name << host;
+    if (!StreamEndpoint::is_local(host)) {
+        name << ":" << port;
+    }
+    return name.str();
+}
+
+}
+
+TunnelPool::TunnelPool(Logger& logger, boost::asio::io_service& ios, const std::string& core_host, uint16_t core_port, uint16_t num_of_connections, uint32_t window,
+    TunnelCodec::Type codec)
+ : m_log(logger), m_ios(ios), m_core_endpoint(StreamEndpoint::make(core_host, core_port)), m_core_name(make_name(core_host, core_port)), m_window(window),
+   m_codecs(std::make_shared<TunnelCodecPool>(codec)), m_is_stopped(false), m_connections(num_of_connections)
+{
+    for (uint16_t slot = 0; slot < num_of_connections; ++slot) {
+        m_reconnect_timers.emplace_back(new boost::asio::deadline_timer(m_ios));
+    }
+}
+
+TunnelPool::~TunnelPool()
+{
+}
+
+void TunnelPool::start()
+{
+    m_log.info("Connecting %u tunnel connections to core %s.", static_cast<unsigned>(m_connections.size()), m_core_name.c_str());
+
+    for (size_t slot = 0; slot < m_connections.size(); ++slot) {
+        connect(slot);
+    }
+}
+
+void TunnelPool::stop()
+{
+    m_is_stopped = true;
+
+    for (size_t slot = 0; slot < m_connections.size(); ++slot) {
+        boost::system::error_code ignored;
+        m_reconnect_timers[slot]->cancel(ignored);
+
+        if (m_connections[slot]) {
+            m_connections[slot]->close();
+        }
+    }
+}
+
+std::shared_ptr<TunnelConnection> TunnelPool::select_connection() const
+{
+    std::shared_ptr<TunnelConnection> selected;
+
+    for (auto& connection : m_connections) {
+        if (connection && connection->is_ready() && (!selected || connection->get_num_of_streams() < selected->get_num_of_streams())) {
+            selected = connection;
+        }
+    }
+
+    return selected;
+}
+
+size_t TunnelPool::get_num_of_ready_connections() const
+{
+    size_t num_of_ready = 0;
+
+    for (auto& connection : m_connections) {
+        if (connection && connection->is_ready()) {
+            ++num_of_ready;
+        }
+    }
+
+    return num_of_ready;
+}
+
+void TunnelPool::connect(size_t slot)
+{
+    if (m_is_stopped) {
+        return;
+    }
+
+    auto connection = std::make_shared<TunnelConnection>(m_log, m_ios, m_window, m_codecs);
+    m_connections[slot] = connection;
+
+    std::weak_ptr<TunnelPool> pool = shared_from_this();
+    connection->get_socket().async_connect(m_core_endpoint, [pool, slot](const boost::system::error_code& error) {
+        if (auto self = pool.lock()) {
+            self->handle_connect(slot, error);
+        }
+    });
+}
+
+void TunnelPool::handle_connect(size_t slot, const boost::system::error_code& error)
+{
+    if (m_is_stopped) {
+        return;
+    }
+
+    if (error) {
+        m_log.warning("Cannot connect tunnel connection %u to core %s, because: %s", static_cast<unsigned>(slot), m_core_name.c_str(), error.message().c_str());
+        reconnect_later(slot);
+        return;
+    }
+
+    std::weak_ptr<TunnelPool> pool = shared_from_this();
+    m_connections[slot]->set_close_handler([pool, slot]() {
+        if (auto self = pool.lock()) {
+            self->reconnect_later(slot);
+        }
+    });
+
+    m_connections[slot]->start();
+}
+
+void TunnelPool::reconnect_later(size_t slot)
+{
+    if (m_is_stopped) {
+        return;
+    }
+
+    std::weak_ptr<TunnelPool> pool = shared_from_this();
+    m_reconnect_timers[slot]->expires_from_now(boost::posix_time::milliseconds(static_cast<long>(reconnect_delay_ms)));
+    m_reconnect_timers[slot]->async_wait([pool, slot](const boost::system::error_code& error) {
+        auto self = pool.lock();
+        if (!error && self) {
+            self->connect(slot);
+        }
+    });
+}
+
+}
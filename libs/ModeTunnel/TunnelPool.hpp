@@ -0,0 +1,104 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelPool.hpp
+ *
+ * @desc TunnelPool keeps the connections of an edge to its core up.
+ */
+
+#ifndef MCT_MODETUNNEL_TUNNELPOOL_HPP
+#define MCT_MODETUNNEL_TUNNELPOOL_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/deadline_timer.hpp>
+
+#include <ModeProxy/StreamEndpoint.hpp>
+#include <ModeTunnel/Config.hpp>
+#include <ModeTunnel/TunnelCodec.hpp>
+
+namespace mct
+{
+
+class Logger;
+class TunnelConnection;
+class TunnelCodecPool;
+
+/**
+ * A fixed number of connections to the core, each of them reconnected a second after it fails. New streams go to
+ * the connection which carries the fewest of them.
+ */
+class MCT_MODETUNNEL_DLL_PUBLIC TunnelPool : public std::enable_shared_from_this<TunnelPool>
+{
+public:
+    // core_host is an IP address or a Unix domain socket name (see StreamEndpoint), codec compresses the data the edge sends
+    TunnelPool(Logger& logger, boost::asio::io_service& ios, const std::string& core_host, uint16_t core_port, uint16_t num_of_connections, uint32_t window,
+        TunnelCodec::Type codec = TunnelCodec::none);
+    ~TunnelPool();
+
+    TunnelPool(const TunnelPool&) = delete;
+    TunnelPool& operator=(const TunnelPool&) = delete;
+
+    void start();
+
+    /**
+     * Closes all the connections (and the streams they carry), nothing is reconnected any more.
+     */
+    void stop();
+
+    /**
+     * Returns nullptr if none of the connections is up.
+     */
+    std::shared_ptr<TunnelConnection> select_connection() const;
+
+    size_t get_num_of_ready_connections() const;
+
+protected:
+    void connect(size_t slot);
+    void handle_connect(size_t slot, const boost::system::error_code& error);
+    void reconnect_later(size_t slot);
+
+protected:
+    enum { reconnect_delay_ms = 1000 };
+
+    Logger& m_log;
+    boost::asio::io_service& m_ios;
+
+    const StreamEndpoint::endpoint_type m_core_endpoint;
+    const std::string m_core_name;
+    const uint32_t m_window;
+    const std::shared_ptr<TunnelCodecPool> m_codecs;
+    bool m_is_stopped;
+
+    std::vector< std::shared_ptr<TunnelConnection> > m_connections;
+    std::vector< std::unique_ptr<boost::asio::deadline_timer> > m_reconnect_timers;
+};
+
+}
+
+#endif // MCT_MODETUNNEL_TUNNELPOOL_HPP
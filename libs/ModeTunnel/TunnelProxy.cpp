@@ -0,0 +1,316 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelProxy.cpp
+ *
+ * @desc TunnelProxy is a session whose data crosses a TunnelConnection as one of its streams.
+ */
+
+#include <array>
+#include <cstring>
+#include <algorithm>
+
+#include <boost/asio/write.hpp>
+
+#include <Logger/Logger.hpp>
+#include <ModeProxy/ProxyRoute.hpp>
+#include <ModeProxy/SessionSlab.hpp>
+#include <ModeTunnel/TunnelPool.hpp>
+#include <ModeTunnel/TunnelProxy.hpp>
+#include <ModeTunnel/TunnelConnection.hpp>
+
+namespace mct
+{
+
+TunnelProxy::TunnelProxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, const std::shared_ptr<const TunnelEdgeSettings>& settings)
+ : Proxy(logger, ios, route), m_settings(settings), m_stream_id(0), m_window(0), m_send_window(0), m_unacknowledged(0), m_inbound_start(0), m_inbound_length(0),
+   m_outbound_length(0), m_compression_skip(0), m_compression_backoff(0), m_is_edge(true), m_is_pumping(false), m_is_read_blocked(false), m_is_writing(false), m_is_local_finished(false), m_is_peer_finished(false)
+{
+}
+
+TunnelProxy::TunnelProxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, const std::shared_ptr<TunnelConnection>& connection,
+	uint32_t stream_id)
+ : Proxy(logger, ios, route), m_connection(connection), m_stream_id(stream_id), m_window(connection->get_window()), m_send_window(connection->get_peer_window()),
+   m_unacknowledged(0), m_inbound_start(0), m_inbound_length(0), m_outbound_length(0), m_compression_skip(0), m_compression_backoff(0), m_is_edge(false), m_is_pumping(false), m_is_read_blocked(false),
+   m_is_writing(false), m_is_local_finished(false), m_is_peer_finished(false)
+{
+	// the client of a core session is the edge
+	boost::system::error_code ignored;
+	m_client_endpoint = StreamEndpoint::to_ip(connection->get_socket().remote_endpoint(ignored));
+}
+
+ListenerOptions::session_factory_type TunnelProxy::create_factory(const std::shared_ptr<const TunnelEdgeSettings>& settings)
+{
+	return [settings](Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route) -> std::shared_ptr<Proxy> {
+		return std::allocate_shared<TunnelProxy>(SessionAllocator<TunnelProxy>(ios), logger, ios, route, settings);
+	};
+}
+
+void TunnelProxy::connect_backend()
+{
+	m_has_started = true;
+	Proxy::connect_remote();
+}
+
+void TunnelProxy::connect_remote()
+{
+	m_connection = m_settings->pool->select_connection();
+	if (!m_connection) {
+		m_log.warning("There is no tunnel connection up which could carry client %s:%u to service '%s'.", get_client_host().c_str(), get_client_port(),
+			m_settings->service.c_str());
+		close();
+		return;
+	}
+
+	m_window = m_connection->get_window();
+	m_send_window = m_connection->get_peer_window();
+	m_stream_id = m_connection->open_stream(std::static_pointer_cast<TunnelProxy>(shared_from_this()), m_settings->service);
+
+	m_log.info("Accepted client %s:%u with listener %s:%u. Forwarding it to service '%s' as stream %u of tunnel connection %s.", get_client_host().c_str(),
+		get_client_port(), m_route->listen_host.c_str(), m_route->listen_port, m_settings->service.c_str(), m_stream_id, m_connection->get_peer_name().c_str());
+
+	// the core may start connecting its backend only after the open frame arrives, but the data of the client does not have to wait for it
+	start_pumps();
+}
+
+void TunnelProxy::start_pumps()
+{
+	m_is_pumping = true;
+
+	read_stream_socket();
+	write_stream_socket();
+}
+
+void TunnelProxy::close()
+{
+	if (m_connection) {
+		std::shared_ptr<TunnelConnection> connection;
+		connection.swap(m_connection);
+		connection->remove_stream(m_stream_id, true);
+	}
+
+	m_outbound_length = 0;
+	Proxy::close();
+}
+
+void TunnelProxy::read_stream_socket()
+{
+	if (m_is_local_finished || !get_stream_socket().is_open()) {
+		return;
+	}
+
+	if (m_send_window == 0) {
+		// add_send_window resumes reading
+		m_is_read_blocked = true;
+		return;
+	}
+
+	const size_t length = std::min<size_t>(m_max_data_length, m_send_window);
+	get_stream_socket().async_read_some(
+		boost::asio::buffer(m_is_edge ? m_client_data : m_remote_data, length),
+		std::bind(&TunnelProxy::handle_stream_socket_read, std::static_pointer_cast<TunnelProxy>(shared_from_this()), std::placeholders::_1, std::placeholders::_2)
+	);
+}
+
+void TunnelProxy::handle_stream_socket_read(const boost::system::error_code& error, size_t bytes_transferred)
+{
+	if (!m_connection) {
+		return;
+	}
+
+	if (error == boost::asio::error::eof) {
+		m_log.debug("[Client %s:%u] %s endpoint has finished sending, closing stream %u.", get_client_host().c_str(), get_client_port(), m_is_edge ? "Client" : "Remote",
+			m_stream_id);
+
+		m_is_local_finished = true;
+		m_connection->send_close(m_stream_id);
+		finish_if_done();
+		return;
+	}
+
+	if (error) {
+		if (m_is_edge) {
+			handle_client_read_error(error);
+		} else {
+			handle_remote_read_error(error);
+		}
+		return;
+	}
+
+	if (m_is_edge) {
+		process_client_data(bytes_transferred);
+	} else {
+		process_remote_data(bytes_transferred);
+	}
+
+	m_outbound_length = static_cast<uint16_t>(bytes_transferred);
+	m_send_window -= static_cast<uint32_t>(bytes_transferred);
+	m_connection->send_data(std::static_pointer_cast<TunnelProxy>(shared_from_this()));
+}
+
+void TunnelProxy::handle_outbound_sent()
+{
+	m_outbound_length = 0;
+	read_stream_socket();
+}
+
+bool TunnelProxy::take_compression_turn()
+{
+	if (m_compression_skip == 0) {
+		return true;
+	}
+
+	--m_compression_skip;
+	return false;
+}
+
+void TunnelProxy::handle_compression_sample(size_t length, size_t compressed_length)
+{
+	if (compressed_length * 8 <= length * 7) {
+		m_compression_backoff = 0;
+		return;
+	}
+
+	m_compression_backoff = m_compression_backoff == 0 ? static_cast<uint8_t>(min_compression_backoff) : std::min<uint8_t>(m_compression_backoff * 2, max_compression_backoff);
+	m_compression_skip = m_compression_backoff;
+}
+
+void TunnelProxy::add_send_window(uint32_t increment)
+{
+	// the peer never has more than its window outstanding, so neither can a misbehaving one make this end send more
+	const uint64_t send_window = static_cast<uint64_t>(m_send_window) + increment;
+	m_send_window = static_cast<uint32_t>(std::min<uint64_t>(send_window, m_connection ? m_connection->get_peer_window() : 0));
+
+	if (m_is_read_blocked && m_send_window > 0) {
+		m_is_read_blocked = false;
+		read_stream_socket();
+	}
+}
+
+bool TunnelProxy::push_inbound(const unsigned char* data, size_t length)
+{
+	if (m_is_peer_finished || static_cast<uint64_t>(m_inbound_length) + m_unacknowledged + length > m_window) {
+		return false;
+	}
+
+	if (!m_inbound) {
+		m_inbound.reset(new unsigned char[m_window]);
+	}
+
+	// the free part of the ring may wrap around its end
+	const uint32_t end = (m_inbound_start + m_inbound_length) % m_window;
+	const size_t first_part = std::min<size_t>(length, m_window - end);
+	std::memcpy(m_inbound.get() + end, data, first_part);
+	std::memcpy(m_inbound.get(), data + first_part, length - first_part);
+	m_inbound_length += static_cast<uint32_t>(length);
+
+	write_stream_socket();
+	return true;
+}
+
+void TunnelProxy::write_stream_socket()
+{
+	if (!m_is_pumping || m_is_writing || !get_stream_socket().is_open()) {
+		return;
+	}
+
+	if (m_inbound_length == 0) {
+		if (m_is_peer_finished) {
+			boost::system::error_code ignored;
+			get_stream_socket().shutdown(boost::asio::socket_base::shutdown_send, ignored);
+			finish_if_done();
+		}
+		return;
+	}
+
+	const size_t first_part = std::min<size_t>(m_inbound_length, m_window - m_inbound_start);
+	std::array<boost::asio::const_buffer, 2> buffers = {{
+		boost::asio::buffer(m_inbound.get() + m_inbound_start, first_part),
+		boost::asio::buffer(m_inbound.get(), m_inbound_length - first_part)
+	}};
+
+	m_is_writing = true;
+	boost::asio::async_write(get_stream_socket(), buffers,
+		std::bind(&TunnelProxy::handle_stream_socket_write, std::static_pointer_cast<TunnelProxy>(shared_from_this()), std::placeholders::_1, std::placeholders::_2));
+}
+
+void TunnelProxy::handle_stream_socket_write(const boost::system::error_code& error, size_t bytes_transferred)
+{
+	m_is_writing = false;
+
+	if (error) {
+		if (m_is_edge) {
+			handle_client_write_error(error);
+		} else {
+			handle_remote_write_error(error);
+		}
+		return;
+	}
+
+	m_inbound_start = static_cast<uint32_t>((m_inbound_start + bytes_transferred) % m_window);
+	m_inbound_length -= static_cast<uint32_t>(bytes_transferred);
+	m_unacknowledged += static_cast<uint32_t>(bytes_transferred);
+
+	// window frames are batched, a quarter of the window keeps the peer sending while the rest is on its way
+	if (m_connection && !m_is_peer_finished && m_unacknowledged >= m_window / 4) {
+		m_connection->send_window(m_stream_id, m_unacknowledged);
+		m_unacknowledged = 0;
+	}
+
+	write_stream_socket();
+}
+
+void TunnelProxy::handle_peer_close()
+{
+	m_log.debug("[Client %s:%u] Stream %u has been closed by the peer.", get_client_host().c_str(), get_client_port(), m_stream_id);
+
+	m_is_peer_finished = true;
+	write_stream_socket();
+}
+
+void TunnelProxy::handle_peer_reset()
+{
+	if (m_connection) {
+		m_log.info("[Client %s:%u] Stream %u has been reset by the peer.", get_client_host().c_str(), get_client_port(), m_stream_id);
+	}
+
+	// the connection has already forgotten the stream
+	m_connection.reset();
+	close();
+}
+
+void TunnelProxy::finish_if_done()
+{
+	if (!m_is_local_finished || !m_is_peer_finished || m_is_writing || m_inbound_length > 0 || !m_connection) {
+		return;
+	}
+
+	std::shared_ptr<TunnelConnection> connection;
+	connection.swap(m_connection);
+	connection->remove_stream(m_stream_id, false);
+
+	close();
+}
+
+}
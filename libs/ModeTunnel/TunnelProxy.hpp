@@ -0,0 +1,156 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelProxy.hpp
+ *
+ * @desc TunnelProxy is a session whose data crosses a TunnelConnection as one of its streams.
+ */
+
+#ifndef MCT_MODETUNNEL_TUNNELPROXY_HPP
+#define MCT_MODETUNNEL_TUNNELPROXY_HPP
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include <ModeProxy/Proxy.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeTunnel/Config.hpp>
+
+namespace mct
+{
+
+class TunnelPool;
+class TunnelConnection;
+
+/**
+ * Shared (read-only) by all the sessions of an edge listener.
+ */
+struct TunnelEdgeSettings
+{
+    std::shared_ptr<TunnelPool> pool;
+    // the core forwards the streams of the listener to its backend of this name
+    std::string service;
+};
+
+/**
+ * On the edge the session holds a client accepted by a ProxyListener, on the core it connects the remote socket
+ * to the backend of the service - either way the other end of the session is a stream of a TunnelConnection.
+ * Data read from the socket is sent straight from the session buffer; the data of the peer is kept in a ring of
+ * the size of the stream window (allocated with the first data), which the peer never overfills.
+ */
+class MCT_MODETUNNEL_DLL_PUBLIC TunnelProxy : public Proxy
+{
+public:
+    // edge
+    TunnelProxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, const std::shared_ptr<const TunnelEdgeSettings>& settings);
+    // core - the edge has opened stream_id on connection
+    TunnelProxy(Logger& logger, boost::asio::io_service& ios, const std::shared_ptr<const ProxyRoute>& route, const std::shared_ptr<TunnelConnection>& connection,
+        uint32_t stream_id);
+
+    /**
+     * Session factory for ListenerOptions, so the edge listeners start TunnelProxy sessions.
+     */
+    static ListenerOptions::session_factory_type create_factory(const std::shared_ptr<const TunnelEdgeSettings>& settings);
+
+    /**
+     * Core - connects to the backend and starts moving data once it is connected.
+     */
+    void connect_backend();
+
+    void close() override;
+
+    // called by TunnelConnection
+    uint32_t get_stream_id() const { return m_stream_id; }
+    const unsigned char* get_outbound_data() const { return m_is_edge ? m_client_data : m_remote_data; }
+    uint16_t get_outbound_length() const { return m_outbound_length; }
+    void handle_outbound_sent();
+
+    /**
+     * Adaptive compression - returns false while the stream sends its data as it is. A block which shrank by less
+     * than an eighth (e.g. TLS records) makes the stream skip the next blocks, twice as many after every such block
+     * in a row, before it samples again.
+     */
+    bool take_compression_turn();
+    void handle_compression_sample(size_t length, size_t compressed_length);
+
+    /**
+     * Returns false if the peer sent more than the window allows.
+     */
+    bool push_inbound(const unsigned char* data, size_t length);
+    void add_send_window(uint32_t increment);
+    void handle_peer_close();
+    void handle_peer_reset();
+
+protected:
+    // edge - opens the stream instead of connecting the remote socket
+    void connect_remote() override;
+    void start_pumps() override;
+
+    // the client socket on the edge, the remote socket on the core
+    socket_type& get_stream_socket() { return m_is_edge ? m_client_socket : m_remote_socket; }
+
+    void read_stream_socket();
+    void handle_stream_socket_read(const boost::system::error_code& error, size_t bytes_transferred);
+
+    void write_stream_socket();
+    void handle_stream_socket_write(const boost::system::error_code& error, size_t bytes_transferred);
+
+    /**
+     * Closes the session without a reset once both ends have sent close and everything has been passed on.
+     */
+    void finish_if_done();
+
+protected:
+    // number of blocks a stream sends as they are after a block which did not compress
+    enum { min_compression_backoff = 4, max_compression_backoff = 64 };
+
+    std::shared_ptr<const TunnelEdgeSettings> m_settings;
+    std::shared_ptr<TunnelConnection> m_connection;
+
+    uint32_t m_stream_id;
+    uint32_t m_window;
+    // bytes this end may still send to the peer
+    uint32_t m_send_window;
+    // bytes written to the socket which the peer has not been given back with a window frame yet
+    uint32_t m_unacknowledged;
+
+    std::unique_ptr<unsigned char[]> m_inbound;
+    uint32_t m_inbound_start;
+    uint32_t m_inbound_length;
+
+    uint16_t m_outbound_length;
+    uint8_t m_compression_skip;
+    uint8_t m_compression_backoff;
+    bool m_is_edge;
+    bool m_is_pumping;
+    bool m_is_read_blocked;
+    bool m_is_writing;
+    bool m_is_local_finished;
+    bool m_is_peer_finished;
+};
+
+}
+
+#endif // MCT_MODETUNNEL_TUNNELPROXY_HPP
@@ -0,0 +1,64 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelService.cpp
+ *
+ * @desc TunnelService is one name=host:port entry of mode.tunnel.service.
+ */
+
+#include <ModeProxy/StreamEndpoint.hpp>
+#include <ModeTunnel/TunnelService.hpp>
+
+namespace mct
+{
+
+bool TunnelService::parse(const std::string& entry, TunnelService& service)
+{
+    const size_t equals = entry.find('=');
+    const size_t colon = entry.rfind(':');
+
+    // names travel in the open frame, but nobody needs more than a short label
+    if (equals == std::string::npos || equals == 0 || equals > 255 || colon == std::string::npos || colon <= equals + 1 ||
+        colon + 1 == entry.size() || colon + 6 < entry.size() || entry.find_first_not_of("0123456789", colon + 1) != std::string::npos) {
+        return false;
+    }
+
+    const unsigned long port = std::stoul(entry.substr(colon + 1));
+    std::string host = entry.substr(equals + 1, colon - equals - 1);
+
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    if (port > 65535 || (port == 0 && !StreamEndpoint::is_local(host))) {
+        return false;
+    }
+
+    service.name = entry.substr(0, equals);
+    service.host = host;
+    service.port = static_cast<uint16_t>(port);
+    return true;
+}
+
+}
@@ -0,0 +1,60 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeTunnel/TunnelService.hpp
+ *
+ * @desc TunnelService is one name=host:port entry of mode.tunnel.service.
+ */
+
+#ifndef MCT_MODETUNNEL_TUNNELSERVICE_HPP
+#define MCT_MODETUNNEL_TUNNELSERVICE_HPP
+
+#include <string>
+#include <cstdint>
+
+#include <ModeTunnel/Config.hpp>
+
+namespace mct
+{
+
+/**
+ * The edge listens on host:port and asks the core for the service by its name, the core forwards the stream to its own host:port of that name.
+ */
+struct MCT_MODETUNNEL_DLL_PUBLIC TunnelService
+{
+    TunnelService() : port(0) {}
+
+    /**
+     * Returns false if the entry is malformed. IPv6 hosts may be written in brackets, the port of a Unix domain socket may be 0.
+     */
+    static bool parse(const std::string& entry, TunnelService& service);
+
+    std::string name;
+    std::string host;
+    uint16_t port;
+};
+
+}
+
+#endif // MCT_MODETUNNEL_TUNNELSERVICE_HPP
@@ -0,0 +1,154 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeUdp/ModeUdp.cpp
+ *
+ * @desc ModeUdp class which is one of the possible program runtime modes.
+ */
+
+#include <memory>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+
+#include <boost/asio/io_service.hpp>
+
+#include <ModeUdp/ModeUdp.hpp>
+#include <ModeUdp/UdpRelay.hpp>
+#include <ModeProxy/IPResolver.hpp>
+
+namespace mct
+{
+
+ModeUdp::ModeUdp(Configuration& config, Logger& logger) : Mode(config, logger)
+{
+}
+
+ModeUdp::~ModeUdp()
+{
+}
+
+const std::string& ModeUdp::get_name() const
+{
+    static std::string udp_name("udp");
+    return udp_name;
+}
+
+bool ModeUdp::validate_configuration() const
+{
+    uint16_t lh = m_config.get_mode_udp_local_hosts().size();
+    uint16_t rh = m_config.get_mode_udp_remote_hosts().size();
+    uint16_t lp = m_config.get_mode_udp_local_ports().size();
+    uint16_t rp = m_config.get_mode_udp_remote_ports().size();
+    uint16_t max = (std::max)({lh, rh, lp, rp});
+
+    if (lh != max || rh != max || lp != max || rp != max) {
+        auto report_conf_problem = [&](const std::string& conf_field, uint16_t expected_val, uint16_t actual_val) {
+            m_log.fatal("There is a problem with the configuration field '%s'. Since it's a set, it should have %d entries (repeats) - while it only has %d.", conf_field.c_str(), expected_val, actual_val);
+        };
+
+        if (lh != max) {
+            report_conf_problem("mode_udp_local_hosts", max, lh);
+        }
+
+        if (rh != max) {
+            report_conf_problem("mode_udp_remote_hosts", max, rh);
+        }
+
+        if (lp != max) {
+            report_conf_problem("mode_udp_local_ports", max, lp);
+        }
+
+        if (rp != max) {
+            report_conf_problem("mode_udp_remote_ports", max, rp);
+        }
+
+        return false;
+    }
+
+    for (auto&& port : m_config.get_mode_udp_local_ports()) {
+        if (port <= 1023) {
+            m_log.warning("One of supplied mode_udp_local_ports: %d is a 'well-known port' (its value is <= 1023). It means that the program might need additional privileges to run correctly.", port);
+        }
+    }
+
+    return true;
+}
+
+uint16_t ModeUdp::get_num_of_all_relays() const
+{   // since all vectors are equal (checked with validate_configuration()), return the size of the first one
+    return m_config.get_mode_udp_local_hosts().size();
+}
+
+bool ModeUdp::run()
+{
+    m_log.log_if_not_silent("Initialized mode '%s'.", get_name().c_str());
+
+    if (!validate_configuration()) {
+        return false;
+    }
+
+    // provides the core I/O functionality (OS calls etc.)
+    boost::asio::io_service ios;
+
+    std::vector< std::shared_ptr<UdpRelay> > relays;
+    {
+        IPResolver ip_resolver(m_log, ios);
+
+        const uint16_t num_of_all_relays = get_num_of_all_relays();
+
+        for (uint16_t relay_num = 0; relay_num < num_of_all_relays; ++relay_num) {
+            std::string local_interface = m_config.get_mode_udp_local_hosts()[relay_num];
+            uint16_t local_port = m_config.get_mode_udp_local_ports()[relay_num];
+            std::string remote_host = m_config.get_mode_udp_remote_hosts()[relay_num];
+            uint16_t remote_port = m_config.get_mode_udp_remote_ports()[relay_num];
+
+            std::string local_ip = ip_resolver.resolve_only_first_ip(local_interface);
+            std::string remote_ip = ip_resolver.resolve_only_first_ip(remote_host);
+
+            try {
+                relays.push_back(std::make_shared<UdpRelay>(ios, m_log, local_ip, local_port, remote_ip, remote_port,
+                    m_config.get_mode_udp_session_timeout(), m_config.get_mode_udp_batch_size(), m_config.get_mode_udp_max_sessions(),
+                    m_config.get_mode_udp_offload()));
+                relays.back()->start();
+            } catch (const boost::system::system_error& e) {
+                std::stringstream sStr;
+                sStr << "Cannot start udp relay using given address and port: (" << local_interface << ") " << local_ip << ":" << local_port << std::endl;
+                sStr << "Error code: " << e.code().value() << std::endl;
+                sStr << "System message: " << e.what() << std::endl;
+                throw std::runtime_error(sStr.str());
+            }
+        }
+    }
+
+    // gives control away to Boost.Asio to asynchronously handle datagrams
+    ios.run();
+
+    return true;
+}
+
+}
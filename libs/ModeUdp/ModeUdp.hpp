@@ -0,0 +1,64 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeUdp/ModeUdp.hpp
+ *
+ * @desc ModeUdp class which is one of the possible program runtime modes.
+ */
+
+#ifndef MCT_MODEUDP_MODEUDP_HPP
+#define MCT_MODEUDP_MODEUDP_HPP
+
+#include <string>
+
+#include <Mode/Mode.hpp>
+#include <ModeUdp/Config.hpp>
+
+namespace mct
+{
+
+class Configuration;
+class Logger;
+
+class MCT_MODEUDP_DLL_PUBLIC ModeUdp : public Mode
+{
+public:
+    ModeUdp(Configuration& config, Logger& logger);
+    virtual ~ModeUdp();
+
+    ModeUdp(const ModeUdp&) = delete;
+    ModeUdp& operator=(const ModeUdp&) = delete;
+
+    virtual const std::string& get_name() const;
+
+    virtual bool run();
+
+protected:
+    uint16_t get_num_of_all_relays() const;
+    bool validate_configuration() const;
+};
+
+}
+
+#endif // MCT_MODEUDP_MODEUDP_HPP
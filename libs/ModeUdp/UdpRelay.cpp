@@ -0,0 +1,597 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeUdp/UdpRelay.cpp
+ *
+ * @desc UdpRelay receives datagrams on a given interface and relays them to the remote endpoint,
+ *  keeping one session (with its own upstream socket) per client endpoint.
+ */
+
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <functional>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+
+// older C library headers miss the UDP offload options (Linux 4.18 and 5.0)
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#endif
+
+#include <boost/asio/ip/udp.hpp>
+
+#include <Logger/Logger.hpp>
+#include <ModeUdp/UdpRelay.hpp>
+
+namespace mct
+{
+
+/**
+ * Fixed set of datagram slots, received and sent with recvmmsg/sendmmsg on Linux
+ * (one system call per batch) and with one receive_from/send_to per datagram elsewhere.
+ *
+ * On a socket with UDP_GRO enabled, one slot may hold several datagrams of the same sender coalesced by the kernel,
+ * all of segment_size(idx) bytes (but the last one). Such a slot is sent on with UDP_SEGMENT, so the kernel (or the NIC)
+ * splits it again - the relay handles the whole train with a single copy.
+ */
+class UdpDatagramBatch
+{
+public:
+    UdpDatagramBatch(size_t capacity, size_t max_datagram_size);
+
+    size_t capacity() const { return m_lengths.size(); }
+    unsigned char* data(size_t idx) { return &m_data[idx * m_max_datagram_size]; }
+    size_t length(size_t idx) const { return m_lengths[idx]; }
+    bool is_truncated(size_t idx) const { return m_lengths[idx] == truncated_datagram; }
+    size_t segment_size(size_t idx) const { return m_segment_sizes[idx]; }
+    const boost::asio::ip::udp::endpoint& endpoint(size_t idx) const { return m_endpoints[idx]; }
+
+    /**
+     * Receives up to capacity() datagrams without blocking.
+     * Returns number of received datagrams, 0 if there was nothing to read (or on error, which is stored in error).
+     */
+    size_t receive(boost::asio::ip::udp::socket& socket, boost::system::error_code& error);
+
+    /**
+     * Sends datagrams [first, first + count) without blocking, either to destination
+     * or (if destination is nullptr) to the peer of a connected socket.
+     * Returns number of datagrams which were sent, the rest should be treated as dropped.
+     */
+    size_t send(boost::asio::ip::udp::socket& socket, size_t first, size_t count, const boost::asio::ip::udp::endpoint* destination);
+
+    /**
+     * Number of datagrams held by slots [first, first + count), coalesced ones counted one by one.
+     */
+    size_t count_datagrams(size_t first, size_t count) const;
+
+private:
+#if defined(__linux__)
+    /**
+     * Sends a coalesced slot as separate datagrams, for routes which cannot segment (sendmmsg fails with EIO then).
+     */
+    bool send_segments(boost::asio::ip::udp::socket& socket, size_t idx, const boost::asio::ip::udp::endpoint* destination);
+#endif
+
+
+    static const size_t truncated_datagram = (std::numeric_limits<size_t>::max)();
+
+    const size_t m_max_datagram_size;
+    std::vector<unsigned char> m_data;
+    std::vector<size_t> m_lengths;
+    // 0 unless the slot holds datagrams coalesced by UDP_GRO
+    std::vector<size_t> m_segment_sizes;
+    std::vector<boost::asio::ip::udp::endpoint> m_endpoints;
+
+#if defined(__linux__)
+    static const size_t control_length = CMSG_SPACE(sizeof(int));
+
+    std::vector<mmsghdr> m_headers;
+    std::vector<iovec> m_iovecs;
+    // ancillary data of every slot: UDP_GRO segment size when receiving, UDP_SEGMENT when sending
+    std::vector<unsigned char> m_control;
+#endif
+};
+
+class UdpSession
+{
+public:
+    UdpSession(boost::asio::io_service& ios, const boost::asio::ip::udp::endpoint& client_endpoint)
+     : m_client_endpoint(client_endpoint), m_socket(ios), m_last_activity(std::chrono::steady_clock::now())
+    {
+    }
+
+    const boost::asio::ip::udp::endpoint m_client_endpoint;
+    boost::asio::ip::udp::socket m_socket;
+    std::chrono::steady_clock::time_point m_last_activity;
+};
+
+size_t UdpEndpointHash::operator()(const boost::asio::ip::udp::endpoint& endpoint) const
+{
+    size_t seed = std::hash<uint16_t>()(endpoint.port());
+
+    if (endpoint.address().is_v4()) {
+        seed ^= std::hash<uint32_t>()(endpoint.address().to_v4().to_ulong()) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    } else {
+        for (auto byte : endpoint.address().to_v6().to_bytes()) {
+            seed ^= std::hash<unsigned char>()(byte) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+    }
+
+    return seed;
+}
+
+UdpDatagramBatch::UdpDatagramBatch(size_t capacity, size_t max_datagram_size)
+ : m_max_datagram_size(max_datagram_size), m_data(capacity * max_datagram_size), m_lengths(capacity, 0), m_segment_sizes(capacity, 0), m_endpoints(capacity)
+#if defined(__linux__)
+ , m_headers(capacity), m_iovecs(capacity), m_control(capacity * control_length)
+#endif
+{
+}
+
+size_t UdpDatagramBatch::receive(boost::asio::ip::udp::socket& socket, boost::system::error_code& error)
+{
+#if defined(__linux__)
+    for (size_t idx = 0; idx < capacity(); ++idx) {
+        m_iovecs[idx].iov_base = data(idx);
+        m_iovecs[idx].iov_len = m_max_datagram_size;
+        m_headers[idx].msg_hdr = msghdr();
+        m_headers[idx].msg_hdr.msg_name = m_endpoints[idx].data();
+        m_headers[idx].msg_hdr.msg_namelen = m_endpoints[idx].capacity();
+        m_headers[idx].msg_hdr.msg_iov = &m_iovecs[idx];
+        m_headers[idx].msg_hdr.msg_iovlen = 1;
+        m_headers[idx].msg_hdr.msg_control = &m_control[idx * control_length];
+        m_headers[idx].msg_hdr.msg_controllen = control_length;
+        m_headers[idx].msg_len = 0;
+    }
+
+    int received = ::recvmmsg(socket.native_handle(), &m_headers[0], capacity(), MSG_DONTWAIT, nullptr);
+
+    if (received < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            error = boost::system::error_code(errno, boost::system::system_category());
+        }
+        return 0;
+    }
+
+    for (int idx = 0; idx < received; ++idx) {
+        m_endpoints[idx].resize(m_headers[idx].msg_hdr.msg_namelen);
+        m_lengths[idx] = (m_headers[idx].msg_hdr.msg_flags & MSG_TRUNC) ? truncated_datagram : m_headers[idx].msg_len;
+        m_segment_sizes[idx] = 0;
+
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&m_headers[idx].msg_hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&m_headers[idx].msg_hdr, cmsg)) {
+            if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                int segment_size = 0;
+                std::memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(segment_size));
+                m_segment_sizes[idx] = (segment_size > 0 && static_cast<size_t>(segment_size) < m_headers[idx].msg_len) ? segment_size : 0;
+            }
+        }
+    }
+
+    return static_cast<size_t>(received);
+#else
+    size_t received = 0;
+
+    while (received < capacity()) {
+        boost::system::error_code ec;
+        m_lengths[received] = socket.receive_from(boost::asio::buffer(data(received), m_max_datagram_size), m_endpoints[received], 0, ec);
+
+        if (ec == boost::asio::error::message_size) {
+            m_lengths[received] = truncated_datagram;
+        } else if (ec) {
+            if (ec != boost::asio::error::would_block) {
+                error = ec;
+            }
+            break;
+        }
+
+        ++received;
+    }
+
+    return received;
+#endif
+}
+
+size_t UdpDatagramBatch::send(boost::asio::ip::udp::socket& socket, size_t first, size_t count, const boost::asio::ip::udp::endpoint* destination)
+{
+#if defined(__linux__)
+    for (size_t idx = first; idx < first + count; ++idx) {
+        m_iovecs[idx].iov_base = data(idx);
+        m_iovecs[idx].iov_len = m_lengths[idx];
+        m_headers[idx].msg_hdr = msghdr();
+        m_headers[idx].msg_hdr.msg_name = destination ? const_cast<sockaddr*>(destination->data()) : nullptr;
+        m_headers[idx].msg_hdr.msg_namelen = destination ? destination->size() : 0;
+        m_headers[idx].msg_hdr.msg_iov = &m_iovecs[idx];
+        m_headers[idx].msg_hdr.msg_iovlen = 1;
+
+        if (m_segment_sizes[idx] > 0) {
+            m_headers[idx].msg_hdr.msg_control = &m_control[idx * control_length];
+            m_headers[idx].msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&m_headers[idx].msg_hdr);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+
+            const uint16_t segment_size = static_cast<uint16_t>(m_segment_sizes[idx]);
+            std::memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+        }
+    }
+
+    size_t sent = 0;
+
+    while (sent < count) {
+        int ret = ::sendmmsg(socket.native_handle(), &m_headers[first + sent], count - sent, MSG_DONTWAIT);
+        if (ret <= 0) {
+            // a coalesced slot is refused with EIO where the route cannot segment, it is split here instead
+            if (ret < 0 && errno == EIO && m_segment_sizes[first + sent] > 0 && send_segments(socket, first + sent, destination)) {
+                ++sent;
+                continue;
+            }
+            break; // socket buffer is full (or the peer is unreachable) - the rest is dropped, as UDP would do
+        }
+        sent += ret;
+    }
+
+    return sent;
+#else
+    size_t sent = 0;
+
+    for (size_t idx = first; idx < first + count; ++idx) {
+        boost::system::error_code ec;
+
+        if (destination) {
+            socket.send_to(boost::asio::buffer(data(idx), m_lengths[idx]), *destination, 0, ec);
+        } else {
+            socket.send(boost::asio::buffer(data(idx), m_lengths[idx]), 0, ec);
+        }
+
+        if (ec) {
+            break;
+        }
+        ++sent;
+    }
+
+    return sent;
+#endif
+}
+
+size_t UdpDatagramBatch::count_datagrams(size_t first, size_t count) const
+{
+    size_t datagrams = 0;
+
+    for (size_t idx = first; idx < first + count; ++idx) {
+        datagrams += (m_segment_sizes[idx] > 0) ? (m_lengths[idx] + m_segment_sizes[idx] - 1) / m_segment_sizes[idx] : 1;
+    }
+
+    return datagrams;
+}
+
+#if defined(__linux__)
+bool UdpDatagramBatch::send_segments(boost::asio::ip::udp::socket& socket, size_t idx, const boost::asio::ip::udp::endpoint* destination)
+{
+    for (size_t offset = 0; offset < m_lengths[idx]; offset += m_segment_sizes[idx]) {
+        const size_t length = (std::min)(m_segment_sizes[idx], m_lengths[idx] - offset);
+        const ssize_t ret = ::sendto(socket.native_handle(), data(idx) + offset, length, MSG_DONTWAIT,
+            destination ? destination->data() : nullptr, destination ? destination->size() : 0);
+
+        if (ret < 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+#endif
+
+// large enough for any UDP payload
+const size_t max_udp_datagram_size = 65536;
+
+/**
+ * Errors a UDP socket reports now and then without being broken: an empty or full buffer, or an ICMP error
+ * caused by an earlier datagram. Waiting on the socket goes on after them.
+ */
+static bool is_transient_error(const boost::system::error_code& error)
+{
+    return error == boost::asio::error::would_block || error == boost::asio::error::try_again || error == boost::asio::error::interrupted ||
+           error == boost::asio::error::connection_refused || error == boost::asio::error::connection_reset ||
+           error == boost::asio::error::no_buffer_space || error == boost::asio::error::host_unreachable ||
+           error == boost::asio::error::network_unreachable;
+}
+
+UdpRelay::UdpRelay(boost::asio::io_service& ios, Logger& logger, const std::string& listen_host, uint16_t listen_port,
+                   const std::string& remote_host, uint16_t remote_port, uint16_t session_timeout, uint16_t batch_size, uint32_t max_sessions, bool is_offload_enabled)
+ : m_ios(ios), m_log(logger), m_listen_host(listen_host), m_listen_port(listen_port), m_remote_host(remote_host), m_remote_port(remote_port),
+   m_remote_endpoint(boost::asio::ip::address::from_string(m_remote_host), m_remote_port), m_session_timeout(session_timeout), m_max_sessions(max_sessions), m_is_offload_enabled(is_offload_enabled),
+   m_socket(m_ios, boost::asio::ip::udp::endpoint(boost::asio::ip::address::from_string(m_listen_host), m_listen_port)),
+   m_expiry_timer(m_ios), m_is_stopped(false), m_is_session_limit_reported(false),
+   m_client_batch(new UdpDatagramBatch((batch_size > 0) ? batch_size : 1, max_udp_datagram_size)),
+   m_remote_batch(new UdpDatagramBatch((batch_size > 0) ? batch_size : 1, max_udp_datagram_size)),
+   m_client_datagrams(0), m_remote_datagrams(0), m_dropped_datagrams(0)
+{
+    m_socket.non_blocking(true);
+
+    if (m_is_offload_enabled && !enable_gro(m_socket)) {
+        m_log.info("UDP GRO is not supported by the kernel, udp relay %s:%u relays datagrams one by one.", m_listen_host.c_str(), m_listen_port);
+        m_is_offload_enabled = false;
+    }
+
+    m_log.debug("Creating udp relay %s:%u.", m_listen_host.c_str(), m_listen_port);
+}
+
+UdpRelay::~UdpRelay()
+{
+    m_log.info("Releasing udp relay %s:%u.", m_listen_host.c_str(), m_listen_port);
+}
+
+void UdpRelay::start()
+{
+    m_log.info("Registering udp relay at %s:%u which will redirect to %s:%u.", m_listen_host.c_str(), m_listen_port, m_remote_host.c_str(), m_remote_port);
+
+    async_wait_client();
+
+    if (m_session_timeout > 0) {
+        async_wait_expiry();
+    }
+}
+
+void UdpRelay::stop()
+{
+    m_is_stopped = true;
+
+    boost::system::error_code ignored;
+    m_socket.close(ignored);
+    m_expiry_timer.cancel(ignored);
+
+    for (auto& session : m_sessions) {
+        session.second->m_socket.close(ignored);
+    }
+
+    m_sessions.clear();
+}
+
+bool UdpRelay::enable_gro(boost::asio::ip::udp::socket& socket)
+{
+#if defined(__linux__)
+    int enabled = 1;
+    return ::setsockopt(socket.native_handle(), SOL_UDP, UDP_GRO, &enabled, sizeof(enabled)) == 0;
+#else
+    return false;
+#endif
+}
+
+void UdpRelay::async_wait_client()
+{
+    m_socket.async_receive(boost::asio::null_buffers(), std::bind(&UdpRelay::handle_client_readable, shared_from_this(), std::placeholders::_1));
+}
+
+void UdpRelay::handle_client_readable(const boost::system::error_code& error)
+{
+    if (m_is_stopped || error == boost::asio::error::operation_aborted) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    boost::system::error_code receive_error;
+    size_t received = error ? 0 : m_client_batch->receive(m_socket, receive_error);
+
+    if (error || receive_error) {
+        const boost::system::error_code& reported = error ? error : receive_error;
+
+        if (!is_transient_error(reported)) {
+            // only this relay goes down, the other relays of the mode keep running
+            m_log.error("Udp relay at %s:%u is stopped, client datagrams cannot be received anymore. Error: %s", m_listen_host.c_str(), m_listen_port,
+                reported.message().c_str());
+            stop();
+            return;
+        }
+
+        m_log.warning("Udp relay at %s:%u cannot receive client datagrams, because: %s", m_listen_host.c_str(), m_listen_port, reported.message().c_str());
+    }
+
+    m_client_datagrams += m_client_batch->count_datagrams(0, received);
+
+    // consecutive datagrams of the same client are forwarded with a single send
+    for (size_t first = 0; first < received; ) {
+        if (m_client_batch->is_truncated(first)) {
+            ++m_dropped_datagrams;
+            ++first;
+            continue;
+        }
+
+        size_t last = first + 1;
+        while (last < received && !m_client_batch->is_truncated(last) && m_client_batch->endpoint(last) == m_client_batch->endpoint(first)) {
+            ++last;
+        }
+
+        std::shared_ptr<UdpSession> session = find_or_create_session(m_client_batch->endpoint(first));
+
+        if (session) {
+            session->m_last_activity = now;
+            const size_t sent = m_client_batch->send(session->m_socket, first, last - first, nullptr);
+            m_dropped_datagrams += m_client_batch->count_datagrams(first + sent, (last - first) - sent);
+        } else {
+            m_dropped_datagrams += m_client_batch->count_datagrams(first, last - first);
+        }
+
+        first = last;
+    }
+
+    async_wait_client();
+}
+
+void UdpRelay::async_wait_remote(const std::shared_ptr<UdpSession>& session)
+{
+    session->m_socket.async_receive(boost::asio::null_buffers(),
+        std::bind(&UdpRelay::handle_remote_readable, shared_from_this(), session, std::placeholders::_1));
+}
+
+void UdpRelay::handle_remote_readable(const std::shared_ptr<UdpSession>& session, const boost::system::error_code& error)
+{
+    if (m_is_stopped || error == boost::asio::error::operation_aborted || !session->m_socket.is_open()) {
+        return;
+    }
+
+    boost::system::error_code receive_error;
+    size_t received = error ? 0 : m_remote_batch->receive(session->m_socket, receive_error);
+
+    if ((error && !is_transient_error(error)) || (receive_error && !is_transient_error(receive_error))) {
+        m_log.error("[Udp client %s:%u] Closing session, datagrams from remote endpoint %s:%u cannot be received anymore. Error: %s",
+            session->m_client_endpoint.address().to_string().c_str(), session->m_client_endpoint.port(), m_remote_host.c_str(), m_remote_port,
+            (error ? error : receive_error).message().c_str());
+        close_session(session);
+        m_sessions.erase(session->m_client_endpoint);
+        return;
+    }
+
+    if (error || receive_error) {
+        // e.g. connection_refused reported by ICMP when the remote endpoint is down - keep the session, remote may come back
+        m_log.debug("[Udp client %s:%u] Cannot receive datagrams from remote endpoint %s:%u, because: %s",
+            session->m_client_endpoint.address().to_string().c_str(), session->m_client_endpoint.port(), m_remote_host.c_str(), m_remote_port,
+            (error ? error : receive_error).message().c_str());
+    }
+
+    if (received > 0) {
+        session->m_last_activity = std::chrono::steady_clock::now();
+        m_remote_datagrams += m_remote_batch->count_datagrams(0, received);
+
+        size_t idx = 0;
+        while (idx < received) {
+            if (m_remote_batch->is_truncated(idx)) {
+                ++m_dropped_datagrams;
+                ++idx;
+                continue;
+            }
+
+            size_t last = idx + 1;
+            while (last < received && !m_remote_batch->is_truncated(last)) {
+                ++last;
+            }
+
+            const size_t sent = m_remote_batch->send(m_socket, idx, last - idx, &session->m_client_endpoint);
+            m_dropped_datagrams += m_remote_batch->count_datagrams(idx + sent, (last - idx) - sent);
+            idx = last;
+        }
+    }
+
+    async_wait_remote(session);
+}
+
+std::shared_ptr<UdpSession> UdpRelay::find_or_create_session(const boost::asio::ip::udp::endpoint& client_endpoint)
+{
+    auto it = m_sessions.find(client_endpoint);
+    if (it != m_sessions.end()) {
+        return it->second;
+    }
+
+    if (m_max_sessions > 0 && m_sessions.size() >= m_max_sessions) {
+        if (!m_is_session_limit_reported) {
+            m_log.warning("Udp relay at %s:%u has reached its limit of %u sessions, datagrams of new clients are dropped until a session expires.",
+                m_listen_host.c_str(), m_listen_port, m_max_sessions);
+            m_is_session_limit_reported = true;
+        }
+        return std::shared_ptr<UdpSession>();
+    }
+
+    auto session = std::make_shared<UdpSession>(m_ios, client_endpoint);
+    boost::system::error_code error;
+
+    session->m_socket.open(m_remote_endpoint.protocol(), error);
+    if (!error) {
+        session->m_socket.connect(m_remote_endpoint, error);
+    }
+    if (!error) {
+        session->m_socket.non_blocking(true, error);
+    }
+    if (!error && m_is_offload_enabled) {
+        enable_gro(session->m_socket);
+    }
+
+    if (error) {
+        m_log.error("Cannot create udp session for client %s:%u to remote endpoint %s:%u. Error: %s",
+            client_endpoint.address().to_string().c_str(), client_endpoint.port(), m_remote_host.c_str(), m_remote_port, error.message().c_str());
+        return std::shared_ptr<UdpSession>();
+    }
+
+    m_log.info("Accepted udp client %s:%u with relay %s:%u. Redirecting datagrams to %s:%u.",
+        client_endpoint.address().to_string().c_str(), client_endpoint.port(), m_listen_host.c_str(), m_listen_port, m_remote_host.c_str(), m_remote_port);
+
+    m_sessions.insert(std::make_pair(client_endpoint, session));
+    async_wait_remote(session);
+
+    return session;
+}
+
+void UdpRelay::close_session(const std::shared_ptr<UdpSession>& session)
+{
+    boost::system::error_code ignored;
+    session->m_socket.close(ignored);
+    m_is_session_limit_reported = false;
+}
+
+void UdpRelay::async_wait_expiry()
+{
+    // sweep twice per timeout, so an idle session lives at most 1.5 * session_timeout
+    m_expiry_timer.expires_from_now(boost::posix_time::milliseconds(m_session_timeout * 500));
+    m_expiry_timer.async_wait(std::bind(&UdpRelay::handle_expiry, shared_from_this(), std::placeholders::_1));
+}
+
+void UdpRelay::handle_expiry(const boost::system::error_code& error)
+{
+    if (m_is_stopped || error == boost::asio::error::operation_aborted) {
+        return;
+    }
+
+    expire_idle_sessions();
+    async_wait_expiry();
+}
+
+void UdpRelay::expire_idle_sessions()
+{
+    auto deadline = std::chrono::steady_clock::now() - std::chrono::seconds(m_session_timeout);
+
+    for (auto it = m_sessions.begin(); it != m_sessions.end(); ) {
+        if (it->second->m_last_activity <= deadline) {
+            m_log.info("Expiring idle udp client %s:%u.", it->first.address().to_string().c_str(), it->first.port());
+            close_session(it->second);
+            it = m_sessions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+}
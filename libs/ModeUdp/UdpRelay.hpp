@@ -0,0 +1,138 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ModeUdp/UdpRelay.hpp
+ *
+ * @desc UdpRelay receives datagrams on a given interface and relays them to the remote endpoint,
+ *  keeping one session (with its own upstream socket) per client endpoint.
+ */
+
+#ifndef MCT_MODEUDP_UDPRELAY_HPP
+#define MCT_MODEUDP_UDPRELAY_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/asio/deadline_timer.hpp>
+
+#include <ModeUdp/Config.hpp>
+
+namespace mct
+{
+
+class Logger;
+class UdpSession;
+class UdpDatagramBatch;
+
+struct UdpEndpointHash
+{
+    size_t operator()(const boost::asio::ip::udp::endpoint& endpoint) const;
+};
+
+class MCT_MODEUDP_DLL_PUBLIC UdpRelay : public std::enable_shared_from_this<UdpRelay>
+{
+public:
+    UdpRelay(boost::asio::io_service& ios, Logger& logger, const std::string& listen_host, uint16_t listen_port,
+             const std::string& remote_host, uint16_t remote_port, uint16_t session_timeout, uint16_t batch_size, uint32_t max_sessions, bool is_offload_enabled);
+    ~UdpRelay();
+
+    UdpRelay(const UdpRelay&) = delete;
+    UdpRelay& operator=(const UdpRelay&) = delete;
+
+    void start();
+    void stop();
+
+    const std::string& get_listen_host() const { return m_listen_host; }
+    const uint16_t get_listen_port() const { return m_listen_port; }
+    const std::string& get_remote_host() const { return m_remote_host; }
+    const uint16_t get_remote_port() const { return m_remote_port; }
+
+    size_t get_num_of_sessions() const { return m_sessions.size(); }
+    bool is_offload_enabled() const { return m_is_offload_enabled; }
+    uint64_t get_client_datagrams() const { return m_client_datagrams; }
+    uint64_t get_remote_datagrams() const { return m_remote_datagrams; }
+    uint64_t get_dropped_datagrams() const { return m_dropped_datagrams; }
+
+    /**
+     * Expires sessions which have been idle for at least session_timeout seconds.
+     * Called periodically by the expiry timer, public so the expiry can be driven explicitly.
+     */
+    void expire_idle_sessions();
+
+protected:
+    void async_wait_client();
+    void handle_client_readable(const boost::system::error_code& error);
+    void async_wait_remote(const std::shared_ptr<UdpSession>& session);
+    void handle_remote_readable(const std::shared_ptr<UdpSession>& session, const boost::system::error_code& error);
+    void async_wait_expiry();
+    void handle_expiry(const boost::system::error_code& error);
+
+    /**
+     * Lets the kernel coalesce datagrams received on socket (UDP_GRO). Returns false where it is not supported.
+     */
+    static bool enable_gro(boost::asio::ip::udp::socket& socket);
+
+    std::shared_ptr<UdpSession> find_or_create_session(const boost::asio::ip::udp::endpoint& client_endpoint);
+    void close_session(const std::shared_ptr<UdpSession>& session);
+
+protected:
+    boost::asio::io_service& m_ios;
+    Logger& m_log;
+
+    const std::string m_listen_host;
+    const uint16_t m_listen_port;
+    const std::string m_remote_host;
+    const uint16_t m_remote_port;
+    const boost::asio::ip::udp::endpoint m_remote_endpoint;
+    const uint16_t m_session_timeout;
+    // every session holds a socket, so a flood of spoofed client endpoints must not be able to open them without end
+    const uint32_t m_max_sessions;
+    // cleared when the kernel does not support UDP GRO on the listening socket
+    bool m_is_offload_enabled;
+
+    boost::asio::ip::udp::socket m_socket;
+    boost::asio::deadline_timer m_expiry_timer;
+    bool m_is_stopped;
+    // the limit is reported once each time it is reached, not for every dropped datagram
+    bool m_is_session_limit_reported;
+
+    // all handlers run on the io_service thread one after another, so a single pair of batches is shared by all sessions
+    std::unique_ptr<UdpDatagramBatch> m_client_batch;
+    std::unique_ptr<UdpDatagramBatch> m_remote_batch;
+
+    std::unordered_map< boost::asio::ip::udp::endpoint, std::shared_ptr<UdpSession>, UdpEndpointHash > m_sessions;
+
+    uint64_t m_client_datagrams;
+    uint64_t m_remote_datagrams;
+    uint64_t m_dropped_datagrams;
+};
+
+}
+
+#endif // MCT_MODEUDP_UDPRELAY_HPP
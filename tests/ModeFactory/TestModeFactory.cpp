@@ -121,3 +121,302 @@ void TestModeFactory::test_modefactory_proxy()
 		CPPUNIT_ASSERT_EQUAL(std::string("proxy"), app_mode->get_name());
 	}
 }
+
+void TestModeFactory::test_modefactory_udp()
+{
+    std::string filename("./tmf_modefactory_udp.cfg");
+    bool expected_value = true;
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, {"log.nofile = 1", "log.silent = 1", "mode = udp"}, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+	expected_message.clear();
+
+	{
+		mct::Logger logger(helper.get_config());
+
+		CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+		CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+		mct::ModeFactory mode_factory(helper.get_config(), logger);
+		std::unique_ptr<mct::Mode> app_mode(mode_factory.create(helper.get_config().get_app_mode()));
+
+		CPPUNIT_ASSERT_EQUAL(false, !app_mode);
+		CPPUNIT_ASSERT_EQUAL(std::string("udp"), app_mode->get_name());
+	}
+}
+
+void TestModeFactory::test_modefactory_replay()
+{
+    std::string filename("./tmf_modefactory_replay.cfg");
+    bool expected_value = true;
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, {"log.nofile = 1", "log.silent = 1", "mode = replay"}, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+	expected_message.clear();
+
+	{
+		mct::Logger logger(helper.get_config());
+
+		CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+		CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+		mct::ModeFactory mode_factory(helper.get_config(), logger);
+		std::unique_ptr<mct::Mode> app_mode(mode_factory.create(helper.get_config().get_app_mode()));
+
+		CPPUNIT_ASSERT_EQUAL(false, !app_mode);
+		CPPUNIT_ASSERT_EQUAL(std::string("replay"), app_mode->get_name());
+	}
+}
+
+void TestModeFactory::test_modefactory_socks5()
+{
+    std::string filename("./tmf_modefactory_socks5.cfg");
+    bool expected_value = true;
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, {"log.nofile = 1", "log.silent = 1", "mode = socks5"}, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+	expected_message.clear();
+
+	{
+		mct::Logger logger(helper.get_config());
+
+		CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+		CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+		mct::ModeFactory mode_factory(helper.get_config(), logger);
+		std::unique_ptr<mct::Mode> app_mode(mode_factory.create(helper.get_config().get_app_mode()));
+
+		CPPUNIT_ASSERT_EQUAL(false, !app_mode);
+		CPPUNIT_ASSERT_EQUAL(std::string("socks5"), app_mode->get_name());
+	}
+}
+
+void TestModeFactory::test_modefactory_http_connect()
+{
+    std::string filename("./tmf_modefactory_http_connect.cfg");
+    bool expected_value = true;
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, {"log.nofile = 1", "log.silent = 1", "mode = http_connect"}, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+	expected_message.clear();
+
+	{
+		mct::Logger logger(helper.get_config());
+
+		CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+		CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+		mct::ModeFactory mode_factory(helper.get_config(), logger);
+		std::unique_ptr<mct::Mode> app_mode(mode_factory.create(helper.get_config().get_app_mode()));
+
+		CPPUNIT_ASSERT_EQUAL(false, !app_mode);
+		CPPUNIT_ASSERT_EQUAL(std::string("http_connect"), app_mode->get_name());
+	}
+}
+
+void TestModeFactory::test_modefactory_sni()
+{
+    std::string filename("./tmf_modefactory_sni.cfg");
+    bool expected_value = true;
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, {"log.nofile = 1", "log.silent = 1", "mode = sni"}, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+	expected_message.clear();
+
+	{
+		mct::Logger logger(helper.get_config());
+
+		CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+		CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+		mct::ModeFactory mode_factory(helper.get_config(), logger);
+		std::unique_ptr<mct::Mode> app_mode(mode_factory.create(helper.get_config().get_app_mode()));
+
+		CPPUNIT_ASSERT_EQUAL(false, !app_mode);
+		CPPUNIT_ASSERT_EQUAL(std::string("sni"), app_mode->get_name());
+	}
+}
+
+void TestModeFactory::test_modefactory_tunnel_edge()
+{
+    std::string filename("./tmf_modefactory_tunnel_edge.cfg");
+    bool expected_value = true;
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, {"log.nofile = 1", "log.silent = 1", "mode = tunnel_edge"}, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+	expected_message.clear();
+
+	{
+		mct::Logger logger(helper.get_config());
+
+		CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+		CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+		mct::ModeFactory mode_factory(helper.get_config(), logger);
+		std::unique_ptr<mct::Mode> app_mode(mode_factory.create(helper.get_config().get_app_mode()));
+
+		CPPUNIT_ASSERT_EQUAL(false, !app_mode);
+		CPPUNIT_ASSERT_EQUAL(std::string("tunnel_edge"), app_mode->get_name());
+	}
+}
+
+void TestModeFactory::test_modefactory_tunnel_core()
+{
+    std::string filename("./tmf_modefactory_tunnel_core.cfg");
+    bool expected_value = true;
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, {"log.nofile = 1", "log.silent = 1", "mode = tunnel_core"}, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+	expected_message.clear();
+
+	{
+		mct::Logger logger(helper.get_config());
+
+		CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+		CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+		mct::ModeFactory mode_factory(helper.get_config(), logger);
+		std::unique_ptr<mct::Mode> app_mode(mode_factory.create(helper.get_config().get_app_mode()));
+
+		CPPUNIT_ASSERT_EQUAL(false, !app_mode);
+		CPPUNIT_ASSERT_EQUAL(std::string("tunnel_core"), app_mode->get_name());
+	}
+}
+
+#if defined(MCT_WITH_OPENSSL)
+void TestModeFactory::test_modefactory_tls()
+{
+    std::string filename("./tmf_modefactory_tls.cfg");
+    bool expected_value = true;
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, {"log.nofile = 1", "log.silent = 1", "mode = tls"}, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+	expected_message.clear();
+
+	{
+		mct::Logger logger(helper.get_config());
+
+		CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+		CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+		mct::ModeFactory mode_factory(helper.get_config(), logger);
+		std::unique_ptr<mct::Mode> app_mode(mode_factory.create(helper.get_config().get_app_mode()));
+
+		CPPUNIT_ASSERT_EQUAL(false, !app_mode);
+		CPPUNIT_ASSERT_EQUAL(std::string("tls"), app_mode->get_name());
+	}
+}
+#endif
+
+void TestModeFactory::test_modefactory_multiplex()
+{
+    std::string filename("./tmf_modefactory_multiplex.cfg");
+    bool expected_value = true;
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, {"log.nofile = 1", "log.silent = 1", "mode = multiplex"}, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+	expected_message.clear();
+
+	{
+		mct::Logger logger(helper.get_config());
+
+		CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+		CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+		mct::ModeFactory mode_factory(helper.get_config(), logger);
+		std::unique_ptr<mct::Mode> app_mode(mode_factory.create(helper.get_config().get_app_mode()));
+
+		CPPUNIT_ASSERT_EQUAL(false, !app_mode);
+		CPPUNIT_ASSERT_EQUAL(std::string("multiplex"), app_mode->get_name());
+	}
+}
@@ -36,6 +36,17 @@ class TestModeFactory : public CPPUNIT_NS::TestCase
 {
     CPPUNIT_TEST_SUITE(TestModeFactory);
     CPPUNIT_TEST(test_modefactory_proxy);
+    CPPUNIT_TEST(test_modefactory_udp);
+    CPPUNIT_TEST(test_modefactory_replay);
+    CPPUNIT_TEST(test_modefactory_socks5);
+    CPPUNIT_TEST(test_modefactory_http_connect);
+    CPPUNIT_TEST(test_modefactory_sni);
+    CPPUNIT_TEST(test_modefactory_tunnel_edge);
+    CPPUNIT_TEST(test_modefactory_tunnel_core);
+#if defined(MCT_WITH_OPENSSL)
+    CPPUNIT_TEST(test_modefactory_tls);
+#endif
+    CPPUNIT_TEST(test_modefactory_multiplex);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -44,6 +55,17 @@ public:
 
 protected:
     void test_modefactory_proxy();
+    void test_modefactory_udp();
+    void test_modefactory_replay();
+    void test_modefactory_socks5();
+    void test_modefactory_http_connect();
+    void test_modefactory_sni();
+    void test_modefactory_tunnel_edge();
+    void test_modefactory_tunnel_core();
+#if defined(MCT_WITH_OPENSSL)
+    void test_modefactory_tls();
+#endif
+    void test_modefactory_multiplex();
 };
 
 #endif // MCT_TESTS_MODEFACTORY_TEST_MODEFACTORY_HPP
@@ -0,0 +1,361 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file tests/ModeHttp/TestModeHttp.cpp
+ *
+ * @desc ModeHttp application mode tests.
+ */
+
+#include <thread>
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+#include <Configuration/ConfigurationBuilder.hpp>
+#include <ModeProxy/ProxyListener.hpp>
+#include <ModeProxy/CachedResolver.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeHttp/AllowList.hpp>
+#include <ModeHttp/HttpConnectParser.hpp>
+#include <ModeHttp/HttpConnectProxy.hpp>
+
+#include "TestModeHttp.hpp"
+
+using boost::asio::ip::tcp;
+
+void TestModeHttp::setUp()
+{
+}
+
+void TestModeHttp::tearDown()
+{
+}
+
+class ConfigFileReaderHelper
+{
+public:
+    ConfigFileReaderHelper(const std::string& filename, const std::vector<std::string>& keys_values, const int argc, const char** argv)
+    : m_config(argc, (char**)argv), m_filename(filename), m_keys_values(keys_values), m_argc(argc), m_argv(argv)
+    {
+    }
+
+    bool read_file(std::string& message_to_user)
+    {
+        std::ofstream fs;
+
+        std::shared_ptr<std::ofstream> fileGuard(&fs, [&](std::ofstream*)
+        {
+            boost::filesystem::remove(m_filename);
+        });
+
+        fs.open(m_filename);
+        for (auto& keys_values : m_keys_values) {
+            fs << "#" << std::endl;
+            fs << "# Standard comment support" << std::endl;
+            fs << "#" << std::endl;
+            fs << keys_values << std::endl << std::endl;
+        }
+        fs.close();
+
+        mct::ConfigurationBuilder config_builder(m_config);
+
+        return config_builder.build_configuration(message_to_user);
+    }
+
+    mct::Configuration& get_config() { return m_config; }
+
+private:
+    mct::Configuration m_config;
+    std::string m_filename;
+    std::vector<std::string> m_keys_values;
+    const int m_argc;
+    const char** m_argv;
+};
+
+namespace
+{
+
+/**
+ * Runs an http_connect listener on its own thread, the tests use blocking sockets of another io_service.
+ */
+class HttpConnectServer
+{
+public:
+    HttpConnectServer(mct::Logger& logger, uint16_t listen_port, const std::vector<std::string>& allow)
+    : m_settings(std::make_shared<mct::HttpConnectSettings>())
+    {
+        for (auto&& rule : allow) {
+            m_settings->allow_list.add(rule);
+        }
+        m_settings->resolver = std::make_shared<mct::CachedResolver>(logger, m_ios, 16, 60);
+
+        mct::ListenerOptions options;
+        options.session_factory = mct::HttpConnectProxy::create_factory(m_settings);
+
+        m_listener = std::make_shared<mct::ProxyListener>(m_ios, logger, "127.0.0.1", listen_port, "0.0.0.0", 0, options);
+        m_listener->async_listen();
+        m_thread = std::thread([this]() { m_ios.run(); });
+    }
+
+    ~HttpConnectServer()
+    {
+        m_ios.stop();
+        m_thread.join();
+    }
+
+private:
+    boost::asio::io_service m_ios;
+    std::shared_ptr<mct::HttpConnectSettings> m_settings;
+    std::shared_ptr<mct::ProxyListener> m_listener;
+    std::thread m_thread;
+};
+
+std::string read_exactly(tcp::socket& socket, size_t length)
+{
+    std::string data(length, '\0');
+    boost::asio::read(socket, boost::asio::buffer(&data[0], length));
+    return data;
+}
+
+/**
+ * Reads the response head, whatever follows it stays in the streambuf.
+ */
+std::string read_response(tcp::socket& socket, boost::asio::streambuf& buffer)
+{
+    size_t length = boost::asio::read_until(socket, buffer, "\r\n\r\n");
+    std::string response(boost::asio::buffers_begin(buffer.data()), boost::asio::buffers_begin(buffer.data()) + length);
+    buffer.consume(length);
+    return response;
+}
+
+bool is_closed(tcp::socket& socket)
+{
+    char data[16];
+    boost::system::error_code error;
+    socket.read_some(boost::asio::buffer(data), error);
+    return error == boost::asio::error::eof || error == boost::asio::error::connection_reset;
+}
+
+mct::HttpConnectParser::Result parse(const std::string& request)
+{
+    mct::HttpConnectParser parser;
+    return parser.parse(reinterpret_cast<const unsigned char*>(request.data()), request.size());
+}
+
+}
+
+void TestModeHttp::test_httpconnectparser_incremental()
+{
+    const std::string request("CONNECT example.com:443 HTTP/1.1\r\nHost: example.com:443\r\nProxy-Connection: keep-alive\r\n\r\n");
+    const std::string pipelined("\x16\x03\x01");
+    const std::string data = request + pipelined;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+
+    // the request arrives byte after byte
+    mct::HttpConnectParser parser;
+    for (size_t length = 1; length < request.size(); ++length) {
+        CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::incomplete, parser.parse(bytes, length));
+    }
+
+    CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::complete, parser.parse(bytes, data.size()));
+    CPPUNIT_ASSERT_EQUAL(request.size(), parser.get_request_length());
+    CPPUNIT_ASSERT_EQUAL(std::string("example.com"), data.substr(parser.get_host_offset(), parser.get_host_length()));
+    CPPUNIT_ASSERT_EQUAL(uint16_t(443), parser.get_port());
+
+    // IPv6 destination, bare line feeds
+    const std::string ipv6_request("CONNECT [::1]:8443 HTTP/1.0\n\n");
+    mct::HttpConnectParser ipv6_parser;
+    CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::complete, ipv6_parser.parse(reinterpret_cast<const unsigned char*>(ipv6_request.data()), ipv6_request.size()));
+    CPPUNIT_ASSERT_EQUAL(std::string("::1"), ipv6_request.substr(ipv6_parser.get_host_offset(), ipv6_parser.get_host_length()));
+    CPPUNIT_ASSERT_EQUAL(uint16_t(8443), ipv6_parser.get_port());
+    CPPUNIT_ASSERT_EQUAL(ipv6_request.size(), ipv6_parser.get_request_length());
+}
+
+void TestModeHttp::test_httpconnectparser_invalid()
+{
+    CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::method_not_allowed, parse("GET http://example.com/ HTTP/1.1\r\n\r\n"));
+    CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::method_not_allowed, parse("CONNECTX example.com:443 HTTP/1.1\r\n\r\n"));
+    CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::bad_request, parse("connect example.com:443 HTTP/1.1\r\n\r\n"));
+    CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::bad_request, parse("CONNECT example.com HTTP/1.1\r\n\r\n"));
+    CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::bad_request, parse("CONNECT example.com:0 HTTP/1.1\r\n\r\n"));
+    CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::bad_request, parse("CONNECT example.com:65536 HTTP/1.1\r\n\r\n"));
+    CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::bad_request, parse("CONNECT exa/mple.com:443 HTTP/1.1\r\n\r\n"));
+    CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::bad_request, parse("CONNECT example.com:443 HTTP/2.0\r\n\r\n"));
+    CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::bad_request, parse("CONNECT example.com:443 HTTP/1.1\r\n folded\r\n\r\n"));
+    CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::bad_request, parse("CONNECT example.com:443 HTTP/1.1\rX"));
+
+    // the result does not change once the request is refused
+    mct::HttpConnectParser parser;
+    const std::string request("GET / HTTP/1.1\r\n\r\n");
+    CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::method_not_allowed, parser.parse(reinterpret_cast<const unsigned char*>(request.data()), 4));
+    CPPUNIT_ASSERT_EQUAL(mct::HttpConnectParser::method_not_allowed, parser.parse(reinterpret_cast<const unsigned char*>(request.data()), request.size()));
+}
+
+void TestModeHttp::test_allowlist_rules()
+{
+    mct::AllowList allow_list;
+
+    CPPUNIT_ASSERT(allow_list.add("*.Example.com:443"));
+    CPPUNIT_ASSERT(allow_list.add("db.internal:5432"));
+    CPPUNIT_ASSERT(allow_list.add("[::1]:8000-8080"));
+    CPPUNIT_ASSERT(allow_list.add("10.0.0.1:*"));
+
+    CPPUNIT_ASSERT(!allow_list.add("example.com"));
+    CPPUNIT_ASSERT(!allow_list.add("example.com:0"));
+    CPPUNIT_ASSERT(!allow_list.add("example.com:99999"));
+    CPPUNIT_ASSERT(!allow_list.add("example.com:80-20"));
+    CPPUNIT_ASSERT(!allow_list.add("ex*ample.com:80"));
+    CPPUNIT_ASSERT(!allow_list.add("::1:80"));
+    CPPUNIT_ASSERT_EQUAL(size_t(4), allow_list.get_num_of_rules());
+
+    CPPUNIT_ASSERT(allow_list.is_allowed("www.example.com", 443));
+    CPPUNIT_ASSERT(allow_list.is_allowed("API.EXAMPLE.COM.", 443));
+    CPPUNIT_ASSERT(!allow_list.is_allowed("example.com", 443));
+    CPPUNIT_ASSERT(!allow_list.is_allowed("www.example.com", 80));
+    CPPUNIT_ASSERT(!allow_list.is_allowed("www.example.com.evil.org", 443));
+    CPPUNIT_ASSERT(!allow_list.is_allowed("wwwexample.com", 443));
+
+    CPPUNIT_ASSERT(allow_list.is_allowed("db.internal", 5432));
+    CPPUNIT_ASSERT(!allow_list.is_allowed("x.db.internal", 5432));
+
+    CPPUNIT_ASSERT(allow_list.is_allowed("::1", 8000));
+    CPPUNIT_ASSERT(allow_list.is_allowed("::1", 8080));
+    CPPUNIT_ASSERT(!allow_list.is_allowed("::1", 8081));
+
+    CPPUNIT_ASSERT(allow_list.is_allowed("10.0.0.1", 22));
+    CPPUNIT_ASSERT(!allow_list.is_allowed("10.0.0.2", 22));
+
+    mct::AllowList empty_list;
+    CPPUNIT_ASSERT(!empty_list.is_allowed("example.com", 443));
+}
+
+void TestModeHttp::test_httpconnectproxy_pipelined()
+{
+    std::string filename("./tmp_modehttp_httpconnectproxy_pipelined.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        HttpConnectServer server(logger, 17220, { "localhost:17221" });
+
+        const auto localhost = boost::asio::ip::address_v4::from_string("127.0.0.1");
+        boost::asio::io_service ios;
+        tcp::acceptor backend(ios, tcp::endpoint(localhost, 17221));
+        tcp::socket client(ios), peer(ios);
+
+        client.connect(tcp::endpoint(localhost, 17220));
+
+        // the request is split in the middle of its first line, the tunnelled bytes follow it without waiting for the response
+        boost::asio::write(client, boost::asio::buffer(std::string("CONNECT local")));
+        boost::asio::write(client, boost::asio::buffer(std::string("host:17221 HTTP/1.1\r\nHost: localhost:17221\r\n\r\nhello")));
+        backend.accept(peer);
+
+        CPPUNIT_ASSERT_EQUAL(std::string("hello"), read_exactly(peer, 5));
+
+        boost::asio::streambuf response;
+        CPPUNIT_ASSERT_EQUAL(std::string("HTTP/1.1 200 Connection established\r\n\r\n"), read_response(client, response));
+
+        boost::asio::write(peer, boost::asio::buffer(std::string("world")));
+        CPPUNIT_ASSERT_EQUAL(std::string("world"), read_exactly(client, 5));
+
+        peer.close();
+        CPPUNIT_ASSERT(is_closed(client));
+    }
+}
+
+void TestModeHttp::test_httpconnectproxy_rejects()
+{
+    std::string filename("./tmp_modehttp_httpconnectproxy_rejects.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        HttpConnectServer server(logger, 17222, { "127.0.0.1:17223" });
+
+        const auto localhost = boost::asio::ip::address_v4::from_string("127.0.0.1");
+        boost::asio::io_service ios;
+
+        auto send_request = [&](const std::string& request) {
+            tcp::socket client(ios);
+            client.connect(tcp::endpoint(localhost, 17222));
+            boost::asio::write(client, boost::asio::buffer(request));
+
+            boost::asio::streambuf buffer;
+            std::string response = read_response(client, buffer);
+            CPPUNIT_ASSERT(is_closed(client));
+            return response.substr(0, response.find("\r\n"));
+        };
+
+        CPPUNIT_ASSERT_EQUAL(std::string("HTTP/1.1 405 Method Not Allowed"), send_request("GET http://127.0.0.1:17223/ HTTP/1.1\r\n\r\n"));
+        CPPUNIT_ASSERT_EQUAL(std::string("HTTP/1.1 400 Bad Request"), send_request("CONNECT 127.0.0.1 HTTP/1.1\r\n\r\n"));
+        CPPUNIT_ASSERT_EQUAL(std::string("HTTP/1.1 403 Forbidden"), send_request("CONNECT 127.0.0.1:22 HTTP/1.1\r\n\r\n"));
+
+        // allowed, but nothing listens at the destination
+        CPPUNIT_ASSERT_EQUAL(std::string("HTTP/1.1 502 Bad Gateway"), send_request("CONNECT 127.0.0.1:17223 HTTP/1.1\r\n\r\n"));
+
+        // the request does not fit into the session buffer (8KB - exactly, so the proxy reads all of it before answering)
+        std::string long_request("CONNECT 127.0.0.1:17223 HTTP/1.1\r\nX-Padding: ");
+        long_request.resize(8192, 'x');
+        CPPUNIT_ASSERT_EQUAL(std::string("HTTP/1.1 431 Request Header Fields Too Large"), send_request(long_request));
+    }
+}
@@ -0,0 +1,657 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file tests/ModeMultiplex/TestModeMultiplex.cpp
+ *
+ * @desc ModeMultiplex application mode tests.
+ */
+
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+#include <Configuration/ConfigurationBuilder.hpp>
+#include <ModeProxy/ProxyListener.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeMultiplex/MultiplexParser.hpp>
+#include <ModeMultiplex/MultiplexPool.hpp>
+#include <ModeMultiplex/MultiplexProxy.hpp>
+
+#include "TestModeMultiplex.hpp"
+
+using boost::asio::ip::tcp;
+
+void TestModeMultiplex::setUp()
+{
+}
+
+void TestModeMultiplex::tearDown()
+{
+}
+
+class ConfigFileReaderHelper
+{
+public:
+    ConfigFileReaderHelper(const std::string& filename, const std::vector<std::string>& keys_values, const int argc, const char** argv)
+    : m_config(argc, (char**)argv), m_filename(filename), m_keys_values(keys_values), m_argc(argc), m_argv(argv)
+    {
+    }
+
+    bool read_file(std::string& message_to_user)
+    {
+        std::ofstream fs;
+
+        std::shared_ptr<std::ofstream> fileGuard(&fs, [&](std::ofstream*)
+        {
+            boost::filesystem::remove(m_filename);
+        });
+
+        fs.open(m_filename);
+        for (auto& keys_values : m_keys_values) {
+            fs << "#" << std::endl;
+            fs << "# Standard comment support" << std::endl;
+            fs << "#" << std::endl;
+            fs << keys_values << std::endl << std::endl;
+        }
+        fs.close();
+
+        mct::ConfigurationBuilder config_builder(m_config);
+
+        return config_builder.build_configuration(message_to_user);
+    }
+
+    mct::Configuration& get_config() { return m_config; }
+
+private:
+    mct::Configuration m_config;
+    std::string m_filename;
+    std::vector<std::string> m_keys_values;
+    const int m_argc;
+    const char** m_argv;
+};
+
+namespace
+{
+
+const auto localhost = boost::asio::ip::address_v4::from_string("127.0.0.1");
+
+struct Message
+{
+    std::string data;
+    std::string command;
+    mct::MultiplexParser::Action action;
+    uint8_t response_kind;
+};
+
+/**
+ * Gives data to the parser in pieces of piece_length bytes, collects the complete messages and returns the result
+ * of the last call.
+ */
+mct::MultiplexParser::Result parse_messages(mct::MultiplexParser& parser, const std::string& data, size_t piece_length, std::vector<Message>& messages)
+{
+    mct::MultiplexParser::Result result = mct::MultiplexParser::incomplete;
+    std::string message;
+
+    for (size_t offset = 0; offset < data.size(); offset += piece_length) {
+        const size_t end = std::min(data.size(), offset + piece_length);
+
+        for (size_t position = offset; position < end; ) {
+            size_t consumed = 0;
+            result = parser.parse(reinterpret_cast<const unsigned char*>(data.data()) + position, end - position, consumed);
+            if (result == mct::MultiplexParser::invalid) {
+                return result;
+            }
+
+            message.append(data, position, consumed);
+            position += consumed;
+
+            if (result == mct::MultiplexParser::complete) {
+                messages.push_back(Message{message, parser.get_command(), parser.get_action(), parser.get_response_kind()});
+                message.clear();
+            }
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Runs a multiplex listener and its pool on their own thread, the tests use blocking sockets of another io_service.
+ */
+class MultiplexServer
+{
+public:
+    MultiplexServer(mct::Logger& logger, mct::MultiplexParser::Protocol protocol, uint16_t listen_port, uint16_t backend_port)
+    {
+        auto settings = std::make_shared<mct::MultiplexSettings>();
+        settings->pool = std::make_shared<mct::MultiplexPool>(logger, m_ios, protocol, "127.0.0.1", backend_port, 1);
+        settings->protocol = protocol;
+        settings->pool->start();
+
+        mct::ListenerOptions options;
+        options.session_factory = mct::MultiplexProxy::create_factory(settings);
+
+        m_listener = std::make_shared<mct::ProxyListener>(m_ios, logger, "127.0.0.1", listen_port, "0.0.0.0", 0, options);
+        m_listener->async_listen();
+
+        m_thread = std::thread([this]() { m_ios.run(); });
+    }
+
+    ~MultiplexServer()
+    {
+        m_ios.stop();
+        m_thread.join();
+    }
+
+private:
+    boost::asio::io_service m_ios;
+    std::shared_ptr<mct::ProxyListener> m_listener;
+    std::thread m_thread;
+};
+
+std::string read_exactly(tcp::socket& socket, size_t length)
+{
+    std::string data(length, '\0');
+    boost::asio::read(socket, boost::asio::buffer(&data[0], length));
+    return data;
+}
+
+void write(tcp::socket& socket, const std::string& data)
+{
+    boost::asio::write(socket, boost::asio::buffer(data));
+}
+
+bool is_closed(tcp::socket& socket)
+{
+    char data[16];
+    boost::system::error_code error;
+    socket.read_some(boost::asio::buffer(data), error);
+    return error == boost::asio::error::eof || error == boost::asio::error::connection_reset;
+}
+
+}
+
+void TestModeMultiplex::test_respparser_requests()
+{
+    const std::string pipeline("*2\r\n$3\r\nGET\r\n$3\r\nkey\r\n*3\r\n$3\r\nsEt\r\n$1\r\nk\r\n$5\r\nva\r\nl\r\n");
+
+    // the bulk of the last request holds a CRLF
+    for (const size_t piece_length : { size_t(1), size_t(7), pipeline.size() }) {
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::redis, true);
+        std::vector<Message> messages;
+
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::complete, parse_messages(*parser, pipeline, piece_length, messages));
+        CPPUNIT_ASSERT_EQUAL(size_t(2), messages.size());
+        CPPUNIT_ASSERT_EQUAL(std::string("*2\r\n$3\r\nGET\r\n$3\r\nkey\r\n"), messages[0].data);
+        CPPUNIT_ASSERT_EQUAL(std::string("get"), messages[0].command);
+        CPPUNIT_ASSERT_EQUAL(std::string("set"), messages[1].command);
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::forward, messages[1].action);
+    }
+
+    {
+        // inline commands, a blank line goes with the next command
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::redis, true);
+        std::vector<Message> messages;
+
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::complete, parse_messages(*parser, "PING\r\n\r\nset a  b\r\n", 3, messages));
+        CPPUNIT_ASSERT_EQUAL(size_t(2), messages.size());
+        CPPUNIT_ASSERT_EQUAL(std::string("ping"), messages[0].command);
+        CPPUNIT_ASSERT_EQUAL(std::string("\r\nset a  b\r\n"), messages[1].data);
+        CPPUNIT_ASSERT_EQUAL(std::string("set"), messages[1].command);
+    }
+
+    {
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::redis, true);
+        std::vector<Message> messages;
+
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::complete,
+            parse_messages(*parser, "*1\r\n$5\r\nMULTI\r\n*2\r\n$9\r\nsubscribe\r\n$1\r\nc\r\nblpop l 0\r\n*1\r\n$4\r\nQuIt\r\nXREAD BLOCK 0 STREAMS s $\r\n", 1000, messages));
+        CPPUNIT_ASSERT_EQUAL(size_t(5), messages.size());
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::refuse, messages[0].action);
+        CPPUNIT_ASSERT_EQUAL(std::string("multi"), messages[0].command);
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::refuse, messages[1].action);
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::refuse, messages[2].action);
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::quit, messages[3].action);
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::refuse, messages[4].action);
+    }
+
+    {
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::redis, true);
+        std::vector<Message> messages;
+
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::incomplete, parse_messages(*parser, "*2\r\n$3\r\nGET\r\n", 1000, messages));
+        CPPUNIT_ASSERT(messages.empty());
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::invalid, parse_messages(*parser, "$x\r\n", 1000, messages));
+    }
+
+    for (const size_t piece_length : { size_t(1), size_t(1000) }) {
+        // the bulk string is followed by something else than its CRLF
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::redis, true);
+        std::vector<Message> messages;
+
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::invalid, parse_messages(*parser, "*2\r\n$3\r\nGET\r\n$1\r\nkXY", piece_length, messages));
+        CPPUNIT_ASSERT(messages.empty());
+    }
+
+    {
+        // lengths which do not fit in 64 bits
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::redis, true);
+        std::vector<Message> messages;
+
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::invalid, parse_messages(*parser, "*99999999999999999999\r\n", 1000, messages));
+    }
+
+    {
+        // requests do not nest, so a client cannot make the parser follow aggregates without end
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::redis, true);
+        std::vector<Message> messages;
+
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::invalid, parse_messages(*parser, "*2\r\n$3\r\nGET\r\n*1\r\n", 1000, messages));
+        CPPUNIT_ASSERT(messages.empty());
+    }
+
+    {
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::redis, true);
+        std::vector<Message> messages;
+
+        std::string nested;
+        for (int i = 0; i < 100000; ++i) {
+            nested += "*1\r\n";
+        }
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::invalid, parse_messages(*parser, nested, 1000, messages));
+    }
+}
+
+void TestModeMultiplex::test_respparser_responses()
+{
+    // simple values, null bulk and array, a bulk holding a CRLF, nested aggregates, an attribute with its value, RESP3 null
+    const std::string responses("+OK\r\n-ERR x\r\n:12\r\n$-1\r\n*-1\r\n$5\r\nab\r\nc\r\n*2\r\n*1\r\n:1\r\n%1\r\n+k\r\n$1\r\nv\r\n|1\r\n+ttl\r\n:3\r\n:4\r\n_\r\n");
+
+    for (const size_t piece_length : { size_t(1), responses.size() }) {
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::redis, false);
+        std::vector<Message> messages;
+
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::complete, parse_messages(*parser, responses, piece_length, messages));
+        CPPUNIT_ASSERT_EQUAL(size_t(9), messages.size());
+        CPPUNIT_ASSERT_EQUAL(std::string("$5\r\nab\r\nc\r\n"), messages[5].data);
+        CPPUNIT_ASSERT_EQUAL(std::string("*2\r\n*1\r\n:1\r\n%1\r\n+k\r\n$1\r\nv\r\n"), messages[6].data);
+        CPPUNIT_ASSERT_EQUAL(std::string("|1\r\n+ttl\r\n:3\r\n:4\r\n"), messages[7].data);
+        CPPUNIT_ASSERT_EQUAL(std::string("_\r\n"), messages[8].data);
+    }
+
+    {
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::redis, false);
+        std::vector<Message> messages;
+
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::incomplete, parse_messages(*parser, "*3\r\n:1\r\n", 1000, messages));
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::invalid, parse_messages(*parser, "?\r\n", 1000, messages));
+    }
+
+    CPPUNIT_ASSERT_EQUAL(std::string("-ERR backend unavailable\r\n"), mct::MultiplexParser::make_error_reply(mct::MultiplexParser::redis, "backend unavailable", false));
+}
+
+void TestModeMultiplex::test_memcachedparser_requests()
+{
+    const std::string pipeline("set k 0 0 5 noreply\r\nhel\r\n\r\nget a b\r\ncas k 1 0 2 77\r\nab\r\nstats\r\nms k 2 T0\r\nxy\r\nmn\r\n");
+
+    for (const size_t piece_length : { size_t(1), size_t(5), pipeline.size() }) {
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::memcached, true);
+        std::vector<Message> messages;
+
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::complete, parse_messages(*parser, pipeline, piece_length, messages));
+        CPPUNIT_ASSERT_EQUAL(size_t(6), messages.size());
+
+        // the data block holds a CRLF
+        CPPUNIT_ASSERT_EQUAL(std::string("set k 0 0 5 noreply\r\nhel\r\n\r\n"), messages[0].data);
+        CPPUNIT_ASSERT_EQUAL(uint8_t(mct::MultiplexParser::no_response), messages[0].response_kind);
+        CPPUNIT_ASSERT_EQUAL(std::string("get"), messages[1].command);
+        CPPUNIT_ASSERT(messages[1].response_kind != messages[2].response_kind);
+        CPPUNIT_ASSERT_EQUAL(std::string("cas k 1 0 2 77\r\nab\r\n"), messages[2].data);
+        CPPUNIT_ASSERT_EQUAL(std::string("stats"), messages[3].command);
+        CPPUNIT_ASSERT_EQUAL(std::string("ms k 2 T0\r\nxy\r\n"), messages[4].data);
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::forward, messages[5].action);
+    }
+
+    {
+        // quiet meta commands answer only some of the requests, watch never stops answering
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::memcached, true);
+        std::vector<Message> messages;
+
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::complete, parse_messages(*parser, "mg k v q\r\nwatch\r\nquit\r\n", 1000, messages));
+        CPPUNIT_ASSERT_EQUAL(size_t(3), messages.size());
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::refuse, messages[0].action);
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::refuse, messages[1].action);
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::quit, messages[2].action);
+    }
+
+    {
+        // memcached answers these with ERROR, noreply or not
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::memcached, true);
+        std::vector<Message> messages;
+
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::complete,
+            parse_messages(*parser, "foo noreply\r\nincr k noreply\r\nincr k 1 noreply\r\ndelete k noreply\r\ntouch k 1 2 noreply\r\n", 1000, messages));
+        CPPUNIT_ASSERT_EQUAL(size_t(5), messages.size());
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::refuse, messages[0].action);
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::refuse, messages[1].action);
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::forward, messages[2].action);
+        CPPUNIT_ASSERT_EQUAL(uint8_t(mct::MultiplexParser::no_response), messages[2].response_kind);
+        CPPUNIT_ASSERT_EQUAL(uint8_t(mct::MultiplexParser::no_response), messages[3].response_kind);
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::refuse, messages[4].action);
+    }
+
+    // a data block which does not end with CRLF, a storage command with too many arguments
+    for (const std::string request : { "set k 0 0\r\n", "set k 0 0 x\r\n", "cas k 0 0 1\r\n", "set k 0 0 1\r\nabc\r\n", "set k 0 0 1 2 noreply\r\n" }) {
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::memcached, true);
+        std::vector<Message> messages;
+
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::invalid, parse_messages(*parser, request, 1000, messages));
+    }
+}
+
+void TestModeMultiplex::test_memcachedparser_responses()
+{
+    auto requests = mct::MultiplexParser::create(mct::MultiplexParser::memcached, true);
+    std::vector<Message> kinds;
+    CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::complete, parse_messages(*requests, "gets a b\r\nstats\r\nmg k v\r\ndelete k\r\n", 1000, kinds));
+    CPPUNIT_ASSERT_EQUAL(size_t(4), kinds.size());
+
+    const std::vector<std::string> responses = {
+        "VALUE a 0 3 1\r\nEND\r\nVALUE b 5 0 2\r\n\r\nEND\r\n",
+        "STAT pid 1\r\nSTAT uptime 2\r\nEND\r\n",
+        "VA 4\r\nEND!\r\n",
+        "NOT_FOUND\r\n"
+    };
+
+    for (const size_t piece_length : { size_t(1), size_t(1000) }) {
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::memcached, false);
+
+        for (size_t i = 0; i < responses.size(); ++i) {
+            std::vector<Message> messages;
+            parser->set_response_kind(kinds[i].response_kind);
+
+            // the data blocks hold what looks like the end of the response
+            CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::complete, parse_messages(*parser, responses[i], piece_length, messages));
+            CPPUNIT_ASSERT_EQUAL(size_t(1), messages.size());
+            CPPUNIT_ASSERT_EQUAL(responses[i], messages[0].data);
+        }
+    }
+
+    {
+        // an error ends any response
+        auto parser = mct::MultiplexParser::create(mct::MultiplexParser::memcached, false);
+        std::vector<Message> messages;
+        parser->set_response_kind(kinds[0].response_kind);
+
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::complete, parse_messages(*parser, "SERVER_ERROR out of memory\r\n", 1000, messages));
+        CPPUNIT_ASSERT_EQUAL(size_t(1), messages.size());
+
+        parser->set_response_kind(kinds[0].response_kind);
+        CPPUNIT_ASSERT_EQUAL(mct::MultiplexParser::invalid, parse_messages(*parser, "VALUE a 0 -1\r\n", 1000, messages));
+    }
+
+    CPPUNIT_ASSERT_EQUAL(std::string("CLIENT_ERROR bad\r\n"), mct::MultiplexParser::make_error_reply(mct::MultiplexParser::memcached, "bad", true));
+}
+
+void TestModeMultiplex::test_multiplexproxy_redis()
+{
+    std::string filename("./tmp_modemultiplex_multiplexproxy_redis.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        boost::asio::io_service ios;
+        tcp::acceptor backend(ios, tcp::endpoint(localhost, 17271));
+        MultiplexServer server(logger, mct::MultiplexParser::redis, 17270, 17271);
+
+        // the single pool connection carries the requests of both clients
+        tcp::socket peer(ios);
+        backend.accept(peer);
+
+        tcp::socket first(ios), second(ios);
+        first.connect(tcp::endpoint(localhost, 17270));
+        second.connect(tcp::endpoint(localhost, 17270));
+
+        const std::string get_a("*2\r\n$3\r\nGET\r\n$1\r\na\r\n");
+        const std::string get_b("*2\r\n$3\r\nGET\r\n$1\r\nb\r\n");
+        write(first, get_a);
+        CPPUNIT_ASSERT_EQUAL(get_a, read_exactly(peer, get_a.size()));
+        write(second, get_b);
+        CPPUNIT_ASSERT_EQUAL(get_b, read_exactly(peer, get_b.size()));
+
+        // the responses are split in the middle of the second one
+        write(peer, "$1\r\nA\r\n$1\r");
+        CPPUNIT_ASSERT_EQUAL(std::string("$1\r\nA\r\n"), read_exactly(first, 7));
+        write(peer, "\nB\r\n");
+        CPPUNIT_ASSERT_EQUAL(std::string("$1\r\nB\r\n"), read_exactly(second, 7));
+
+        // a pipeline with a refused command in the middle, its error reply keeps its place
+        write(first, "PING\r\n*1\r\n$5\r\nMULTI\r\n*2\r\n$3\r\nGET\r\n$1\r\nc\r\n");
+        const std::string forwarded("PING\r\n*2\r\n$3\r\nGET\r\n$1\r\nc\r\n");
+        CPPUNIT_ASSERT_EQUAL(forwarded, read_exactly(peer, forwarded.size()));
+
+        write(peer, "+PONG\r\n*2\r\n$1\r\nx\r\n:5\r\n");
+        const std::string replies("+PONG\r\n-ERR command 'multi' is not supported by the multiplexer\r\n*2\r\n$1\r\nx\r\n:5\r\n");
+        CPPUNIT_ASSERT_EQUAL(replies, read_exactly(first, replies.size()));
+
+        // QUIT closes the client, not the backend connection
+        write(first, "*1\r\n$4\r\nQUIT\r\n");
+        CPPUNIT_ASSERT_EQUAL(std::string("+OK\r\n"), read_exactly(first, 5));
+        CPPUNIT_ASSERT(is_closed(first));
+
+        // the request waiting on a lost connection is answered with an error, the pool connects again
+        const std::string get_d("*2\r\n$3\r\nGET\r\n$1\r\nd\r\n");
+        write(second, get_d);
+        CPPUNIT_ASSERT_EQUAL(get_d, read_exactly(peer, get_d.size()));
+        peer.close();
+
+        const std::string lost("-ERR backend connection lost\r\n");
+        CPPUNIT_ASSERT_EQUAL(lost, read_exactly(second, lost.size()));
+
+        tcp::socket reconnected(ios);
+        backend.accept(reconnected);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        write(second, get_a);
+        CPPUNIT_ASSERT_EQUAL(get_a, read_exactly(reconnected, get_a.size()));
+        write(reconnected, "$-1\r\n");
+        CPPUNIT_ASSERT_EQUAL(std::string("$-1\r\n"), read_exactly(second, 5));
+    }
+}
+
+void TestModeMultiplex::test_multiplexproxy_memcached()
+{
+    std::string filename("./tmp_modemultiplex_multiplexproxy_memcached.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        boost::asio::io_service ios;
+        tcp::acceptor backend(ios, tcp::endpoint(localhost, 17273));
+        MultiplexServer server(logger, mct::MultiplexParser::memcached, 17272, 17273);
+
+        tcp::socket peer(ios);
+        backend.accept(peer);
+
+        tcp::socket client(ios);
+        client.connect(tcp::endpoint(localhost, 17272));
+
+        // noreply gets no reply slot, the value belongs to the get
+        const std::string requests("set k 0 0 5 noreply\r\nhello\r\nget k\r\n");
+        write(client, requests);
+        CPPUNIT_ASSERT_EQUAL(requests, read_exactly(peer, requests.size()));
+
+        const std::string value("VALUE k 0 5\r\nhello\r\nEND\r\n");
+        write(peer, value);
+        CPPUNIT_ASSERT_EQUAL(value, read_exactly(client, value.size()));
+
+        write(client, "watch\r\nmn\r\n");
+        CPPUNIT_ASSERT_EQUAL(std::string("mn\r\n"), read_exactly(peer, 4));
+        write(peer, "MN\r\n");
+        const std::string replies("CLIENT_ERROR command 'watch' is not supported by the multiplexer\r\nMN\r\n");
+        CPPUNIT_ASSERT_EQUAL(replies, read_exactly(client, replies.size()));
+
+        write(client, "quit\r\n");
+        CPPUNIT_ASSERT(is_closed(client));
+
+        // a client which has finished sending still gets its pending replies
+        tcp::socket finished(ios);
+        finished.connect(tcp::endpoint(localhost, 17272));
+        write(finished, "get z\r\n");
+        finished.shutdown(tcp::socket::shutdown_send);
+
+        CPPUNIT_ASSERT_EQUAL(std::string("get z\r\n"), read_exactly(peer, 7));
+        write(peer, "END\r\n");
+        CPPUNIT_ASSERT_EQUAL(std::string("END\r\n"), read_exactly(finished, 5));
+        CPPUNIT_ASSERT(is_closed(finished));
+    }
+}
+
+void TestModeMultiplex::test_multiplexproxy_reply_backlog()
+{
+    std::string filename("./tmp_modemultiplex_multiplexproxy_reply_backlog.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        boost::asio::io_service ios;
+        tcp::acceptor backend(ios, tcp::endpoint(localhost, 17331));
+        MultiplexServer server(logger, mct::MultiplexParser::redis, 17330, 17331);
+
+        tcp::socket peer(ios);
+        backend.accept(peer);
+
+        // the slow client does not read its replies until it is told to
+        tcp::socket slow(ios), other(ios);
+        slow.open(tcp::v4());
+        slow.set_option(boost::asio::socket_base::receive_buffer_size(4096));
+        slow.connect(tcp::endpoint(localhost, 17330));
+        other.connect(tcp::endpoint(localhost, 17330));
+
+        const std::string get_a("*2\r\n$3\r\nGET\r\n$1\r\na\r\n");
+        write(slow, get_a);
+        CPPUNIT_ASSERT_EQUAL(get_a, read_exactly(peer, get_a.size()));
+
+        // larger than what the socket buffers take, so most of it stays with the session
+        const std::string large_reply("$16777216\r\n" + std::string(16 * 1024 * 1024, 'a') + "\r\n");
+        write(peer, large_reply);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        // with a megabyte of replies waiting, the next request of the slow client is not taken
+        const std::string get_b("*2\r\n$3\r\nGET\r\n$1\r\nb\r\n");
+        write(slow, get_b);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        CPPUNIT_ASSERT_EQUAL(size_t(0), peer.available());
+
+        // the other client shares the backend connection, which keeps going
+        const std::string get_c("*2\r\n$3\r\nGET\r\n$1\r\nc\r\n");
+        write(other, get_c);
+        CPPUNIT_ASSERT_EQUAL(get_c, read_exactly(peer, get_c.size()));
+        write(peer, "$1\r\nC\r\n");
+        CPPUNIT_ASSERT_EQUAL(std::string("$1\r\nC\r\n"), read_exactly(other, 7));
+
+        // once the reply is taken, the waiting request goes on
+        CPPUNIT_ASSERT(large_reply == read_exactly(slow, large_reply.size()));
+        CPPUNIT_ASSERT_EQUAL(get_b, read_exactly(peer, get_b.size()));
+        write(peer, "$1\r\nB\r\n");
+        CPPUNIT_ASSERT_EQUAL(std::string("$1\r\nB\r\n"), read_exactly(slow, 7));
+
+        // a reply which outgrows the backlog limit closes the client which does not take it
+        const std::string get_d("*2\r\n$3\r\nGET\r\n$1\r\nd\r\n");
+        write(slow, get_d);
+        CPPUNIT_ASSERT_EQUAL(get_d, read_exactly(peer, get_d.size()));
+
+        // the socket buffers take a few dozen megabytes of it as well
+        const std::string huge_reply("$134217728\r\n" + std::string(128 * 1024 * 1024, 'd') + "\r\n");
+        write(peer, huge_reply);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        std::string received;
+        boost::system::error_code error;
+        std::vector<char> data(1024 * 1024);
+        while (!error) {
+            received.append(data.data(), slow.read_some(boost::asio::buffer(data), error));
+        }
+        CPPUNIT_ASSERT(received.size() < huge_reply.size());
+
+        write(other, get_c);
+        CPPUNIT_ASSERT_EQUAL(get_c, read_exactly(peer, get_c.size()));
+        write(peer, "$1\r\nC\r\n");
+        CPPUNIT_ASSERT_EQUAL(std::string("$1\r\nC\r\n"), read_exactly(other, 7));
+    }
+}
@@ -31,11 +31,23 @@
 #include <thread>
 #include <memory>
 #include <vector>
+#include <atomic>
+#include <fstream>
+#include <csignal>
 
 #define WIN32_LEAN_AND_MEAN
 
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
 #include <boost/filesystem.hpp>
 #include <boost/process/all.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
 
 #include <Mode/Mode.hpp>
 #include <Logger/Logger.hpp>
@@ -43,6 +55,18 @@
 #include <Configuration/Configuration.hpp>
 #include <Configuration/ConfigurationBuilder.hpp>
 #include <ModeProxy/IPResolver.hpp>
+#include <ModeProxy/ShadowSink.hpp>
+#include <ModeProxy/Proxy.hpp>
+#include <ModeProxy/ProxyRoute.hpp>
+#include <ModeProxy/ProxyListener.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeProxy/ListenerHandoff.hpp>
+#include <ModeProxy/SocketOptions.hpp>
+#include <ModeProxy/SessionSlab.hpp>
+#include <ModeProxy/AffinityTable.hpp>
+#include <ModeProxy/ProxyProtocol.hpp>
+#include <ModeProxy/StreamEndpoint.hpp>
+#include <ModeProxy/PortRange.hpp>
 
 #include "TestModeProxy.hpp"
 
@@ -101,6 +125,33 @@ private:
     const char** m_argv;
 };
 
+/**
+ * Logger of a test which neither writes a log file nor prints anything.
+ */
+class TestLogger
+{
+public:
+    explicit TestLogger(const std::string& filename)
+    : m_filename(filename), m_argv{ "mct", "-c", m_filename.c_str() }, m_helper(m_filename, { "log.nofile = 1", "log.silent = 1" }, 3, m_argv)
+    {
+        std::string message_to_user;
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, true, m_helper.read_file(message_to_user));
+        CPPUNIT_ASSERT_EQUAL(std::string("Mattsource's Connection Tunneler v. 0.1.0-dev"), message_to_user);
+
+        message_to_user.clear();
+        m_logger.reset(new mct::Logger(m_helper.get_config()));
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, true, m_logger->initialize(message_to_user));
+    }
+
+    mct::Logger& get() { return *m_logger; }
+
+private:
+    std::string m_filename;
+    const char* m_argv[3];
+    ConfigFileReaderHelper m_helper;
+    std::unique_ptr<mct::Logger> m_logger;
+};
+
 void TestModeProxy::test_modeproxy_error_local_port_already_bound()
 {
     std::cout << std::endl;
@@ -213,3 +264,1412 @@ void TestModeProxy::test_ipresolver_localhost()
         }
     }
 }
+
+void TestModeProxy::test_shadowsink_bounded_buffer()
+{
+    TestLogger test_logger("./tmp_modeproxy_shadowsink_bounded_buffer.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    boost::asio::io_service ios;
+    boost::asio::ip::tcp::acceptor shadow_acceptor(ios, boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 17181));
+    boost::asio::ip::tcp::socket shadow_peer(ios);
+
+    const unsigned char first_chunk[10] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    const unsigned char second_chunk[10] = { 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j' };
+
+    auto shadow = std::make_shared<mct::ShadowSink>(logger, ios, "127.0.0.1", 17181, 16);
+    shadow->start();
+
+    // nothing is connected yet, so both chunks are queued - and the second one does not fit entirely
+    shadow->push(first_chunk, sizeof(first_chunk));
+    shadow->push(second_chunk, sizeof(second_chunk));
+    CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(4), shadow->get_dropped_bytes());
+
+    shadow_acceptor.accept(shadow_peer);
+    shadow->close();
+    ios.run();
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(16), shadow->get_forwarded_bytes());
+
+    std::string received;
+    boost::system::error_code error;
+    char data[64];
+
+    while (!error) {
+        size_t length = shadow_peer.read_some(boost::asio::buffer(data), error);
+        received.append(data, length);
+    }
+
+    CPPUNIT_ASSERT_EQUAL(std::string("0123456789abcdef"), received);
+}
+
+void TestModeProxy::test_shadowsink_unreachable()
+{
+    TestLogger test_logger("./tmp_modeproxy_shadowsink_unreachable.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    boost::asio::io_service ios;
+    const unsigned char chunk[8] = { 's', 'h', 'a', 'd', 'o', 'w', '!', '!' };
+
+    // nobody listens on this port, so the connection is refused
+    auto shadow = std::make_shared<mct::ShadowSink>(logger, ios, "127.0.0.1", 17182, 1024);
+    shadow->start();
+    ios.run();
+
+    shadow->push(chunk, sizeof(chunk));
+    shadow->push(chunk, sizeof(chunk));
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(0), shadow->get_forwarded_bytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(16), shadow->get_dropped_bytes());
+}
+
+void TestModeProxy::test_shadowsink_close_timeout()
+{
+    TestLogger test_logger("./tmp_modeproxy_shadowsink_close_timeout.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    boost::asio::io_service ios;
+    boost::asio::ip::tcp::acceptor shadow_acceptor(ios);
+    const boost::asio::ip::tcp::endpoint shadow_endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 17183);
+    shadow_acceptor.open(shadow_endpoint.protocol());
+    shadow_acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+    // small receive buffer, so the queued bytes cannot all disappear into the kernel
+    shadow_acceptor.set_option(boost::asio::socket_base::receive_buffer_size(4096));
+    shadow_acceptor.bind(shadow_endpoint);
+    shadow_acceptor.listen();
+
+    // the shadow backend accepts the connection, but never reads from it
+    boost::asio::ip::tcp::socket shadow_peer(ios);
+
+    const uint64_t total_length = 8 * 1024 * 1024;
+    auto shadow = std::make_shared<mct::ShadowSink>(logger, ios, "127.0.0.1", 17183, total_length, 200);
+    shadow->start();
+    shadow_acceptor.accept(shadow_peer);
+
+    const std::vector<unsigned char> chunk(64 * 1024, 'x');
+    for (uint64_t pushed = 0; pushed < total_length; pushed += chunk.size()) {
+        shadow->push(chunk.data(), chunk.size());
+        ios.poll();
+        ios.reset();
+    }
+
+    const auto closed_at = std::chrono::steady_clock::now();
+    shadow->close();
+    // returns only when nothing is pending on the shadow connection anymore
+    ios.run();
+
+    CPPUNIT_ASSERT(std::chrono::steady_clock::now() - closed_at < std::chrono::seconds(3));
+    CPPUNIT_ASSERT(shadow->get_dropped_bytes() > 0);
+    CPPUNIT_ASSERT_EQUAL(total_length, shadow->get_forwarded_bytes() + shadow->get_dropped_bytes());
+    // no handler keeps the sink (and its queue) alive anymore
+    CPPUNIT_ASSERT_EQUAL(1L, shadow.use_count());
+}
+
+/**
+ * Runs ready handlers until the acceptor gets a connection (or a second passes).
+ */
+bool accept_while_polling(boost::asio::io_service& ios, boost::asio::ip::tcp::acceptor& acceptor, boost::asio::ip::tcp::socket& peer)
+{
+    acceptor.non_blocking(true);
+
+    for (int i = 0; i < 100; ++i) {
+        ios.poll();
+        ios.reset();
+
+        boost::system::error_code error;
+        acceptor.accept(peer, error);
+        if (!error) {
+            return true;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return false;
+}
+
+/**
+ * Sends data from client through the listener's session and returns what the backend peer received.
+ */
+std::string forward_while_polling(boost::asio::io_service& ios, boost::asio::ip::tcp::socket& client, boost::asio::ip::tcp::socket& peer, const std::string& data)
+{
+    boost::asio::write(client, boost::asio::buffer(data));
+
+    for (int i = 0; i < 100 && peer.available() < data.size(); ++i) {
+        ios.poll();
+        ios.reset();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::string received(peer.available(), '\0');
+    if (!received.empty()) {
+        peer.read_some(boost::asio::buffer(&received[0], received.size()));
+    }
+
+    return received;
+}
+
+void TestModeProxy::test_proxylistener_set_route()
+{
+    TestLogger test_logger("./tmp_modeproxy_proxylistener_set_route.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    using boost::asio::ip::tcp;
+    const auto localhost = boost::asio::ip::address::from_string("127.0.0.1");
+
+    boost::asio::io_service ios;
+    tcp::acceptor first_backend(ios, tcp::endpoint(localhost, 17184));
+    tcp::acceptor second_backend(ios, tcp::endpoint(localhost, 17185));
+    tcp::socket first_client(ios), first_peer(ios), second_client(ios), second_peer(ios);
+
+    auto listener = std::make_shared<mct::ProxyListener>(ios, logger, "127.0.0.1", 17183, "127.0.0.1", 17184, mct::ListenerOptions());
+    listener->async_listen();
+
+    first_client.connect(tcp::endpoint(localhost, 17183));
+    CPPUNIT_ASSERT_EQUAL(true, accept_while_polling(ios, first_backend, first_peer));
+
+    // the listener is already waiting for the next connection with the previous route
+    listener->set_route("127.0.0.1", 17185, mct::ListenerOptions());
+    CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(17185), listener->get_remote_port());
+
+    second_client.connect(tcp::endpoint(localhost, 17183));
+    CPPUNIT_ASSERT_EQUAL(true, accept_while_polling(ios, second_backend, second_peer));
+
+    CPPUNIT_ASSERT_EQUAL(std::string("second"), forward_while_polling(ios, second_client, second_peer, "second"));
+    // the established session keeps its backend
+    CPPUNIT_ASSERT_EQUAL(std::string("first"), forward_while_polling(ios, first_client, first_peer, "first"));
+}
+
+void TestModeProxy::test_proxylistener_stop()
+{
+    TestLogger test_logger("./tmp_modeproxy_proxylistener_stop.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    using boost::asio::ip::tcp;
+    const auto localhost = boost::asio::ip::address::from_string("127.0.0.1");
+
+    boost::asio::io_service ios;
+    tcp::acceptor backend(ios, tcp::endpoint(localhost, 17187));
+    tcp::socket client(ios), peer(ios), late_client(ios);
+
+    auto listener = std::make_shared<mct::ProxyListener>(ios, logger, "127.0.0.1", 17186, "127.0.0.1", 17187, mct::ListenerOptions());
+    listener->async_listen();
+
+    client.connect(tcp::endpoint(localhost, 17186));
+    CPPUNIT_ASSERT_EQUAL(true, accept_while_polling(ios, backend, peer));
+
+    listener->stop();
+    ios.poll();
+    ios.reset();
+
+    CPPUNIT_ASSERT_EQUAL(true, listener->is_stopped());
+    CPPUNIT_ASSERT_EQUAL(true, listener->is_dead());
+
+    boost::system::error_code error;
+    late_client.connect(tcp::endpoint(localhost, 17186), error);
+    CPPUNIT_ASSERT_EQUAL(true, !!error);
+
+    // the established session is drained, not dropped
+    CPPUNIT_ASSERT_EQUAL(std::string("still here"), forward_while_polling(ios, client, peer, "still here"));
+}
+
+void TestModeProxy::test_listenerhandoff_takeover()
+{
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    TestLogger test_logger("./tmp_modeproxy_listenerhandoff_takeover.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    using boost::asio::ip::tcp;
+    const std::string socket_path("./tmp_modeproxy_listenerhandoff.sock");
+    const auto localhost = boost::asio::ip::address::from_string("127.0.0.1");
+
+    // the previous instance: serves its listening socket from its own io_service thread
+    boost::asio::io_service previous_ios;
+    tcp::acceptor previous_acceptor(previous_ios, tcp::endpoint(localhost, 17188));
+    bool is_handed_off = false;
+
+    {   // nobody serves the handoff socket yet
+        boost::asio::io_service ios;
+        auto handoff = std::make_shared<mct::ListenerHandoff>(logger, ios, socket_path);
+        CPPUNIT_ASSERT_EQUAL(true, handoff->receive_listeners().empty());
+    }
+
+    auto previous_handoff = std::make_shared<mct::ListenerHandoff>(logger, previous_ios, socket_path);
+    previous_handoff->serve([&]() {
+        mct::ListenerHandoff::handles_type handles;
+        handles["127.0.0.1:17188"] = previous_acceptor.native_handle();
+        return handles;
+    }, [&]() {
+        is_handed_off = true;
+        previous_acceptor.close();
+    });
+
+    std::thread previous_instance([&]() { previous_ios.run(); });
+
+    boost::asio::io_service ios;
+    auto handoff = std::make_shared<mct::ListenerHandoff>(logger, ios, socket_path);
+    mct::ListenerHandoff::handles_type handles = handoff->receive_listeners();
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), handles.size());
+    CPPUNIT_ASSERT_EQUAL(true, handles.count("127.0.0.1:17188") == 1);
+
+    tcp::acceptor acceptor(ios, tcp::v4(), handles["127.0.0.1:17188"]);
+    handoff->confirm_takeover();
+
+    // serving ends with the takeover, so the previous io_service runs out of work
+    previous_instance.join();
+    CPPUNIT_ASSERT_EQUAL(true, is_handed_off);
+
+    // the socket survived closing the previous instance's descriptor
+    tcp::socket client(ios), peer(ios);
+    client.connect(tcp::endpoint(localhost, 17188));
+    acceptor.accept(peer);
+    CPPUNIT_ASSERT_EQUAL(static_cast<unsigned short>(17188), acceptor.local_endpoint().port());
+
+    boost::filesystem::remove(socket_path);
+#endif
+}
+
+namespace
+{
+
+/**
+ * The client half-closes after its request, the backend answers only then - the whole answer must arrive.
+ */
+void exchange_after_half_close(mct::Logger& logger, const mct::ListenerOptions& options, uint16_t listen_port, uint16_t remote_port)
+{
+    using boost::asio::ip::tcp;
+    const auto localhost = boost::asio::ip::address::from_string("127.0.0.1");
+
+    // the proxy runs on its own thread, the test uses blocking sockets of another io_service
+    boost::asio::io_service proxy_ios;
+    auto listener = std::make_shared<mct::ProxyListener>(proxy_ios, logger, "127.0.0.1", listen_port, "127.0.0.1", remote_port, options);
+    listener->async_listen();
+    std::thread proxy_thread([&]() { proxy_ios.run(); });
+
+    boost::asio::io_service ios;
+    tcp::acceptor backend(ios, tcp::endpoint(localhost, remote_port));
+    tcp::socket client(ios), peer(ios);
+
+    client.connect(tcp::endpoint(localhost, listen_port));
+    backend.accept(peer);
+
+    // the client sends its request and shuts down its sending side
+    boost::asio::write(client, boost::asio::buffer(std::string("request")));
+    client.shutdown(tcp::socket::shutdown_send);
+
+    std::string request;
+    boost::system::error_code error;
+    char data[4096];
+    while (!error) {
+        size_t length = peer.read_some(boost::asio::buffer(data), error);
+        request.append(data, length);
+    }
+
+    CPPUNIT_ASSERT_EQUAL(std::string("request"), request);
+    CPPUNIT_ASSERT(error == boost::asio::error::eof);
+
+    // the response (larger than the proxy buffers) is sent after the request has ended and must arrive entirely
+    const std::string response(256 * 1024, 'r');
+    boost::asio::write(peer, boost::asio::buffer(response));
+    peer.shutdown(tcp::socket::shutdown_send);
+
+    std::string received;
+    error = boost::system::error_code();
+    while (!error) {
+        size_t length = client.read_some(boost::asio::buffer(data), error);
+        received.append(data, length);
+    }
+
+    CPPUNIT_ASSERT(error == boost::asio::error::eof);
+    CPPUNIT_ASSERT_EQUAL(response.size(), received.size());
+    CPPUNIT_ASSERT(response == received);
+
+    proxy_ios.stop();
+    proxy_thread.join();
+}
+
+}
+
+void TestModeProxy::test_proxy_half_close()
+{
+    TestLogger test_logger("./tmp_modeproxy_proxy_half_close.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    exchange_after_half_close(logger, mct::ListenerOptions(), 17189, 17190);
+}
+
+namespace
+{
+
+int get_socket_option(int handle, int level, int name)
+{
+    int value = -1;
+    socklen_t length = sizeof(value);
+    ::getsockopt(handle, level, name, &value, &length);
+    return value;
+}
+
+}
+
+void TestModeProxy::test_socketoptions_apply()
+{
+    TestLogger test_logger("./tmp_modeproxy_socketoptions_apply.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    using boost::asio::ip::tcp;
+    boost::asio::io_service ios;
+
+    mct::SocketOptions defaults;
+    tcp::socket untouched(ios);
+    untouched.open(tcp::v4());
+    const int default_nodelay = get_socket_option(untouched.native_handle(), IPPROTO_TCP, TCP_NODELAY);
+    CPPUNIT_ASSERT(defaults.apply_to_connection(logger, untouched.native_handle()));
+    CPPUNIT_ASSERT_EQUAL(default_nodelay, get_socket_option(untouched.native_handle(), IPPROTO_TCP, TCP_NODELAY));
+
+    mct::ListenerOptions options;
+    options.socket_options.tcp_nodelay = 1;
+    options.socket_options.receive_buffer_size = 65536;
+    options.socket_options.keepalive = 1;
+    options.socket_options.keepalive_idle = 30;
+    options.socket_options.keepalive_interval = 5;
+    options.socket_options.keepalive_count = 3;
+    options.socket_options.backlog = 16;
+    options.socket_options.tcp_defer_accept = 1;
+
+    tcp::socket connection(ios);
+    connection.open(tcp::v4());
+    CPPUNIT_ASSERT(options.socket_options.apply_to_connection(logger, connection.native_handle()));
+    CPPUNIT_ASSERT(get_socket_option(connection.native_handle(), IPPROTO_TCP, TCP_NODELAY) != 0);
+    CPPUNIT_ASSERT(get_socket_option(connection.native_handle(), SOL_SOCKET, SO_KEEPALIVE) != 0);
+    CPPUNIT_ASSERT_EQUAL(30, get_socket_option(connection.native_handle(), IPPROTO_TCP, TCP_KEEPIDLE));
+    CPPUNIT_ASSERT_EQUAL(5, get_socket_option(connection.native_handle(), IPPROTO_TCP, TCP_KEEPINTVL));
+    CPPUNIT_ASSERT_EQUAL(3, get_socket_option(connection.native_handle(), IPPROTO_TCP, TCP_KEEPCNT));
+    // the kernel doubles the requested size for its bookkeeping
+    CPPUNIT_ASSERT(get_socket_option(connection.native_handle(), SOL_SOCKET, SO_RCVBUF) >= 65536);
+
+    // a family known by the listener is trusted instead of asking the kernel, TCP options are left alone for Unix domain sockets
+    tcp::socket told(ios);
+    told.open(tcp::v4());
+    CPPUNIT_ASSERT(options.socket_options.apply_to_connection(logger, told.native_handle(), AF_UNIX));
+    CPPUNIT_ASSERT_EQUAL(default_nodelay, get_socket_option(told.native_handle(), IPPROTO_TCP, TCP_NODELAY));
+    CPPUNIT_ASSERT(get_socket_option(told.native_handle(), SOL_SOCKET, SO_KEEPALIVE) != 0);
+    CPPUNIT_ASSERT(options.socket_options.apply_to_connection(logger, told.native_handle(), AF_INET));
+    CPPUNIT_ASSERT(get_socket_option(told.native_handle(), IPPROTO_TCP, TCP_NODELAY) != 0);
+
+    // options of the listening socket are applied when it is bound and the listener still accepts connections
+    auto listener = std::make_shared<mct::ProxyListener>(ios, logger, "127.0.0.1", 17191, "127.0.0.1", 17192, options);
+    CPPUNIT_ASSERT(get_socket_option(listener->get_native_handle(), IPPROTO_TCP, TCP_DEFER_ACCEPT) > 0);
+    CPPUNIT_ASSERT(get_socket_option(listener->get_native_handle(), SOL_SOCKET, SO_RCVBUF) >= 65536);
+
+    listener->async_listen();
+
+    tcp::socket client(ios);
+    client.connect(tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 17191));
+    // deferred accept waits for the first bytes of the client
+    boost::asio::write(client, boost::asio::buffer(std::string("hello")));
+
+    for (int i = 0; (i < 100) && (listener->get_num_of_accepted_sessions() == 0); ++i) {
+        ios.run_one();
+    }
+
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), listener->get_num_of_accepted_sessions());
+
+    listener->stop();
+    ios.poll();
+}
+
+void TestModeProxy::test_proxylistener_accept_batch()
+{
+    TestLogger test_logger("./tmp_modeproxy_proxylistener_accept_batch.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    using boost::asio::ip::tcp;
+    boost::asio::io_service ios;
+    const tcp::endpoint listen_endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 17193);
+
+    mct::ListenerOptions options;
+    options.accept_batch_size = 8;
+
+    auto listener = std::make_shared<mct::ProxyListener>(ios, logger, "127.0.0.1", 17193, "127.0.0.1", 17194, options);
+    listener->async_listen();
+
+    // all the connections wait in the accept queue before the listener is woken up
+    std::vector< std::unique_ptr<tcp::socket> > clients;
+    for (int i = 0; i < 20; ++i) {
+        clients.emplace_back(new tcp::socket(ios));
+        clients.back()->connect(listen_endpoint);
+    }
+
+    // a single wake-up accepts a whole batch, the rest is left for the next ones
+    ios.run_one();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(8), listener->get_num_of_accepted_sessions());
+
+    for (int i = 0; (i < 100) && (listener->get_num_of_accepted_sessions() < 20); ++i) {
+        ios.run_one();
+    }
+
+    CPPUNIT_ASSERT_EQUAL(uint64_t(20), listener->get_num_of_accepted_sessions());
+
+    listener->stop();
+    ios.poll();
+}
+
+void TestModeProxy::test_proxy_footprint()
+{
+    // everything but the data buffers has to fit in the budget of a single session
+    const size_t session_budget = 512;
+    CPPUNIT_ASSERT(sizeof(mct::Proxy) - mct::Proxy::get_buffers_size() < session_budget);
+
+    TestLogger test_logger("./tmp_modeproxy_proxy_footprint.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    boost::asio::io_service ios;
+    auto route = std::make_shared<const mct::ProxyRoute>("127.0.0.1", 17195, "127.0.0.1", 17196, mct::ListenerOptions());
+
+    // sessions reference the route of their listener instead of copying it
+    std::vector< std::shared_ptr<mct::Proxy> > sessions;
+    for (int i = 0; i < 16; ++i) {
+        sessions.push_back(std::make_shared<mct::Proxy>(logger, ios, route));
+    }
+
+    CPPUNIT_ASSERT_EQUAL(long(17), route.use_count());
+
+    sessions.clear();
+    CPPUNIT_ASSERT_EQUAL(long(1), route.use_count());
+}
+
+void TestModeProxy::test_sessionslab_recycling()
+{
+    // slot sizes are unique per test, so every test gets a fresh slab of this thread
+    mct::SessionSlab& slab = mct::SessionSlab::for_this_thread(1000);
+
+    CPPUNIT_ASSERT_EQUAL(&slab, &mct::SessionSlab::for_this_thread(1000));
+    CPPUNIT_ASSERT_EQUAL(size_t(0), slab.get_num_of_live_slots());
+
+    void* first = slab.allocate();
+    void* second = slab.allocate();
+    CPPUNIT_ASSERT(first != second);
+    CPPUNIT_ASSERT_EQUAL(size_t(0), reinterpret_cast<uintptr_t>(first) % alignof(std::max_align_t));
+    CPPUNIT_ASSERT_EQUAL(size_t(2), slab.get_num_of_live_slots());
+
+    // the slot freed last is handed out first
+    mct::SessionSlab::release(first);
+    CPPUNIT_ASSERT_EQUAL(first, slab.allocate());
+
+    mct::SessionSlab::release(first);
+    mct::SessionSlab::release(second);
+    CPPUNIT_ASSERT_EQUAL(size_t(0), slab.get_num_of_live_slots());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), slab.get_num_of_chunks());
+
+    // objects created with the allocator share one slot with their control block
+    std::vector< std::shared_ptr<std::string> > strings;
+    for (int i = 0; i < 8; ++i) {
+        strings.push_back(std::allocate_shared<std::string>(mct::SessionAllocator<std::string>(), "session"));
+    }
+
+    CPPUNIT_ASSERT_EQUAL(std::string("session"), *strings.back());
+    strings.clear();
+}
+
+void TestModeProxy::test_sessionslab_release_chunks()
+{
+    mct::SessionSlab& slab = mct::SessionSlab::for_this_thread(16 * 1024 + 1);
+    const size_t num_of_slots = slab.get_slots_per_chunk() * 4;
+
+    std::vector<void*> slots;
+    for (size_t i = 0; i < num_of_slots; ++i) {
+        slots.push_back(slab.allocate());
+    }
+
+    CPPUNIT_ASSERT_EQUAL(size_t(4), slab.get_num_of_chunks());
+
+    for (auto slot : slots) {
+        mct::SessionSlab::release(slot);
+    }
+
+    // empty chunks go back to the system, except for a single spare one
+    CPPUNIT_ASSERT_EQUAL(size_t(0), slab.get_num_of_live_slots());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), slab.get_num_of_chunks());
+
+    slots.clear();
+    for (size_t i = 0; i < num_of_slots; ++i) {
+        slots.push_back(slab.allocate());
+    }
+
+    CPPUNIT_ASSERT_EQUAL(size_t(4), slab.get_num_of_chunks());
+
+    for (auto slot : slots) {
+        mct::SessionSlab::release(slot);
+    }
+
+    CPPUNIT_ASSERT_EQUAL(size_t(1), slab.get_num_of_chunks());
+}
+
+void TestModeProxy::test_sessionslab_remote_release()
+{
+    mct::SessionSlab& slab = mct::SessionSlab::for_this_thread(2000);
+
+    void* slot = slab.allocate();
+    CPPUNIT_ASSERT_EQUAL(size_t(1), slab.get_num_of_live_slots());
+
+    // a slot released by another thread is queued until the owner allocates again
+    std::thread releasing_thread([slot]() { mct::SessionSlab::release(slot); });
+    releasing_thread.join();
+
+    CPPUNIT_ASSERT_EQUAL(size_t(1), slab.get_num_of_live_slots());
+    CPPUNIT_ASSERT_EQUAL(slot, slab.allocate());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), slab.get_num_of_live_slots());
+
+    mct::SessionSlab::release(slot);
+
+    // a slab of a finished thread is released by whichever thread frees its last slot
+    void* orphaned_slot = nullptr;
+    std::thread allocating_thread([&orphaned_slot]() { orphaned_slot = mct::SessionSlab::for_this_thread(2000).allocate(); });
+    allocating_thread.join();
+
+    CPPUNIT_ASSERT(orphaned_slot != nullptr);
+    mct::SessionSlab::release(orphaned_slot);
+}
+
+void TestModeProxy::test_sessionslab_remote_reclaim()
+{
+    boost::asio::io_service ios;
+    mct::SessionSlab& slab = mct::SessionSlab::for_this_thread(3000);
+    slab.set_reclaim_service(ios);
+
+    std::vector<void*> slots;
+    for (size_t i = 0; i < slab.get_slots_per_chunk() * 3; ++i) {
+        slots.push_back(slab.allocate());
+    }
+
+    CPPUNIT_ASSERT_EQUAL(size_t(3), slab.get_num_of_chunks());
+
+    // all sessions are released by the cleanup thread after a burst, nothing is allocated afterwards
+    std::thread releasing_thread([&slots]() {
+        for (auto slot : slots) {
+            mct::SessionSlab::release(slot);
+        }
+    });
+    releasing_thread.join();
+
+    CPPUNIT_ASSERT_EQUAL(size_t(3), slab.get_num_of_chunks());
+
+    // the owner reclaims the slots through its io_service, which gives the chunks back except for the spare one
+    ios.run();
+
+    CPPUNIT_ASSERT_EQUAL(size_t(0), slab.get_num_of_live_slots());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), slab.get_num_of_chunks());
+
+    // a stopped io_service is not asked, the slot waits for the next allocation of the owner
+    void* slot = slab.allocate();
+    std::thread([slot]() { mct::SessionSlab::release(slot); }).join();
+    CPPUNIT_ASSERT_EQUAL(size_t(0), ios.poll());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), slab.get_num_of_live_slots());
+
+    // the slab forgets an io_service which is destroyed, releasing a slot elsewhere does not touch it anymore
+    {
+        boost::asio::io_service short_lived;
+        slab.set_reclaim_service(short_lived);
+    }
+
+    slot = slab.allocate();
+    CPPUNIT_ASSERT_EQUAL(size_t(1), slab.get_num_of_live_slots());
+    std::thread([slot]() { mct::SessionSlab::release(slot); }).join();
+
+    slot = slab.allocate();
+    CPPUNIT_ASSERT_EQUAL(size_t(1), slab.get_num_of_live_slots());
+    mct::SessionSlab::release(slot);
+    CPPUNIT_ASSERT_EQUAL(size_t(0), slab.get_num_of_live_slots());
+}
+
+void TestModeProxy::test_coroutineproxy_half_close()
+{
+    TestLogger test_logger("./tmp_modeproxy_coroutineproxy_half_close.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    mct::ListenerOptions options;
+    options.session_engine = mct::ListenerOptions::coroutine_engine;
+
+    exchange_after_half_close(logger, options, 17197, 17198);
+}
+
+void TestModeProxy::test_affinitytable_eviction()
+{
+    const uint32_t timeout = 600;
+    mct::AffinityTable table(64, timeout);
+
+    const size_t memory_size = table.get_memory_size();
+    CPPUNIT_ASSERT_EQUAL(size_t(64), table.get_capacity());
+    CPPUNIT_ASSERT_EQUAL(size_t(64 * 16), memory_size);
+
+    // one client keeps coming back while many others connect once
+    const uint64_t regular_client = mct::AffinityTable::make_key(boost::asio::ip::address::from_string("192.168.1.1"), false);
+    CPPUNIT_ASSERT_EQUAL(uint16_t(1), table.pin(regular_client, 1, 0));
+
+    for (uint32_t client = 0; client < 10000; ++client) {
+        const uint64_t key = mct::AffinityTable::make_key(boost::asio::ip::address_v4(0x0a000000 + client), false);
+        CPPUNIT_ASSERT_EQUAL(uint16_t(client % 3), table.pin(key, client % 3, client / 100));
+        CPPUNIT_ASSERT_EQUAL(uint16_t(1), table.pin(regular_client, 2, client / 100));
+    }
+
+    // the table never grows - the least recently used clients have been forgotten instead
+    CPPUNIT_ASSERT_EQUAL(memory_size, table.get_memory_size());
+    CPPUNIT_ASSERT(table.get_num_of_entries(99) <= table.get_capacity());
+    CPPUNIT_ASSERT(table.get_num_of_evictions() >= 10000 - table.get_capacity());
+
+    uint16_t backend = 0;
+    CPPUNIT_ASSERT(table.find(regular_client, 99, backend));
+    CPPUNIT_ASSERT_EQUAL(uint16_t(1), backend);
+    CPPUNIT_ASSERT(!table.find(mct::AffinityTable::make_key(boost::asio::ip::address_v4(0x0a000000), false), 99, backend));
+
+    // a client pinned to a backend which has failed is sent elsewhere next time
+    table.unpin(regular_client, 1);
+    CPPUNIT_ASSERT(!table.find(regular_client, 99, backend));
+    CPPUNIT_ASSERT_EQUAL(uint16_t(2), table.pin(regular_client, 2, 99));
+}
+
+void TestModeProxy::test_affinitytable_expiry()
+{
+    const uint32_t timeout = 60;
+    mct::AffinityTable table(1024, timeout);
+
+    const uint64_t client = mct::AffinityTable::make_key(boost::asio::ip::address::from_string("10.1.2.3"), false);
+    const uint64_t neighbour = mct::AffinityTable::make_key(boost::asio::ip::address::from_string("10.1.2.200"), false);
+    CPPUNIT_ASSERT(client != neighbour);
+
+    // with prefix affinity the whole /24 network shares one entry
+    CPPUNIT_ASSERT_EQUAL(mct::AffinityTable::make_key(boost::asio::ip::address::from_string("10.1.2.3"), true),
+        mct::AffinityTable::make_key(boost::asio::ip::address::from_string("10.1.2.200"), true));
+    CPPUNIT_ASSERT(mct::AffinityTable::make_key(boost::asio::ip::address::from_string("10.1.2.3"), true) !=
+        mct::AffinityTable::make_key(boost::asio::ip::address::from_string("10.1.3.3"), true));
+    CPPUNIT_ASSERT_EQUAL(mct::AffinityTable::make_key(boost::asio::ip::address::from_string("2001:db8::1"), true),
+        mct::AffinityTable::make_key(boost::asio::ip::address::from_string("2001:db8::2"), true));
+
+    // IPv4 clients of a dual-stack listener are keyed by their IPv4 address
+    CPPUNIT_ASSERT_EQUAL(client, mct::AffinityTable::make_key(boost::asio::ip::address::from_string("::ffff:10.1.2.3"), false));
+    CPPUNIT_ASSERT_EQUAL(mct::AffinityTable::make_key(boost::asio::ip::address::from_string("10.1.2.3"), true),
+        mct::AffinityTable::make_key(boost::asio::ip::address::from_string("::ffff:10.1.2.3"), true));
+    CPPUNIT_ASSERT(mct::AffinityTable::make_key(boost::asio::ip::address::from_string("::ffff:10.1.2.3"), true) !=
+        mct::AffinityTable::make_key(boost::asio::ip::address::from_string("::ffff:10.1.3.3"), true));
+
+    CPPUNIT_ASSERT_EQUAL(uint16_t(3), table.pin(client, 3, 1000));
+    CPPUNIT_ASSERT_EQUAL(uint16_t(3), table.pin(client, 0, 1000 + timeout - 1));
+
+    // every use extends the lifetime of an entry
+    uint16_t backend = 0;
+    CPPUNIT_ASSERT(table.find(client, 1000 + 2 * timeout - 2, backend));
+    CPPUNIT_ASSERT_EQUAL(uint16_t(3), backend);
+
+    // an idle client is forgotten and may be sent to any backend
+    CPPUNIT_ASSERT(!table.find(client, 1000 + 2 * timeout, backend));
+    CPPUNIT_ASSERT_EQUAL(size_t(0), table.get_num_of_entries(1000 + 2 * timeout));
+    CPPUNIT_ASSERT_EQUAL(uint16_t(0), table.pin(client, 0, 1000 + 2 * timeout));
+
+    // expired entries are reused without counting as evictions
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), table.get_num_of_evictions());
+}
+
+void TestModeProxy::test_proxylistener_affinity()
+{
+    TestLogger test_logger("./tmp_modeproxy_proxylistener_affinity.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    using boost::asio::ip::tcp;
+    const auto localhost = boost::asio::ip::address::from_string("127.0.0.1");
+
+    boost::asio::io_service ios;
+    tcp::acceptor first_backend(ios, tcp::endpoint(localhost, 17200));
+    tcp::acceptor second_backend(ios, tcp::endpoint(localhost, 17201));
+    first_backend.non_blocking(true);
+    second_backend.non_blocking(true);
+
+    // returns the number of the backend the next session has been sent to
+    auto connect_client = [&](boost::asio::io_service& proxy_ios) {
+        tcp::socket client(ios), peer(ios);
+        client.connect(tcp::endpoint(localhost, 17199));
+
+        for (int i = 0; i < 1000; ++i) {
+            proxy_ios.poll();
+
+            boost::system::error_code error;
+            if (!first_backend.accept(peer, error)) {
+                return 0;
+            }
+            if (!second_backend.accept(peer, error)) {
+                return 1;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return -1;
+    };
+
+    mct::ListenerOptions options;
+    options.extra_backends.push_back(std::make_pair(std::string("127.0.0.1"), uint16_t(17201)));
+
+    // without affinity new sessions take turns between the backends
+    {
+        boost::asio::io_service proxy_ios;
+        auto listener = std::make_shared<mct::ProxyListener>(proxy_ios, logger, "127.0.0.1", 17199, "127.0.0.1", 17200, options);
+        listener->async_listen();
+
+        CPPUNIT_ASSERT_EQUAL(0, connect_client(proxy_ios));
+        CPPUNIT_ASSERT_EQUAL(1, connect_client(proxy_ios));
+        CPPUNIT_ASSERT_EQUAL(0, connect_client(proxy_ios));
+
+        listener->stop();
+        listener->close_sessions();
+        proxy_ios.poll();
+    }
+
+    // with affinity the client keeps going to the backend it was sent to first
+    options.affinity = std::make_shared<mct::AffinityTable>(1024, 60);
+    {
+        boost::asio::io_service proxy_ios;
+        auto listener = std::make_shared<mct::ProxyListener>(proxy_ios, logger, "127.0.0.1", 17199, "127.0.0.1", 17200, options);
+        listener->async_listen();
+
+        CPPUNIT_ASSERT_EQUAL(0, connect_client(proxy_ios));
+        CPPUNIT_ASSERT_EQUAL(0, connect_client(proxy_ios));
+        CPPUNIT_ASSERT_EQUAL(0, connect_client(proxy_ios));
+        CPPUNIT_ASSERT_EQUAL(size_t(1), options.affinity->get_num_of_entries(mct::AffinityTable::get_current_time()));
+
+        listener->stop();
+        listener->close_sessions();
+        proxy_ios.poll();
+    }
+}
+
+void TestModeProxy::test_proxyprotocol_headers()
+{
+    using boost::asio::ip::tcp;
+    const tcp::endpoint client(boost::asio::ip::address::from_string("203.0.113.7"), 4242);
+    const tcp::endpoint listener(boost::asio::ip::address::from_string("10.0.0.1"), 443);
+    const tcp::endpoint client_v6(boost::asio::ip::address::from_string("2001:db8::7"), 4242);
+
+    unsigned char buffer[mct::ProxyProtocol::max_header_length];
+    mct::ProxyHeader header;
+
+    size_t length = mct::ProxyProtocol::write_header(mct::ListenerOptions::proxy_protocol_v1, client, listener, buffer);
+    CPPUNIT_ASSERT_EQUAL(std::string("PROXY TCP4 203.0.113.7 10.0.0.1 4242 443\r\n"), std::string(reinterpret_cast<char*>(buffer), length));
+    CPPUNIT_ASSERT_EQUAL(mct::ProxyProtocol::complete, mct::ProxyProtocol::parse_header(mct::ListenerOptions::proxy_protocol_any, buffer, length, 8192, header));
+    CPPUNIT_ASSERT_EQUAL(length, header.length);
+    CPPUNIT_ASSERT(header.has_addresses);
+    CPPUNIT_ASSERT(client == header.source);
+    CPPUNIT_ASSERT(listener == header.destination);
+
+    // a v2 header arrives byte after byte
+    length = mct::ProxyProtocol::write_header(mct::ListenerOptions::proxy_protocol_v2, client, listener, buffer);
+    CPPUNIT_ASSERT_EQUAL(size_t(16 + 12), length);
+    for (size_t received = 0; received < length; ++received) {
+        CPPUNIT_ASSERT_EQUAL(mct::ProxyProtocol::incomplete, mct::ProxyProtocol::parse_header(mct::ListenerOptions::proxy_protocol_v2, buffer, received, 8192, header));
+    }
+    CPPUNIT_ASSERT_EQUAL(mct::ProxyProtocol::complete, mct::ProxyProtocol::parse_header(mct::ListenerOptions::proxy_protocol_v2, buffer, length, 8192, header));
+    CPPUNIT_ASSERT(client == header.source);
+    CPPUNIT_ASSERT(listener == header.destination);
+
+    // mixed families are written as IPv6
+    length = mct::ProxyProtocol::write_header(mct::ListenerOptions::proxy_protocol_v2, client_v6, listener, buffer);
+    CPPUNIT_ASSERT_EQUAL(size_t(16 + 36), length);
+    CPPUNIT_ASSERT_EQUAL(mct::ProxyProtocol::complete, mct::ProxyProtocol::parse_header(mct::ListenerOptions::proxy_protocol_any, buffer, length, 8192, header));
+    CPPUNIT_ASSERT(client_v6 == header.source);
+    CPPUNIT_ASSERT(header.destination.address().to_v6().is_v4_mapped());
+
+    length = mct::ProxyProtocol::write_header(mct::ListenerOptions::proxy_protocol_v1, client_v6, listener, buffer);
+    CPPUNIT_ASSERT_EQUAL(std::string("PROXY TCP6 2001:db8::7 ::ffff:10.0.0.1 4242 443\r\n"), std::string(reinterpret_cast<char*>(buffer), length));
+
+    auto parse = [&](mct::ListenerOptions::proxy_protocol_type version, const std::string& data) {
+        return mct::ProxyProtocol::parse_header(version, reinterpret_cast<const unsigned char*>(data.data()), data.size(), 8192, header);
+    };
+
+    // the version has to be the accepted one
+    CPPUNIT_ASSERT_EQUAL(mct::ProxyProtocol::invalid, parse(mct::ListenerOptions::proxy_protocol_v2, "PROXY TCP4 1.2.3.4 5.6.7.8 1 2\r\n"));
+    CPPUNIT_ASSERT_EQUAL(mct::ProxyProtocol::invalid, parse(mct::ListenerOptions::proxy_protocol_any, "GET / HTTP/1.1\r\n\r\n"));
+    CPPUNIT_ASSERT_EQUAL(mct::ProxyProtocol::invalid, parse(mct::ListenerOptions::proxy_protocol_v1, "PROXY TCP4 1.2.3.4 5.6.7.8 1\r\n"));
+    CPPUNIT_ASSERT_EQUAL(mct::ProxyProtocol::invalid, parse(mct::ListenerOptions::proxy_protocol_v1, "PROXY TCP6 1.2.3.4 5.6.7.8 1 2\r\n"));
+    CPPUNIT_ASSERT_EQUAL(mct::ProxyProtocol::invalid, parse(mct::ListenerOptions::proxy_protocol_v1, "PROXY TCP4 1.2.3.4 5.6.7.8 1 70000\r\n"));
+    CPPUNIT_ASSERT_EQUAL(mct::ProxyProtocol::invalid, parse(mct::ListenerOptions::proxy_protocol_v1, "PROXY TCP4 " + std::string(120, '1')));
+    CPPUNIT_ASSERT_EQUAL(mct::ProxyProtocol::incomplete, parse(mct::ListenerOptions::proxy_protocol_v1, "PROXY TCP4 1.2.3.4"));
+
+    // health checks of the load balancer carry no addresses
+    CPPUNIT_ASSERT_EQUAL(mct::ProxyProtocol::complete, parse(mct::ListenerOptions::proxy_protocol_v1, "PROXY UNKNOWN\r\nGET"));
+    CPPUNIT_ASSERT(!header.has_addresses);
+    CPPUNIT_ASSERT_EQUAL(size_t(15), header.length);
+}
+
+void TestModeProxy::test_proxy_proxy_protocol()
+{
+    TestLogger test_logger("./tmp_modeproxy_proxy_proxy_protocol.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    using boost::asio::ip::tcp;
+    const auto localhost = boost::asio::ip::address::from_string("127.0.0.1");
+
+    // a load balancer sends v2 to the listener, which tells the backend in v1
+    mct::ListenerOptions options;
+    options.accept_proxy_protocol = mct::ListenerOptions::proxy_protocol_any;
+    options.send_proxy_protocol = mct::ListenerOptions::proxy_protocol_v1;
+
+    boost::asio::io_service proxy_ios;
+    auto listener = std::make_shared<mct::ProxyListener>(proxy_ios, logger, "127.0.0.1", 17202, "127.0.0.1", 17203, options);
+    listener->async_listen();
+    std::thread proxy_thread([&]() { proxy_ios.run(); });
+
+    boost::asio::io_service ios;
+    tcp::acceptor backend(ios, tcp::endpoint(localhost, 17203));
+
+    auto read_exactly = [](tcp::socket& socket, size_t length) {
+        std::string data(length, '\0');
+        boost::asio::read(socket, boost::asio::buffer(&data[0], length));
+        return data;
+    };
+
+    {
+        tcp::socket client(ios), peer(ios);
+        client.connect(tcp::endpoint(localhost, 17202));
+
+        unsigned char header[mct::ProxyProtocol::max_header_length];
+        const size_t header_length = mct::ProxyProtocol::write_header(mct::ListenerOptions::proxy_protocol_v2,
+            tcp::endpoint(boost::asio::ip::address::from_string("203.0.113.7"), 4242), tcp::endpoint(localhost, 17202), header);
+
+        // the data sent right behind the header is not lost
+        boost::asio::write(client, boost::asio::buffer(std::string(reinterpret_cast<char*>(header), header_length) + "hello"));
+        backend.accept(peer);
+
+        const std::string expected("PROXY TCP4 203.0.113.7 127.0.0.1 4242 17202\r\nhello");
+        CPPUNIT_ASSERT_EQUAL(expected, read_exactly(peer, expected.size()));
+
+        boost::asio::write(peer, boost::asio::buffer(std::string("world")));
+        CPPUNIT_ASSERT_EQUAL(std::string("world"), read_exactly(client, 5));
+    }
+
+    // a client without the header is not let through
+    {
+        tcp::socket client(ios);
+        client.connect(tcp::endpoint(localhost, 17202));
+        boost::asio::write(client, boost::asio::buffer(std::string("GET / HTTP/1.1\r\n\r\n")));
+
+        char data[16];
+        boost::system::error_code error;
+        client.read_some(boost::asio::buffer(data), error);
+        CPPUNIT_ASSERT(error == boost::asio::error::eof || error == boost::asio::error::connection_reset);
+    }
+
+    proxy_ios.stop();
+    proxy_thread.join();
+}
+
+void TestModeProxy::test_streamendpoint_make()
+{
+    const mct::StreamEndpoint::endpoint_type ip_endpoint = mct::StreamEndpoint::make("127.0.0.1", 8080);
+    CPPUNIT_ASSERT(mct::StreamEndpoint::is_ip(ip_endpoint));
+    CPPUNIT_ASSERT(mct::StreamEndpoint::to_ip(ip_endpoint) == boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 8080));
+    CPPUNIT_ASSERT(mct::StreamEndpoint::is_ip(mct::StreamEndpoint::make("::1", 8080)));
+    CPPUNIT_ASSERT(!mct::StreamEndpoint::is_local("127.0.0.1"));
+    CPPUNIT_ASSERT(mct::StreamEndpoint::get_path("127.0.0.1").empty());
+
+    // the port of a Unix domain socket is ignored
+    const mct::StreamEndpoint::endpoint_type path_endpoint = mct::StreamEndpoint::make("unix:/run/backend.sock", 8080);
+    CPPUNIT_ASSERT(!mct::StreamEndpoint::is_ip(path_endpoint));
+    CPPUNIT_ASSERT_EQUAL(AF_UNIX, static_cast<int>(path_endpoint.protocol().family()));
+    CPPUNIT_ASSERT_EQUAL(uint16_t(0), mct::StreamEndpoint::to_ip(path_endpoint).port());
+    CPPUNIT_ASSERT_EQUAL(std::string("/run/backend.sock"), mct::StreamEndpoint::get_path("unix:/run/backend.sock"));
+
+    // abstract sockets have no file to remove
+    const mct::StreamEndpoint::endpoint_type abstract_endpoint = mct::StreamEndpoint::make("unix:@backend", 0);
+    CPPUNIT_ASSERT_EQUAL(AF_UNIX, static_cast<int>(abstract_endpoint.protocol().family()));
+    CPPUNIT_ASSERT_EQUAL('\0', abstract_endpoint.data()->sa_data[0]);
+    CPPUNIT_ASSERT(mct::StreamEndpoint::get_path("unix:@backend").empty());
+
+    CPPUNIT_ASSERT_THROW(mct::StreamEndpoint::make("unix:", 0), boost::system::system_error);
+    CPPUNIT_ASSERT_THROW(mct::StreamEndpoint::make("unix:@", 0), boost::system::system_error);
+    CPPUNIT_ASSERT_THROW(mct::StreamEndpoint::make("unix:/" + std::string(200, 'x'), 0), boost::system::system_error);
+    CPPUNIT_ASSERT_THROW(mct::StreamEndpoint::make("localhost", 0), boost::system::system_error);
+}
+
+void TestModeProxy::test_proxy_unix_sockets()
+{
+    TestLogger test_logger("./tmp_modeproxy_proxy_unix_sockets.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    using boost::asio::ip::tcp;
+    using boost::asio::local::stream_protocol;
+    const std::string listener_path("./tmp_modeproxy_proxy_unix_sockets.sock");
+
+    // a stale socket file does not keep the listener from binding
+    {
+        boost::asio::io_service ios;
+        stream_protocol::acceptor stale(ios, stream_protocol::endpoint(listener_path));
+
+        // while somebody listens on it the socket file is in use and stays in place
+        CPPUNIT_ASSERT_THROW(mct::ProxyListener(ios, logger, "unix:" + listener_path, 0, "127.0.0.1", 17204, mct::ListenerOptions()), boost::system::system_error);
+        CPPUNIT_ASSERT(boost::filesystem::exists(listener_path));
+    }
+
+    boost::asio::io_service ios;
+    std::string abstract_name("mct_test_proxy_unix_sockets");
+    stream_protocol::acceptor backend(ios, stream_protocol::endpoint(std::string(1, '\0') + abstract_name));
+
+    // clients of the Unix domain listener have no address, so the backend is told about a LOCAL connection
+    mct::ListenerOptions options;
+    options.send_proxy_protocol = mct::ListenerOptions::proxy_protocol_v1;
+    options.socket_options.tcp_nodelay = 1;
+
+    boost::asio::io_service proxy_ios;
+    auto unix_listener = std::make_shared<mct::ProxyListener>(proxy_ios, logger, "unix:" + listener_path, 0, "unix:@" + abstract_name, 0, options);
+    auto tcp_listener = std::make_shared<mct::ProxyListener>(proxy_ios, logger, "127.0.0.1", 17204, "unix:@" + abstract_name, 0, mct::ListenerOptions());
+    unix_listener->async_listen();
+    tcp_listener->async_listen();
+
+    std::thread proxy_thread([&]() { proxy_ios.run(); });
+
+    auto read_exactly = [](stream_protocol::socket& socket, size_t length) {
+        std::string data(length, '\0');
+        boost::asio::read(socket, boost::asio::buffer(&data[0], length));
+        return data;
+    };
+
+    {
+        stream_protocol::socket client(ios), peer(ios);
+        client.connect(stream_protocol::endpoint(listener_path));
+        boost::asio::write(client, boost::asio::buffer(std::string("hello")));
+        backend.accept(peer);
+
+        CPPUNIT_ASSERT_EQUAL(std::string("PROXY UNKNOWN\r\nhello"), read_exactly(peer, 20));
+
+        boost::asio::write(peer, boost::asio::buffer(std::string("world")));
+        CPPUNIT_ASSERT_EQUAL(std::string("world"), read_exactly(client, 5));
+
+        // half close crosses the listener the same way as with TCP
+        client.shutdown(boost::asio::socket_base::shutdown_send);
+        char data[16];
+        boost::system::error_code error;
+        peer.read_some(boost::asio::buffer(data), error);
+        CPPUNIT_ASSERT(error == boost::asio::error::eof);
+    }
+
+    // TCP clients reach Unix domain backends as well
+    {
+        tcp::socket client(ios);
+        stream_protocol::socket peer(ios);
+        client.connect(tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 17204));
+        boost::asio::write(client, boost::asio::buffer(std::string("ping")));
+        backend.accept(peer);
+
+        CPPUNIT_ASSERT_EQUAL(std::string("ping"), read_exactly(peer, 4));
+
+        boost::asio::write(peer, boost::asio::buffer(std::string("pong")));
+        std::string data(4, '\0');
+        boost::asio::read(client, boost::asio::buffer(&data[0], data.size()));
+        CPPUNIT_ASSERT_EQUAL(std::string("pong"), data);
+    }
+
+    proxy_ios.stop();
+    proxy_thread.join();
+
+    boost::filesystem::remove("./tmp_modeproxy_proxy_unix_sockets.sock");
+}
+
+void TestModeProxy::test_portrange_parse()
+{
+    mct::PortRange range;
+
+    CPPUNIT_ASSERT(mct::PortRange::parse("0.0.0.0:20000-29999=10.0.0.1:30000-39999", range));
+    CPPUNIT_ASSERT_EQUAL(std::string("0.0.0.0"), range.local_host);
+    CPPUNIT_ASSERT_EQUAL(uint16_t(20000), range.local_first);
+    CPPUNIT_ASSERT_EQUAL(uint16_t(29999), range.local_last);
+    CPPUNIT_ASSERT_EQUAL(std::string("10.0.0.1"), range.remote_host);
+    CPPUNIT_ASSERT_EQUAL(uint16_t(30000), range.remote_first);
+    CPPUNIT_ASSERT_EQUAL(uint16_t(39999), range.remote_last);
+    CPPUNIT_ASSERT_EQUAL(uint32_t(10000), range.get_num_of_ports());
+    CPPUNIT_ASSERT(range.is_port_mapped());
+
+    // every local port to the same remote port
+    CPPUNIT_ASSERT(mct::PortRange::parse("127.0.0.1:1-65535=backend.local:8080", range));
+    CPPUNIT_ASSERT_EQUAL(uint32_t(65535), range.get_num_of_ports());
+    CPPUNIT_ASSERT_EQUAL(uint16_t(8080), range.remote_last);
+    CPPUNIT_ASSERT(!range.is_port_mapped());
+
+    // hosts are split from ports at the last colon
+    CPPUNIT_ASSERT(mct::PortRange::parse("::1:5000-5009=unix:/run/backend.sock:0", range));
+    CPPUNIT_ASSERT_EQUAL(std::string("::1"), range.local_host);
+    CPPUNIT_ASSERT_EQUAL(std::string("unix:/run/backend.sock"), range.remote_host);
+
+    CPPUNIT_ASSERT(!mct::PortRange::parse("127.0.0.1:5000-5009=127.0.0.1:6000-6008", range));
+    CPPUNIT_ASSERT(!mct::PortRange::parse("127.0.0.1:5009-5000=127.0.0.1:6000", range));
+    CPPUNIT_ASSERT(!mct::PortRange::parse("127.0.0.1:0-10=127.0.0.1:6000", range));
+    CPPUNIT_ASSERT(!mct::PortRange::parse("127.0.0.1:5000-5009=127.0.0.1:0", range));
+    CPPUNIT_ASSERT(!mct::PortRange::parse("127.0.0.1:5000-70000=127.0.0.1:6000", range));
+    CPPUNIT_ASSERT(!mct::PortRange::parse("127.0.0.1:5000-5009", range));
+    CPPUNIT_ASSERT(!mct::PortRange::parse(":5000-5009=127.0.0.1:6000", range));
+    CPPUNIT_ASSERT(!mct::PortRange::parse("127.0.0.1:a-b=127.0.0.1:6000", range));
+}
+
+void TestModeProxy::test_proxylistener_port_range()
+{
+    TestLogger test_logger("./tmp_modeproxy_proxylistener_port_range.cfg");
+    mct::Logger& logger = test_logger.get();
+
+    using boost::asio::ip::tcp;
+    const auto localhost = boost::asio::ip::address::from_string("127.0.0.1");
+
+    boost::asio::io_service ios;
+    tcp::acceptor first_backend(ios, tcp::endpoint(localhost, 17208));
+    tcp::acceptor last_backend(ios, tcp::endpoint(localhost, 17210));
+    tcp::acceptor fixed_backend(ios, tcp::endpoint(localhost, 17211));
+
+    // 17205-17207 -> 17208-17210, all listeners share one route
+    auto mapped_route = std::make_shared<mct::ProxyRoute>("127.0.0.1", 17205, "127.0.0.1", 17208, mct::ListenerOptions(), true);
+    auto first_listener = std::make_shared<mct::ProxyListener>(ios, logger, mapped_route, 17205);
+    auto last_listener = std::make_shared<mct::ProxyListener>(ios, logger, mapped_route, 17207);
+    first_listener->async_listen();
+    last_listener->async_listen();
+
+    CPPUNIT_ASSERT_EQUAL(uint16_t(17205), first_listener->get_listen_port());
+    CPPUNIT_ASSERT_EQUAL(uint16_t(17208), first_listener->get_remote_port());
+    CPPUNIT_ASSERT_EQUAL(uint16_t(17207), last_listener->get_listen_port());
+    CPPUNIT_ASSERT_EQUAL(uint16_t(17210), last_listener->get_remote_port());
+
+    {
+        tcp::socket client(ios), peer(ios);
+        client.connect(tcp::endpoint(localhost, 17207));
+        CPPUNIT_ASSERT_EQUAL(true, accept_while_polling(ios, last_backend, peer));
+        CPPUNIT_ASSERT_EQUAL(std::string("last"), forward_while_polling(ios, client, peer, "last"));
+    }
+
+    {
+        tcp::socket client(ios), peer(ios);
+        client.connect(tcp::endpoint(localhost, 17205));
+        CPPUNIT_ASSERT_EQUAL(true, accept_while_polling(ios, first_backend, peer));
+        CPPUNIT_ASSERT_EQUAL(std::string("first"), forward_while_polling(ios, client, peer, "first"));
+    }
+
+    // without a remote range every listener keeps the remote port of the route, also after a reload
+    auto fixed_route = std::make_shared<mct::ProxyRoute>("127.0.0.1", 17205, "127.0.0.1", 17211, mct::ListenerOptions());
+    last_listener->set_route(fixed_route);
+    CPPUNIT_ASSERT_EQUAL(uint16_t(17211), last_listener->get_remote_port());
+
+    {
+        tcp::socket client(ios), peer(ios);
+        client.connect(tcp::endpoint(localhost, 17207));
+        CPPUNIT_ASSERT_EQUAL(true, accept_while_polling(ios, fixed_backend, peer));
+        CPPUNIT_ASSERT_EQUAL(std::string("fixed"), forward_while_polling(ios, client, peer, "fixed"));
+    }
+}
+
+namespace
+{
+
+void write_config_file(const std::string& filename, const std::vector<std::string>& lines)
+{
+    std::ofstream fs(filename);
+    for (auto& line : lines) {
+        fs << line << std::endl;
+    }
+}
+
+/**
+ * Runs the mode of a configuration file on its own thread the way the application does, the test talks to it
+ * with signals - which the mode handles once its io_service runs, i.e. once it has forwarded data of a session.
+ */
+class ModeRunner
+{
+public:
+    ModeRunner(const std::string& filename, const std::vector<std::string>& lines)
+     : m_filename(filename), m_argv{ "mct", "-c", m_filename.c_str() }, m_config(3, const_cast<char**>(m_argv)), m_logger(m_config),
+       m_is_finished(false), m_result(false)
+    {
+        write_config_file(m_filename, lines);
+
+        std::string message_to_user;
+        mct::ConfigurationBuilder config_builder(m_config);
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, true, config_builder.build_configuration(message_to_user));
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, true, m_logger.initialize(message_to_user));
+
+        mct::ModeFactory mode_factory(m_config, m_logger);
+        m_mode.reset(mode_factory.create(m_config.get_app_mode()));
+        CPPUNIT_ASSERT_EQUAL(false, !m_mode);
+
+        m_thread = std::thread([this]() {
+            try {
+                m_result = m_mode->run();
+            } catch (const std::exception&) {
+                m_result = false;
+            }
+            m_is_finished = true;
+        });
+    }
+
+    ~ModeRunner()
+    {
+        if (m_thread.joinable()) {
+            // a failed test must not leave the mode running
+            send_signal(SIGTERM);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            send_signal(SIGTERM);
+            m_thread.join();
+        }
+        boost::filesystem::remove(m_filename);
+    }
+
+    void send_signal(int signal_number) { kill(getpid(), signal_number); }
+
+    /**
+     * Returns the result of run(), or false if it has not returned within timeout.
+     */
+    bool wait(std::chrono::milliseconds timeout)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!m_is_finished && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        if (!m_is_finished) {
+            return false;
+        }
+
+        m_thread.join();
+        return m_result;
+    }
+
+    bool is_finished() const { return m_is_finished; }
+
+private:
+    std::string m_filename;
+    const char* m_argv[3];
+    mct::Configuration m_config;
+    mct::Logger m_logger;
+    std::unique_ptr<mct::Mode> m_mode;
+    std::thread m_thread;
+    std::atomic<bool> m_is_finished;
+    bool m_result;
+};
+
+/**
+ * Retries for up to two seconds, the listeners of a mode running on another thread appear (and disappear) a bit later.
+ */
+bool connect_within(boost::asio::ip::tcp::socket& socket, uint16_t port)
+{
+    for (int i = 0; i < 200; ++i) {
+        boost::system::error_code error;
+        socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), port), error);
+        if (!error) {
+            return true;
+        }
+
+        socket.close();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return false;
+}
+
+bool is_refused_within(boost::asio::io_service& ios, uint16_t port)
+{
+    for (int i = 0; i < 200; ++i) {
+        boost::asio::ip::tcp::socket socket(ios);
+        boost::system::error_code error;
+        socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), port), error);
+        if (error == boost::asio::error::connection_refused) {
+            return true;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return false;
+}
+
+std::string read_exactly(boost::asio::ip::tcp::socket& socket, size_t length)
+{
+    std::string data(length, '\0');
+    boost::asio::read(socket, boost::asio::buffer(&data[0], length));
+    return data;
+}
+
+/**
+ * Reads until the peer closes the connection.
+ */
+std::string read_until_closed(boost::asio::ip::tcp::socket& socket)
+{
+    std::string received;
+    boost::system::error_code error;
+    char data[65536];
+
+    while (!error) {
+        size_t length = socket.read_some(boost::asio::buffer(data), error);
+        received.append(data, length);
+    }
+
+    return received;
+}
+
+}
+
+void TestModeProxy::test_modeproxy_reload_configuration()
+{
+    using boost::asio::ip::tcp;
+    const auto localhost = boost::asio::ip::address::from_string("127.0.0.1");
+
+    boost::asio::io_service ios;
+    tcp::acceptor backend(ios, tcp::endpoint(localhost, 17301));
+    tcp::acceptor rerouted_backend(ios, tcp::endpoint(localhost, 17303));
+
+    const std::vector<std::string> common_lines = { "log.nofile = 1", "log.silent = 1", "mode = proxy", "mode.proxy.drain_timeout = 1" };
+
+    // 17300 and 17302 -> 17301
+    std::vector<std::string> lines = common_lines;
+    lines.insert(lines.end(), {
+        "mode.proxy.local_host = 127.0.0.1", "mode.proxy.local_port = 17300", "mode.proxy.remote_host = 127.0.0.1", "mode.proxy.remote_port = 17301",
+        "mode.proxy.local_host = 127.0.0.1", "mode.proxy.local_port = 17302", "mode.proxy.remote_host = 127.0.0.1", "mode.proxy.remote_port = 17301"
+    });
+
+    ModeRunner runner("./tmp_modeproxy_reload_configuration.cfg", lines);
+
+    tcp::socket established(ios), established_peer(ios);
+    CPPUNIT_ASSERT(connect_within(established, 17300));
+    boost::asio::write(established, boost::asio::buffer(std::string("before")));
+    backend.accept(established_peer);
+    CPPUNIT_ASSERT_EQUAL(std::string("before"), read_exactly(established_peer, 6));
+
+    // 17300 -> 17303 (rerouted), 17302 removed, 17304 -> 17301 added
+    lines = common_lines;
+    lines.insert(lines.end(), {
+        "mode.proxy.local_host = 127.0.0.1", "mode.proxy.local_port = 17300", "mode.proxy.remote_host = 127.0.0.1", "mode.proxy.remote_port = 17303",
+        "mode.proxy.local_host = 127.0.0.1", "mode.proxy.local_port = 17304", "mode.proxy.remote_host = 127.0.0.1", "mode.proxy.remote_port = 17301"
+    });
+    write_config_file("./tmp_modeproxy_reload_configuration.cfg", lines);
+    runner.send_signal(SIGHUP);
+
+    {
+        tcp::socket client(ios), peer(ios);
+        CPPUNIT_ASSERT(connect_within(client, 17304));
+        boost::asio::write(client, boost::asio::buffer(std::string("added")));
+        backend.accept(peer);
+        CPPUNIT_ASSERT_EQUAL(std::string("added"), read_exactly(peer, 5));
+    }
+
+    CPPUNIT_ASSERT(is_refused_within(ios, 17302));
+
+    {
+        tcp::socket client(ios), peer(ios);
+        CPPUNIT_ASSERT(connect_within(client, 17300));
+        boost::asio::write(client, boost::asio::buffer(std::string("rerouted")));
+        rerouted_backend.accept(peer);
+        CPPUNIT_ASSERT_EQUAL(std::string("rerouted"), read_exactly(peer, 8));
+    }
+
+    // the session established before the reload keeps its backend, in both directions
+    boost::asio::write(established, boost::asio::buffer(std::string("after")));
+    CPPUNIT_ASSERT_EQUAL(std::string("after"), read_exactly(established_peer, 5));
+    boost::asio::write(established_peer, boost::asio::buffer(std::string("reply")));
+    CPPUNIT_ASSERT_EQUAL(std::string("reply"), read_exactly(established, 5));
+
+    established.close();
+    established_peer.close();
+
+    runner.send_signal(SIGTERM);
+    CPPUNIT_ASSERT_EQUAL(true, runner.wait(std::chrono::milliseconds(3000)));
+}
+
+void TestModeProxy::test_modeproxy_drain_deadline()
+{
+    using boost::asio::ip::tcp;
+    const auto localhost = boost::asio::ip::address::from_string("127.0.0.1");
+    const std::string log_directory("./tmp_modeproxy_drain_deadline_logs");
+
+    boost::asio::io_service ios;
+    tcp::acceptor backend(ios, tcp::endpoint(localhost, 17321));
+
+    // the statistics logged when run() returns are checked in the log file, the console shows only fatal messages
+    const std::vector<std::string> lines = { "log.nofile = 0", "log.silent = 0", "log.severity.console = fatal", "log.severity.file = info",
+        "log.directory = " + log_directory, "log.filename = mct.log", "mode = proxy", "mode.proxy.drain_timeout = 1",
+        "mode.proxy.local_host = 127.0.0.1", "mode.proxy.local_port = 17320", "mode.proxy.remote_host = 127.0.0.1", "mode.proxy.remote_port = 17321" };
+
+    {
+        ModeRunner runner("./tmp_modeproxy_drain_deadline.cfg", lines);
+
+        tcp::socket client(ios), peer(ios);
+        CPPUNIT_ASSERT(connect_within(client, 17320));
+        boost::asio::write(client, boost::asio::buffer(std::string("hello")));
+        backend.accept(peer);
+        CPPUNIT_ASSERT_EQUAL(std::string("hello"), read_exactly(peer, 5));
+
+        const auto drain_started = std::chrono::steady_clock::now();
+        runner.send_signal(SIGTERM);
+        CPPUNIT_ASSERT(is_refused_within(ios, 17320));
+
+        // the session keeps working until the deadline, then it is closed
+        boost::asio::write(client, boost::asio::buffer(std::string("draining")));
+        CPPUNIT_ASSERT_EQUAL(std::string("draining"), read_exactly(peer, 8));
+
+        CPPUNIT_ASSERT_EQUAL(std::string(), read_until_closed(client));
+        CPPUNIT_ASSERT(std::chrono::steady_clock::now() - drain_started >= std::chrono::milliseconds(900));
+
+        CPPUNIT_ASSERT(runner.wait(std::chrono::milliseconds(3000)));
+    }
+
+    std::ifstream log_file(log_directory + "/mct.log");
+    const std::string log((std::istreambuf_iterator<char>(log_file)), std::istreambuf_iterator<char>());
+    log_file.close();
+    boost::filesystem::remove_all(log_directory);
+
+    // a probe of is_refused_within() may still have been accepted before the listener stopped, so the numbers of sessions are not checked
+    CPPUNIT_ASSERT(log.find("Drain timeout has passed, closing ") != std::string::npos);
+    CPPUNIT_ASSERT(log.find("Listener 127.0.0.1:17320 accepted ") != std::string::npos);
+    CPPUNIT_ASSERT(log.find(" sessions, 0 of them are still active.") != std::string::npos);
+}
+
+void TestModeProxy::test_modeproxy_drain_second_signal()
+{
+    using boost::asio::ip::tcp;
+    const auto localhost = boost::asio::ip::address::from_string("127.0.0.1");
+
+    boost::asio::io_service ios;
+    tcp::acceptor backend(ios, tcp::endpoint(localhost, 17311));
+
+    // the shadow reads nothing until the session is closed, so the shadow sink still has most of the client bytes queued then
+    tcp::acceptor shadow_acceptor(ios);
+    const tcp::endpoint shadow_endpoint(localhost, 17312);
+    shadow_acceptor.open(shadow_endpoint.protocol());
+    shadow_acceptor.set_option(tcp::acceptor::reuse_address(true));
+    shadow_acceptor.set_option(boost::asio::socket_base::receive_buffer_size(4096));
+    shadow_acceptor.bind(shadow_endpoint);
+    shadow_acceptor.listen();
+
+    const std::vector<std::string> lines = { "log.nofile = 1", "log.silent = 1", "mode = proxy", "mode.proxy.drain_timeout = 30",
+        "mode.proxy.local_host = 127.0.0.1", "mode.proxy.local_port = 17310", "mode.proxy.remote_host = 127.0.0.1", "mode.proxy.remote_port = 17311",
+        "mode.proxy.shadow_host = 127.0.0.1", "mode.proxy.shadow_port = 17312", "mode.proxy.shadow_buffer_size = 33554432",
+        "mode.proxy.shadow_close_timeout = 10000" };
+
+    ModeRunner runner("./tmp_modeproxy_drain_second_signal.cfg", lines);
+
+    tcp::socket client(ios), peer(ios), shadow_peer(ios);
+    CPPUNIT_ASSERT(connect_within(client, 17310));
+    backend.accept(peer);
+    shadow_acceptor.accept(shadow_peer);
+
+    const std::string payload(16 * 1024 * 1024, 's');
+    std::thread writer([&client, &payload]() { boost::asio::write(client, boost::asio::buffer(payload)); });
+    CPPUNIT_ASSERT(payload == read_exactly(peer, payload.size()));
+    writer.join();
+
+    runner.send_signal(SIGTERM);
+    CPPUNIT_ASSERT(is_refused_within(ios, 17310));
+
+    boost::asio::write(client, boost::asio::buffer(std::string("!")));
+    CPPUNIT_ASSERT_EQUAL(std::string("!"), read_exactly(peer, 1));
+
+    // the second signal does not wait for the drain timeout
+    const auto closing_started = std::chrono::steady_clock::now();
+    runner.send_signal(SIGTERM);
+    CPPUNIT_ASSERT_EQUAL(std::string(), read_until_closed(client));
+    CPPUNIT_ASSERT(std::chrono::steady_clock::now() - closing_started < std::chrono::seconds(5));
+
+    // ios.run() has been left, but the shadow sink still writes everything it has queued
+    CPPUNIT_ASSERT(payload + "!" == read_until_closed(shadow_peer));
+
+    CPPUNIT_ASSERT(runner.wait(std::chrono::milliseconds(3000)));
+}
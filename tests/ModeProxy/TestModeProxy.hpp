@@ -37,6 +37,33 @@ class TestModeProxy : public CPPUNIT_NS::TestCase
     CPPUNIT_TEST_SUITE(TestModeProxy);
     CPPUNIT_TEST(test_modeproxy_error_local_port_already_bound);
     CPPUNIT_TEST(test_ipresolver_localhost);
+    CPPUNIT_TEST(test_shadowsink_bounded_buffer);
+    CPPUNIT_TEST(test_shadowsink_unreachable);
+    CPPUNIT_TEST(test_shadowsink_close_timeout);
+    CPPUNIT_TEST(test_proxylistener_set_route);
+    CPPUNIT_TEST(test_proxylistener_stop);
+    CPPUNIT_TEST(test_listenerhandoff_takeover);
+    CPPUNIT_TEST(test_proxy_half_close);
+    CPPUNIT_TEST(test_socketoptions_apply);
+    CPPUNIT_TEST(test_proxylistener_accept_batch);
+    CPPUNIT_TEST(test_proxy_footprint);
+    CPPUNIT_TEST(test_sessionslab_recycling);
+    CPPUNIT_TEST(test_sessionslab_release_chunks);
+    CPPUNIT_TEST(test_sessionslab_remote_release);
+    CPPUNIT_TEST(test_sessionslab_remote_reclaim);
+    CPPUNIT_TEST(test_coroutineproxy_half_close);
+    CPPUNIT_TEST(test_affinitytable_eviction);
+    CPPUNIT_TEST(test_affinitytable_expiry);
+    CPPUNIT_TEST(test_proxylistener_affinity);
+    CPPUNIT_TEST(test_proxyprotocol_headers);
+    CPPUNIT_TEST(test_proxy_proxy_protocol);
+    CPPUNIT_TEST(test_streamendpoint_make);
+    CPPUNIT_TEST(test_proxy_unix_sockets);
+    CPPUNIT_TEST(test_portrange_parse);
+    CPPUNIT_TEST(test_proxylistener_port_range);
+    CPPUNIT_TEST(test_modeproxy_reload_configuration);
+    CPPUNIT_TEST(test_modeproxy_drain_deadline);
+    CPPUNIT_TEST(test_modeproxy_drain_second_signal);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -46,6 +73,33 @@ public:
 protected:
     void test_modeproxy_error_local_port_already_bound();
     void test_ipresolver_localhost();
+    void test_shadowsink_bounded_buffer();
+    void test_shadowsink_unreachable();
+    void test_shadowsink_close_timeout();
+    void test_proxylistener_set_route();
+    void test_proxylistener_stop();
+    void test_listenerhandoff_takeover();
+    void test_proxy_half_close();
+    void test_socketoptions_apply();
+    void test_proxylistener_accept_batch();
+    void test_proxy_footprint();
+    void test_sessionslab_recycling();
+    void test_sessionslab_release_chunks();
+    void test_sessionslab_remote_release();
+    void test_sessionslab_remote_reclaim();
+    void test_coroutineproxy_half_close();
+    void test_affinitytable_eviction();
+    void test_affinitytable_expiry();
+    void test_proxylistener_affinity();
+    void test_proxyprotocol_headers();
+    void test_proxy_proxy_protocol();
+    void test_streamendpoint_make();
+    void test_proxy_unix_sockets();
+    void test_portrange_parse();
+    void test_proxylistener_port_range();
+    void test_modeproxy_reload_configuration();
+    void test_modeproxy_drain_deadline();
+    void test_modeproxy_drain_second_signal();
 };
 
 #endif // MCT_TESTS_MODEPROXY_TEST_MODEPROXY_HPP
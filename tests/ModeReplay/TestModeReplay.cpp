@@ -0,0 +1,346 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file tests/ModeReplay/TestModeReplay.cpp
+ *
+ * @desc ModeReplay application mode tests.
+ */
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+#include <Configuration/ConfigurationBuilder.hpp>
+#include <ModeProxy/CaptureRing.hpp>
+#include <ModeReplay/CaptureReplayer.hpp>
+
+#include "TestModeReplay.hpp"
+
+using boost::asio::ip::tcp;
+
+void TestModeReplay::setUp()
+{
+}
+
+void TestModeReplay::tearDown()
+{
+}
+
+class ConfigFileReaderHelper
+{
+public:
+    ConfigFileReaderHelper(const std::string& filename, const std::vector<std::string>& keys_values, const int argc, const char** argv)
+    : m_config(argc, (char**)argv), m_filename(filename), m_keys_values(keys_values), m_argc(argc), m_argv(argv)
+    {
+    }
+
+    bool read_file(std::string& message_to_user)
+    {
+        std::ofstream fs;
+
+        std::shared_ptr<std::ofstream> fileGuard(&fs, [&](std::ofstream*)
+        {
+            boost::filesystem::remove(m_filename);
+        });
+
+        fs.open(m_filename);
+        for (auto& keys_values : m_keys_values) {
+            fs << "#" << std::endl;
+            fs << "# Standard comment support" << std::endl;
+            fs << "#" << std::endl;
+            fs << keys_values << std::endl << std::endl;
+        }
+        fs.close();
+
+        mct::ConfigurationBuilder config_builder(m_config);
+
+        return config_builder.build_configuration(message_to_user);
+    }
+
+    mct::Configuration& get_config() { return m_config; }
+
+private:
+    mct::Configuration m_config;
+    std::string m_filename;
+    std::vector<std::string> m_keys_values;
+    const int m_argc;
+    const char** m_argv;
+};
+
+/**
+ * Removes <prefix>.<n> capture files and the lock file of the ring when going out of scope.
+ */
+class CaptureFilesGuard
+{
+public:
+    explicit CaptureFilesGuard(const std::string& prefix) : m_prefix(prefix) {}
+
+    ~CaptureFilesGuard()
+    {
+        for (uint16_t index = 0; boost::filesystem::exists(mct::CaptureRing::get_file_name(m_prefix, index)); ++index) {
+            boost::filesystem::remove(mct::CaptureRing::get_file_name(m_prefix, index));
+        }
+        boost::filesystem::remove(mct::CaptureRing::get_lock_file_name(m_prefix));
+    }
+
+private:
+    std::string m_prefix;
+};
+
+void capture_append(mct::CaptureRing& ring, uint64_t session_id, mct::capture_direction direction, const std::string& data)
+{
+    ring.append(session_id, direction, reinterpret_cast<const unsigned char*>(data.data()), data.size());
+}
+
+std::string capture_data(const mct::CaptureRecord& record)
+{
+    return std::string(reinterpret_cast<const char*>(record.data), record.length);
+}
+
+/**
+ * Collects everything received on every accepted connection, indexed by the order of accepts.
+ */
+class ReplayCollector : public std::enable_shared_from_this<ReplayCollector>
+{
+public:
+    ReplayCollector(boost::asio::io_service& ios, uint16_t port)
+     : m_ios(ios), m_acceptor(ios, tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), port)), m_closed_connections(0)
+    {
+    }
+
+    void start_accept()
+    {
+        auto socket = std::make_shared<tcp::socket>(m_ios);
+        auto self = shared_from_this();
+        m_acceptor.async_accept(*socket, [self, socket](const boost::system::error_code& error) {
+            if (!error) {
+                const size_t connection = self->m_received.size();
+                self->m_received.push_back(std::string());
+                self->start_read(socket, connection);
+                self->start_accept();
+            }
+        });
+    }
+
+    void stop()
+    {
+        boost::system::error_code ignored;
+        m_acceptor.close(ignored);
+    }
+
+    const std::vector<std::string>& get_received() const { return m_received; }
+    size_t get_closed_connections() const { return m_closed_connections; }
+
+private:
+    void start_read(const std::shared_ptr<tcp::socket>& socket, size_t connection)
+    {
+        auto self = shared_from_this();
+        auto data = std::make_shared< std::array<char, 1024> >();
+        socket->async_read_some(boost::asio::buffer(*data), [self, socket, data, connection](const boost::system::error_code& error, size_t length) {
+            if (error) {
+                ++self->m_closed_connections;
+                return;
+            }
+
+            self->m_received[connection].append(data->data(), length);
+            boost::asio::write(*socket, boost::asio::buffer(std::string("ok")));
+            self->start_read(socket, connection);
+        });
+    }
+
+private:
+    boost::asio::io_service& m_ios;
+    tcp::acceptor m_acceptor;
+    std::vector<std::string> m_received;
+    size_t m_closed_connections;
+};
+
+void TestModeReplay::test_capturering_roundtrip()
+{
+    const std::string prefix("./tmr_capturering_roundtrip.cap");
+    CaptureFilesGuard guard(prefix);
+
+    {
+        mct::CaptureRing ring(prefix, 4096, 2);
+
+        const uint64_t first = ring.next_session_id();
+        const uint64_t second = ring.next_session_id();
+        CPPUNIT_ASSERT(first != second);
+
+        capture_append(ring, first, mct::capture_session_open, "");
+        capture_append(ring, first, mct::capture_client_to_remote, "GET / HTTP/1.0\r\n\r\n");
+        capture_append(ring, second, mct::capture_client_to_remote, "hello");
+        capture_append(ring, first, mct::capture_remote_to_client, "HTTP/1.0 200 OK\r\n\r\n");
+        capture_append(ring, first, mct::capture_session_close, "");
+    }
+
+    mct::CaptureReader reader(prefix);
+    mct::CaptureRecord record;
+
+    // the files are replaced by the next ring of the prefix, not overwritten under the reader which still maps them
+    {
+        mct::CaptureRing ring(prefix, 4096, 2);
+        CPPUNIT_ASSERT_THROW(mct::CaptureRing(prefix, 4096, 2), std::runtime_error);
+        capture_append(ring, ring.next_session_id(), mct::capture_client_to_remote, "next capture");
+    }
+
+    CPPUNIT_ASSERT_EQUAL(true, reader.next(record));
+    CPPUNIT_ASSERT_EQUAL(mct::capture_session_open, record.direction);
+    CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(0), record.length);
+    const uint64_t first = record.session_id;
+    const uint64_t first_timestamp = record.timestamp_ns;
+
+    CPPUNIT_ASSERT_EQUAL(true, reader.next(record));
+    CPPUNIT_ASSERT_EQUAL(mct::capture_client_to_remote, record.direction);
+    CPPUNIT_ASSERT_EQUAL(first, record.session_id);
+    CPPUNIT_ASSERT_EQUAL(std::string("GET / HTTP/1.0\r\n\r\n"), capture_data(record));
+    CPPUNIT_ASSERT(record.timestamp_ns >= first_timestamp);
+
+    CPPUNIT_ASSERT_EQUAL(true, reader.next(record));
+    CPPUNIT_ASSERT(first != record.session_id);
+    CPPUNIT_ASSERT_EQUAL(std::string("hello"), capture_data(record));
+
+    CPPUNIT_ASSERT_EQUAL(true, reader.next(record));
+    CPPUNIT_ASSERT_EQUAL(mct::capture_remote_to_client, record.direction);
+    CPPUNIT_ASSERT_EQUAL(std::string("HTTP/1.0 200 OK\r\n\r\n"), capture_data(record));
+
+    CPPUNIT_ASSERT_EQUAL(true, reader.next(record));
+    CPPUNIT_ASSERT_EQUAL(mct::capture_session_close, record.direction);
+
+    CPPUNIT_ASSERT_EQUAL(false, reader.next(record));
+}
+
+void TestModeReplay::test_capturering_wraparound()
+{
+    const std::string prefix("./tmr_capturering_wraparound.cap");
+    CaptureFilesGuard guard(prefix);
+
+    {
+        // 64 bytes of file header + 3 records of 24 + 104 bytes (128 bytes each) fit into one file
+        mct::CaptureRing ring(prefix, 448, 3);
+        const uint64_t session_id = ring.next_session_id();
+
+        for (char c = 'a'; c <= 'z'; ++c) {
+            capture_append(ring, session_id, mct::capture_client_to_remote, std::string(104, c));
+        }
+    }
+
+    mct::CaptureReader reader(prefix);
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), reader.get_num_of_files());
+
+    // 26 records in files of 3: the ring switched files 8 times, so only the last 3 files (8 records) are left - oldest first
+    std::string order;
+    mct::CaptureRecord record;
+    while (reader.next(record)) {
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(104), record.length);
+        CPPUNIT_ASSERT_EQUAL(std::string(104, static_cast<char>(record.data[0])), capture_data(record));
+        order.push_back(static_cast<char>(record.data[0]));
+    }
+
+    CPPUNIT_ASSERT_EQUAL(std::string("stuvwxyz"), order);
+}
+
+void TestModeReplay::test_capturereplayer_replay()
+{
+    std::string filename("./tmr_capturereplayer_replay.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    const std::string prefix("./tmr_capturereplayer_replay.cap");
+    CaptureFilesGuard guard(prefix);
+
+    {
+        mct::CaptureRing ring(prefix, 65536, 2);
+        const uint64_t first = ring.next_session_id();
+        const uint64_t second = ring.next_session_id();
+
+        capture_append(ring, first, mct::capture_session_open, "");
+        capture_append(ring, first, mct::capture_client_to_remote, "first ");
+        capture_append(ring, second, mct::capture_session_open, "");
+        capture_append(ring, first, mct::capture_remote_to_client, "ok");
+        capture_append(ring, first, mct::capture_client_to_remote, "session");
+        capture_append(ring, second, mct::capture_client_to_remote, "second session");
+        capture_append(ring, first, mct::capture_session_close, "");
+        // the second session is never closed in the capture, it is finished when the capture ends
+    }
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        boost::asio::io_service ios;
+
+        auto collector = std::make_shared<ReplayCollector>(ios, 17291);
+        collector->start_accept();
+
+        mct::CaptureReader reader(prefix);
+        auto replayer = std::make_shared<mct::CaptureReplayer>(ios, logger, reader, "127.0.0.1", 17291, 0);
+        replayer->start();
+
+        for (int i = 0; i < 200 && collector->get_closed_connections() < 2; ++i) {
+            ios.poll();
+            ios.reset();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), collector->get_closed_connections());
+
+        std::vector<std::string> received = collector->get_received();
+        std::sort(received.begin(), received.end());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), received.size());
+        CPPUNIT_ASSERT_EQUAL(std::string("first session"), received[0]);
+        CPPUNIT_ASSERT_EQUAL(std::string("second session"), received[1]);
+
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(2), replayer->get_replayed_sessions());
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(0), replayer->get_failed_sessions());
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(27), replayer->get_sent_bytes());
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(2), replayer->get_captured_response_bytes());
+
+        collector->stop();
+        ios.run();
+    }
+}
@@ -0,0 +1,347 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file tests/ModeSni/TestModeSni.cpp
+ *
+ * @desc ModeSni application mode tests.
+ */
+
+#include <thread>
+#include <memory>
+#include <vector>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+#include <Configuration/ConfigurationBuilder.hpp>
+#include <ModeProxy/ProxyListener.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeSni/SniProxy.hpp>
+#include <ModeSni/SniRouter.hpp>
+#include <ModeSni/ClientHelloParser.hpp>
+
+#include "TestModeSni.hpp"
+
+using boost::asio::ip::tcp;
+
+void TestModeSni::setUp()
+{
+}
+
+void TestModeSni::tearDown()
+{
+}
+
+class ConfigFileReaderHelper
+{
+public:
+    ConfigFileReaderHelper(const std::string& filename, const std::vector<std::string>& keys_values, const int argc, const char** argv)
+    : m_config(argc, (char**)argv), m_filename(filename), m_keys_values(keys_values), m_argc(argc), m_argv(argv)
+    {
+    }
+
+    bool read_file(std::string& message_to_user)
+    {
+        std::ofstream fs;
+
+        std::shared_ptr<std::ofstream> fileGuard(&fs, [&](std::ofstream*)
+        {
+            boost::filesystem::remove(m_filename);
+        });
+
+        fs.open(m_filename);
+        for (auto& keys_values : m_keys_values) {
+            fs << "#" << std::endl;
+            fs << "# Standard comment support" << std::endl;
+            fs << "#" << std::endl;
+            fs << keys_values << std::endl << std::endl;
+        }
+        fs.close();
+
+        mct::ConfigurationBuilder config_builder(m_config);
+
+        return config_builder.build_configuration(message_to_user);
+    }
+
+    mct::Configuration& get_config() { return m_config; }
+
+private:
+    mct::Configuration m_config;
+    std::string m_filename;
+    std::vector<std::string> m_keys_values;
+    const int m_argc;
+    const char** m_argv;
+};
+
+namespace
+{
+
+/**
+ * Runs an sni listener on its own thread, the tests use blocking sockets of another io_service.
+ */
+class SniServer
+{
+public:
+    SniServer(mct::Logger& logger, uint16_t listen_port, const std::shared_ptr<mct::SniSettings>& settings)
+    {
+        mct::ListenerOptions options;
+        options.session_factory = mct::SniProxy::create_factory(settings);
+
+        m_listener = std::make_shared<mct::ProxyListener>(m_ios, logger, "127.0.0.1", listen_port, "0.0.0.0", 0, options);
+        m_listener->async_listen();
+        m_thread = std::thread([this]() { m_ios.run(); });
+    }
+
+    ~SniServer()
+    {
+        m_ios.stop();
+        m_thread.join();
+    }
+
+private:
+    boost::asio::io_service m_ios;
+    std::shared_ptr<mct::ProxyListener> m_listener;
+    std::thread m_thread;
+};
+
+std::string read_exactly(tcp::socket& socket, size_t length)
+{
+    std::string data(length, '\0');
+    boost::asio::read(socket, boost::asio::buffer(&data[0], length));
+    return data;
+}
+
+void append_uint16(std::string& data, size_t value)
+{
+    data += static_cast<char>((value >> 8) & 0xff);
+    data += static_cast<char>(value & 0xff);
+}
+
+/**
+ * TLS 1.2 style ClientHello record, with the server name extension behind another one if server_name is not empty.
+ */
+std::string client_hello(const std::string& server_name)
+{
+    std::string extensions;
+    // ec_point_formats
+    append_uint16(extensions, 0x000b);
+    append_uint16(extensions, 2);
+    extensions += std::string("\x01\x00", 2);
+
+    if (!server_name.empty()) {
+        append_uint16(extensions, 0x0000);
+        append_uint16(extensions, server_name.size() + 5);
+        append_uint16(extensions, server_name.size() + 3);
+        extensions += '\0';
+        append_uint16(extensions, server_name.size());
+        extensions += server_name;
+    }
+
+    std::string hello("\x03\x03", 2);
+    hello += std::string(32, 'r');
+    hello += static_cast<char>(32);
+    hello += std::string(32, 's');
+    append_uint16(hello, 2);
+    hello += std::string("\x13\x01", 2);
+    hello += std::string("\x01\x00", 2);
+    append_uint16(hello, extensions.size());
+    hello += extensions;
+
+    std::string handshake("\x01", 1);
+    handshake += '\0';
+    append_uint16(handshake, hello.size());
+    handshake += hello;
+
+    std::string record("\x16\x03\x01", 3);
+    append_uint16(record, handshake.size());
+    return record + handshake;
+}
+
+mct::ClientHelloParser::Result parse(const std::string& data)
+{
+    mct::ClientHelloParser parser(8192);
+    return parser.parse(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+}
+
+bool is_closed(tcp::socket& socket)
+{
+    char data[16];
+    boost::system::error_code error;
+    socket.read_some(boost::asio::buffer(data), error);
+    return error == boost::asio::error::eof || error == boost::asio::error::connection_reset;
+}
+
+}
+
+void TestModeSni::test_clienthelloparser_server_name()
+{
+    const std::string hello = client_hello("www.example.com");
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(hello.data());
+
+    // the record arrives byte after byte
+    mct::ClientHelloParser parser(8192);
+    for (size_t length = 0; length < hello.size(); ++length) {
+        CPPUNIT_ASSERT_EQUAL(mct::ClientHelloParser::incomplete, parser.parse(data, length));
+    }
+
+    CPPUNIT_ASSERT_EQUAL(mct::ClientHelloParser::complete, parser.parse(data, hello.size()));
+    CPPUNIT_ASSERT_EQUAL(std::string("www.example.com"), hello.substr(parser.get_server_name_offset(), parser.get_server_name_length()));
+
+    // application data sent right after the hello does not matter
+    CPPUNIT_ASSERT_EQUAL(mct::ClientHelloParser::complete, parse(hello + "\x17\x03\x03"));
+
+    CPPUNIT_ASSERT_EQUAL(mct::ClientHelloParser::no_server_name, parse(client_hello("")));
+}
+
+void TestModeSni::test_clienthelloparser_invalid()
+{
+    // plain HTTP
+    CPPUNIT_ASSERT_EQUAL(mct::ClientHelloParser::invalid, parse("GET / HTTP/1.1\r\n\r\n"));
+
+    // a record larger than the buffer of the session
+    std::string hello = client_hello("www.example.com");
+    std::string huge = hello.substr(0, 3) + "\x3f\xff";
+    CPPUNIT_ASSERT_EQUAL(mct::ClientHelloParser::invalid, parse(huge));
+
+    // the server name claims more bytes than its extension has
+    std::string broken = hello;
+    broken[broken.size() - std::string("www.example.com").size() - 1] = 0x7f;
+    CPPUNIT_ASSERT_EQUAL(mct::ClientHelloParser::invalid, parse(broken));
+
+    // not a ClientHello
+    std::string server_hello = hello;
+    server_hello[5] = 0x02;
+    CPPUNIT_ASSERT_EQUAL(mct::ClientHelloParser::invalid, parse(server_hello));
+
+    // the session id runs past the end of the record
+    std::string short_record = hello.substr(0, 3);
+    append_uint16(short_record, 40);
+    short_record += hello.substr(5, 40);
+    CPPUNIT_ASSERT_EQUAL(mct::ClientHelloParser::invalid, parse(short_record));
+}
+
+void TestModeSni::test_snirouter_wildcards()
+{
+    mct::SniRouter router;
+
+    CPPUNIT_ASSERT(router.add_route("www.example.com", "10.0.0.1", 443));
+    CPPUNIT_ASSERT(router.add_route("*.Example.com", "10.0.0.2", 443));
+    CPPUNIT_ASSERT(router.add_route("api.example.org", "10.0.0.2", 443));
+    CPPUNIT_ASSERT(!router.add_route("www.example.com", "10.0.0.3", 443));
+    CPPUNIT_ASSERT(!router.add_route("*", "10.0.0.3", 443));
+    CPPUNIT_ASSERT(!router.add_route("www.exa mple.com", "10.0.0.3", 443));
+    CPPUNIT_ASSERT_EQUAL(size_t(3), router.get_num_of_routes());
+    CPPUNIT_ASSERT_EQUAL(size_t(2), router.get_num_of_backends());
+
+    CPPUNIT_ASSERT_EQUAL(std::string("10.0.0.1"), router.find_backend("WWW.example.com.")->host);
+    CPPUNIT_ASSERT_EQUAL(std::string("10.0.0.2"), router.find_backend("mail.example.com")->host);
+    CPPUNIT_ASSERT_EQUAL(std::string("10.0.0.2"), router.find_backend("api.example.org")->host);
+
+    // a wildcard matches a single label only
+    CPPUNIT_ASSERT(!router.find_backend("a.b.example.com"));
+    CPPUNIT_ASSERT(!router.find_backend("example.com"));
+    CPPUNIT_ASSERT(!router.find_backend(""));
+
+    router.set_default_backend("10.0.0.9", 8443);
+    CPPUNIT_ASSERT_EQUAL(uint16_t(8443), router.find_backend("a.b.example.com")->port);
+    CPPUNIT_ASSERT_EQUAL(uint16_t(8443), router.find_backend("")->port);
+}
+
+void TestModeSni::test_sniproxy_routing()
+{
+    std::string filename("./tmp_modesni_sniproxy_routing.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        auto settings = std::make_shared<mct::SniSettings>();
+        settings->router.add_route("one.example.com", "127.0.0.1", 17231);
+        settings->router.add_route("*.two.example.com", "127.0.0.1", 17232);
+
+        SniServer server(logger, 17230, settings);
+
+        const auto localhost = boost::asio::ip::address_v4::from_string("127.0.0.1");
+        boost::asio::io_service ios;
+        tcp::acceptor backend_one(ios, tcp::endpoint(localhost, 17231));
+        tcp::acceptor backend_two(ios, tcp::endpoint(localhost, 17232));
+
+        // the hello is split, the backend gets it untouched together with what followed it
+        {
+            tcp::socket client(ios), peer(ios);
+            const std::string hello = client_hello("www.two.example.com");
+
+            client.connect(tcp::endpoint(localhost, 17230));
+            boost::asio::write(client, boost::asio::buffer(hello.substr(0, 20)));
+            boost::asio::write(client, boost::asio::buffer(hello.substr(20) + "early"));
+            backend_two.accept(peer);
+
+            CPPUNIT_ASSERT(hello + "early" == read_exactly(peer, hello.size() + 5));
+
+            boost::asio::write(peer, boost::asio::buffer(std::string("server hello")));
+            CPPUNIT_ASSERT_EQUAL(std::string("server hello"), read_exactly(client, 12));
+
+            boost::asio::write(client, boost::asio::buffer(std::string("finished")));
+            CPPUNIT_ASSERT_EQUAL(std::string("finished"), read_exactly(peer, 8));
+        }
+
+        {
+            tcp::socket client(ios), peer(ios);
+            const std::string hello = client_hello("one.example.com");
+
+            client.connect(tcp::endpoint(localhost, 17230));
+            boost::asio::write(client, boost::asio::buffer(hello));
+            backend_one.accept(peer);
+            CPPUNIT_ASSERT(hello == read_exactly(peer, hello.size()));
+        }
+
+        // an unknown name is refused with a fatal unrecognized_name alert
+        {
+            tcp::socket client(ios);
+            client.connect(tcp::endpoint(localhost, 17230));
+            boost::asio::write(client, boost::asio::buffer(client_hello("three.example.com")));
+            CPPUNIT_ASSERT(std::string("\x15\x03\x01\x00\x02\x02\x70", 7) == read_exactly(client, 7));
+            CPPUNIT_ASSERT(is_closed(client));
+        }
+    }
+}
@@ -0,0 +1,393 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file tests/ModeSocks/TestModeSocks.cpp
+ *
+ * @desc ModeSocks application mode tests.
+ */
+
+#include <thread>
+#include <memory>
+#include <vector>
+#include <string>
+#include <initializer_list>
+
+#include <boost/filesystem.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+#include <Configuration/ConfigurationBuilder.hpp>
+#include <ModeProxy/ProxyListener.hpp>
+#include <ModeProxy/CachedResolver.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeSocks/Socks5Proxy.hpp>
+
+#include "TestModeSocks.hpp"
+
+using boost::asio::ip::tcp;
+
+void TestModeSocks::setUp()
+{
+}
+
+void TestModeSocks::tearDown()
+{
+}
+
+class ConfigFileReaderHelper
+{
+public:
+    ConfigFileReaderHelper(const std::string& filename, const std::vector<std::string>& keys_values, const int argc, const char** argv)
+    : m_config(argc, (char**)argv), m_filename(filename), m_keys_values(keys_values), m_argc(argc), m_argv(argv)
+    {
+    }
+
+    bool read_file(std::string& message_to_user)
+    {
+        std::ofstream fs;
+
+        std::shared_ptr<std::ofstream> fileGuard(&fs, [&](std::ofstream*)
+        {
+            boost::filesystem::remove(m_filename);
+        });
+
+        fs.open(m_filename);
+        for (auto& keys_values : m_keys_values) {
+            fs << "#" << std::endl;
+            fs << "# Standard comment support" << std::endl;
+            fs << "#" << std::endl;
+            fs << keys_values << std::endl << std::endl;
+        }
+        fs.close();
+
+        mct::ConfigurationBuilder config_builder(m_config);
+
+        return config_builder.build_configuration(message_to_user);
+    }
+
+    mct::Configuration& get_config() { return m_config; }
+
+private:
+    mct::Configuration m_config;
+    std::string m_filename;
+    std::vector<std::string> m_keys_values;
+    const int m_argc;
+    const char** m_argv;
+};
+
+namespace
+{
+
+/**
+ * Runs a SOCKS5 listener on its own thread, the tests use blocking sockets of another io_service.
+ */
+class Socks5Server
+{
+public:
+    Socks5Server(mct::Logger& logger, uint16_t listen_port, const std::string& username, const std::string& password)
+    : m_settings(std::make_shared<mct::Socks5Settings>())
+    {
+        m_settings->username = username;
+        m_settings->password = password;
+        m_settings->resolver = std::make_shared<mct::CachedResolver>(logger, m_ios, 16, 60);
+
+        mct::ListenerOptions options;
+        options.session_factory = mct::Socks5Proxy::create_factory(m_settings);
+
+        m_listener = std::make_shared<mct::ProxyListener>(m_ios, logger, "127.0.0.1", listen_port, "0.0.0.0", 0, options);
+        m_listener->async_listen();
+        m_thread = std::thread([this]() { m_ios.run(); });
+    }
+
+    ~Socks5Server()
+    {
+        m_ios.stop();
+        m_thread.join();
+    }
+
+    const mct::CachedResolver& get_resolver() const { return *m_settings->resolver; }
+
+private:
+    boost::asio::io_service m_ios;
+    std::shared_ptr<mct::Socks5Settings> m_settings;
+    std::shared_ptr<mct::ProxyListener> m_listener;
+    std::thread m_thread;
+};
+
+std::string read_exactly(tcp::socket& socket, size_t length)
+{
+    std::string data(length, '\0');
+    boost::asio::read(socket, boost::asio::buffer(&data[0], length));
+    return data;
+}
+
+std::string bytes(const std::initializer_list<unsigned char>& values)
+{
+    return std::string(values.begin(), values.end());
+}
+
+/**
+ * CONNECT request for an IPv4 destination.
+ */
+std::string connect_request(const boost::asio::ip::address_v4& address, uint16_t port, unsigned char command = 0x01)
+{
+    boost::asio::ip::address_v4::bytes_type ip = address.to_bytes();
+    return bytes({ 0x05, command, 0x00, 0x01, ip[0], ip[1], ip[2], ip[3], static_cast<unsigned char>(port >> 8), static_cast<unsigned char>(port & 0xff) });
+}
+
+bool is_closed(tcp::socket& socket)
+{
+    char data[16];
+    boost::system::error_code error;
+    socket.read_some(boost::asio::buffer(data), error);
+    return error == boost::asio::error::eof || error == boost::asio::error::connection_reset;
+}
+
+}
+
+void TestModeSocks::test_cachedresolver_cache()
+{
+    std::string filename("./tmp_modesocks_cachedresolver_cache.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        boost::asio::io_service ios;
+        auto resolver = std::make_shared<mct::CachedResolver>(logger, ios, 16, 60);
+
+        size_t num_of_answers = 0;
+        auto expect_localhost = [&](const boost::system::error_code& error, const mct::CachedResolver::addresses_type& addresses) {
+            CPPUNIT_ASSERT(!error);
+            CPPUNIT_ASSERT(!addresses.empty());
+            CPPUNIT_ASSERT(addresses.front().is_loopback());
+            ++num_of_answers;
+        };
+
+        // sessions asking at the same time share a single lookup
+        resolver->async_resolve("localhost", expect_localhost);
+        resolver->async_resolve("localhost", expect_localhost);
+        CPPUNIT_ASSERT_EQUAL(size_t(0), num_of_answers);
+        ios.run();
+        ios.reset();
+
+        CPPUNIT_ASSERT_EQUAL(size_t(2), num_of_answers);
+        CPPUNIT_ASSERT_EQUAL(uint64_t(1), resolver->get_num_of_lookups());
+        CPPUNIT_ASSERT_EQUAL(size_t(1), resolver->get_num_of_entries());
+
+        // later sessions are answered from the cache, addresses are not looked up at all
+        resolver->async_resolve("localhost", expect_localhost);
+        resolver->async_resolve("127.0.0.1", expect_localhost);
+        ios.run();
+
+        CPPUNIT_ASSERT_EQUAL(size_t(4), num_of_answers);
+        CPPUNIT_ASSERT_EQUAL(uint64_t(1), resolver->get_num_of_lookups());
+        CPPUNIT_ASSERT_EQUAL(uint64_t(1), resolver->get_num_of_hits());
+    }
+}
+
+void TestModeSocks::test_socks5proxy_connect()
+{
+    std::string filename("./tmp_modesocks_socks5proxy_connect.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        Socks5Server server(logger, 17210, "", "");
+
+        const auto localhost = boost::asio::ip::address_v4::from_string("127.0.0.1");
+        boost::asio::io_service ios;
+        tcp::acceptor backend(ios, tcp::endpoint(localhost, 17211));
+        tcp::socket client(ios), peer(ios);
+
+        client.connect(tcp::endpoint(localhost, 17210));
+        boost::asio::write(client, boost::asio::buffer(bytes({ 0x05, 0x02, 0x02, 0x00 })));
+        CPPUNIT_ASSERT(bytes({ 0x05, 0x00 }) == read_exactly(client, 2));
+
+        // the first request bytes are sent together with the CONNECT request
+        boost::asio::write(client, boost::asio::buffer(connect_request(localhost, 17211) + "hello"));
+        backend.accept(peer);
+
+        std::string reply = read_exactly(client, 10);
+        CPPUNIT_ASSERT(bytes({ 0x05, 0x00, 0x00, 0x01, 127, 0, 0, 1 }) == reply.substr(0, 8));
+        CPPUNIT_ASSERT_EQUAL(std::string("hello"), read_exactly(peer, 5));
+
+        boost::asio::write(peer, boost::asio::buffer(std::string("world")));
+        CPPUNIT_ASSERT_EQUAL(std::string("world"), read_exactly(client, 5));
+
+        peer.close();
+        CPPUNIT_ASSERT(is_closed(client));
+    }
+}
+
+void TestModeSocks::test_socks5proxy_authentication()
+{
+    std::string filename("./tmp_modesocks_socks5proxy_authentication.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        Socks5Server server(logger, 17212, "user", "secret");
+
+        const auto localhost = boost::asio::ip::address_v4::from_string("127.0.0.1");
+        boost::asio::io_service ios;
+        tcp::acceptor backend(ios, tcp::endpoint(localhost, 17213));
+
+        // a client which cannot authenticate is refused
+        {
+            tcp::socket client(ios);
+            client.connect(tcp::endpoint(localhost, 17212));
+            boost::asio::write(client, boost::asio::buffer(bytes({ 0x05, 0x01, 0x00 })));
+            CPPUNIT_ASSERT(bytes({ 0x05, 0xff }) == read_exactly(client, 2));
+            CPPUNIT_ASSERT(is_closed(client));
+        }
+
+        // so is a client with a wrong password
+        {
+            tcp::socket client(ios);
+            client.connect(tcp::endpoint(localhost, 17212));
+            boost::asio::write(client, boost::asio::buffer(bytes({ 0x05, 0x01, 0x02 })));
+            CPPUNIT_ASSERT(bytes({ 0x05, 0x02 }) == read_exactly(client, 2));
+            boost::asio::write(client, boost::asio::buffer(bytes({ 0x01, 0x04 }) + "user" + bytes({ 0x06 }) + "secreT"));
+            CPPUNIT_ASSERT(bytes({ 0x01, 0x01 }) == read_exactly(client, 2));
+            CPPUNIT_ASSERT(is_closed(client));
+        }
+
+        // the right credentials let the client connect to a host name
+        {
+            tcp::socket client(ios), peer(ios);
+            client.connect(tcp::endpoint(localhost, 17212));
+            boost::asio::write(client, boost::asio::buffer(bytes({ 0x05, 0x01, 0x02 })));
+            CPPUNIT_ASSERT(bytes({ 0x05, 0x02 }) == read_exactly(client, 2));
+            boost::asio::write(client, boost::asio::buffer(bytes({ 0x01, 0x04 }) + "user" + bytes({ 0x06 }) + "secret"));
+            CPPUNIT_ASSERT(bytes({ 0x01, 0x00 }) == read_exactly(client, 2));
+
+            boost::asio::write(client, boost::asio::buffer(bytes({ 0x05, 0x01, 0x00, 0x03, 9 }) + "localhost" + bytes({ 17213 >> 8, 17213 & 0xff })));
+            backend.accept(peer);
+
+            std::string reply = read_exactly(client, 4);
+            CPPUNIT_ASSERT(bytes({ 0x05, 0x00, 0x00 }) == reply.substr(0, 3));
+            read_exactly(client, (reply[3] == 0x04) ? 18 : 6);
+
+            boost::asio::write(client, boost::asio::buffer(std::string("ping")));
+            CPPUNIT_ASSERT_EQUAL(std::string("ping"), read_exactly(peer, 4));
+        }
+
+        CPPUNIT_ASSERT_EQUAL(uint64_t(1), server.get_resolver().get_num_of_lookups());
+    }
+}
+
+void TestModeSocks::test_socks5proxy_rejects()
+{
+    std::string filename("./tmp_modesocks_socks5proxy_rejects.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        Socks5Server server(logger, 17214, "", "");
+
+        const auto localhost = boost::asio::ip::address_v4::from_string("127.0.0.1");
+        boost::asio::io_service ios;
+
+        auto send_request = [&](const std::string& request) {
+            tcp::socket client(ios);
+            client.connect(tcp::endpoint(localhost, 17214));
+            boost::asio::write(client, boost::asio::buffer(bytes({ 0x05, 0x01, 0x00 })));
+            CPPUNIT_ASSERT(bytes({ 0x05, 0x00 }) == read_exactly(client, 2));
+
+            boost::asio::write(client, boost::asio::buffer(request));
+            std::string reply = read_exactly(client, 10);
+            CPPUNIT_ASSERT(is_closed(client));
+            return static_cast<unsigned char>(reply[1]);
+        };
+
+        // BIND is not supported
+        CPPUNIT_ASSERT_EQUAL(static_cast<unsigned char>(0x07), send_request(connect_request(localhost, 17215, 0x02)));
+
+        // nothing listens at the destination
+        CPPUNIT_ASSERT_EQUAL(static_cast<unsigned char>(0x05), send_request(connect_request(localhost, 17215)));
+
+        // unknown address type
+        CPPUNIT_ASSERT_EQUAL(static_cast<unsigned char>(0x08), send_request(bytes({ 0x05, 0x01, 0x00, 0x07, 0x00 })));
+    }
+}
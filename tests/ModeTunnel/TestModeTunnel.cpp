@@ -0,0 +1,725 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file tests/ModeTunnel/TestModeTunnel.cpp
+ *
+ * @desc ModeTunnel application mode tests.
+ */
+
+#include <chrono>
+#include <future>
+#include <random>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+#include <Configuration/ConfigurationBuilder.hpp>
+#include <ModeProxy/ProxyRoute.hpp>
+#include <ModeProxy/ProxyListener.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+#include <ModeTunnel/TunnelPool.hpp>
+#include <ModeTunnel/TunnelCodec.hpp>
+#include <ModeTunnel/TunnelCodecPool.hpp>
+#include <ModeTunnel/TunnelFrame.hpp>
+#include <ModeTunnel/TunnelProxy.hpp>
+#include <ModeTunnel/TunnelService.hpp>
+#include <ModeTunnel/TunnelListener.hpp>
+#include <ModeTunnel/TunnelConnection.hpp>
+
+#include "TestModeTunnel.hpp"
+
+using boost::asio::ip::tcp;
+
+void TestModeTunnel::setUp()
+{
+}
+
+void TestModeTunnel::tearDown()
+{
+}
+
+class ConfigFileReaderHelper
+{
+public:
+    ConfigFileReaderHelper(const std::string& filename, const std::vector<std::string>& keys_values, const int argc, const char** argv)
+    : m_config(argc, (char**)argv), m_filename(filename), m_keys_values(keys_values), m_argc(argc), m_argv(argv)
+    {
+    }
+
+    bool read_file(std::string& message_to_user)
+    {
+        std::ofstream fs;
+
+        std::shared_ptr<std::ofstream> fileGuard(&fs, [&](std::ofstream*)
+        {
+            boost::filesystem::remove(m_filename);
+        });
+
+        fs.open(m_filename);
+        for (auto& keys_values : m_keys_values) {
+            fs << "#" << std::endl;
+            fs << "# Standard comment support" << std::endl;
+            fs << "#" << std::endl;
+            fs << keys_values << std::endl << std::endl;
+        }
+        fs.close();
+
+        mct::ConfigurationBuilder config_builder(m_config);
+
+        return config_builder.build_configuration(message_to_user);
+    }
+
+    mct::Configuration& get_config() { return m_config; }
+
+private:
+    mct::Configuration m_config;
+    std::string m_filename;
+    std::vector<std::string> m_keys_values;
+    const int m_argc;
+    const char** m_argv;
+};
+
+namespace
+{
+
+/**
+ * Runs a core and (if edge_port is not 0) an edge connected to it on their own thread, the tests use blocking
+ * sockets of another io_service. The core forwards service "echo" to backend_port.
+ */
+class TunnelEnds
+{
+public:
+    TunnelEnds(mct::Logger& logger, uint16_t core_port, uint16_t edge_port, const std::string& service, uint16_t backend_port, uint16_t num_of_connections, uint32_t window,
+        mct::TunnelCodec::Type edge_codec = mct::TunnelCodec::none, mct::TunnelCodec::Type core_codec = mct::TunnelCodec::none)
+    : m_num_of_connections(num_of_connections)
+    {
+        mct::TunnelListener::services_type services;
+        services["echo"] = std::make_shared<mct::ProxyRoute>("127.0.0.1", core_port, "127.0.0.1", backend_port, mct::ListenerOptions());
+
+        m_core = std::make_shared<mct::TunnelListener>(m_ios, logger, "127.0.0.1", core_port, window, services, core_codec);
+        m_core->async_listen();
+
+        if (edge_port != 0) {
+            m_pool = std::make_shared<mct::TunnelPool>(logger, m_ios, "127.0.0.1", core_port, num_of_connections, window, edge_codec);
+            m_pool->start();
+
+            auto settings = std::make_shared<mct::TunnelEdgeSettings>();
+            settings->pool = m_pool;
+            settings->service = service;
+
+            mct::ListenerOptions options;
+            options.session_factory = mct::TunnelProxy::create_factory(settings);
+
+            m_edge = std::make_shared<mct::ProxyListener>(m_ios, logger, "127.0.0.1", edge_port, "0.0.0.0", 0, options);
+            m_edge->async_listen();
+
+            // both ends exchange their hellos before any client shows up
+            for (int attempt = 0; attempt < 2000 && m_pool->get_num_of_ready_connections() < num_of_connections; ++attempt) {
+                m_ios.poll();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        m_thread = std::thread([this]() { m_ios.run(); });
+    }
+
+    ~TunnelEnds()
+    {
+        m_ios.stop();
+        m_thread.join();
+    }
+
+    /**
+     * Runs function on the thread of the tunnel, so it may look at the state of both ends.
+     */
+    template <typename Function>
+    auto inspect(Function function) -> decltype(function())
+    {
+        std::packaged_task<decltype(function()) ()> task(function);
+        auto result = task.get_future();
+        m_ios.post([&task]() { task(); });
+        return result.get();
+    }
+
+    bool is_ready()
+    {
+        return inspect([this]() { return m_pool->get_num_of_ready_connections() == m_num_of_connections; });
+    }
+
+    size_t get_num_of_streams_of_next_connection()
+    {
+        return inspect([this]() { return m_pool->select_connection()->get_num_of_streams(); });
+    }
+
+    std::shared_ptr<mct::TunnelConnection> get_next_connection()
+    {
+        return inspect([this]() { return m_pool->select_connection(); });
+    }
+
+private:
+    boost::asio::io_service m_ios;
+    const size_t m_num_of_connections;
+    std::shared_ptr<mct::TunnelListener> m_core;
+    std::shared_ptr<mct::TunnelPool> m_pool;
+    std::shared_ptr<mct::ProxyListener> m_edge;
+    std::thread m_thread;
+};
+
+std::string read_exactly(tcp::socket& socket, size_t length)
+{
+    std::string data(length, '\0');
+    boost::asio::read(socket, boost::asio::buffer(&data[0], length));
+    return data;
+}
+
+bool is_closed(tcp::socket& socket)
+{
+    char data[16];
+    boost::system::error_code error;
+    socket.read_some(boost::asio::buffer(data), error);
+    return error == boost::asio::error::eof || error == boost::asio::error::connection_reset;
+}
+
+std::string frame(mct::TunnelFrame::Type type, uint32_t stream_id, const std::string& payload)
+{
+    std::string data(mct::TunnelFrame::header_length, '\0');
+    mct::TunnelFrame::write_header(type, stream_id, static_cast<uint16_t>(payload.size()), reinterpret_cast<unsigned char*>(&data[0]));
+    return data + payload;
+}
+
+std::string uint32_payload(uint32_t value)
+{
+    std::string payload(4, '\0');
+    mct::TunnelFrame::write_uint32(value, reinterpret_cast<unsigned char*>(&payload[0]));
+    return payload;
+}
+
+mct::TunnelFrameHeader read_frame(tcp::socket& socket, std::string& payload)
+{
+    const std::string header_data = read_exactly(socket, mct::TunnelFrame::header_length);
+
+    mct::TunnelFrameHeader header;
+    mct::TunnelFrame::parse_header(reinterpret_cast<const unsigned char*>(header_data.data()), header_data.size(), header);
+    payload = read_exactly(socket, header.length);
+    return header;
+}
+
+// requests of a text protocol, which compress well
+std::string make_text(size_t length)
+{
+    std::string data;
+    for (size_t i = 0; data.size() < length; ++i) {
+        data += "GET /api/v1/items/" + std::to_string(i % 1000) + " HTTP/1.1\r\nHost: backend.example.com\r\nAccept: application/json\r\n"
+            "X-Request-Id: " + std::to_string(i * 7919) + "\r\n\r\n";
+    }
+    data.resize(length);
+    return data;
+}
+
+// e.g. TLS records, which do not compress at all
+std::string make_random(size_t length)
+{
+    std::mt19937 generator(5489u);
+    std::string data(length, '\0');
+    for (auto& byte : data) {
+        byte = static_cast<char>(generator() & 0xff);
+    }
+    return data;
+}
+
+std::string make_pattern(size_t length)
+{
+    std::string data(length, '\0');
+    for (size_t i = 0; i < length; ++i) {
+        data[i] = static_cast<char>((i * 7 + i / 251) & 0xff);
+    }
+    return data;
+}
+
+}
+
+void TestModeTunnel::test_tunnelframe_headers()
+{
+    unsigned char data[mct::TunnelFrame::header_length];
+    mct::TunnelFrame::write_header(mct::TunnelFrame::window, 0x01020304, 0xfffe, data);
+
+    const unsigned char expected[] = { 0x04, 0x00, 0xff, 0xfe, 0x01, 0x02, 0x03, 0x04 };
+    CPPUNIT_ASSERT(std::equal(data, data + sizeof(data), expected));
+
+    mct::TunnelFrameHeader header;
+    CPPUNIT_ASSERT(!mct::TunnelFrame::parse_header(data, sizeof(data) - 1, header));
+    CPPUNIT_ASSERT(mct::TunnelFrame::parse_header(data, sizeof(data), header));
+    CPPUNIT_ASSERT_EQUAL(uint8_t(mct::TunnelFrame::window), header.type);
+    CPPUNIT_ASSERT_EQUAL(uint16_t(0xfffe), header.length);
+    CPPUNIT_ASSERT_EQUAL(uint32_t(0x01020304), header.stream_id);
+
+    unsigned char value[4];
+    mct::TunnelFrame::write_uint32(0xdeadbeef, value);
+    CPPUNIT_ASSERT_EQUAL(uint32_t(0xdeadbeef), mct::TunnelFrame::read_uint32(value));
+}
+
+void TestModeTunnel::test_tunnelservice_parse()
+{
+    mct::TunnelService service;
+
+    CPPUNIT_ASSERT(mct::TunnelService::parse("db=10.0.0.1:5432", service));
+    CPPUNIT_ASSERT_EQUAL(std::string("db"), service.name);
+    CPPUNIT_ASSERT_EQUAL(std::string("10.0.0.1"), service.host);
+    CPPUNIT_ASSERT_EQUAL(uint16_t(5432), service.port);
+
+    CPPUNIT_ASSERT(mct::TunnelService::parse("web=[::1]:8080", service));
+    CPPUNIT_ASSERT_EQUAL(std::string("::1"), service.host);
+
+    CPPUNIT_ASSERT(mct::TunnelService::parse("local=unix:/run/app.sock:0", service));
+    CPPUNIT_ASSERT_EQUAL(std::string("unix:/run/app.sock"), service.host);
+
+    CPPUNIT_ASSERT(!mct::TunnelService::parse("db", service));
+    CPPUNIT_ASSERT(!mct::TunnelService::parse("=10.0.0.1:5432", service));
+    CPPUNIT_ASSERT(!mct::TunnelService::parse("db=10.0.0.1", service));
+    CPPUNIT_ASSERT(!mct::TunnelService::parse("db=:5432", service));
+    CPPUNIT_ASSERT(!mct::TunnelService::parse("db=10.0.0.1:0", service));
+    CPPUNIT_ASSERT(!mct::TunnelService::parse("db=10.0.0.1:65536", service));
+    CPPUNIT_ASSERT(!mct::TunnelService::parse("db=10.0.0.1:54x", service));
+    CPPUNIT_ASSERT(!mct::TunnelService::parse(std::string(256, 'n') + "=10.0.0.1:5432", service));
+}
+
+void TestModeTunnel::test_tunnellistener_protocol()
+{
+    std::string filename("./tmp_modetunnel_tunnellistener_protocol.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        const auto localhost = boost::asio::ip::address_v4::from_string("127.0.0.1");
+        boost::asio::io_service ios;
+        tcp::acceptor backend(ios, tcp::endpoint(localhost, 17241));
+
+        // the test speaks for the edge
+        TunnelEnds core(logger, 17240, 0, "", 17241, 0, 4096);
+
+        tcp::socket edge(ios), peer(ios);
+        edge.connect(tcp::endpoint(localhost, 17240));
+
+        std::string payload;
+        mct::TunnelFrameHeader header = read_frame(edge, payload);
+        CPPUNIT_ASSERT_EQUAL(uint8_t(mct::TunnelFrame::hello), header.type);
+        CPPUNIT_ASSERT_EQUAL(uint32_t(0), header.stream_id);
+        CPPUNIT_ASSERT_EQUAL(std::string(1, '\x01') + uint32_payload(4096), payload);
+
+        const std::string data = make_pattern(4096);
+        boost::asio::write(edge, boost::asio::buffer(frame(mct::TunnelFrame::hello, 0, std::string(1, '\x01') + uint32_payload(65536)) +
+            frame(mct::TunnelFrame::open, 1, "echo") + frame(mct::TunnelFrame::data, 1, data)));
+
+        backend.accept(peer);
+        CPPUNIT_ASSERT(data == read_exactly(peer, data.size()));
+
+        // the window comes back once the backend has the data, less than a quarter of it may be held back
+        uint32_t window = 0;
+        while (window <= 3072) {
+            header = read_frame(edge, payload);
+            CPPUNIT_ASSERT_EQUAL(uint8_t(mct::TunnelFrame::window), header.type);
+            CPPUNIT_ASSERT_EQUAL(uint32_t(1), header.stream_id);
+            window += mct::TunnelFrame::read_uint32(reinterpret_cast<const unsigned char*>(payload.data()));
+        }
+        CPPUNIT_ASSERT(window <= 4096);
+
+        boost::asio::write(peer, boost::asio::buffer(std::string("pong")));
+        header = read_frame(edge, payload);
+        CPPUNIT_ASSERT_EQUAL(uint8_t(mct::TunnelFrame::data), header.type);
+        CPPUNIT_ASSERT_EQUAL(uint32_t(1), header.stream_id);
+        CPPUNIT_ASSERT_EQUAL(std::string("pong"), payload);
+
+        // the end of the backend becomes close, the stream lives on in the opposite direction
+        peer.shutdown(tcp::socket::shutdown_send);
+        header = read_frame(edge, payload);
+        CPPUNIT_ASSERT_EQUAL(uint8_t(mct::TunnelFrame::close), header.type);
+        CPPUNIT_ASSERT_EQUAL(uint32_t(1), header.stream_id);
+
+        boost::asio::write(edge, boost::asio::buffer(frame(mct::TunnelFrame::data, 1, "late") + frame(mct::TunnelFrame::close, 1, "")));
+        CPPUNIT_ASSERT_EQUAL(std::string("late"), read_exactly(peer, 4));
+        CPPUNIT_ASSERT(is_closed(peer));
+
+        // unknown services are refused
+        boost::asio::write(edge, boost::asio::buffer(frame(mct::TunnelFrame::open, 2, "unknown")));
+        header = read_frame(edge, payload);
+        CPPUNIT_ASSERT_EQUAL(uint8_t(mct::TunnelFrame::reset), header.type);
+        CPPUNIT_ASSERT_EQUAL(uint32_t(2), header.stream_id);
+
+        // more than the window is a protocol error, which ends the whole connection
+        boost::asio::write(edge, boost::asio::buffer(frame(mct::TunnelFrame::open, 3, "echo") + frame(mct::TunnelFrame::data, 3, make_pattern(4097))));
+        boost::system::error_code error;
+        while (!error) {
+            std::string rest(64, '\0');
+            edge.read_some(boost::asio::buffer(&rest[0], rest.size()), error);
+        }
+        CPPUNIT_ASSERT(error == boost::asio::error::eof || error == boost::asio::error::connection_reset);
+    }
+}
+
+void TestModeTunnel::test_tunnel_loopback()
+{
+    std::string filename("./tmp_modetunnel_tunnel_loopback.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        const auto localhost = boost::asio::ip::address_v4::from_string("127.0.0.1");
+        boost::asio::io_service ios;
+        tcp::acceptor backend(ios, tcp::endpoint(localhost, 17244));
+
+        TunnelEnds ends(logger, 17242, 17243, "echo", 17244, 2, 65536);
+        CPPUNIT_ASSERT(ends.is_ready());
+
+        std::vector<tcp::socket> clients, peers;
+        for (int i = 0; i < 3; ++i) {
+            clients.emplace_back(ios);
+            peers.emplace_back(ios);
+        }
+
+        for (size_t i = 0; i < clients.size(); ++i) {
+            const std::string hello = "hello " + std::to_string(i);
+
+            clients[i].connect(tcp::endpoint(localhost, 17243));
+            boost::asio::write(clients[i], boost::asio::buffer(hello));
+            backend.accept(peers[i]);
+            CPPUNIT_ASSERT_EQUAL(hello, read_exactly(peers[i], hello.size()));
+        }
+
+        // three streams over two connections, the next one goes to the connection which carries only one
+        CPPUNIT_ASSERT_EQUAL(size_t(1), ends.get_num_of_streams_of_next_connection());
+
+        for (size_t i = 0; i < clients.size(); ++i) {
+            const std::string world = "world " + std::to_string(i);
+
+            boost::asio::write(peers[i], boost::asio::buffer(world));
+            CPPUNIT_ASSERT_EQUAL(world, read_exactly(clients[i], world.size()));
+        }
+
+        // half close crosses the tunnel in both directions
+        clients[0].shutdown(tcp::socket::shutdown_send);
+        CPPUNIT_ASSERT(is_closed(peers[0]));
+        boost::asio::write(peers[0], boost::asio::buffer(std::string("bye")));
+        peers[0].shutdown(tcp::socket::shutdown_send);
+        CPPUNIT_ASSERT_EQUAL(std::string("bye"), read_exactly(clients[0], 3));
+        CPPUNIT_ASSERT(is_closed(clients[0]));
+
+        // bulk data in both directions at once, far beyond the window
+        const std::string upstream = make_pattern(4 * 1024 * 1024);
+        const std::string downstream = make_pattern(3 * 1024 * 1024 + 17);
+
+        std::thread upstream_writer([&]() { boost::asio::write(clients[1], boost::asio::buffer(upstream)); });
+        std::thread downstream_writer([&]() { boost::asio::write(peers[1], boost::asio::buffer(downstream)); });
+        std::string downstream_received;
+        std::thread downstream_reader([&]() { downstream_received = read_exactly(clients[1], downstream.size()); });
+
+        CPPUNIT_ASSERT(upstream == read_exactly(peers[1], upstream.size()));
+
+        upstream_writer.join();
+        downstream_writer.join();
+        downstream_reader.join();
+        CPPUNIT_ASSERT(downstream == downstream_received);
+
+        // a closed backend resets the stream, the client is closed as well
+        peers[2].close();
+        CPPUNIT_ASSERT(is_closed(clients[2]));
+    }
+}
+
+void TestModeTunnel::test_tunnel_flow_control()
+{
+    std::string filename("./tmp_modetunnel_tunnel_flow_control.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        const auto localhost = boost::asio::ip::address_v4::from_string("127.0.0.1");
+        boost::asio::io_service ios;
+        tcp::acceptor backend(ios, tcp::endpoint(localhost, 17247));
+
+        // both streams share the only connection
+        TunnelEnds ends(logger, 17245, 17246, "echo", 17247, 1, 4096);
+        CPPUNIT_ASSERT(ends.is_ready());
+
+        tcp::socket stalled_client(ios), stalled_peer(ios), client(ios), peer(ios);
+
+        stalled_client.connect(tcp::endpoint(localhost, 17246));
+        boost::asio::write(stalled_client, boost::asio::buffer(std::string("s")));
+        backend.accept(stalled_peer);
+        CPPUNIT_ASSERT_EQUAL(std::string("s"), read_exactly(stalled_peer, 1));
+
+        // the backend of the first stream does not read, its client keeps sending
+        const std::string data = make_pattern(16 * 1024 * 1024);
+        std::thread writer([&]() { boost::asio::write(stalled_client, boost::asio::buffer(data)); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        // the stream window keeps the stalled stream from blocking the connection for the others
+        client.connect(tcp::endpoint(localhost, 17246));
+        boost::asio::write(client, boost::asio::buffer(std::string("ping")));
+        backend.accept(peer);
+        CPPUNIT_ASSERT_EQUAL(std::string("ping"), read_exactly(peer, 4));
+        boost::asio::write(peer, boost::asio::buffer(std::string("pong")));
+        CPPUNIT_ASSERT_EQUAL(std::string("pong"), read_exactly(client, 4));
+
+        CPPUNIT_ASSERT(data == read_exactly(stalled_peer, data.size()));
+        writer.join();
+    }
+}
+
+void TestModeTunnel::test_tunnelcodec_roundtrip()
+{
+    mct::TunnelCodec::Type codec = mct::TunnelCodec::none;
+    CPPUNIT_ASSERT(mct::TunnelCodec::parse("zstd", codec));
+    CPPUNIT_ASSERT_EQUAL(mct::TunnelCodec::zstd, codec);
+    CPPUNIT_ASSERT_EQUAL(std::string("lz4"), std::string(mct::TunnelCodec::get_name(mct::TunnelCodec::lz4)));
+    CPPUNIT_ASSERT(!mct::TunnelCodec::parse("gzip", codec));
+    CPPUNIT_ASSERT(mct::TunnelCodec::is_supported(mct::TunnelCodec::none));
+    CPPUNIT_ASSERT(!mct::TunnelCompressor::create(mct::TunnelCodec::none));
+
+    const std::string text = make_text(256 * 1024);
+    const std::string random = make_random(64 * 1024);
+    const size_t block_lengths[] = { 100, 8192, 3000, mct::TunnelCodec::max_block_length, 64 };
+
+    for (auto type : { mct::TunnelCodec::lz4, mct::TunnelCodec::zstd }) {
+        // mct may be built without any of them
+        if (!mct::TunnelCodec::is_supported(type)) {
+            continue;
+        }
+
+        auto compressor = mct::TunnelCompressor::create(type);
+        auto decompressor = mct::TunnelDecompressor::create(type);
+        CPPUNIT_ASSERT(compressor && decompressor);
+
+        std::vector<unsigned char> block(mct::TunnelCodec::max_compressed_length);
+
+        // twice, the second time after both have been reset as if they served another connection
+        for (int round = 0; round < 2; ++round) {
+            size_t text_length = 0, compressed_text_length = 0, offset = 0;
+
+            for (size_t i = 0; offset < text.size(); ++i) {
+                const size_t length = std::min(block_lengths[i % 5], text.size() - offset);
+                const size_t compressed_length = compressor->compress(reinterpret_cast<const unsigned char*>(text.data() + offset), length, block.data());
+                CPPUNIT_ASSERT(compressed_length > 0 && compressed_length <= mct::TunnelCodec::max_compressed_length);
+
+                const unsigned char* data = nullptr;
+                size_t data_length = 0;
+                CPPUNIT_ASSERT(decompressor->decompress(block.data(), compressed_length, data, data_length));
+                CPPUNIT_ASSERT(text.compare(offset, length, reinterpret_cast<const char*>(data), data_length) == 0);
+
+                text_length += length;
+                compressed_text_length += compressed_length;
+                offset += length;
+
+                // the data which does not compress is carried by the same stream
+                if (i % 16 == 15) {
+                    const size_t random_offset = (i / 16) * 8192 % (random.size() - 8192);
+                    const size_t random_length = compressor->compress(reinterpret_cast<const unsigned char*>(random.data() + random_offset), 8192, block.data());
+                    CPPUNIT_ASSERT(random_length >= 8192 && random_length <= mct::TunnelCodec::max_compressed_length);
+                    CPPUNIT_ASSERT(decompressor->decompress(block.data(), random_length, data, data_length));
+                    CPPUNIT_ASSERT(random.compare(random_offset, 8192, reinterpret_cast<const char*>(data), data_length) == 0);
+                }
+            }
+
+            CPPUNIT_ASSERT(compressed_text_length * 4 < text_length);
+
+            compressor->reset();
+            decompressor->reset();
+        }
+
+        CPPUNIT_ASSERT_EQUAL(size_t(0), compressor->compress(reinterpret_cast<const unsigned char*>(text.data()), mct::TunnelCodec::max_block_length + 1, block.data()));
+
+        // two blocks in one frame make more than a frame may carry
+        compressor->reset();
+        decompressor->reset();
+        std::vector<unsigned char> blocks(2 * mct::TunnelCodec::max_compressed_length);
+        size_t blocks_length = compressor->compress(reinterpret_cast<const unsigned char*>(random.data()), 10000, blocks.data());
+        blocks_length += compressor->compress(reinterpret_cast<const unsigned char*>(random.data() + 10000), 10000, blocks.data() + blocks_length);
+
+        const unsigned char* data = nullptr;
+        size_t data_length = 0;
+        CPPUNIT_ASSERT(!decompressor->decompress(blocks.data(), blocks_length, data, data_length));
+    }
+}
+
+void TestModeTunnel::test_tunnelcodecpool_reuse()
+{
+    mct::TunnelCodecPool none(mct::TunnelCodec::none);
+    CPPUNIT_ASSERT(!none.acquire_compressor());
+    CPPUNIT_ASSERT(!none.acquire_decompressor(mct::TunnelCodec::none));
+
+    if (!mct::TunnelCodec::is_supported(mct::TunnelCodec::lz4) || !mct::TunnelCodec::is_supported(mct::TunnelCodec::zstd)) {
+        return;
+    }
+
+    mct::TunnelCodecPool pool(mct::TunnelCodec::zstd);
+
+    auto compressor = pool.acquire_compressor();
+    CPPUNIT_ASSERT(compressor && compressor->get_codec() == mct::TunnelCodec::zstd);
+    mct::TunnelCompressor* const compressor_address = compressor.get();
+
+    // peers may use another codec than this end
+    auto lz4_decompressor = pool.acquire_decompressor(mct::TunnelCodec::lz4);
+    auto zstd_decompressor = pool.acquire_decompressor(mct::TunnelCodec::zstd);
+    CPPUNIT_ASSERT(lz4_decompressor && lz4_decompressor->get_codec() == mct::TunnelCodec::lz4);
+    CPPUNIT_ASSERT(zstd_decompressor && zstd_decompressor->get_codec() == mct::TunnelCodec::zstd);
+    mct::TunnelDecompressor* const zstd_decompressor_address = zstd_decompressor.get();
+
+    CPPUNIT_ASSERT_EQUAL(size_t(0), pool.get_num_of_idle_contexts());
+    pool.release(std::move(compressor));
+    pool.release(std::move(lz4_decompressor));
+    pool.release(std::move(zstd_decompressor));
+    CPPUNIT_ASSERT_EQUAL(size_t(3), pool.get_num_of_idle_contexts());
+
+    CPPUNIT_ASSERT(pool.acquire_compressor().get() == compressor_address);
+    CPPUNIT_ASSERT(pool.acquire_decompressor(mct::TunnelCodec::zstd).get() == zstd_decompressor_address);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), pool.get_num_of_idle_contexts());
+
+    // a burst of connections does not keep all of their contexts around
+    std::vector< std::unique_ptr<mct::TunnelCompressor> > compressors;
+    for (int i = 0; i < 20; ++i) {
+        compressors.push_back(pool.acquire_compressor());
+    }
+    for (auto& context : compressors) {
+        pool.release(std::move(context));
+    }
+    CPPUNIT_ASSERT(pool.get_num_of_idle_contexts() <= 9);
+}
+
+void TestModeTunnel::test_tunnel_compression()
+{
+    std::string filename("./tmp_modetunnel_tunnel_compression.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    if (!mct::TunnelCodec::is_supported(mct::TunnelCodec::lz4) || !mct::TunnelCodec::is_supported(mct::TunnelCodec::zstd)) {
+        return;
+    }
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        const auto localhost = boost::asio::ip::address_v4::from_string("127.0.0.1");
+        boost::asio::io_service ios;
+        tcp::acceptor backend(ios, tcp::endpoint(localhost, 17250));
+
+        // every direction has its own codec
+        TunnelEnds ends(logger, 17248, 17249, "echo", 17250, 1, 65536, mct::TunnelCodec::lz4, mct::TunnelCodec::zstd);
+        CPPUNIT_ASSERT(ends.is_ready());
+
+        tcp::socket client(ios), peer(ios);
+        client.connect(tcp::endpoint(localhost, 17249));
+
+        const std::string request = make_text(1024 * 1024);
+        std::thread writer([&]() { boost::asio::write(client, boost::asio::buffer(request)); });
+        backend.accept(peer);
+        CPPUNIT_ASSERT(request == read_exactly(peer, request.size()));
+        writer.join();
+
+        const std::string response = make_text(512 * 1024 + 3);
+        std::thread response_writer([&]() { boost::asio::write(peer, boost::asio::buffer(response)); });
+        CPPUNIT_ASSERT(response == read_exactly(client, response.size()));
+        response_writer.join();
+
+        // short messages are sent as they are
+        boost::asio::write(client, boost::asio::buffer(std::string("PING\r\n")));
+        CPPUNIT_ASSERT_EQUAL(std::string("PING\r\n"), read_exactly(peer, 6));
+
+        const std::string encrypted = make_random(1024 * 1024);
+        std::thread encrypted_writer([&]() { boost::asio::write(client, boost::asio::buffer(encrypted)); });
+        CPPUNIT_ASSERT(encrypted == read_exactly(peer, encrypted.size()));
+        encrypted_writer.join();
+
+        std::shared_ptr<mct::TunnelConnection> connection = ends.get_next_connection();
+        const uint64_t input_bytes = ends.inspect([&]() { return connection->get_compression_input_bytes(); });
+        const uint64_t output_bytes = ends.inspect([&]() { return connection->get_compression_output_bytes(); });
+        const uint64_t uncompressed_bytes = ends.inspect([&]() { return connection->get_uncompressed_bytes(); });
+
+        CPPUNIT_ASSERT_EQUAL(uint64_t(request.size() + 6 + encrypted.size()), input_bytes + uncompressed_bytes);
+        // most of the random data skips the compressor after the first samples, the text shrinks a lot
+        CPPUNIT_ASSERT(uncompressed_bytes > encrypted.size() * 3 / 4);
+        CPPUNIT_ASSERT(output_bytes * 4 < input_bytes);
+    }
+}
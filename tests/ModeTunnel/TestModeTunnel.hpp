@@ -0,0 +1,63 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file tests/ModeTunnel/TestModeTunnel.hpp
+ *
+ * @desc ModeTunnel application mode tests.
+ */
+
+#ifndef MCT_TESTS_MODETUNNEL_TEST_MODETUNNEL_HPP
+#define MCT_TESTS_MODETUNNEL_TEST_MODETUNNEL_HPP
+
+#include <moctest/moctest.hpp>
+
+class TestModeTunnel : public CPPUNIT_NS::TestCase
+{
+    CPPUNIT_TEST_SUITE(TestModeTunnel);
+    CPPUNIT_TEST(test_tunnelframe_headers);
+    CPPUNIT_TEST(test_tunnelservice_parse);
+    CPPUNIT_TEST(test_tunnellistener_protocol);
+    CPPUNIT_TEST(test_tunnel_loopback);
+    CPPUNIT_TEST(test_tunnel_flow_control);
+    CPPUNIT_TEST(test_tunnelcodec_roundtrip);
+    CPPUNIT_TEST(test_tunnelcodecpool_reuse);
+    CPPUNIT_TEST(test_tunnel_compression);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+
+protected:
+    void test_tunnelframe_headers();
+    void test_tunnelservice_parse();
+    void test_tunnellistener_protocol();
+    void test_tunnel_loopback();
+    void test_tunnel_flow_control();
+    void test_tunnelcodec_roundtrip();
+    void test_tunnelcodecpool_reuse();
+    void test_tunnel_compression();
+};
+
+#endif // MCT_TESTS_MODETUNNEL_TEST_MODETUNNEL_HPP
@@ -0,0 +1,406 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file tests/ModeUdp/TestModeUdp.cpp
+ *
+ * @desc ModeUdp application mode tests.
+ */
+
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <functional>
+
+#if defined(__linux__)
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#endif
+
+#include <boost/filesystem.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/udp.hpp>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+#include <Configuration/ConfigurationBuilder.hpp>
+#include <ModeUdp/UdpRelay.hpp>
+
+#include "TestModeUdp.hpp"
+
+using boost::asio::ip::udp;
+
+void TestModeUdp::setUp()
+{
+}
+
+void TestModeUdp::tearDown()
+{
+}
+
+class ConfigFileReaderHelper
+{
+public:
+    ConfigFileReaderHelper(const std::string& filename, const std::vector<std::string>& keys_values, const int argc, const char** argv)
+    : m_config(argc, (char**)argv), m_filename(filename), m_keys_values(keys_values), m_argc(argc), m_argv(argv)
+    {
+    }
+
+    bool read_file(std::string& message_to_user)
+    {
+        std::ofstream fs;
+
+        std::shared_ptr<std::ofstream> fileGuard(&fs, [&](std::ofstream*)
+        {
+            boost::filesystem::remove(m_filename);
+        });
+
+        fs.open(m_filename);
+        for (auto& keys_values : m_keys_values) {
+            fs << "#" << std::endl;
+            fs << "# Standard comment support" << std::endl;
+            fs << "#" << std::endl;
+            fs << keys_values << std::endl << std::endl;
+        }
+        fs.close();
+
+        mct::ConfigurationBuilder config_builder(m_config);
+
+        return config_builder.build_configuration(message_to_user);
+    }
+
+    mct::Configuration& get_config() { return m_config; }
+
+private:
+    mct::Configuration m_config;
+    std::string m_filename;
+    std::vector<std::string> m_keys_values;
+    const int m_argc;
+    const char** m_argv;
+};
+
+/**
+ * Runs ready handlers of the relay until predicate is satisfied (or a second passes).
+ * Everything runs on the test thread, so the relay state can be inspected without locking.
+ */
+bool poll_until(boost::asio::io_service& ios, const std::function<bool ()>& predicate)
+{
+    for (int i = 0; i < 100; ++i) {
+        ios.poll();
+        ios.reset();
+
+        if (predicate()) {
+            return true;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return false;
+}
+
+/**
+ * Sends one datagram from client through the relay to the backend, echoes it back and returns what the client received.
+ */
+std::string udp_roundtrip(boost::asio::io_service& ios, mct::UdpRelay& relay, udp::socket& client, udp::socket& backend, const std::string& payload)
+{
+    const uint64_t remote_datagrams = relay.get_remote_datagrams();
+    udp::endpoint relay_endpoint(boost::asio::ip::address::from_string(relay.get_listen_host()), relay.get_listen_port());
+    client.send_to(boost::asio::buffer(payload), relay_endpoint);
+
+    CPPUNIT_ASSERT_EQUAL(true, poll_until(ios, [&]() { return backend.available() > 0; }));
+
+    char data[1024];
+    udp::endpoint session_endpoint;
+    size_t length = backend.receive_from(boost::asio::buffer(data), session_endpoint);
+    backend.send_to(boost::asio::buffer(data, length), session_endpoint);
+
+    CPPUNIT_ASSERT_EQUAL(true, poll_until(ios, [&]() { return relay.get_remote_datagrams() > remote_datagrams && client.available() > 0; }));
+
+    udp::endpoint sender_endpoint;
+    length = client.receive_from(boost::asio::buffer(data), sender_endpoint);
+
+    CPPUNIT_ASSERT_EQUAL(relay_endpoint, sender_endpoint);
+    return std::string(data, length);
+}
+
+void TestModeUdp::test_udprelay_roundtrip()
+{
+    std::string filename("./tmu_udprelay_roundtrip.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+    expected_message.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        boost::asio::io_service ios;
+        udp::socket backend(ios, udp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 17272));
+        udp::socket client(ios, udp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0));
+
+        auto relay = std::make_shared<mct::UdpRelay>(ios, logger, "127.0.0.1", 17271, "127.0.0.1", 17272, 60, 8, 0, false);
+        relay->start();
+
+        CPPUNIT_ASSERT_EQUAL(std::string("first datagram"), udp_roundtrip(ios, *relay, client, backend, "first datagram"));
+        CPPUNIT_ASSERT_EQUAL(std::string("second datagram"), udp_roundtrip(ios, *relay, client, backend, "second datagram"));
+
+        // both datagrams came from the same client endpoint, so they share one session
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), relay->get_num_of_sessions());
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(2), relay->get_client_datagrams());
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(2), relay->get_remote_datagrams());
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(0), relay->get_dropped_datagrams());
+
+        udp::socket second_client(ios, udp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0));
+        CPPUNIT_ASSERT_EQUAL(std::string("other client"), udp_roundtrip(ios, *relay, second_client, backend, "other client"));
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), relay->get_num_of_sessions());
+
+        relay->stop();
+    }
+}
+
+void TestModeUdp::test_udprelay_session_expiry()
+{
+    std::string filename("./tmu_udprelay_session_expiry.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        boost::asio::io_service ios;
+        udp::socket backend(ios, udp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 17274));
+        udp::socket client(ios, udp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0));
+
+        auto relay = std::make_shared<mct::UdpRelay>(ios, logger, "127.0.0.1", 17273, "127.0.0.1", 17274, 1, 8, 0, false);
+        relay->start();
+
+        CPPUNIT_ASSERT_EQUAL(std::string("ping"), udp_roundtrip(ios, *relay, client, backend, "ping"));
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), relay->get_num_of_sessions());
+
+        relay->expire_idle_sessions();
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), relay->get_num_of_sessions());
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+        relay->expire_idle_sessions();
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), relay->get_num_of_sessions());
+
+        // an expired client gets a fresh session on its next datagram
+        CPPUNIT_ASSERT_EQUAL(std::string("pong"), udp_roundtrip(ios, *relay, client, backend, "pong"));
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), relay->get_num_of_sessions());
+
+        relay->stop();
+    }
+}
+
+void TestModeUdp::test_udprelay_max_sessions()
+{
+    std::string filename("./tmu_udprelay_max_sessions.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        boost::asio::io_service ios;
+        udp::socket backend(ios, udp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 17276));
+        udp::socket first_client(ios, udp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0));
+        udp::socket second_client(ios, udp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0));
+        udp::socket third_client(ios, udp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0));
+
+        auto relay = std::make_shared<mct::UdpRelay>(ios, logger, "127.0.0.1", 17275, "127.0.0.1", 17276, 1, 8, 2, false);
+        relay->start();
+
+        CPPUNIT_ASSERT_EQUAL(std::string("first"), udp_roundtrip(ios, *relay, first_client, backend, "first"));
+        CPPUNIT_ASSERT_EQUAL(std::string("second"), udp_roundtrip(ios, *relay, second_client, backend, "second"));
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), relay->get_num_of_sessions());
+
+        // the limit is reached, so the datagram of a new client is dropped instead of opening a third socket
+        udp::endpoint relay_endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 17275);
+        third_client.send_to(boost::asio::buffer(std::string("third")), relay_endpoint);
+
+        CPPUNIT_ASSERT_EQUAL(true, poll_until(ios, [&]() { return relay->get_dropped_datagrams() == 1; }));
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), relay->get_num_of_sessions());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), backend.available());
+
+        // clients already known keep their sessions
+        CPPUNIT_ASSERT_EQUAL(std::string("first again"), udp_roundtrip(ios, *relay, first_client, backend, "first again"));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        relay->expire_idle_sessions();
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), relay->get_num_of_sessions());
+
+        // expired sessions make room for new clients
+        CPPUNIT_ASSERT_EQUAL(std::string("third"), udp_roundtrip(ios, *relay, third_client, backend, "third"));
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), relay->get_num_of_sessions());
+
+        relay->stop();
+    }
+}
+
+/**
+ * Sends payload as a train of segment_size datagrams with a single system call (UDP GSO).
+ * Returns false where the kernel does not support it.
+ */
+bool send_segmented(udp::socket& socket, const udp::endpoint& destination, const std::string& payload, uint16_t segment_size)
+{
+#if defined(__linux__)
+    iovec iov;
+    iov.iov_base = const_cast<char*>(payload.data());
+    iov.iov_len = payload.size();
+
+    unsigned char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+    msghdr header = msghdr();
+    header.msg_name = const_cast<sockaddr*>(destination.data());
+    header.msg_namelen = destination.size();
+    header.msg_iov = &iov;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&header);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    std::memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+
+    return ::sendmsg(socket.native_handle(), &header, 0) == static_cast<ssize_t>(payload.size());
+#else
+    return false;
+#endif
+}
+
+void TestModeUdp::test_udprelay_offload()
+{
+    std::string filename("./tmu_udprelay_offload.cfg");
+    std::string expected_message("Mattsource's Connection Tunneler v. 0.1.0-dev");
+    std::string message_to_user;
+    const bool expected_return_value = true;
+
+    const int argc = 3;
+    const char* argv[argc] = { "mct", "-c", filename.c_str()};
+
+    ConfigFileReaderHelper helper(filename, { "log.nofile = 1", "log.silent = 1" }, argc, argv);
+
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(message_to_user, expected_return_value, helper.read_file(message_to_user));
+    CPPUNIT_ASSERT_EQUAL(expected_message, message_to_user);
+
+    message_to_user.clear();
+
+    {
+        mct::Logger logger(helper.get_config());
+        CPPUNIT_ASSERT_EQUAL(expected_return_value, logger.initialize(message_to_user));
+
+        boost::asio::io_service ios;
+        udp::socket backend(ios, udp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 17278));
+        udp::socket client(ios, udp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0));
+
+        auto relay = std::make_shared<mct::UdpRelay>(ios, logger, "127.0.0.1", 17277, "127.0.0.1", 17278, 60, 8, 0, true);
+        relay->start();
+
+        // three datagrams of 100 bytes each, in a single train
+        std::string payload;
+        for (char segment = 'a'; segment <= 'c'; ++segment) {
+            payload.append(100, segment);
+        }
+
+        udp::endpoint relay_endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 17277);
+        if (!relay->is_offload_enabled() || !send_segmented(client, relay_endpoint, payload, 100)) {
+            relay->stop();
+            return; // the kernel does not support UDP GRO/GSO, datagrams are relayed one by one as covered by the other tests
+        }
+
+        // whether the relay got them coalesced or not, the backend receives them as three separate datagrams
+        udp::endpoint session_endpoint;
+        char data[1024];
+
+        for (char segment = 'a'; segment <= 'c'; ++segment) {
+            CPPUNIT_ASSERT_EQUAL(true, poll_until(ios, [&]() { return backend.available() > 0; }));
+            size_t length = backend.receive_from(boost::asio::buffer(data), session_endpoint);
+            CPPUNIT_ASSERT_EQUAL(std::string(100, segment), std::string(data, length));
+        }
+
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(3), relay->get_client_datagrams());
+
+        // the same the other way round
+        CPPUNIT_ASSERT_EQUAL(true, send_segmented(backend, session_endpoint, payload, 100));
+
+        for (char segment = 'a'; segment <= 'c'; ++segment) {
+            CPPUNIT_ASSERT_EQUAL(true, poll_until(ios, [&]() { return client.available() > 0; }));
+            udp::endpoint sender_endpoint;
+            size_t length = client.receive_from(boost::asio::buffer(data), sender_endpoint);
+            CPPUNIT_ASSERT_EQUAL(relay_endpoint, sender_endpoint);
+            CPPUNIT_ASSERT_EQUAL(std::string(100, segment), std::string(data, length));
+        }
+
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(3), relay->get_remote_datagrams());
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(0), relay->get_dropped_datagrams());
+
+        relay->stop();
+    }
+}
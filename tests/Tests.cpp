@@ -35,6 +35,16 @@
 #include "Mode/TestMode.hpp"
 #include "ModeFactory/TestModeFactory.hpp"
 #include "ModeProxy/TestModeProxy.hpp"
+#include "ModeUdp/TestModeUdp.hpp"
+#include "ModeReplay/TestModeReplay.hpp"
+#include "ModeSocks/TestModeSocks.hpp"
+#include "ModeHttp/TestModeHttp.hpp"
+#include "ModeSni/TestModeSni.hpp"
+#include "ModeTunnel/TestModeTunnel.hpp"
+#if defined(MCT_WITH_OPENSSL)
+#include "ModeTls/TestModeTls.hpp"
+#endif
+#include "ModeMultiplex/TestModeMultiplex.hpp"
 
 
 int main(int argc, char* argv[])
@@ -46,5 +56,15 @@ int main(int argc, char* argv[])
     tests.register_suite<TestMode>();
     tests.register_suite<TestModeFactory>();
     tests.register_suite<TestModeProxy>();
+    tests.register_suite<TestModeUdp>();
+    tests.register_suite<TestModeReplay>();
+    tests.register_suite<TestModeSocks>();
+    tests.register_suite<TestModeHttp>();
+    tests.register_suite<TestModeSni>();
+    tests.register_suite<TestModeTunnel>();
+#if defined(MCT_WITH_OPENSSL)
+    tests.register_suite<TestModeTls>();
+#endif
+    tests.register_suite<TestModeMultiplex>();
     return tests.run();
 }
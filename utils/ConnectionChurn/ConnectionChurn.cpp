@@ -0,0 +1,297 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file utils/ConnectionChurn/ConnectionChurn.cpp
+ *
+ * @desc Benchmark which opens and closes many short-lived connections through a running mct instance.
+ *
+ * Every connection is set up through mct, a single byte is echoed back by the backend (which proves that
+ * the whole accept -> remote connect -> pump path is up) and then the connection is closed.
+ * Reported numbers: accept rate, setup latency percentiles and (on Linux) peak RSS of the mct process.
+ *
+ * With several rounds, RSS of mct is sampled after each of them, which shows whether memory stays flat
+ * under churn or keeps growing (fragmentation, leaks). Long soak runs need correspondingly many connections.
+ */
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "ConnectionChurn.hpp"
+
+using boost::asio::ip::tcp;
+
+class EchoSession : public std::enable_shared_from_this<EchoSession>
+{
+public:
+	EchoSession(boost::asio::io_service& ios) : m_socket(ios) {}
+
+	tcp::socket& get_socket() { return m_socket; }
+
+	void async_read()
+	{
+		m_socket.async_read_some(boost::asio::buffer(m_data, sizeof(m_data)),
+			std::bind(&EchoSession::handle_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+	}
+
+protected:
+	void handle_read(const boost::system::error_code& error, size_t bytes_transferred)
+	{
+		if (error) {
+			return;
+		}
+
+		boost::asio::async_write(m_socket, boost::asio::buffer(m_data, bytes_transferred),
+			std::bind(&EchoSession::handle_write, shared_from_this(), std::placeholders::_1));
+	}
+
+	void handle_write(const boost::system::error_code& error)
+	{
+		if (!error) {
+			async_read();
+		}
+	}
+
+private:
+	tcp::socket m_socket;
+	unsigned char m_data[4096];
+};
+
+EchoBackend::EchoBackend(uint16_t port)
+ : m_acceptor(m_ios, tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), port))
+{
+}
+
+void EchoBackend::run()
+{
+	async_accept();
+	m_ios.run();
+}
+
+void EchoBackend::stop()
+{
+	m_ios.stop();
+}
+
+void EchoBackend::async_accept()
+{
+	auto session = std::make_shared<EchoSession>(m_ios);
+
+	m_acceptor.async_accept(session->get_socket(), [this, session](const boost::system::error_code& error) {
+		if (!error) {
+			session->async_read();
+		}
+
+		async_accept();
+	});
+}
+
+ConnectionChurn::ConnectionChurn(const ChurnSettings& settings)
+ : m_settings(settings), m_next_connection(0), m_round_end(0), m_failed_connections(0)
+{
+	m_latencies_ns.reserve(static_cast<size_t>(m_settings.connections));
+}
+
+int ConnectionChurn::run()
+{
+	EchoBackend backend(m_settings.backend_port);
+	std::thread backend_thread(&EchoBackend::run, &backend);
+
+	std::cout << "[ConnectionChurn] " << m_settings.connections << " connections through " << m_settings.mct_host << ":" << m_settings.mct_port
+	          << " (backend 127.0.0.1:" << m_settings.backend_port << "), concurrency: " << m_settings.concurrency << std::endl;
+
+	auto started = std::chrono::steady_clock::now();
+
+	for (uint32_t round = 1; round <= m_settings.rounds; ++round) {
+		m_next_connection = (m_settings.connections * (round - 1)) / m_settings.rounds;
+		m_round_end = (m_settings.connections * round) / m_settings.rounds;
+
+		std::vector<std::thread> workers;
+		for (uint32_t i = 0; i < m_settings.concurrency; ++i) {
+			workers.push_back(std::thread(&ConnectionChurn::run_worker, this));
+		}
+
+		for (auto& worker : workers) {
+			worker.join();
+		}
+
+		if (m_settings.mct_pid != 0 && m_settings.rounds > 1) {
+			m_rss_samples_kb.push_back(read_proc_status_kb(m_settings.mct_pid, "VmRSS"));
+			std::cout << "[ConnectionChurn] round " << round << "/" << m_settings.rounds << ": " << m_round_end << " connections, mct RSS: "
+			          << m_rss_samples_kb.back() << " kB" << std::endl;
+		}
+	}
+
+	auto finished = std::chrono::steady_clock::now();
+
+	backend.stop();
+	backend_thread.join();
+
+	print_report(std::chrono::duration<double>(finished - started).count());
+
+	return (m_failed_connections == 0) ? 0 : 1;
+}
+
+void ConnectionChurn::run_worker()
+{
+	boost::asio::io_service ios;
+	tcp::endpoint endpoint(boost::asio::ip::address::from_string(m_settings.mct_host), m_settings.mct_port);
+
+	std::vector<uint64_t> latencies;
+
+	while (m_next_connection++ < m_round_end) {
+		uint64_t latency_ns = 0;
+
+		if (run_single_connection(ios, endpoint, latency_ns)) {
+			latencies.push_back(latency_ns);
+		} else {
+			++m_failed_connections;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_latencies_access);
+	m_latencies_ns.insert(m_latencies_ns.end(), latencies.begin(), latencies.end());
+}
+
+bool ConnectionChurn::run_single_connection(boost::asio::io_service& ios, const tcp::endpoint& endpoint, uint64_t& latency_ns)
+{
+	boost::system::error_code error;
+	unsigned char probe = 0x2a;
+
+	auto started = std::chrono::steady_clock::now();
+
+	tcp::socket socket(ios);
+	socket.connect(endpoint, error);
+	if (error) {
+		return false;
+	}
+
+	boost::asio::write(socket, boost::asio::buffer(&probe, 1), error);
+	if (error) {
+		return false;
+	}
+
+	boost::asio::read(socket, boost::asio::buffer(&probe, 1), error);
+	if (error) {
+		return false;
+	}
+
+	latency_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+
+	// abortive close, so millions of connections do not exhaust ephemeral ports with TIME_WAIT entries
+	socket.set_option(boost::asio::socket_base::linger(true, 0), error);
+	socket.close(error);
+
+	return true;
+}
+
+uint64_t ConnectionChurn::read_proc_status_kb(uint32_t pid, const std::string& field)
+{
+	std::ifstream status(std::string("/proc/") + boost::lexical_cast<std::string>(pid) + std::string("/status"));
+	std::string line;
+
+	while (std::getline(status, line)) {
+		if (line.compare(0, field.length(), field) == 0) {
+			std::istringstream value(line.substr(field.length() + 1));
+			uint64_t kb = 0;
+			value >> kb;
+			return kb;
+		}
+	}
+
+	return 0;
+}
+
+void ConnectionChurn::print_report(double elapsed_seconds)
+{
+	std::sort(m_latencies_ns.begin(), m_latencies_ns.end());
+
+	auto percentile_us = [&](double p) -> double {
+		if (m_latencies_ns.empty()) {
+			return 0.0;
+		}
+		size_t idx = static_cast<size_t>(p * (m_latencies_ns.size() - 1));
+		return m_latencies_ns[idx] / 1000.0;
+	};
+
+	const uint64_t succeeded = m_latencies_ns.size();
+
+	std::cout << "[ConnectionChurn] elapsed: " << elapsed_seconds << " s" << std::endl;
+	std::cout << "[ConnectionChurn] succeeded: " << succeeded << ", failed: " << m_failed_connections << std::endl;
+	std::cout << "[ConnectionChurn] accept rate: " << (elapsed_seconds > 0.0 ? succeeded / elapsed_seconds : 0.0) << " connections/s" << std::endl;
+	std::cout << "[ConnectionChurn] setup latency (us): p50 " << percentile_us(0.50) << ", p90 " << percentile_us(0.90)
+	          << ", p99 " << percentile_us(0.99) << ", max " << percentile_us(1.0) << std::endl;
+
+	if (m_settings.mct_pid != 0) {
+		std::cout << "[ConnectionChurn] mct peak RSS: " << read_proc_status_kb(m_settings.mct_pid, "VmHWM") << " kB, current RSS: "
+		          << read_proc_status_kb(m_settings.mct_pid, "VmRSS") << " kB" << std::endl;
+	}
+
+	print_rss_report();
+}
+
+void ConnectionChurn::print_rss_report()
+{
+	if (m_rss_samples_kb.size() < 2) {
+		return;
+	}
+
+	// the first round warms up allocators and caches, steady state is measured from there on
+	const auto minmax = std::minmax_element(m_rss_samples_kb.begin() + 1, m_rss_samples_kb.end());
+	const int64_t drift = static_cast<int64_t>(m_rss_samples_kb.back()) - static_cast<int64_t>(m_rss_samples_kb.front());
+
+	std::cout << "[ConnectionChurn] steady-state RSS: min " << *minmax.first << " kB, max " << *minmax.second
+	          << " kB, drift since the first round: " << drift << " kB" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 5) {
+		std::cerr << "[ConnectionChurn] Usage: " << argv[0] << " <mct_host> <mct_port> <backend_port> <connections> [concurrency] [mct_pid] [rounds]" << std::endl;
+		std::cerr << "[ConnectionChurn] mct has to redirect <mct_host>:<mct_port> to 127.0.0.1:<backend_port>; mct_pid enables RSS reporting (Linux only)." << std::endl;
+		std::cerr << "[ConnectionChurn] rounds > 1 samples RSS after each round." << std::endl;
+		return 1;
+	}
+
+	ChurnSettings settings;
+	settings.mct_host = argv[1];
+	settings.mct_port = boost::lexical_cast<uint16_t>(argv[2]);
+	settings.backend_port = boost::lexical_cast<uint16_t>(argv[3]);
+	settings.connections = boost::lexical_cast<uint64_t>(argv[4]);
+	settings.concurrency = (argc > 5) ? boost::lexical_cast<uint32_t>(argv[5]) : 1;
+	settings.mct_pid = (argc > 6) ? boost::lexical_cast<uint32_t>(argv[6]) : 0;
+	settings.rounds = (argc > 7) ? (std::max)(1u, boost::lexical_cast<uint32_t>(argv[7])) : 1;
+
+	ConnectionChurn churn(settings);
+	return churn.run();
+}
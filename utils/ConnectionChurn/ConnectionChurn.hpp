@@ -0,0 +1,101 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file utils/ConnectionChurn/ConnectionChurn.hpp
+ *
+ * @desc Benchmark which opens and closes many short-lived connections through a running mct instance.
+ */
+
+#ifndef MCT_UTILS_CONNECTIONCHURN_CONNECTIONCHURN_HPP
+#define MCT_UTILS_CONNECTIONCHURN_CONNECTIONCHURN_HPP
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+/**
+ * Minimal asynchronous echo server used as the backend of the benchmarked tunnel.
+ * mct has to be configured to redirect to 127.0.0.1:<port>.
+ */
+class EchoBackend
+{
+public:
+	EchoBackend(uint16_t port);
+
+	void run();
+	void stop();
+
+protected:
+	void async_accept();
+
+private:
+	boost::asio::io_service m_ios;
+	boost::asio::ip::tcp::acceptor m_acceptor;
+};
+
+struct ChurnSettings
+{
+	std::string mct_host;
+	uint16_t mct_port;
+	uint16_t backend_port;
+	uint64_t connections;
+	uint32_t concurrency;
+	uint32_t mct_pid;
+	// connections are split into rounds, RSS of mct is sampled after each of them
+	uint32_t rounds;
+};
+
+class ConnectionChurn
+{
+public:
+	ConnectionChurn(const ChurnSettings& settings);
+
+	int run();
+
+protected:
+	void run_worker();
+	bool run_single_connection(boost::asio::io_service& ios, const boost::asio::ip::tcp::endpoint& endpoint, uint64_t& latency_ns);
+	void print_report(double elapsed_seconds);
+	void print_rss_report();
+
+	static uint64_t read_proc_status_kb(uint32_t pid, const std::string& field);
+
+private:
+	const ChurnSettings m_settings;
+
+	std::atomic<uint64_t> m_next_connection;
+	uint64_t m_round_end;
+	std::atomic<uint64_t> m_failed_connections;
+
+	std::mutex m_latencies_access;
+	std::vector<uint64_t> m_latencies_ns;
+	std::vector<uint64_t> m_rss_samples_kb;
+};
+
+#endif // MCT_UTILS_CONNECTIONCHURN_CONNECTIONCHURN_HPP
@@ -0,0 +1,197 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file utils/LoggerBench/LoggerBench.cpp
+ *
+ * @desc Benchmark measuring throughput and latency of the Logger library.
+ *
+ * Scenarios: records filtered out by severity, short records (fitting the 256-byte stack buffer of
+ * LoggerImpl::print_helper), long records (heap fallback), console vs file vs rotating sinks
+ * and several threads logging concurrently. Console output is discarded, file output goes to ./bench_logs.
+ */
+
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <algorithm>
+#include <streambuf>
+
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/log/core/core.hpp>
+#include <boost/log/attributes/attribute_set.hpp>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+
+#include "LoggerBench.hpp"
+
+const std::string BENCH_LOG_DIRECTORY = "bench_logs";
+
+class NullStreamBuffer : public std::streambuf
+{
+protected:
+	virtual int_type overflow(int_type c) { return traits_type::not_eof(c); }
+	virtual std::streamsize xsputn(const char*, std::streamsize n) { return n; }
+};
+
+LoggerBench::LoggerBench(int argc, char** argv, uint64_t iterations, uint32_t threads)
+ : m_argc(argc), m_argv(argv), m_iterations(iterations), m_threads(threads)
+{
+}
+
+int LoggerBench::run()
+{
+	const std::string short_message("Accepted client 127.0.0.1:54321 with listener 0.0.0.0:8080.");
+	const std::string long_message(1024, 'x');
+
+	auto debug_call = [](mct::Logger& logger, const std::string& message) { logger.debug("%s %u", message.c_str(), 42u); };
+	auto info_call = [](mct::Logger& logger, const std::string& message) { logger.info("%s %u", message.c_str(), 42u); };
+
+	NullStreamBuffer null_buffer;
+	std::streambuf* prev_buffer = std::clog.rdbuf(&null_buffer);
+
+	std::cout << "[LoggerBench] " << m_iterations << " records per thread" << std::endl;
+
+	bool result = true;
+	result = run_scenario("filtered debug, console", sink_console, "info", 1, debug_call, short_message) && result;
+	result = run_scenario("filtered debug, file", sink_file, "info", 1, debug_call, short_message) && result;
+	result = run_scenario("short info, console", sink_console, "info", 1, info_call, short_message) && result;
+	result = run_scenario("long info, console", sink_console, "info", 1, info_call, long_message) && result;
+	result = run_scenario("short info, file", sink_file, "info", 1, info_call, short_message) && result;
+	result = run_scenario("long info, file", sink_file, "info", 1, info_call, long_message) && result;
+	result = run_scenario("short info, rotating file", sink_rotate, "info", 1, info_call, short_message) && result;
+	result = run_scenario("long info, rotating file", sink_rotate, "info", 1, info_call, long_message) && result;
+	result = run_scenario("filtered debug, file, threads", sink_file, "info", m_threads, debug_call, short_message) && result;
+	result = run_scenario("short info, file, threads", sink_file, "info", m_threads, info_call, short_message) && result;
+	result = run_scenario("short info, rotating file, threads", sink_rotate, "info", m_threads, info_call, short_message) && result;
+
+	std::clog.rdbuf(prev_buffer);
+	boost::filesystem::remove_all(BENCH_LOG_DIRECTORY);
+
+	return result ? 0 : 1;
+}
+
+void LoggerBench::configure(mct::Configuration& config, sink_type sink, const std::string& severity) const
+{
+	config.set_log_silent(false);
+	config.set_log_nofile(sink == sink_console);
+	config.set_log_directory(BENCH_LOG_DIRECTORY);
+	config.set_log_filename("bench.log");
+	config.set_log_format("%H:%M:%S.%f");
+	config.set_log_severity_console(sink == sink_console ? severity : std::string("fatal"));
+	config.set_log_severity_file(severity);
+	config.set_log_rotate(sink == sink_rotate);
+	config.set_log_rotate_size(1048576);
+	config.set_log_rotate_filename("bench_%5N.log");
+	config.set_log_rotate_all_files_max_size(67108864);
+	config.set_log_rotate_min_free_space(0);
+}
+
+bool LoggerBench::run_scenario(const std::string& name, sink_type sink, const std::string& severity, uint32_t threads,
+	const std::function<void (mct::Logger&, const std::string&)>& log_call, const std::string& message)
+{
+	boost::filesystem::remove_all(BENCH_LOG_DIRECTORY);
+
+	std::mutex latencies_access;
+	std::vector<uint64_t> latencies_ns;
+	latencies_ns.reserve(static_cast<size_t>(m_iterations * threads));
+	double elapsed_seconds = 0.0;
+
+	{
+		mct::Configuration config(m_argc, m_argv);
+		configure(config, sink, severity);
+
+		mct::Logger logger(config);
+		std::string msg;
+
+		if (!logger.initialize(msg)) {
+			std::cerr << "[LoggerBench] " << name << ": cannot initialize logger: " << msg << std::endl;
+			return false;
+		}
+
+		auto worker = [&]() {
+			std::vector<uint64_t> local_latencies;
+			local_latencies.reserve(static_cast<size_t>(m_iterations));
+
+			for (uint64_t i = 0; i < m_iterations; ++i) {
+				auto started = std::chrono::steady_clock::now();
+				log_call(logger, message);
+				local_latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count());
+			}
+
+			std::lock_guard<std::mutex> lock(latencies_access);
+			latencies_ns.insert(latencies_ns.end(), local_latencies.begin(), local_latencies.end());
+		};
+
+		auto started = std::chrono::steady_clock::now();
+
+		std::vector<std::thread> workers;
+		for (uint32_t i = 0; i < threads; ++i) {
+			workers.push_back(std::thread(worker));
+		}
+
+		for (auto& w : workers) {
+			w.join();
+		}
+
+		boost::log::core::get()->flush();
+		elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	}
+
+	// Logger registers its sinks in the global logging core, drop them before the next scenario
+	boost::log::core::get()->remove_all_sinks();
+	boost::log::core::get()->get_global_attributes().clear();
+
+	print_result(name, threads, elapsed_seconds, latencies_ns);
+	return true;
+}
+
+void LoggerBench::print_result(const std::string& name, uint32_t threads, double elapsed_seconds, std::vector<uint64_t>& latencies_ns) const
+{
+	std::sort(latencies_ns.begin(), latencies_ns.end());
+
+	auto percentile = [&](double p) -> uint64_t {
+		return latencies_ns.empty() ? 0 : latencies_ns[static_cast<size_t>(p * (latencies_ns.size() - 1))];
+	};
+
+	std::cout << "[LoggerBench] " << name << " (" << threads << " thread(s)): "
+	          << (elapsed_seconds > 0.0 ? latencies_ns.size() / elapsed_seconds : 0.0) << " records/s, latency (ns): p50 "
+	          << percentile(0.50) << ", p99 " << percentile(0.99) << ", max " << percentile(1.0) << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	const uint64_t iterations = (argc > 1) ? boost::lexical_cast<uint64_t>(argv[1]) : 100000;
+	const uint32_t threads = (argc > 2) ? boost::lexical_cast<uint32_t>(argv[2]) : 4;
+
+	if (iterations == 0 || threads == 0) {
+		std::cerr << "[LoggerBench] Usage: " << argv[0] << " [records_per_thread] [threads]" << std::endl;
+		return 1;
+	}
+
+	LoggerBench bench(argc, argv, iterations, threads);
+	return bench.run();
+}
@@ -0,0 +1,71 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file utils/LoggerBench/LoggerBench.hpp
+ *
+ * @desc Benchmark measuring throughput and latency of the Logger library.
+ */
+
+#ifndef MCT_UTILS_LOGGERBENCH_LOGGERBENCH_HPP
+#define MCT_UTILS_LOGGERBENCH_LOGGERBENCH_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+namespace mct
+{
+class Configuration;
+class Logger;
+}
+
+class LoggerBench
+{
+public:
+	LoggerBench(int argc, char** argv, uint64_t iterations, uint32_t threads);
+
+	int run();
+
+protected:
+	enum sink_type { sink_console, sink_file, sink_rotate };
+
+	/**
+	 * Sets up a fresh Logger with the given sink and severity, then calls `log_call` `m_iterations` times
+	 * on every one of `threads` threads and prints throughput and latency percentiles.
+	 */
+	bool run_scenario(const std::string& name, sink_type sink, const std::string& severity, uint32_t threads,
+		const std::function<void (mct::Logger&, const std::string&)>& log_call, const std::string& message);
+
+	void configure(mct::Configuration& config, sink_type sink, const std::string& severity) const;
+	void print_result(const std::string& name, uint32_t threads, double elapsed_seconds, std::vector<uint64_t>& latencies_ns) const;
+
+private:
+	int m_argc;
+	char** m_argv;
+	const uint64_t m_iterations;
+	const uint32_t m_threads;
+};
+
+#endif // MCT_UTILS_LOGGERBENCH_LOGGERBENCH_HPP
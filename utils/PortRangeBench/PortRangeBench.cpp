@@ -0,0 +1,288 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file utils/PortRangeBench/PortRangeBench.cpp
+ *
+ * @desc Benchmark measuring startup time and memory of listeners forwarding large port ranges.
+ *
+ * Startup: time to bind, listen and register every listener (what ModeProxy does per port). Memory: RSS and heap
+ * growth per listener while all of them are listening.
+ */
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include <sys/resource.h>
+#include <malloc.h>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/log/core/core.hpp>
+#include <boost/log/attributes/attribute_set.hpp>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+#include <ModeProxy/ProxyRoute.hpp>
+#include <ModeProxy/ProxyListener.hpp>
+#include <ModeProxy/ListenerOptions.hpp>
+
+#include "PortRangeBench.hpp"
+
+using boost::asio::ip::tcp;
+
+namespace
+{
+
+// answers every connection with a single byte and closes it
+class ByteBackend
+{
+public:
+	ByteBackend(uint16_t port) : m_acceptor(m_ios, tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), port))
+	{
+		async_accept();
+		m_thread = std::thread([this]() { m_ios.run(); });
+	}
+
+	~ByteBackend()
+	{
+		m_ios.stop();
+		m_thread.join();
+	}
+
+protected:
+	void async_accept()
+	{
+		auto socket = std::make_shared<tcp::socket>(m_ios);
+
+		m_acceptor.async_accept(*socket, [this, socket](const boost::system::error_code& error) {
+			if (!error) {
+				static const unsigned char reply = 0x2a;
+				boost::system::error_code ignored;
+				boost::asio::write(*socket, boost::asio::buffer(&reply, 1), ignored);
+			}
+
+			async_accept();
+		});
+	}
+
+private:
+	boost::asio::io_service m_ios;
+	tcp::acceptor m_acceptor;
+	std::thread m_thread;
+};
+
+}
+
+PortRangeBench::PortRangeBench(int argc, char** argv, const PortRangeBenchSettings& settings)
+ : m_argc(argc), m_argv(argv), m_settings(settings)
+{
+}
+
+int PortRangeBench::run()
+{
+	const uint64_t descriptor_limit = raise_descriptor_limit();
+
+	std::cout << "[PortRangeBench] listeners from 127.0.0.1:" << m_settings.first_port << " to backend 127.0.0.1:" << m_settings.backend_port
+	          << ", descriptor limit: " << descriptor_limit << std::endl;
+
+	bool is_ok = true;
+
+	for (auto num_of_ports : m_settings.num_of_ports) {
+		if (num_of_ports == 0 || m_settings.first_port + num_of_ports - 1 > 65535 || num_of_ports + 64 > descriptor_limit) {
+			std::cerr << "[PortRangeBench] " << num_of_ports << " ports: skipped, the range does not fit into ports or the descriptor limit" << std::endl;
+			is_ok = false;
+			continue;
+		}
+
+		is_ok = run_listeners(num_of_ports, false) && is_ok;
+		is_ok = run_listeners(num_of_ports, true) && is_ok;
+	}
+
+	return is_ok ? 0 : 1;
+}
+
+bool PortRangeBench::run_listeners(uint32_t num_of_ports, bool is_route_shared)
+{
+	const char* name = is_route_shared ? "shared route" : "route per port";
+	double startup_ms = 0.0;
+	double kb_per_listener = 0.0;
+	double heap_per_listener = 0.0;
+	bool is_forwarding = false;
+
+	{
+		mct::Configuration config(m_argc, m_argv);
+		config.set_log_silent(true);
+		config.set_log_nofile(true);
+		config.set_log_severity_console("fatal");
+
+		mct::Logger logger(config);
+		std::string msg;
+
+		if (!logger.initialize(msg)) {
+			std::cerr << "[PortRangeBench] " << name << ": cannot initialize logger: " << msg << std::endl;
+			return false;
+		}
+
+		ByteBackend backend(m_settings.backend_port);
+		boost::asio::io_service proxy_ios;
+		std::vector< std::shared_ptr<mct::ProxyListener> > listeners;
+		listeners.reserve(num_of_ports);
+
+		const uint64_t rss_before = read_rss_kb();
+		const uint64_t heap_before = read_heap_bytes();
+		auto started = std::chrono::steady_clock::now();
+
+		try {
+			if (is_route_shared) {
+				auto route = std::make_shared<mct::ProxyRoute>("127.0.0.1", m_settings.first_port, "127.0.0.1", m_settings.backend_port, mct::ListenerOptions());
+				for (uint32_t port = m_settings.first_port; port < m_settings.first_port + num_of_ports; ++port) {
+					listeners.push_back(std::make_shared<mct::ProxyListener>(proxy_ios, logger, route, static_cast<uint16_t>(port)));
+					listeners.back()->async_listen();
+				}
+			} else {
+				for (uint32_t port = m_settings.first_port; port < m_settings.first_port + num_of_ports; ++port) {
+					listeners.push_back(std::make_shared<mct::ProxyListener>(proxy_ios, logger, "127.0.0.1", static_cast<uint16_t>(port), "127.0.0.1",
+						m_settings.backend_port, mct::ListenerOptions()));
+					listeners.back()->async_listen();
+				}
+			}
+		} catch (const boost::system::system_error& e) {
+			std::cerr << "[PortRangeBench] " << name << ": listener " << listeners.size() << " cannot be started: " << e.what() << std::endl;
+		}
+
+		startup_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+		kb_per_listener = static_cast<double>(read_rss_kb() - rss_before) / num_of_ports;
+		heap_per_listener = static_cast<double>(read_heap_bytes() - heap_before) / num_of_ports;
+
+		if (listeners.size() == num_of_ports) {
+			std::thread proxy_thread([&proxy_ios]() { proxy_ios.run(); });
+
+			is_forwarding = probe_port(m_settings.first_port) && probe_port(static_cast<uint16_t>(m_settings.first_port + num_of_ports / 2)) &&
+				probe_port(static_cast<uint16_t>(m_settings.first_port + num_of_ports - 1));
+
+			proxy_ios.stop();
+			proxy_thread.join();
+		}
+
+		for (auto& listener : listeners) {
+			listener->stop();
+			listener->close_sessions();
+		}
+	}
+
+	// Logger registers its sinks in the global logging core, drop them before the next run
+	boost::log::core::get()->remove_all_sinks();
+	boost::log::core::get()->get_global_attributes().clear();
+
+	std::cout << "[PortRangeBench] " << num_of_ports << " ports, " << name << ": " << startup_ms << " ms startup, " << kb_per_listener
+	          << " kB RSS / " << heap_per_listener
+	          << " B heap per listener, " << (is_forwarding ? "forwarding" : "NOT forwarding") << std::endl;
+
+	return is_forwarding;
+}
+
+bool PortRangeBench::probe_port(uint16_t port) const
+{
+	try {
+		boost::asio::io_service ios;
+		tcp::socket client(ios);
+		client.connect(tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), port));
+
+		unsigned char reply = 0;
+		boost::asio::read(client, boost::asio::buffer(&reply, 1));
+		return reply == 0x2a;
+	} catch (const boost::system::system_error& e) {
+		std::cerr << "[PortRangeBench] port " << port << ": " << e.what() << std::endl;
+		return false;
+	}
+}
+
+uint64_t PortRangeBench::read_rss_kb()
+{
+	std::ifstream status("/proc/self/status");
+	std::string line;
+
+	while (std::getline(status, line)) {
+		if (line.compare(0, 6, "VmRSS:") == 0) {
+			std::istringstream value(line.substr(6));
+			uint64_t kb = 0;
+			value >> kb;
+			return kb;
+		}
+	}
+
+	return 0;
+}
+
+uint64_t PortRangeBench::read_heap_bytes()
+{
+	// RSS does not grow when a run reuses heap freed by the previous one, bytes in use do
+	return static_cast<uint64_t>(::mallinfo2().uordblks);
+}
+
+uint64_t PortRangeBench::raise_descriptor_limit()
+{
+	rlimit limit;
+	if (::getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+		return 0;
+	}
+
+	// every listener holds one descriptor, the soft limit is usually far below 60k
+	limit.rlim_cur = limit.rlim_max;
+	::setrlimit(RLIMIT_NOFILE, &limit);
+	::getrlimit(RLIMIT_NOFILE, &limit);
+
+	return static_cast<uint64_t>(limit.rlim_cur);
+}
+
+int main(int argc, char* argv[])
+{
+	PortRangeBenchSettings settings;
+	settings.first_port = (argc > 1) ? boost::lexical_cast<uint16_t>(argv[1]) : 4000;
+	settings.backend_port = (argc > 2) ? boost::lexical_cast<uint16_t>(argv[2]) : 3999;
+
+	for (int i = 3; i < argc; ++i) {
+		settings.num_of_ports.push_back(boost::lexical_cast<uint32_t>(argv[i]));
+	}
+
+	if (settings.num_of_ports.empty()) {
+		settings.num_of_ports = { 10000, 20000, 40000, 60000 };
+	}
+
+	if (settings.first_port == 0) {
+		std::cerr << "[PortRangeBench] Usage: " << argv[0] << " [first_port] [backend_port] [num_of_ports...]" << std::endl;
+		return 1;
+	}
+
+	PortRangeBench bench(argc, argv, settings);
+	return bench.run();
+}
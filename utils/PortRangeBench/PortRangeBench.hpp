@@ -0,0 +1,70 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file utils/PortRangeBench/PortRangeBench.hpp
+ *
+ * @desc Benchmark measuring startup time and memory of listeners forwarding large port ranges.
+ */
+
+#ifndef MCT_UTILS_PORTRANGEBENCH_PORTRANGEBENCH_HPP
+#define MCT_UTILS_PORTRANGEBENCH_PORTRANGEBENCH_HPP
+
+#include <vector>
+#include <cstdint>
+
+struct PortRangeBenchSettings
+{
+	uint16_t first_port;
+	uint16_t backend_port;
+	std::vector<uint32_t> num_of_ports;
+};
+
+/**
+ * Starts one listener per port in-process, either all sharing the route of a single port range rule or each
+ * with a route of its own (as when every port is configured separately). Memory is the RSS and heap growth of
+ * the process per listener - kernel socket memory is not included. A few ports of every range are checked to
+ * actually forward to the backend.
+ */
+class PortRangeBench
+{
+public:
+	PortRangeBench(int argc, char** argv, const PortRangeBenchSettings& settings);
+
+	int run();
+
+protected:
+	bool run_listeners(uint32_t num_of_ports, bool is_route_shared);
+	bool probe_port(uint16_t port) const;
+
+	static uint64_t read_rss_kb();
+	static uint64_t read_heap_bytes();
+	static uint64_t raise_descriptor_limit();
+
+private:
+	int m_argc;
+	char** m_argv;
+	const PortRangeBenchSettings m_settings;
+};
+
+#endif // MCT_UTILS_PORTRANGEBENCH_PORTRANGEBENCH_HPP
@@ -0,0 +1,301 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file utils/SessionBench/SessionBench.cpp
+ *
+ * @desc Benchmark comparing throughput and per-session memory of the proxy session engines.
+ *
+ * Throughput: several streams push data through the proxy to the echo backend and read it back (each byte
+ * crosses the proxy twice). Memory: RSS growth per idle, established session.
+ */
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/log/core/core.hpp>
+#include <boost/log/attributes/attribute_set.hpp>
+
+#include <Logger/Logger.hpp>
+#include <Configuration/Configuration.hpp>
+#include <ModeProxy/Proxy.hpp>
+#include <ModeProxy/CoroutineProxy.hpp>
+#include <ModeProxy/ProxyListener.hpp>
+
+#include "SessionBench.hpp"
+
+using boost::asio::ip::tcp;
+
+namespace
+{
+
+class EchoSession : public std::enable_shared_from_this<EchoSession>
+{
+public:
+	EchoSession(boost::asio::io_service& ios) : m_socket(ios) {}
+
+	tcp::socket& get_socket() { return m_socket; }
+
+	void async_read()
+	{
+		m_socket.async_read_some(boost::asio::buffer(m_data, sizeof(m_data)),
+			std::bind(&EchoSession::handle_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+	}
+
+protected:
+	void handle_read(const boost::system::error_code& error, size_t bytes_transferred)
+	{
+		if (error) {
+			return;
+		}
+
+		boost::asio::async_write(m_socket, boost::asio::buffer(m_data, bytes_transferred),
+			std::bind(&EchoSession::handle_write, shared_from_this(), std::placeholders::_1));
+	}
+
+	void handle_write(const boost::system::error_code& error)
+	{
+		if (!error) {
+			async_read();
+		}
+	}
+
+private:
+	tcp::socket m_socket;
+	unsigned char m_data[16384];
+};
+
+class EchoBackend
+{
+public:
+	EchoBackend(uint16_t port) : m_acceptor(m_ios, tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), port))
+	{
+		async_accept();
+		m_thread = std::thread([this]() { m_ios.run(); });
+	}
+
+	~EchoBackend()
+	{
+		m_ios.stop();
+		m_thread.join();
+	}
+
+protected:
+	void async_accept()
+	{
+		auto session = std::make_shared<EchoSession>(m_ios);
+
+		m_acceptor.async_accept(session->get_socket(), [this, session](const boost::system::error_code& error) {
+			if (!error) {
+				session->get_socket().set_option(tcp::no_delay(true));
+				session->async_read();
+			}
+
+			async_accept();
+		});
+	}
+
+private:
+	boost::asio::io_service m_ios;
+	tcp::acceptor m_acceptor;
+	std::thread m_thread;
+};
+
+}
+
+SessionBench::SessionBench(int argc, char** argv, const SessionBenchSettings& settings)
+ : m_argc(argc), m_argv(argv), m_settings(settings)
+{
+}
+
+int SessionBench::run()
+{
+	std::cout << "[SessionBench] " << m_settings.idle_sessions << " idle sessions, " << m_settings.streams << " streams of "
+	          << m_settings.bytes_per_stream << " bytes through 127.0.0.1:" << m_settings.listen_port << std::endl;
+
+	bool is_ok = run_engine("callback", mct::ListenerOptions::callback_engine, sizeof(mct::Proxy));
+	is_ok = run_engine("coroutine", mct::ListenerOptions::coroutine_engine, sizeof(mct::CoroutineProxy)) && is_ok;
+
+	return is_ok ? 0 : 1;
+}
+
+bool SessionBench::run_engine(const std::string& name, mct::ListenerOptions::session_engine_type engine, size_t session_size)
+{
+	double kb_per_session = 0.0;
+	double throughput_mb = 0.0;
+
+	{
+		mct::Configuration config(m_argc, m_argv);
+		config.set_log_silent(true);
+		config.set_log_nofile(true);
+		config.set_log_severity_console("fatal");
+
+		mct::Logger logger(config);
+		std::string msg;
+
+		if (!logger.initialize(msg)) {
+			std::cerr << "[SessionBench] " << name << ": cannot initialize logger: " << msg << std::endl;
+			return false;
+		}
+
+		EchoBackend backend(m_settings.backend_port);
+
+		mct::ListenerOptions options;
+		options.session_engine = engine;
+		// request/response streams would otherwise measure delayed acknowledgements instead of the engine
+		options.socket_options.tcp_nodelay = 1;
+
+		boost::asio::io_service proxy_ios;
+		auto listener = std::make_shared<mct::ProxyListener>(proxy_ios, logger, "127.0.0.1", m_settings.listen_port, "127.0.0.1", m_settings.backend_port, options);
+		listener->async_listen();
+		std::thread proxy_thread([&proxy_ios]() { proxy_ios.run(); });
+
+		try {
+			kb_per_session = measure_kb_per_session();
+			throughput_mb = measure_throughput_mb();
+		} catch (const boost::system::system_error& e) {
+			std::cerr << "[SessionBench] " << name << ": " << e.what() << std::endl;
+		}
+
+		listener->stop();
+		listener->close_sessions();
+		proxy_ios.stop();
+		proxy_thread.join();
+	}
+
+	// Logger registers its sinks in the global logging core, drop them before the next engine
+	boost::log::core::get()->remove_all_sinks();
+	boost::log::core::get()->get_global_attributes().clear();
+
+	std::cout << "[SessionBench] " << name << ": " << throughput_mb << " MB/s, " << kb_per_session << " kB RSS per session, sizeof(session): "
+	          << session_size << " bytes" << std::endl;
+
+	return throughput_mb > 0.0;
+}
+
+double SessionBench::measure_kb_per_session() const
+{
+	boost::asio::io_service ios;
+	tcp::endpoint endpoint(boost::asio::ip::address::from_string("127.0.0.1"), m_settings.listen_port);
+	std::vector< std::unique_ptr<tcp::socket> > clients;
+
+	const uint64_t rss_before = read_rss_kb();
+
+	// a byte echoed through every session proves it is established (remote side connected, both pumps running)
+	for (uint32_t i = 0; i < m_settings.idle_sessions; ++i) {
+		unsigned char probe = 0x2a;
+		clients.emplace_back(new tcp::socket(ios));
+		clients.back()->connect(endpoint);
+		boost::asio::write(*clients.back(), boost::asio::buffer(&probe, 1));
+		boost::asio::read(*clients.back(), boost::asio::buffer(&probe, 1));
+	}
+
+	const uint64_t rss_after = read_rss_kb();
+
+	return (m_settings.idle_sessions > 0) ? static_cast<double>(rss_after - rss_before) / m_settings.idle_sessions : 0.0;
+}
+
+double SessionBench::measure_throughput_mb() const
+{
+	tcp::endpoint endpoint(boost::asio::ip::address::from_string("127.0.0.1"), m_settings.listen_port);
+
+	auto stream = [&]() {
+		boost::asio::io_service ios;
+		tcp::socket socket(ios);
+		socket.connect(endpoint);
+		socket.set_option(tcp::no_delay(true));
+
+		std::vector<unsigned char> data(65536, 0x5a);
+		uint64_t sent = 0;
+
+		while (sent < m_settings.bytes_per_stream) {
+			size_t length = static_cast<size_t>((std::min)(static_cast<uint64_t>(data.size()), m_settings.bytes_per_stream - sent));
+			boost::asio::write(socket, boost::asio::buffer(data.data(), length));
+			boost::asio::read(socket, boost::asio::buffer(data.data(), length));
+			sent += length;
+		}
+	};
+
+	auto started = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> streams;
+	for (uint32_t i = 0; i < m_settings.streams; ++i) {
+		streams.push_back(std::thread(stream));
+	}
+
+	for (auto& s : streams) {
+		s.join();
+	}
+
+	const double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	const double total_mb = 2.0 * m_settings.streams * m_settings.bytes_per_stream / (1024.0 * 1024.0);
+
+	return (elapsed_seconds > 0.0) ? total_mb / elapsed_seconds : 0.0;
+}
+
+uint64_t SessionBench::read_rss_kb()
+{
+	std::ifstream status("/proc/self/status");
+	std::string line;
+
+	while (std::getline(status, line)) {
+		if (line.compare(0, 6, "VmRSS:") == 0) {
+			std::istringstream value(line.substr(6));
+			uint64_t kb = 0;
+			value >> kb;
+			return kb;
+		}
+	}
+
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	SessionBenchSettings settings;
+	settings.listen_port = (argc > 1) ? boost::lexical_cast<uint16_t>(argv[1]) : 17401;
+	settings.backend_port = (argc > 2) ? boost::lexical_cast<uint16_t>(argv[2]) : 17402;
+	settings.idle_sessions = (argc > 3) ? boost::lexical_cast<uint32_t>(argv[3]) : 1000;
+	settings.streams = (argc > 4) ? boost::lexical_cast<uint32_t>(argv[4]) : 4;
+	settings.bytes_per_stream = (argc > 5) ? boost::lexical_cast<uint64_t>(argv[5]) : 268435456;
+
+	if (settings.streams == 0) {
+		std::cerr << "[SessionBench] Usage: " << argv[0] << " [listen_port] [backend_port] [idle_sessions] [streams] [bytes_per_stream]" << std::endl;
+		return 1;
+	}
+
+	SessionBench bench(argc, argv, settings);
+	return bench.run();
+}
@@ -0,0 +1,73 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2014 Mateusz Kolodziejski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file utils/SessionBench/SessionBench.hpp
+ *
+ * @desc Benchmark comparing throughput and per-session memory of the proxy session engines.
+ */
+
+#ifndef MCT_UTILS_SESSIONBENCH_SESSIONBENCH_HPP
+#define MCT_UTILS_SESSIONBENCH_SESSIONBENCH_HPP
+
+#include <string>
+#include <cstdint>
+
+#include <ModeProxy/ListenerOptions.hpp>
+
+struct SessionBenchSettings
+{
+	uint16_t listen_port;
+	uint16_t backend_port;
+	uint32_t idle_sessions;
+	uint32_t streams;
+	uint64_t bytes_per_stream;
+};
+
+/**
+ * Runs a ProxyListener in-process for every session engine, in front of an echo backend.
+ * Per-session memory is the RSS growth of the whole process while idle sessions are held open - clients
+ * and backend add the same amount for every engine, so the difference between engines is the engine's own.
+ */
+class SessionBench
+{
+public:
+	SessionBench(int argc, char** argv, const SessionBenchSettings& settings);
+
+	int run();
+
+protected:
+	bool run_engine(const std::string& name, mct::ListenerOptions::session_engine_type engine, size_t session_size);
+
+	double measure_kb_per_session() const;
+	double measure_throughput_mb() const;
+
+	static uint64_t read_rss_kb();
+
+private:
+	int m_argc;
+	char** m_argv;
+	const SessionBenchSettings m_settings;
+};
+
+#endif // MCT_UTILS_SESSIONBENCH_SESSIONBENCH_HPP